@@ -0,0 +1,183 @@
+#include "AssetPack.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+
+#include "Files/BinaryIO.hpp"
+#include "OS/FileIO.hpp"
+
+namespace {
+	constexpr uint64_t Blob_Alignment = 16;
+
+	uint64_t align(uint64_t x) noexcept {
+		return (x + Blob_Alignment - 1) & ~(Blob_Alignment - 1);
+	}
+
+	// Relative to the working directory and normalized, so "./res/../res/a.png" and the absolute
+	// path of the same file end up on the same entry.
+	std::string pack_name(const std::filesystem::path& path) noexcept {
+		auto relative = path;
+		if (path.is_absolute()) {
+			std::error_code ec;
+			auto working_directory = std::filesystem::current_path(ec);
+			if (!ec) relative = path.lexically_relative(working_directory);
+		}
+		return relative.lexically_normal().generic_string();
+	}
+
+	Asset_Pack Mounted_Pack;
+	std::atomic<bool> Loose_Assets_First{ false };
+};
+
+bool Asset_Pack::open(const std::filesystem::path& path) noexcept {
+	entries = nullptr;
+	count = 0;
+	names = nullptr;
+	if (!file.open(path)) return false;
+
+	auto fail = [&] {
+		file.close();
+		return false;
+	};
+
+	uint64_t size = file.size();
+	if (size < sizeof(Asset_Pack_Header)) return fail();
+
+	Asset_Pack_Header header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, Asset_Pack_Header{}.magic, sizeof(header.magic)) != 0) return fail();
+	if (header.version != Asset_Pack_Version) return fail();
+
+	uint64_t table_end = sizeof(header) + (uint64_t)header.entry_count * sizeof(Asset_Pack_Entry);
+	if (table_end > size) return fail();
+	if (header.names_offset < table_end || header.names_offset > size) return fail();
+	if (header.names_size > size - header.names_offset) return fail();
+
+	// Once this is checked find can trust every entry, and the binary search the order.
+	auto table = (const Asset_Pack_Entry*)(file.data() + sizeof(header));
+	for (size_t i = 0; i < header.entry_count; ++i) {
+		auto& entry = table[i];
+		if (i > 0 && entry.hash < table[i - 1].hash) return fail();
+		if (entry.offset > size || entry.size > size - entry.offset) return fail();
+		if ((uint64_t)entry.name_offset + entry.name_size > header.names_size) return fail();
+	}
+
+	entries = table;
+	count = header.entry_count;
+	names = (const char*)file.data() + header.names_offset;
+	return true;
+}
+
+std::optional<std::string_view> Asset_Pack::find(std::string_view name) const noexcept {
+	if (count == 0) return std::nullopt;
+
+	auto hash = stable_hash(name);
+	auto it = std::lower_bound(
+		entries, entries + count, hash, [](const Asset_Pack_Entry& entry, uint64_t hash) {
+			return entry.hash < hash;
+		}
+	);
+	// The names with the same hash are next to each other.
+	for (; it != entries + count && it->hash == hash; ++it) {
+		if (std::string_view{ names + it->name_offset, it->name_size } != name) continue;
+		return std::string_view{ (const char*)file.data() + it->offset, (size_t)it->size };
+	}
+	return std::nullopt;
+}
+
+bool write_asset_pack(
+	const std::filesystem::path& pack, const std::vector<std::filesystem::path>& files
+) noexcept {
+	struct Packed_File {
+		std::string name;
+		uint64_t hash;
+		std::vector<char> bytes;
+	};
+	std::vector<Packed_File> packed;
+	for (auto& path : files) {
+		auto bytes = read_whole_file(path);
+		if (!bytes) return false;
+
+		auto name = pack_name(path);
+		auto hash = stable_hash(name);
+		packed.push_back({ std::move(name), hash, std::move(*bytes) });
+	}
+
+	auto by_hash = [](const Packed_File& a, const Packed_File& b) {
+		return a.hash != b.hash ? a.hash < b.hash : a.name < b.name;
+	};
+	auto same_name = [](const Packed_File& a, const Packed_File& b) {
+		return a.name == b.name;
+	};
+	std::sort(std::begin(packed), std::end(packed), by_hash);
+	// The same file given twice.
+	packed.erase(std::unique(std::begin(packed), std::end(packed), same_name), std::end(packed));
+
+	Asset_Pack_Header header;
+	header.entry_count = (uint32_t)packed.size();
+
+	std::vector<Asset_Pack_Entry> entries(packed.size());
+	std::string names;
+	for (size_t i = 0; i < packed.size(); ++i) {
+		entries[i].hash = packed[i].hash;
+		entries[i].name_offset = (uint32_t)names.size();
+		entries[i].name_size = (uint32_t)packed[i].name.size();
+		names += packed[i].name;
+	}
+	header.names_offset = sizeof(header) + entries.size() * sizeof(Asset_Pack_Entry);
+	header.names_size = names.size();
+
+	// The + 1 is the zero byte after each file.
+	uint64_t offset = align(header.names_offset + header.names_size);
+	for (size_t i = 0; i < packed.size(); ++i) {
+		entries[i].offset = offset;
+		entries[i].size = packed[i].bytes.size();
+		offset = align(offset + entries[i].size + 1);
+	}
+
+	Writer writer;
+	writer.bytes.reserve((size_t)offset);
+	writer.pod(header);
+	for (auto& entry : entries) writer.pod(entry);
+	writer.bytes += names;
+	for (size_t i = 0; i < packed.size(); ++i) {
+		writer.bytes.resize((size_t)entries[i].offset, '\0');
+		writer.bytes.append(packed[i].bytes.data(), packed[i].bytes.size());
+	}
+	writer.bytes.resize((size_t)offset, '\0');
+
+	return overwrite_file(pack, writer.bytes) == 0;
+}
+
+bool mount_asset_pack(const std::filesystem::path& path) noexcept {
+	return Mounted_Pack.open(path);
+}
+
+void set_loose_assets_first(bool loose_first) noexcept {
+	Loose_Assets_First = loose_first;
+}
+
+std::optional<std::string_view> find_packed_asset(const std::filesystem::path& path) noexcept {
+	if (!Mounted_Pack.is_open()) return std::nullopt;
+
+	std::error_code ec;
+	if (Loose_Assets_First && std::filesystem::is_regular_file(path, ec)) return std::nullopt;
+
+	return Mounted_Pack.find(pack_name(path));
+}
+
+std::optional<Asset_Bytes> read_asset(const std::filesystem::path& path) noexcept {
+	Asset_Bytes asset;
+	if (auto packed = find_packed_asset(path)) {
+		asset.packed_bytes = *packed;
+		return asset;
+	}
+
+	auto loose = read_whole_file(path);
+	if (!loose) return std::nullopt;
+
+	asset.loose = std::move(*loose);
+	return asset;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "OS/MappedFile.hpp"
+
+// Every file of res/ in a single one, so starting up is one mapping instead of hundreds of
+// opens and reads. Made by write_asset_pack (Infographie --pack-assets), mounted once at startup
+// by Assets_Manager::mount_pack, then every asset read goes through read_asset.
+//
+// Layout, little endian:
+//   Asset_Pack_Header
+//   Asset_Pack_Entry * entry_count, sorted by hash
+//   the names, back to back
+//   the files, each at a 16 bytes aligned offset from the start of the pack and followed by at
+//   least one zero byte, the text parsers can sscanf the end of a file safely.
+
+constexpr char Asset_Pack_Extension[] = ".igpack";
+constexpr uint32_t Asset_Pack_Version = 1;
+
+struct Asset_Pack_Header {
+	char magic[4]{ 'I', 'G', 'P', 'K' };
+	uint32_t version{ Asset_Pack_Version };
+	uint32_t entry_count{ 0 };
+	uint32_t padding{ 0 };
+	uint64_t names_offset{ 0 };
+	uint64_t names_size{ 0 };
+};
+static_assert(sizeof(Asset_Pack_Header) == 32);
+
+struct Asset_Pack_Entry {
+	// stable_hash of the name.
+	uint64_t hash{ 0 };
+	uint64_t offset{ 0 };
+	uint64_t size{ 0 };
+	// In the names.
+	uint32_t name_offset{ 0 };
+	uint32_t name_size{ 0 };
+};
+static_assert(sizeof(Asset_Pack_Entry) == 32);
+
+class Asset_Pack {
+public:
+	// Maps the pack and checks that the whole table of contents lies in it. Nothing else is
+	// read, the files are paged in when they are used.
+	bool open(const std::filesystem::path& path) noexcept;
+
+	// name is relative to the working directory, '/' separated ("res/white.png").
+	std::optional<std::string_view> find(std::string_view name) const noexcept;
+
+	bool is_open() const noexcept { return file.is_open(); }
+	size_t entry_count() const noexcept { return count; }
+
+private:
+	Mapped_File file;
+	const Asset_Pack_Entry* entries{ nullptr };
+	size_t count{ 0 };
+	const char* names{ nullptr };
+};
+
+// files are relative to the working directory, that's how they'll be looked up. False if one of
+// them can't be read or the pack can't be written.
+bool write_asset_pack(
+	const std::filesystem::path& pack, const std::vector<std::filesystem::path>& files
+) noexcept;
+
+// The pack read_asset looks into. Main thread, before anything is loaded, it stays mounted (and
+// what it gave stays valid) until the end.
+bool mount_asset_pack(const std::filesystem::path& path) noexcept;
+
+// Normally we take a file from the pack if it's there and only read the loose one otherwise.
+// When we hot reload it's the loose files that are being edited, so they come first.
+void set_loose_assets_first(bool loose_first) noexcept;
+
+// A file either in the pack (nothing copied, it points in the mapping) or read from the disk.
+// Move only, a copy of a loose file would be a copy of all of it.
+struct Asset_Bytes {
+	Asset_Bytes() noexcept = default;
+	Asset_Bytes(const Asset_Bytes&) = delete;
+	Asset_Bytes& operator=(const Asset_Bytes&) = delete;
+	Asset_Bytes(Asset_Bytes&&) noexcept = default;
+	Asset_Bytes& operator=(Asset_Bytes&&) noexcept = default;
+
+	// Only one of them is set. Nothing points in loose, so it can move around.
+	std::vector<char> loose;
+	std::string_view packed_bytes;
+
+	bool packed() const noexcept { return !packed_bytes.empty(); }
+	const char* data() const noexcept { return packed() ? packed_bytes.data() : loose.data(); }
+	size_t size() const noexcept { return packed() ? packed_bytes.size() : loose.size(); }
+	std::string_view view() const noexcept { return { data(), size() }; }
+};
+
+// Only the pack, nullopt if it doesn't have path (or if the loose file comes first and exists).
+std::optional<std::string_view> find_packed_asset(const std::filesystem::path& path) noexcept;
+
+// The pack, then the disk.
+std::optional<Asset_Bytes> read_asset(const std::filesystem::path& path) noexcept;
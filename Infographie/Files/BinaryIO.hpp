@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// What the on disk caches need: raw pod dumps and a stamp of the source file to know when they
+// are stale.
+
+struct Source_Stamp {
+	uint64_t size{ 0 };
+	int64_t time{ 0 };
+};
+
+inline std::optional<Source_Stamp> stamp(const std::filesystem::path& source) noexcept {
+	std::error_code ec;
+	Source_Stamp s;
+	s.size = (uint64_t)std::filesystem::file_size(source, ec);
+	if (ec) return std::nullopt;
+	s.time = (int64_t)std::filesystem::last_write_time(source, ec).time_since_epoch().count();
+	if (ec) return std::nullopt;
+	return s;
+}
+
+// FNV-1a, std::hash isn't guaranteed to be the same from one run to another.
+inline uint64_t stable_hash(
+	std::string_view bytes, uint64_t hash = 14695981039346656037ull
+) noexcept {
+	for (auto c : bytes) {
+		hash ^= (uint8_t)c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+struct Writer {
+	std::string bytes;
+
+	template<typename T>
+	void pod(const T& x) noexcept {
+		static_assert(std::is_trivially_copyable_v<T>);
+		bytes.append((const char*)&x, sizeof(T));
+	}
+
+	template<typename T>
+	void array(const std::vector<T>& x) noexcept {
+		static_assert(std::is_trivially_copyable_v<T>);
+		pod((uint64_t)x.size());
+		bytes.append((const char*)x.data(), x.size() * sizeof(T));
+	}
+};
+
+struct Reader {
+	const std::vector<char>& bytes;
+	size_t cursor{ 0 };
+
+	template<typename T>
+	bool pod(T& x) noexcept {
+		static_assert(std::is_trivially_copyable_v<T>);
+		if (bytes.size() - cursor < sizeof(T)) return false;
+		memcpy(&x, bytes.data() + cursor, sizeof(T));
+		cursor += sizeof(T);
+		return true;
+	}
+
+	template<typename T>
+	bool array(std::vector<T>& x) noexcept {
+		static_assert(std::is_trivially_copyable_v<T>);
+		uint64_t size;
+		if (!pod(size)) return false;
+		if ((bytes.size() - cursor) / sizeof(T) < size) return false;
+		x.resize((size_t)size);
+		memcpy(x.data(), bytes.data() + cursor, (size_t)size * sizeof(T));
+		cursor += (size_t)size * sizeof(T);
+		return true;
+	}
+};
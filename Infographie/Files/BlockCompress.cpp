@@ -0,0 +1,1223 @@
+#include "BlockCompress.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+
+#include "Files/BinaryIO.hpp"
+#include "OS/FileIO.hpp"
+#include "Utils/Parallel.hpp"
+
+namespace {
+	constexpr char Magic[4] = { 'I', 'G', 'B', 'C' };
+	const std::filesystem::path Cache_Dir = "cache/blocks";
+
+	// 16 texels in reading order.
+	struct Block {
+		uint8_t texels[16][4];
+	};
+
+	void load_block(
+		const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, Block& block
+	) noexcept {
+		for (uint32_t y = 0; y < 4; ++y) {
+			uint32_t sy = std::min(by * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; ++x) {
+				uint32_t sx = std::min(bx * 4 + x, width - 1);
+				memcpy(block.texels[y * 4 + x], rgba + 4 * ((size_t)sy * width + sx), 4);
+			}
+		}
+	}
+
+	void store_block(
+		const Block& block, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t* rgba
+	) noexcept {
+		for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y) {
+			for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x) {
+				size_t i = (size_t)(by * 4 + y) * width + bx * 4 + x;
+				memcpy(rgba + 4 * i, block.texels[y * 4 + x], 4);
+			}
+		}
+	}
+
+	constexpr uint8_t All_Texels[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+	// Mean and main direction of the points (their first N channels), a few power iterations on
+	// the covariance are plenty for 16 points.
+	template<size_t N>
+	void principal_axis(
+		const float (*points)[4], const uint8_t* subset, size_t count, float* mean, float* axis
+	) noexcept {
+		for (size_t c = 0; c < N; ++c) mean[c] = 0;
+		for (size_t i = 0; i < count; ++i) {
+			for (size_t c = 0; c < N; ++c) mean[c] += points[subset[i]][c];
+		}
+		for (size_t c = 0; c < N; ++c) mean[c] /= count;
+
+		float covariance[N][N] = {};
+		for (size_t i = 0; i < count; ++i) {
+			float d[N];
+			for (size_t c = 0; c < N; ++c) d[c] = points[subset[i]][c] - mean[c];
+			for (size_t a = 0; a < N; ++a) for (size_t b = 0; b < N; ++b) {
+				covariance[a][b] += d[a] * d[b];
+			}
+		}
+
+		for (size_t c = 0; c < N; ++c) axis[c] = 1;
+		for (size_t iteration = 0; iteration < 8; ++iteration) {
+			float next[N] = {};
+			for (size_t a = 0; a < N; ++a) for (size_t b = 0; b < N; ++b) {
+				next[a] += covariance[a][b] * axis[b];
+			}
+			float length = 0;
+			for (size_t c = 0; c < N; ++c) length += next[c] * next[c];
+			// Every point is the same, any axis will do.
+			if (!(length > 1e-12f)) return;
+
+			length = std::sqrt(length);
+			for (size_t c = 0; c < N; ++c) axis[c] = next[c] / length;
+		}
+	}
+
+	// The extremes of the points along the axis.
+	template<size_t N>
+	void fit_endpoints(
+		const float (*points)[4],
+		const uint8_t* subset,
+		size_t count,
+		const float* mean,
+		const float* axis,
+		float* e0,
+		float* e1
+	) noexcept {
+		float min = INFINITY;
+		float max = -INFINITY;
+		for (size_t i = 0; i < count; ++i) {
+			float t = 0;
+			for (size_t c = 0; c < N; ++c) t += (points[subset[i]][c] - mean[c]) * axis[c];
+			min = std::min(min, t);
+			max = std::max(max, t);
+		}
+		for (size_t c = 0; c < N; ++c) {
+			e0[c] = std::clamp(mean[c] + min * axis[c], 0.f, 255.f);
+			e1[c] = std::clamp(mean[c] + max * axis[c], 0.f, 255.f);
+		}
+	}
+
+	// Nearest palette entry for every point, gives back the total squared error.
+	template<size_t N>
+	float assign_indices(
+		const float (*points)[4],
+		const uint8_t* subset,
+		size_t count,
+		const int (*palette)[4],
+		size_t palette_size,
+		uint8_t* indices
+	) noexcept {
+		float error = 0;
+		for (size_t i = 0; i < count; ++i) {
+			auto& p = points[subset[i]];
+			float best = INFINITY;
+			for (size_t k = 0; k < palette_size; ++k) {
+				float d = 0;
+				for (size_t c = 0; c < N; ++c) d += (p[c] - palette[k][c]) * (p[c] - palette[k][c]);
+				if (d < best) {
+					best = d;
+					indices[subset[i]] = (uint8_t)k;
+				}
+			}
+			error += best;
+		}
+		return error;
+	}
+
+	// With the indices fixed, the endpoints minimizing the error. weights[k] is how far palette
+	// entry k is from e0 toward e1.
+	template<size_t N>
+	bool least_squares(
+		const float (*points)[4],
+		const uint8_t* subset,
+		size_t count,
+		const uint8_t* indices,
+		const float* weights,
+		float* e0,
+		float* e1
+	) noexcept {
+		float aa = 0;
+		float ab = 0;
+		float bb = 0;
+		float ax[N] = {};
+		float bx[N] = {};
+		for (size_t i = 0; i < count; ++i) {
+			float b = weights[indices[subset[i]]];
+			float a = 1 - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (size_t c = 0; c < N; ++c) {
+				ax[c] += a * points[subset[i]][c];
+				bx[c] += b * points[subset[i]][c];
+			}
+		}
+
+		float det = aa * bb - ab * ab;
+		if (std::abs(det) < 1e-6f) return false;
+		for (size_t c = 0; c < N; ++c) {
+			e0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.f, 255.f);
+			e1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.f, 255.f);
+		}
+		return true;
+	}
+
+	size_t refine_iterations(Block_Quality quality) noexcept {
+		switch (quality) {
+		case Block_Quality::Fast: return 0;
+		case Block_Quality::Normal: return 1;
+		default: return 3;
+		}
+	}
+
+	// BC1 ////////////////////////////////////////////////////////////////////////////////////////
+
+	uint16_t to_565(const float* c) noexcept {
+		auto q = [](float x, int max) {
+			return std::clamp((int)std::lround(x * max / 255), 0, max);
+		};
+		return (uint16_t)((q(c[0], 31) << 11) | (q(c[1], 63) << 5) | q(c[2], 31));
+	}
+
+	// Four colors, or three and a transparent black when c0 <= c1 (only BC1 has that mode).
+	void color_palette(uint16_t c0, uint16_t c1, bool three_colors, int (*palette)[4]) noexcept {
+		for (size_t k = 0; k < 2; ++k) {
+			uint16_t v = k == 0 ? c0 : c1;
+			int r = (v >> 11) & 31;
+			int g = (v >> 5) & 63;
+			int b = v & 31;
+			palette[k][0] = (r << 3) | (r >> 2);
+			palette[k][1] = (g << 2) | (g >> 4);
+			palette[k][2] = (b << 3) | (b >> 2);
+			palette[k][3] = 255;
+		}
+		for (size_t c = 0; c < 4; ++c) {
+			if (three_colors) {
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+			else {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+		}
+	}
+
+	struct Single_Color_Fit {
+		uint8_t e0{ 0 };
+		uint8_t e1{ 0 };
+	};
+
+	// For every 8 bit value, the two endpoints on bits whose palette entry 2 (2 * e0 + e1) / 3 is
+	// the closest to it, the same thing as stb_dxt's tables but against our palette. Among the
+	// closest, the endpoints closest to each other, decoders don't all round the mix the same.
+	std::array<Single_Color_Fit, 256> single_color_fits(int bits) noexcept {
+		int max = (1 << bits) - 1;
+		auto widen = [&](int x) { return (x << (8 - bits)) | (x >> (2 * bits - 8)); };
+
+		std::array<Single_Color_Fit, 256> fits;
+		for (int v = 0; v < 256; ++v) {
+			int best_error = INT32_MAX;
+			int best_spread = INT32_MAX;
+			for (int e0 = 0; e0 <= max; ++e0) for (int e1 = 0; e1 <= max; ++e1) {
+				int error = std::abs((2 * widen(e0) + widen(e1)) / 3 - v);
+				int spread = std::abs(widen(e0) - widen(e1));
+				if (error > best_error || (error == best_error && spread >= best_spread)) continue;
+
+				best_error = error;
+				best_spread = spread;
+				fits[v] = { (uint8_t)e0, (uint8_t)e1 };
+			}
+		}
+		return fits;
+	}
+
+	// The principal axis, then refined by least squares.
+	void fit_color(
+		const Block& block,
+		Block_Quality quality,
+		uint16_t& best0,
+		uint16_t& best1,
+		uint8_t* best_indices
+	) noexcept {
+		constexpr float Weights[4] = { 0, 1, 1 / 3.f, 2 / 3.f };
+
+		float points[16][4];
+		for (size_t i = 0; i < 16; ++i) for (size_t c = 0; c < 4; ++c) {
+			points[i][c] = block.texels[i][c];
+		}
+
+		float mean[3];
+		float axis[3];
+		float e0[3];
+		float e1[3];
+		principal_axis<3>(points, All_Texels, 16, mean, axis);
+		fit_endpoints<3>(points, All_Texels, 16, mean, axis, e0, e1);
+
+		float best_error = INFINITY;
+		auto attempt = [&](const float* a, const float* b) {
+			uint16_t c0 = to_565(a);
+			uint16_t c1 = to_565(b);
+			int palette[4][4];
+			color_palette(c0, c1, false, palette);
+
+			uint8_t indices[16];
+			float error = assign_indices<3>(points, All_Texels, 16, palette, 4, indices);
+			if (error >= best_error) return false;
+
+			best_error = error;
+			best0 = c0;
+			best1 = c1;
+			memcpy(best_indices, indices, sizeof(indices));
+			return true;
+		};
+		attempt(e0, e1);
+
+		for (size_t i = 0; i < refine_iterations(quality); ++i) {
+			if (!least_squares<3>(points, All_Texels, 16, best_indices, Weights, e0, e1)) break;
+			if (!attempt(e0, e1)) break;
+		}
+	}
+
+	// Always in the four colors mode, that's the only one BC3 knows.
+	void encode_color(const Block& block, Block_Quality quality, uint8_t* out) noexcept {
+		uint16_t best0 = 0;
+		uint16_t best1 = 0;
+		uint8_t best_indices[16] = {};
+
+		bool single_color = true;
+		for (auto& t : block.texels) single_color &= memcmp(t, block.texels[0], 3) == 0;
+
+		// The principal axis has nothing to go by there and lands a few levels off, the tables
+		// give the closest we can get with every texel on entry 2.
+		if (single_color) {
+			static const auto Fits_5 = single_color_fits(5);
+			static const auto Fits_6 = single_color_fits(6);
+			auto& r = Fits_5[block.texels[0][0]];
+			auto& g = Fits_6[block.texels[0][1]];
+			auto& b = Fits_5[block.texels[0][2]];
+			best0 = (uint16_t)((r.e0 << 11) | (g.e0 << 5) | b.e0);
+			best1 = (uint16_t)((r.e1 << 11) | (g.e1 << 5) | b.e1);
+			memset(best_indices, 2, sizeof(best_indices));
+		}
+		else {
+			fit_color(block, quality, best0, best1, best_indices);
+		}
+
+		// c0 > c1 is what tells BC1 it's the four colors mode, swapping the endpoints swaps the
+		// indices 0 <-> 1 and 2 <-> 3.
+		if (best0 < best1) {
+			std::swap(best0, best1);
+			for (auto& i : best_indices) i ^= 1;
+		}
+		// And when they are the same it's the three colors one, where only 0 is still c0.
+		if (best0 == best1) memset(best_indices, 0, sizeof(best_indices));
+
+		uint32_t bits = 0;
+		for (size_t i = 0; i < 16; ++i) bits |= (uint32_t)best_indices[i] << (2 * i);
+		memcpy(out + 0, &best0, 2);
+		memcpy(out + 2, &best1, 2);
+		memcpy(out + 4, &bits, 4);
+	}
+
+	void decode_color(const uint8_t* in, bool allow_three_colors, Block& block) noexcept {
+		uint16_t c0;
+		uint16_t c1;
+		uint32_t bits;
+		memcpy(&c0, in + 0, 2);
+		memcpy(&c1, in + 2, 2);
+		memcpy(&bits, in + 4, 4);
+
+		int palette[4][4];
+		color_palette(c0, c1, allow_three_colors && c0 <= c1, palette);
+		for (size_t i = 0; i < 16; ++i) {
+			auto& p = palette[(bits >> (2 * i)) & 3];
+			for (size_t c = 0; c < 4; ++c) block.texels[i][c] = (uint8_t)p[c];
+		}
+	}
+
+	// BC4 ////////////////////////////////////////////////////////////////////////////////////////
+
+	// Only the eight values mode (a0 > a1), the other one is for blocks mixing 0 and 255 with
+	// something in between which we don't bother with.
+	void alpha_palette(int a0, int a1, int* palette) noexcept {
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1) {
+			for (int i = 2; i < 8; ++i) palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+		}
+		else {
+			for (int i = 2; i < 6; ++i) palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	void encode_channel(
+		const Block& block, size_t channel, Block_Quality quality, uint8_t* out
+	) noexcept {
+		int lo = 255;
+		int hi = 0;
+		for (auto& t : block.texels) {
+			lo = std::min(lo, (int)t[channel]);
+			hi = std::max(hi, (int)t[channel]);
+		}
+
+		memset(out, 0, 8);
+		out[0] = (uint8_t)hi;
+		out[1] = (uint8_t)lo;
+		if (lo == hi) return;
+
+		// Pulling the endpoints in a bit can land more values right on a palette entry.
+		int inset = quality == Block_Quality::Fast ? 0 : (quality == Block_Quality::Normal ? 1 : 3);
+		uint64_t best_bits = 0;
+		int best_error = INT32_MAX;
+		for (int d0 = 0; d0 <= inset; ++d0) for (int d1 = 0; d1 <= inset; ++d1) {
+			int a0 = hi - d0;
+			int a1 = lo + d1;
+			if (a0 <= a1) continue;
+
+			int palette[8];
+			alpha_palette(a0, a1, palette);
+
+			uint64_t bits = 0;
+			int error = 0;
+			for (size_t i = 0; i < 16; ++i) {
+				int v = block.texels[i][channel];
+				int best = INT32_MAX;
+				uint64_t index = 0;
+				for (size_t k = 0; k < 8; ++k) {
+					int d = (v - palette[k]) * (v - palette[k]);
+					if (d < best) {
+						best = d;
+						index = k;
+					}
+				}
+				error += best;
+				bits |= index << (3 * i);
+			}
+			if (error >= best_error) continue;
+
+			best_error = error;
+			best_bits = bits;
+			out[0] = (uint8_t)a0;
+			out[1] = (uint8_t)a1;
+		}
+		for (size_t i = 0; i < 6; ++i) out[2 + i] = (uint8_t)(best_bits >> (8 * i));
+	}
+
+	void decode_channel(const uint8_t* in, size_t channel, Block& block) noexcept {
+		int palette[8];
+		alpha_palette(in[0], in[1], palette);
+
+		uint64_t bits = 0;
+		for (size_t i = 0; i < 6; ++i) bits |= (uint64_t)in[2 + i] << (8 * i);
+		for (size_t i = 0; i < 16; ++i) {
+			block.texels[i][channel] = (uint8_t)palette[(bits >> (3 * i)) & 7];
+		}
+	}
+
+	// BC7 ////////////////////////////////////////////////////////////////////////////////////////
+
+	// We only use two modes of the eight. 6: one subset, RGBA endpoints on 7 bits + a p bit each,
+	// 4 bits indices. 1: two subsets picked from 64 partitions, RGB on 6 bits + a p bit shared by
+	// the two endpoints of the subset, 3 bits indices. 6 does most of the work, 1 is better on the
+	// opaque blocks with two distinct colors.
+	constexpr int Weights_3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	constexpr int Weights_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Bit i is the subset of texel i.
+	constexpr uint16_t Partitions_2[64] = {
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+		0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+		0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+		0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+		0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+	};
+
+	// The texel of the second subset whose index loses its top bit (the first is always texel 0).
+	constexpr uint8_t Anchors_2[64] = {
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+		15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+		 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+	};
+
+	struct Bit_Writer {
+		uint8_t* out;
+		size_t bit{ 0 };
+
+		void put(uint32_t value, size_t count) noexcept {
+			for (size_t i = 0; i < count; ++i, ++bit) {
+				if ((value >> i) & 1) out[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+			}
+		}
+	};
+
+	struct Bit_Reader {
+		const uint8_t* in;
+		size_t bit{ 0 };
+
+		uint32_t get(size_t count) noexcept {
+			uint32_t value = 0;
+			for (size_t i = 0; i < count; ++i, ++bit) {
+				value |= (uint32_t)((in[bit >> 3] >> (bit & 7)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	int interpolate(int e0, int e1, int weight) noexcept {
+		return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+	}
+
+	// bits + the p bit, widened to 8 bits by repeating the top bits.
+	int expand(int q, int p, int bits) noexcept {
+		int v = (q << 1) | p;
+		int total = bits + 1;
+		return total == 8 ? v : (v << (8 - total)) | (v >> (2 * total - 8));
+	}
+
+	// The closest value we can store on bits with this p bit, gives back the squared error.
+	template<size_t N>
+	float quantize(const float* e, int p, int bits, int* q, int* value) noexcept {
+		int max = (1 << bits) - 1;
+		float error = 0;
+		for (size_t c = 0; c < N; ++c) {
+			int guess = (int)std::lround((e[c] * ((1 << (bits + 1)) - 1) / 255 - p) / 2);
+			float best = INFINITY;
+			for (int candidate = guess - 1; candidate <= guess + 1; ++candidate) {
+				int x = std::clamp(candidate, 0, max);
+				float d = e[c] - expand(x, p, bits);
+				if (d * d < best) {
+					best = d * d;
+					q[c] = x;
+					value[c] = expand(x, p, bits);
+				}
+			}
+			error += best;
+		}
+		return error;
+	}
+
+	struct Mode_6 {
+		int q[2][4];
+		int p[2];
+		uint8_t indices[16];
+		float error{ INFINITY };
+	};
+
+	// An opaque block has to come back at exactly 255, the p bits are chosen for the rgb and a
+	// p bit of 0 caps the alpha at 254. So there we force both to 1 and the alpha to 127 << 1 | 1.
+	Mode_6 encode_mode_6(const float (*points)[4], bool opaque, Block_Quality quality) noexcept {
+		float weights[16];
+		for (size_t k = 0; k < 16; ++k) weights[k] = Weights_4[k] / 64.f;
+
+		float mean[4];
+		float axis[4];
+		float e[2][4];
+		principal_axis<4>(points, All_Texels, 16, mean, axis);
+		fit_endpoints<4>(points, All_Texels, 16, mean, axis, e[0], e[1]);
+
+		Mode_6 best;
+		auto attempt = [&](const float (*ends)[4]) {
+			Mode_6 m;
+			int value[2][4];
+			// In High we try every p bits pair on the whole block, otherwise each endpoint gets
+			// the one that fits it best.
+			bool every_pair = quality == Block_Quality::High && !opaque;
+			float block_error = INFINITY;
+			for (int pair = opaque ? 3 : 0; pair < 4; ++pair) {
+				int p[2] = { pair & 1, pair >> 1 };
+				int q[2][4];
+				int v[2][4];
+				if (!every_pair && !opaque) {
+					for (size_t k = 0; k < 2; ++k) {
+						int q0[4], v0[4], q1[4], v1[4];
+						float error0 = quantize<4>(ends[k], 0, 7, q0, v0);
+						float error1 = quantize<4>(ends[k], 1, 7, q1, v1);
+						p[k] = error1 < error0 ? 1 : 0;
+					}
+				}
+				for (size_t k = 0; k < 2; ++k) {
+					quantize<4>(ends[k], p[k], 7, q[k], v[k]);
+					if (!opaque) continue;
+					q[k][3] = 127;
+					v[k][3] = 255;
+				}
+
+				int palette[16][4];
+				for (size_t k = 0; k < 16; ++k) for (size_t c = 0; c < 4; ++c) {
+					palette[k][c] = interpolate(v[0][c], v[1][c], Weights_4[k]);
+				}
+				uint8_t indices[16];
+				float error = assign_indices<4>(points, All_Texels, 16, palette, 16, indices);
+				if (error < block_error) {
+					block_error = error;
+					memcpy(m.q, q, sizeof(q));
+					memcpy(value, v, sizeof(v));
+					m.p[0] = p[0];
+					m.p[1] = p[1];
+					memcpy(m.indices, indices, sizeof(indices));
+				}
+				if (!every_pair) break;
+			}
+			m.error = block_error;
+			if (m.error >= best.error) return false;
+			best = m;
+			return true;
+		};
+		attempt(e);
+
+		for (size_t i = 0; i < refine_iterations(quality); ++i) {
+			if (!least_squares<4>(points, All_Texels, 16, best.indices, weights, e[0], e[1])) break;
+			if (!attempt(e)) break;
+		}
+		return best;
+	}
+
+	struct Mode_1 {
+		uint32_t partition{ 0 };
+		int q[2][2][3];
+		int p[2];
+		uint8_t indices[16];
+		float error{ INFINITY };
+	};
+
+	// One subset of mode 1, its two endpoints share the p bit.
+	float encode_mode_1_subset(
+		const float (*points)[4],
+		const uint8_t* subset,
+		size_t count,
+		Block_Quality quality,
+		int (*q)[3],
+		int& p,
+		uint8_t* indices
+	) noexcept {
+		float weights[8];
+		for (size_t k = 0; k < 8; ++k) weights[k] = Weights_3[k] / 64.f;
+
+		float mean[3];
+		float axis[3];
+		float e[2][3];
+		principal_axis<3>(points, subset, count, mean, axis);
+		fit_endpoints<3>(points, subset, count, mean, axis, e[0], e[1]);
+
+		float best = INFINITY;
+		auto attempt = [&] {
+			int best_p = 0;
+			float best_fit = INFINITY;
+			int qs[2][2][3];
+			int vs[2][2][3];
+			for (int pb = 0; pb < 2; ++pb) {
+				float fit =
+					quantize<3>(e[0], pb, 6, qs[pb][0], vs[pb][0]) +
+					quantize<3>(e[1], pb, 6, qs[pb][1], vs[pb][1]);
+				if (fit < best_fit) {
+					best_fit = fit;
+					best_p = pb;
+				}
+			}
+
+			int palette[8][4];
+			for (size_t k = 0; k < 8; ++k) {
+				for (size_t c = 0; c < 3; ++c) {
+					palette[k][c] = interpolate(vs[best_p][0][c], vs[best_p][1][c], Weights_3[k]);
+				}
+				palette[k][3] = 255;
+			}
+			uint8_t candidate[16];
+			memcpy(candidate, indices, 16);
+			float error = assign_indices<3>(points, subset, count, palette, 8, candidate);
+			if (error >= best) return false;
+
+			best = error;
+			p = best_p;
+			memcpy(q, qs[best_p], sizeof(qs[best_p]));
+			memcpy(indices, candidate, 16);
+			return true;
+		};
+		attempt();
+
+		for (size_t i = 0; i < refine_iterations(quality); ++i) {
+			if (!least_squares<3>(points, subset, count, indices, weights, e[0], e[1])) break;
+			if (!attempt()) break;
+		}
+		return best;
+	}
+
+	// Trying the 64 partitions for real is too slow, we rank them by how well two unquantized
+	// principal axis fits do and only encode the best few.
+	Mode_1 encode_mode_1(const float (*points)[4], Block_Quality quality) noexcept {
+		constexpr size_t Tried = 4;
+
+		auto split = [](uint32_t partition, uint8_t (*subsets)[16], size_t* counts) {
+			counts[0] = counts[1] = 0;
+			for (uint8_t i = 0; i < 16; ++i) {
+				size_t s = (Partitions_2[partition] >> i) & 1;
+				subsets[s][counts[s]++] = i;
+			}
+		};
+
+		std::pair<float, uint32_t> ranking[64];
+		for (uint32_t partition = 0; partition < 64; ++partition) {
+			uint8_t subsets[2][16];
+			size_t counts[2];
+			split(partition, subsets, counts);
+
+			float estimate = 0;
+			for (size_t s = 0; s < 2; ++s) {
+				float mean[3];
+				float axis[3];
+				float e0[3];
+				float e1[3];
+				principal_axis<3>(points, subsets[s], counts[s], mean, axis);
+				fit_endpoints<3>(points, subsets[s], counts[s], mean, axis, e0, e1);
+
+				int palette[8][4];
+				for (size_t k = 0; k < 8; ++k) for (size_t c = 0; c < 3; ++c) {
+					palette[k][c] = (int)std::lround(e0[c] + (e1[c] - e0[c]) * Weights_3[k] / 64);
+				}
+				uint8_t indices[16];
+				estimate += assign_indices<3>(points, subsets[s], counts[s], palette, 8, indices);
+			}
+			ranking[partition] = { estimate, partition };
+		}
+		std::partial_sort(ranking, ranking + Tried, ranking + 64);
+
+		Mode_1 best;
+		for (size_t r = 0; r < Tried; ++r) {
+			Mode_1 m;
+			m.partition = ranking[r].second;
+			uint8_t subsets[2][16];
+			size_t counts[2];
+			split(m.partition, subsets, counts);
+
+			m.error = 0;
+			for (size_t s = 0; s < 2; ++s) {
+				m.error += encode_mode_1_subset(
+					points, subsets[s], counts[s], quality, m.q[s], m.p[s], m.indices
+				);
+			}
+			if (m.error < best.error) best = m;
+		}
+		return best;
+	}
+
+	void encode_bc7(const Block& block, Block_Quality quality, uint8_t* out) noexcept {
+		float points[16][4];
+		bool opaque = true;
+		for (size_t i = 0; i < 16; ++i) {
+			for (size_t c = 0; c < 4; ++c) points[i][c] = block.texels[i][c];
+			opaque &= block.texels[i][3] == 255;
+		}
+
+		memset(out, 0, 16);
+		Bit_Writer writer{ out };
+
+		auto m6 = encode_mode_6(points, opaque, quality);
+		std::optional<Mode_1> m1;
+		if (quality == Block_Quality::High && opaque && m6.error > 0) {
+			m1 = encode_mode_1(points, quality);
+			if (!(m1->error < m6.error)) m1.reset();
+		}
+
+		if (!m1) {
+			// The top bit of the first index is implied 0, if it's set we swap the endpoints.
+			if (m6.indices[0] & 8) {
+				std::swap(m6.q[0], m6.q[1]);
+				std::swap(m6.p[0], m6.p[1]);
+				for (auto& i : m6.indices) i = 15 - i;
+			}
+
+			writer.put(1 << 6, 7);
+			for (size_t c = 0; c < 4; ++c) {
+				writer.put(m6.q[0][c], 7);
+				writer.put(m6.q[1][c], 7);
+			}
+			writer.put(m6.p[0], 1);
+			writer.put(m6.p[1], 1);
+			for (size_t i = 0; i < 16; ++i) writer.put(m6.indices[i], i == 0 ? 3 : 4);
+			return;
+		}
+
+		// Same thing for both anchors.
+		uint16_t mask = Partitions_2[m1->partition];
+		size_t anchors[2] = { 0, Anchors_2[m1->partition] };
+		for (size_t s = 0; s < 2; ++s) {
+			if (!(m1->indices[anchors[s]] & 4)) continue;
+			std::swap(m1->q[s][0], m1->q[s][1]);
+			for (size_t i = 0; i < 16; ++i) {
+				if (((mask >> i) & 1) == s) m1->indices[i] = 7 - m1->indices[i];
+			}
+		}
+
+		writer.put(1 << 1, 2);
+		writer.put(m1->partition, 6);
+		for (size_t c = 0; c < 3; ++c) {
+			for (size_t s = 0; s < 2; ++s) {
+				writer.put(m1->q[s][0][c], 6);
+				writer.put(m1->q[s][1][c], 6);
+			}
+		}
+		writer.put(m1->p[0], 1);
+		writer.put(m1->p[1], 1);
+		for (size_t i = 0; i < 16; ++i) {
+			writer.put(m1->indices[i], (i == anchors[0] || i == anchors[1]) ? 2 : 3);
+		}
+	}
+
+	void decode_bc7(const uint8_t* in, Block& block) noexcept {
+		memset(&block, 0, sizeof(block));
+		Bit_Reader reader{ in };
+
+		size_t mode = 0;
+		while (mode < 8 && reader.get(1) == 0) mode++;
+
+		if (mode == 6) {
+			int q[2][4];
+			for (size_t c = 0; c < 4; ++c) {
+				q[0][c] = (int)reader.get(7);
+				q[1][c] = (int)reader.get(7);
+			}
+			int p0 = (int)reader.get(1);
+			int p1 = (int)reader.get(1);
+			for (size_t i = 0; i < 16; ++i) {
+				int index = (int)reader.get(i == 0 ? 3 : 4);
+				for (size_t c = 0; c < 4; ++c) {
+					int e0 = expand(q[0][c], p0, 7);
+					int e1 = expand(q[1][c], p1, 7);
+					block.texels[i][c] = (uint8_t)interpolate(e0, e1, Weights_4[index]);
+				}
+			}
+		}
+		else if (mode == 1) {
+			uint32_t partition = reader.get(6);
+			int q[2][2][3];
+			for (size_t c = 0; c < 3; ++c) {
+				for (size_t s = 0; s < 2; ++s) {
+					q[s][0][c] = (int)reader.get(6);
+					q[s][1][c] = (int)reader.get(6);
+				}
+			}
+			int p[2];
+			p[0] = (int)reader.get(1);
+			p[1] = (int)reader.get(1);
+			for (size_t i = 0; i < 16; ++i) {
+				bool anchor = i == 0 || i == Anchors_2[partition];
+				int index = (int)reader.get(anchor ? 2 : 3);
+				size_t s = (Partitions_2[partition] >> i) & 1;
+				for (size_t c = 0; c < 3; ++c) {
+					int e0 = expand(q[s][0][c], p[s], 6);
+					int e1 = expand(q[s][1][c], p[s], 6);
+					block.texels[i][c] = (uint8_t)interpolate(e0, e1, Weights_3[index]);
+				}
+				block.texels[i][3] = 255;
+			}
+		}
+	}
+
+	void encode_block(
+		const Block& block, Block_Format format, Block_Quality quality, uint8_t* out
+	) noexcept {
+		switch (format) {
+		case Block_Format::BC1:
+			encode_color(block, quality, out);
+			break;
+		case Block_Format::BC3:
+			encode_channel(block, 3, quality, out);
+			encode_color(block, quality, out + 8);
+			break;
+		case Block_Format::BC4:
+			encode_channel(block, 0, quality, out);
+			break;
+		case Block_Format::BC5:
+			encode_channel(block, 0, quality, out);
+			encode_channel(block, 1, quality, out + 8);
+			break;
+		case Block_Format::BC7:
+			encode_bc7(block, quality, out);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void decode_block(const uint8_t* in, Block_Format format, Block& block) noexcept {
+		// What a format doesn't store reads as 0, except alpha which is 1.
+		memset(&block, 0, sizeof(block));
+		for (auto& t : block.texels) t[3] = 255;
+
+		switch (format) {
+		case Block_Format::BC1:
+			decode_color(in, true, block);
+			break;
+		case Block_Format::BC3:
+			decode_color(in + 8, false, block);
+			decode_channel(in, 3, block);
+			break;
+		case Block_Format::BC4:
+			decode_channel(in, 0, block);
+			break;
+		case Block_Format::BC5:
+			decode_channel(in, 0, block);
+			decode_channel(in + 8, 1, block);
+			break;
+		case Block_Format::BC7:
+			decode_bc7(in, block);
+			break;
+		default:
+			break;
+		}
+	}
+
+	size_t channel_count(Block_Format format) noexcept {
+		switch (format) {
+		case Block_Format::BC1: return 3;
+		case Block_Format::BC4: return 1;
+		case Block_Format::BC5: return 2;
+		default: return 4;
+		}
+	}
+
+	std::filesystem::path cache_path(const std::filesystem::path& source, uint32_t key) noexcept {
+		std::error_code ec;
+		auto absolute = std::filesystem::absolute(source, ec).generic_string();
+
+		char name[64];
+		snprintf(
+			name, sizeof(name), "%016llx_%08x.bc", (unsigned long long)stable_hash(absolute), key
+		);
+		return Cache_Dir / name;
+	}
+
+	std::optional<Compressed_Texture> load_block_cache(
+		const std::filesystem::path& source, uint32_t key
+	) noexcept {
+		auto source_stamp = stamp(source);
+		if (!source_stamp) return std::nullopt;
+
+		auto path = cache_path(source, key);
+		if (!std::filesystem::is_regular_file(path)) return std::nullopt;
+
+		auto bytes = read_whole_file(path);
+		if (!bytes) return std::nullopt;
+
+		Reader reader{ *bytes };
+
+		char magic[4];
+		uint32_t version;
+		uint32_t cached_key;
+		Source_Stamp cached_stamp;
+		if (!reader.pod(magic) || memcmp(magic, Magic, sizeof(Magic)) != 0) return std::nullopt;
+		if (!reader.pod(version) || version != Block_Cache_Version) return std::nullopt;
+		if (!reader.pod(cached_key) || cached_key != key) return std::nullopt;
+		if (!reader.pod(cached_stamp.size) || cached_stamp.size != source_stamp->size)
+			return std::nullopt;
+		if (!reader.pod(cached_stamp.time) || cached_stamp.time != source_stamp->time)
+			return std::nullopt;
+
+		Compressed_Texture texture;
+		uint32_t count;
+		bool ok =
+			reader.pod(texture.format) &&
+			reader.pod(texture.psnr) &&
+			reader.pod(texture.texel_count) &&
+			reader.pod(count);
+		if (!ok || texture.format == Block_Format::None || texture.format >= Block_Format::Count)
+			return std::nullopt;
+
+		texture.levels.resize(count);
+		for (auto& level : texture.levels) {
+			ok =
+				reader.pod(level.width) &&
+				reader.pod(level.height) &&
+				reader.array(level.blocks);
+			auto size = compressed_size(texture.format, level.width, level.height);
+			if (!ok || level.blocks.size() != size) return std::nullopt;
+		}
+		return texture;
+	}
+
+	bool save_block_cache(
+		const std::filesystem::path& source, uint32_t key, const Compressed_Texture& texture
+	) noexcept {
+		auto source_stamp = stamp(source);
+		if (!source_stamp) return false;
+
+		std::error_code ec;
+		std::filesystem::create_directories(Cache_Dir, ec);
+		if (ec) return false;
+
+		Writer writer;
+		writer.pod(Magic);
+		writer.pod(Block_Cache_Version);
+		writer.pod(key);
+		writer.pod(source_stamp->size);
+		writer.pod(source_stamp->time);
+
+		writer.pod(texture.format);
+		writer.pod(texture.psnr);
+		writer.pod(texture.texel_count);
+		writer.pod((uint32_t)texture.levels.size());
+		for (auto& level : texture.levels) {
+			writer.pod(level.width);
+			writer.pod(level.height);
+			writer.array(level.blocks);
+		}
+
+		return overwrite_file(cache_path(source, key), writer.bytes) == 0;
+	}
+};
+
+uint32_t Block_Options::to_bits() const noexcept {
+	return (uint32_t)enabled | ((uint32_t)quality << 1) | ((uint32_t)normal_map << 3);
+}
+
+Block_Format pick_block_format(const Block_Options& options, bool has_alpha) noexcept {
+	if (!options.enabled) return Block_Format::None;
+	if (options.normal_map) return Block_Format::BC5;
+	if (options.quality == Block_Quality::High) return Block_Format::BC7;
+	return has_alpha ? Block_Format::BC3 : Block_Format::BC1;
+}
+
+size_t block_bytes(Block_Format format) noexcept {
+	switch (format) {
+	case Block_Format::BC1:
+	case Block_Format::BC4:
+		return 8;
+	case Block_Format::None:
+	case Block_Format::Count:
+		return 0;
+	default:
+		return 16;
+	}
+}
+
+size_t compressed_size(Block_Format format, uint32_t width, uint32_t height) noexcept {
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * block_bytes(format);
+}
+
+std::vector<uint8_t> compress_blocks(
+	const uint8_t* rgba,
+	uint32_t width,
+	uint32_t height,
+	Block_Format format,
+	Block_Quality quality
+) noexcept {
+	std::vector<uint8_t> blocks(compressed_size(format, width, height));
+	if (blocks.empty()) return blocks;
+
+	uint32_t blocks_x = (width + 3) / 4;
+	uint32_t blocks_y = (height + 3) / 4;
+	size_t bytes = block_bytes(format);
+
+	// A row of blocks is already a good chunk of work in BC7, less so in BC1.
+	parallel_for(blocks_y, [&](size_t begin, size_t end, size_t) {
+		Block block;
+		for (size_t by = begin; by < end; ++by) {
+			for (uint32_t bx = 0; bx < blocks_x; ++bx) {
+				load_block(rgba, width, height, bx, (uint32_t)by, block);
+				encode_block(block, format, quality, &blocks[(by * blocks_x + bx) * bytes]);
+			}
+		}
+	}, std::max((size_t)1, (size_t)256 / blocks_x));
+	return blocks;
+}
+
+std::vector<uint8_t> decompress_blocks(
+	const uint8_t* blocks, uint32_t width, uint32_t height, Block_Format format
+) noexcept {
+	std::vector<uint8_t> rgba((size_t)width * height * 4);
+	size_t bytes = block_bytes(format);
+	if (bytes == 0) return rgba;
+
+	uint32_t blocks_x = (width + 3) / 4;
+	uint32_t blocks_y = (height + 3) / 4;
+	parallel_for(blocks_y, [&](size_t begin, size_t end, size_t) {
+		Block block;
+		for (size_t by = begin; by < end; ++by) {
+			for (uint32_t bx = 0; bx < blocks_x; ++bx) {
+				decode_block(&blocks[(by * blocks_x + bx) * bytes], format, block);
+				store_block(block, width, height, bx, (uint32_t)by, rgba.data());
+			}
+		}
+	}, std::max((size_t)1, (size_t)1024 / blocks_x));
+	return rgba;
+}
+
+float compute_psnr(
+	const uint8_t* a, const uint8_t* b, uint32_t width, uint32_t height, Block_Format format
+) noexcept {
+	size_t channels = channel_count(format);
+	size_t n = (size_t)width * height;
+	if (n == 0) return INFINITY;
+
+	double error = 0;
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t c = 0; c < channels; ++c) {
+			double d = (double)a[4 * i + c] - b[4 * i + c];
+			error += d * d;
+		}
+	}
+	double mse = error / (n * channels);
+	if (mse == 0) return INFINITY;
+	return (float)(10 * std::log10(255.0 * 255.0 / mse));
+}
+
+Compressed_Texture compress_texture(
+	const std::filesystem::path& source,
+	const uint8_t* rgba,
+	uint32_t width,
+	uint32_t height,
+	const Mip_Options& mips,
+	const Block_Options& options
+) noexcept {
+	Compressed_Texture texture;
+	if (!options.enabled || width == 0 || height == 0) return texture;
+
+	uint32_t key = mips.to_bits() | (options.to_bits() << 16);
+	if (auto cached = load_block_cache(source, key)) {
+		// Same last check as the mips, the stamp alone could lie.
+		bool fits =
+			!cached->levels.empty() &&
+			cached->levels[0].width == width &&
+			cached->levels[0].height == height;
+		if (fits) return std::move(*cached);
+	}
+
+	bool has_alpha = false;
+	for (size_t i = 0; i < (size_t)width * height && !has_alpha; ++i) {
+		has_alpha = rgba[4 * i + 3] != 255;
+	}
+	texture.format = pick_block_format(options, has_alpha);
+
+	auto chain = cached_mips(source, rgba, width, height, mips);
+
+	auto start = std::chrono::steady_clock::now();
+	auto add_level = [&](const uint8_t* pixels, uint32_t w, uint32_t h) {
+		auto& level = texture.levels.emplace_back();
+		level.width = w;
+		level.height = h;
+		level.blocks = compress_blocks(pixels, w, h, texture.format, options.quality);
+		texture.texel_count += (uint64_t)w * h;
+	};
+	add_level(rgba, width, height);
+	for (auto& level : chain) add_level(level.pixels.data(), level.width, level.height);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	texture.seconds = elapsed.count();
+
+	auto& base = texture.levels[0].blocks;
+	auto decoded = decompress_blocks(base.data(), width, height, texture.format);
+	texture.psnr = compute_psnr(rgba, decoded.data(), width, height, texture.format);
+
+	save_block_cache(source, key, texture);
+	return texture;
+}
+
+std::vector<std::string> validate_block_compression() noexcept {
+	constexpr const char* Format_Names[] = { "", "BC1", "BC3", "BC4", "BC5", "BC7" };
+	constexpr const char* Quality_Names[] = { "Fast", "Normal", "High" };
+
+	// The flat blocks first, every channel value is in there.
+	constexpr size_t Flat_Blocks = 256;
+	std::vector<Block> blocks;
+	for (int v = 0; v < 256; ++v) {
+		auto& block = blocks.emplace_back();
+		for (auto& t : block.texels) t[0] = t[1] = t[2] = (uint8_t)v;
+	}
+	for (int c = 0; c < 3; ++c) {
+		auto& block = blocks.emplace_back();
+		for (size_t i = 0; i < 16; ++i) {
+			block.texels[i][0] = block.texels[i][1] = block.texels[i][2] = 64;
+			block.texels[i][c] = (uint8_t)(i * 17);
+		}
+	}
+	// Same noise every run.
+	uint32_t seed = 12345;
+	for (size_t b = 0; b < 64; ++b) {
+		auto& block = blocks.emplace_back();
+		for (auto& t : block.texels) for (size_t c = 0; c < 3; ++c) {
+			seed = seed * 1664525u + 1013904223u;
+			t[c] = (uint8_t)(seed >> 24);
+		}
+	}
+	for (auto& block : blocks) for (auto& t : block.texels) t[3] = 255;
+
+	// All the blocks in a single row of them.
+	uint32_t width = (uint32_t)blocks.size() * 4;
+	uint32_t height = 4;
+	std::vector<uint8_t> rgba((size_t)width * height * 4);
+	for (uint32_t b = 0; b < blocks.size(); ++b) {
+		store_block(blocks[b], width, height, b, 0, rgba.data());
+	}
+
+	std::vector<std::string> failures;
+	auto fail = [&](
+		Block_Format format,
+		Block_Quality quality,
+		const char* check,
+		const uint8_t* decoded,
+		size_t i
+	) {
+		auto in = &rgba[4 * i];
+		auto out = &decoded[4 * i];
+		char line[192];
+		snprintf(
+			line,
+			sizeof(line),
+			"%s %s: %s, block %zu (%d, %d, %d, %d) came back (%d, %d, %d, %d)",
+			Format_Names[(size_t)format],
+			Quality_Names[(size_t)quality],
+			check,
+			(i % width) / 4,
+			in[0], in[1], in[2], in[3],
+			out[0], out[1], out[2], out[3]
+		);
+		failures.push_back(line);
+	};
+
+	for (auto format : { Block_Format::BC1, Block_Format::BC3, Block_Format::BC7 }) {
+		for (size_t q = 0; q < (size_t)Block_Quality::Count; ++q) {
+			auto quality = (Block_Quality)q;
+			auto compressed = compress_blocks(rgba.data(), width, height, format, quality);
+			auto decoded = decompress_blocks(compressed.data(), width, height, format);
+
+			for (size_t i = 0; i < (size_t)width * height; ++i) {
+				if (decoded[4 * i + 3] == 255) continue;
+				fail(format, quality, "opaque but not at alpha 255", decoded.data(), i);
+				break;
+			}
+
+			// 565 can't store every value, the best mix of two endpoints can be 1 away. Same in
+			// BC7, the opaque blocks only have odd endpoints.
+			constexpr int Tolerance = 1;
+			for (size_t i = 0; i < (size_t)width * height; ++i) {
+				if ((i % width) / 4 >= Flat_Blocks) continue;
+
+				bool close = true;
+				for (size_t c = 0; c < 3; ++c) {
+					close &= std::abs(decoded[4 * i + c] - rgba[4 * i + c]) <= Tolerance;
+				}
+				if (close) continue;
+				fail(format, quality, "flat color moved", decoded.data(), i);
+				break;
+			}
+		}
+	}
+	return failures;
+}
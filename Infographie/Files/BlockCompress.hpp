@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Files/Mipmap.hpp"
+
+// Block compression (BCn), the gpu samples it as is at 4 or 8 bits per texel instead of 32.
+// Every format cuts the image in 4x4 blocks, past the borders we repeat the last row / column.
+
+enum class Block_Format : uint8_t {
+	None = 0,
+	BC1, // Two 565 colors and 2 bits per texel, no alpha. 8 bytes per block.
+	BC3, // BC1 for the colors and a BC4 block for the alpha. 16 bytes.
+	BC4, // One channel, two 8 bit values and 3 bits per texel. 8 bytes.
+	BC5, // A BC4 block for red and one for green, the xy of a normal map. 16 bytes.
+	BC7, // RGBA, 16 bytes. Way better than BC1/BC3 on colors but the slowest to encode.
+	Count
+};
+
+enum class Block_Quality : uint8_t {
+	Fast,   // Endpoints straight from the principal axis.
+	Normal, // Then refined by least squares.
+	High,   // More refining, and for BC7 the two subsets mode on the opaque blocks.
+	Count
+};
+
+struct Block_Options {
+	bool enabled{ false };
+	Block_Quality quality{ Block_Quality::Normal };
+	// BC5, only x and y are kept, the shader rebuilds z.
+	bool normal_map{ false };
+
+	uint32_t to_bits() const noexcept;
+};
+
+// BC5 for the normal maps, BC7 in High, otherwise BC1 or BC3 if there is any alpha.
+Block_Format pick_block_format(const Block_Options& options, bool has_alpha) noexcept;
+
+size_t block_bytes(Block_Format format) noexcept;
+size_t compressed_size(Block_Format format, uint32_t width, uint32_t height) noexcept;
+
+// rgba is 4 bytes per texel. The rows of blocks are split between the cores.
+std::vector<uint8_t> compress_blocks(
+	const uint8_t* rgba,
+	uint32_t width,
+	uint32_t height,
+	Block_Format format,
+	Block_Quality quality = Block_Quality::Normal
+) noexcept;
+
+// Back to rgba, to measure what we lost. For BC7 we only decode the two modes we encode with
+// (1 and 6), a block in any other mode comes out black.
+std::vector<uint8_t> decompress_blocks(
+	const uint8_t* blocks, uint32_t width, uint32_t height, Block_Format format
+) noexcept;
+
+// Peak signal to noise ratio (dB) over the channels the format keeps: rgb for BC1, r for BC4, rg
+// for BC5 and rgba for the rest.
+float compute_psnr(
+	const uint8_t* a, const uint8_t* b, uint32_t width, uint32_t height, Block_Format format
+) noexcept;
+
+// Debug tool, see --validate-blocks. Synthetic blocks (flat greys, gradients, noise) through
+// every format and quality and back, a line per check that failed, empty if none did. An opaque
+// block has to come back at alpha 255, a flat one at its color, 1 off at most.
+std::vector<std::string> validate_block_compression() noexcept;
+
+struct Compressed_Level {
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+	std::vector<uint8_t> blocks;
+};
+
+struct Compressed_Texture {
+	Block_Format format{ Block_Format::None };
+	// The base level then every mip.
+	std::vector<Compressed_Level> levels;
+
+	// Of the base level.
+	float psnr{ 0 };
+	// How long the encoding took, 0 if it came from the cache.
+	double seconds{ 0 };
+	uint64_t texel_count{ 0 };
+};
+
+// Every level of the texture, the mips come from cached_mips. The result is cached on disk under
+// cache/blocks/ like the mips, for the exact source file and options.
+constexpr uint32_t Block_Cache_Version = 3;
+
+Compressed_Texture compress_texture(
+	const std::filesystem::path& source,
+	const uint8_t* rgba,
+	uint32_t width,
+	uint32_t height,
+	const Mip_Options& mips,
+	const Block_Options& options
+) noexcept;
@@ -0,0 +1,176 @@
+#include "BrdfLut.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Files/BinaryIO.hpp"
+#include "Math/Half.hpp"
+#include "OS/FileIO.hpp"
+#include "Utils/Parallel.hpp"
+
+namespace {
+	constexpr float Pi = 3.14159265358979f;
+	constexpr char Magic[4] = { 'I', 'G', 'B', 'L' };
+
+	// http://holger.dammertz.org/stuff/notes_HammersleyOnHemisphere.html
+	float radical_inverse(uint32_t bits) noexcept {
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return (float)bits * 2.3283064365386963e-10f;
+	}
+
+	// Schlick-GGX with the k of the ibl, roughness^2 / 2.
+	float geometry(float n_dot, float k) noexcept {
+		return n_dot / (n_dot * (1 - k) + k);
+	}
+
+	// (A, B), the scale and bias to F0. n is z, v is in the xz plane.
+	void integrate(float n_dot_v, float roughness, uint32_t samples, double& a, double& b)
+		noexcept
+	{
+		float alpha = roughness * roughness;
+		float alpha2 = alpha * alpha;
+		float k = alpha / 2;
+		float v[3] = { std::sqrt(1 - n_dot_v * n_dot_v), 0, n_dot_v };
+
+		a = 0;
+		b = 0;
+		for (uint32_t i = 0; i < samples; ++i) {
+			float phi = 2 * Pi * i / samples;
+			float u = radical_inverse(i);
+			float cos_theta = std::sqrt((1 - u) / (1 + (alpha2 - 1) * u));
+			float sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+			float h[3] = { std::cos(phi) * sin_theta, std::sin(phi) * sin_theta, cos_theta };
+
+			float v_dot_h = v[0] * h[0] + v[1] * h[1] + v[2] * h[2];
+			float n_dot_l = 2 * v_dot_h * h[2] - v[2];
+			if (n_dot_l <= 0) continue;
+			v_dot_h = std::max(v_dot_h, 0.f);
+
+			float g = geometry(n_dot_v, k) * geometry(n_dot_l, k);
+			float g_vis = g * v_dot_h / (h[2] * n_dot_v);
+			float fc = std::pow(1 - v_dot_h, 5.f);
+			a += (1 - fc) * g_vis;
+			b += fc * g_vis;
+		}
+		a /= samples;
+		b /= samples;
+	}
+
+	// The two channels of the texel, laid out for the kind.
+	void integrate_texel(
+		Brdf_Lut_Kind kind, float n_dot_v, float roughness, uint32_t samples, float* rg
+	) noexcept {
+		double a;
+		double b;
+		integrate(n_dot_v, roughness, samples, a, b);
+
+		rg[0] = (float)a;
+		rg[1] = (float)b;
+		if (kind == Brdf_Lut_Kind::Multi_Scatter) {
+			rg[0] = (float)b;
+			rg[1] = (float)(a + b);
+		}
+	}
+};
+
+Brdf_Lut integrate_brdf_lut(Brdf_Lut_Kind kind, uint32_t size, uint32_t samples) noexcept {
+	Brdf_Lut lut;
+	lut.kind = kind;
+	lut.size = size;
+	lut.pixels.resize((size_t)size * size * 2);
+
+	parallel_for(size, [&](size_t begin, size_t end, size_t) {
+		for (size_t y = begin; y < end; ++y) {
+			float roughness = (y + 0.5f) / size;
+			for (size_t x = 0; x < size; ++x) {
+				float n_dot_v = (x + 0.5f) / size;
+
+				float rg[2];
+				integrate_texel(kind, n_dot_v, roughness, samples, rg);
+				half::from_float_n(rg, lut.pixels.data() + (y * size + x) * 2, 2);
+			}
+		}
+	}, 4);
+	return lut;
+}
+
+std::optional<Brdf_Lut> load_brdf_lut(const std::filesystem::path& path) noexcept {
+	if (!std::filesystem::is_regular_file(path)) return std::nullopt;
+
+	auto bytes = read_whole_file(path);
+	if (!bytes) return std::nullopt;
+
+	Reader reader{ *bytes };
+
+	char magic[4];
+	uint32_t version;
+	Brdf_Lut lut;
+	if (!reader.pod(magic) || memcmp(magic, Magic, sizeof(Magic)) != 0) return std::nullopt;
+	if (!reader.pod(version) || version != Brdf_Lut_Version) return std::nullopt;
+	if (!reader.pod(lut.kind) || lut.kind >= Brdf_Lut_Kind::Count) return std::nullopt;
+	if (!reader.pod(lut.size) || !reader.array(lut.pixels)) return std::nullopt;
+	if (lut.pixels.size() != (size_t)lut.size * lut.size * 2) return std::nullopt;
+	return lut;
+}
+
+bool save_brdf_lut(const std::filesystem::path& path, const Brdf_Lut& lut) noexcept {
+	Writer writer;
+	writer.pod(Magic);
+	writer.pod(Brdf_Lut_Version);
+	writer.pod(lut.kind);
+	writer.pod(lut.size);
+	writer.array(lut.pixels);
+	return overwrite_file(path, writer.bytes) == 0;
+}
+
+Brdf_Lut cached_brdf_lut(const std::filesystem::path& path, Brdf_Lut_Kind kind) noexcept {
+	if (auto lut = load_brdf_lut(path); lut && lut->kind == kind) return std::move(*lut);
+
+	auto lut = integrate_brdf_lut(kind);
+	save_brdf_lut(path, lut);
+	return lut;
+}
+
+Brdf_Lut_Error compare_brdf_lut(const Brdf_Lut& lut, uint32_t samples) noexcept {
+	uint32_t size = lut.size;
+	// Per row, put together once they are all done.
+	std::vector<Brdf_Lut_Error> rows(size);
+	std::vector<double> squares(size);
+
+	parallel_for(size, [&](size_t begin, size_t end, size_t) {
+		for (size_t y = begin; y < end; ++y) {
+			float roughness = (y + 0.5f) / size;
+			for (size_t x = 0; x < size; ++x) {
+				float n_dot_v = (x + 0.5f) / size;
+
+				float reference[2];
+				float shipped[2];
+				integrate_texel(lut.kind, n_dot_v, roughness, samples, reference);
+				half::to_float_n(lut.pixels.data() + (y * size + x) * 2, shipped, 2);
+
+				for (size_t c = 0; c < 2; ++c) {
+					float d = std::abs(shipped[c] - reference[c]);
+					squares[y] += (double)d * d;
+					if (!(d <= rows[y].max_error)) {
+						rows[y].max_error = d;
+						rows[y].n_dot_v = n_dot_v;
+						rows[y].roughness = roughness;
+					}
+				}
+			}
+		}
+	}, 1);
+
+	Brdf_Lut_Error error;
+	double sum = 0;
+	for (size_t y = 0; y < size; ++y) {
+		sum += squares[y];
+		if (rows[y].max_error > error.max_error) error = rows[y];
+	}
+	if (size > 0) error.rmse = (float)std::sqrt(sum / ((double)size * size * 2));
+	return error;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+// The brdf half of the split sum approximation (Karis, Real Shading in Unreal Engine 4), the
+// GGX specular integrated over the hemisphere for every (n.v, roughness). It doesn't depend on
+// the environment at all so we ship it as a file instead of rendering it every run.
+
+enum class Brdf_Lut_Kind : uint8_t {
+	// (A, B), specular = prefiltered * (F0 * A + B).
+	Split_Sum = 0,
+	// (B, A + B), the same integrals laid out for the multiple scattering compensation (Filament):
+	// specular = prefiltered * mix(x, y, F0) * (1 + F0 * (1 / y - 1)).
+	Multi_Scatter,
+	Count
+};
+
+// x is n.v and y the roughness, both from 0 to 1 at the texel centers. RG halfs, size x size.
+struct Brdf_Lut {
+	Brdf_Lut_Kind kind{ Brdf_Lut_Kind::Split_Sum };
+	uint32_t size{ 0 };
+	std::vector<uint16_t> pixels;
+};
+
+constexpr uint32_t Brdf_Lut_Size = 128;
+constexpr uint32_t Brdf_Lut_Samples = 1024;
+
+// Hammersley points importance sampling the GGX distribution (the integrand of Karis' course
+// notes). The rows are split between the cores.
+Brdf_Lut integrate_brdf_lut(
+	Brdf_Lut_Kind kind, uint32_t size = Brdf_Lut_Size, uint32_t samples = Brdf_Lut_Samples
+) noexcept;
+
+// The reference the shipped lut is validated against, integrated again with a lot more samples.
+constexpr uint32_t Brdf_Lut_Reference_Samples = 65536;
+// What we accept against it. The grazing texels (n.v near 0) converge the slowest, the shipped
+// 1024 samples are at ~0.01 there and ~0.001 on average, 256 samples would be twice that.
+constexpr float Brdf_Lut_Max_Tolerance = 0.015f;
+constexpr float Brdf_Lut_Rmse_Tolerance = 0.002f;
+
+struct Brdf_Lut_Error {
+	// Over both channels of every texel.
+	float max_error{ 0 };
+	float rmse{ 0 };
+	// The texel of the largest one.
+	float n_dot_v{ 0 };
+	float roughness{ 0 };
+};
+
+// Debug tool, see --validate-brdf-lut. The lut against the reference of the same kind and size.
+Brdf_Lut_Error compare_brdf_lut(
+	const Brdf_Lut& lut, uint32_t samples = Brdf_Lut_Reference_Samples
+) noexcept;
+
+constexpr uint32_t Brdf_Lut_Version = 1;
+
+std::optional<Brdf_Lut> load_brdf_lut(const std::filesystem::path& path) noexcept;
+bool save_brdf_lut(const std::filesystem::path& path, const Brdf_Lut& lut) noexcept;
+
+// The shipped file if it's there and of the right kind, otherwise integrated and written there.
+Brdf_Lut cached_brdf_lut(const std::filesystem::path& path, Brdf_Lut_Kind kind) noexcept;
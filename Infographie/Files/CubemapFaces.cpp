@@ -0,0 +1,80 @@
+#include "CubemapFaces.hpp"
+
+#include <chrono>
+#include <cstring>
+
+#include "Files/stb_image.h"
+#include "Utils/Parallel.hpp"
+
+std::optional<Cubemap_Faces> load_cubemap_faces(
+	const std::filesystem::path& folder, std::string& error
+) noexcept {
+	auto start = std::chrono::steady_clock::now();
+
+	// Only the headers, that's cheap, and we know how much to allocate for the whole thing.
+	int size = 0;
+	for (size_t i = 0; i < 6; ++i) {
+		auto path = folder / Cubemap_Face_Names[i];
+		if (!std::filesystem::is_regular_file(path)) {
+			error = std::string("Missing in the cube map folder: ") + Cubemap_Face_Names[i];
+			return std::nullopt;
+		}
+
+		int width;
+		int height;
+		int channels;
+		if (!stbi_info(path.generic_string().c_str(), &width, &height, &channels)) {
+			error = std::string("Can't read the cube map face: ") + Cubemap_Face_Names[i];
+			return std::nullopt;
+		}
+		if (width != height || width <= 0) {
+			error =
+				std::string("Cube map face isn't square: ") + Cubemap_Face_Names[i] +
+				" is " + std::to_string(width) + "x" + std::to_string(height);
+			return std::nullopt;
+		}
+		if (i > 0 && width != size) {
+			error =
+				std::string("Cube map faces don't have the same size: ") +
+				Cubemap_Face_Names[i] + " is " + std::to_string(width) + ", " +
+				Cubemap_Face_Names[0] + " is " + std::to_string(size);
+			return std::nullopt;
+		}
+		size = width;
+	}
+
+	Cubemap_Faces faces;
+	faces.size = (uint32_t)size;
+	// No need to zero 6 faces we are about to overwrite, that's 400Mb for a 4K skybox.
+	faces.pixels = std::make_unique_for_overwrite<uint8_t[]>(6 * faces.face_bytes());
+
+	// One face per thread, stb gives back its own buffer so it's one copy in the slot per face.
+	bool decoded[6] = {};
+	parallel_for(6, [&](size_t begin, size_t end, size_t) {
+		for (size_t i = begin; i < end; ++i) {
+			auto path = (folder / Cubemap_Face_Names[i]).generic_string();
+			int width;
+			int height;
+			int channels;
+			auto data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+			if (!data) continue;
+
+			// The file could have changed since we read its header.
+			if (width == size && height == size) {
+				std::memcpy(faces.pixels.get() + i * faces.face_bytes(), data, faces.face_bytes());
+				decoded[i] = true;
+			}
+			stbi_image_free(data);
+		}
+	}, 1);
+
+	for (size_t i = 0; i < 6; ++i) {
+		if (decoded[i]) continue;
+		error = std::string("Couldn't decode the cube map face: ") + Cubemap_Face_Names[i];
+		return std::nullopt;
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	faces.seconds = elapsed.count();
+	return faces;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+
+// A cube map folder is six pngs, one per face, in GL's order (+x, -x, +y, -y, +z, -z).
+constexpr const char* Cubemap_Face_Names[6] =
+	{ "right.png", "left.png", "top.png", "bot.png", "front.png", "back.png" };
+
+// Every face decoded back to back in a single allocation, RGBA8, ready to be handed to the gl
+// thread in one move.
+struct Cubemap_Faces {
+	// Faces are square, size x size.
+	uint32_t size{ 0 };
+	std::unique_ptr<uint8_t[]> pixels;
+	// How long the decoding took.
+	double seconds{ 0 };
+
+	size_t face_bytes() const noexcept { return (size_t)size * size * 4; }
+	const uint8_t* face(size_t i) const noexcept { return pixels.get() + i * face_bytes(); }
+};
+
+// We first read the headers of the six files, so a missing face or one of the wrong size is
+// reported before we decode anything. Then each face is decoded on its own thread and copied in
+// its slot. On failure error says why.
+std::optional<Cubemap_Faces> load_cubemap_faces(
+	const std::filesystem::path& folder, std::string& error
+) noexcept;
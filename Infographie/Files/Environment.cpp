@@ -0,0 +1,513 @@
+#include "Environment.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include "Files/AssetPack.hpp"
+#include "Files/BinaryIO.hpp"
+#include "Files/stb_image.h"
+#include "Math/Half.hpp"
+#include "OS/FileIO.hpp"
+#include "Utils/Parallel.hpp"
+
+namespace {
+	constexpr float Pi = 3.14159265358979f;
+	constexpr char Magic[4] = { 'I', 'G', 'E', 'V' };
+	const std::filesystem::path Cache_Dir = "cache/environments";
+
+	// The float working copy of a Cube_Level, same layout.
+	struct Cube {
+		uint32_t size{ 0 };
+		std::vector<float> rgb;
+
+		Cube() = default;
+		explicit Cube(uint32_t size) noexcept : size(size), rgb((size_t)6 * size * size * 3) {}
+
+		float* texel(size_t face, uint32_t x, uint32_t y) noexcept {
+			return rgb.data() + ((face * size + y) * size + x) * 3;
+		}
+		const float* texel(size_t face, uint32_t x, uint32_t y) const noexcept {
+			return rgb.data() + ((face * size + y) * size + x) * 3;
+		}
+	};
+
+	// f(face, x, y, rgb) for every texel, the 6 * size rows are split between the cores.
+	template<typename F>
+	void for_each_texel(Cube& cube, F&& f) noexcept {
+		parallel_for((size_t)6 * cube.size, [&](size_t begin, size_t end, size_t) {
+			for (size_t row = begin; row < end; ++row) {
+				size_t face = row / cube.size;
+				uint32_t y = (uint32_t)(row % cube.size);
+				for (uint32_t x = 0; x < cube.size; ++x) f(face, x, y, cube.texel(face, x, y));
+			}
+		}, std::max((size_t)1, (size_t)4096 / cube.size));
+	}
+
+	// The reverse of cube_direction, which face and where on it in [0, 1]. That's the table of
+	// the GL spec, the same samplerCube uses.
+	void cube_coordinates(const Vector3f& d, size_t& face, float& s, float& t) noexcept {
+		float ax = std::abs(d.x);
+		float ay = std::abs(d.y);
+		float az = std::abs(d.z);
+
+		float sc;
+		float tc;
+		float ma;
+		if (ax >= ay && ax >= az) {
+			face = d.x > 0 ? 0 : 1;
+			sc = d.x > 0 ? -d.z : d.z;
+			tc = -d.y;
+			ma = ax;
+		}
+		else if (ay >= az) {
+			face = d.y > 0 ? 2 : 3;
+			sc = d.x;
+			tc = d.y > 0 ? d.z : -d.z;
+			ma = ay;
+		}
+		else {
+			face = d.z > 0 ? 4 : 5;
+			sc = d.z > 0 ? d.x : -d.x;
+			tc = -d.y;
+			ma = az;
+		}
+		s = 0.5f * (sc / ma + 1);
+		t = 0.5f * (tc / ma + 1);
+	}
+
+	// Bilinear, clamped to the face like GL does without seamless cube maps.
+	void sample(const Cube& cube, const Vector3f& d, float out[3]) noexcept {
+		size_t face;
+		float s;
+		float t;
+		cube_coordinates(d, face, s, t);
+
+		float last = (float)(cube.size - 1);
+		float x = std::clamp(s * cube.size - 0.5f, 0.f, last);
+		float y = std::clamp(t * cube.size - 0.5f, 0.f, last);
+		uint32_t x0 = (uint32_t)x;
+		uint32_t y0 = (uint32_t)y;
+		uint32_t x1 = std::min(x0 + 1, cube.size - 1);
+		uint32_t y1 = std::min(y0 + 1, cube.size - 1);
+		float fx = x - x0;
+		float fy = y - y0;
+
+		auto a = cube.texel(face, x0, y0);
+		auto b = cube.texel(face, x1, y0);
+		auto c = cube.texel(face, x0, y1);
+		auto e = cube.texel(face, x1, y1);
+		for (size_t i = 0; i < 3; ++i) {
+			float top = a[i] + (b[i] - a[i]) * fx;
+			float bot = c[i] + (e[i] - c[i]) * fx;
+			out[i] = top + (bot - top) * fy;
+		}
+	}
+
+	// Trilinear between the two closest levels of the chain.
+	void sample_lod(const std::vector<Cube>& chain, const Vector3f& d, float lod, float out[3])
+		noexcept
+	{
+		lod = std::clamp(lod, 0.f, (float)(chain.size() - 1));
+		size_t level = (size_t)lod;
+		float f = lod - level;
+
+		sample(chain[level], d, out);
+		if (f <= 0 || level + 1 >= chain.size()) return;
+
+		float next[3];
+		sample(chain[level + 1], d, next);
+		for (size_t i = 0; i < 3; ++i) out[i] += (next[i] - out[i]) * f;
+	}
+
+	// Same mapping as the old equi_to_cube shader, the row 0 of the image is v = 0. We wrap
+	// around horizontally and clamp at the poles.
+	void sample_equirect(const Hdr_Image& source, const Vector3f& d, float out[3]) noexcept {
+		uint32_t width = source.width;
+		uint32_t height = source.height;
+
+		float u = std::atan2(d.z, d.x) / (2 * Pi) + 0.5f;
+		float v = std::asin(std::clamp(d.y, -1.f, 1.f)) / Pi + 0.5f;
+
+		float x = u * width - 0.5f;
+		float y = std::clamp(v * height - 0.5f, 0.f, (float)(height - 1));
+		float floor_x = std::floor(x);
+		uint32_t x0 = (uint32_t)(((int64_t)floor_x % width + width) % width);
+		uint32_t x1 = (x0 + 1) % width;
+		uint32_t y0 = (uint32_t)y;
+		uint32_t y1 = std::min(y0 + 1, height - 1);
+		float fx = x - floor_x;
+		float fy = y - y0;
+
+		auto texel = [&](uint32_t x, uint32_t y) {
+			return source.pixels.data() + ((size_t)y * width + x) * 3;
+		};
+		auto a = texel(x0, y0);
+		auto b = texel(x1, y0);
+		auto c = texel(x0, y1);
+		auto e = texel(x1, y1);
+		for (size_t i = 0; i < 3; ++i) {
+			float ai = half::to_float(a[i]);
+			float ci = half::to_float(c[i]);
+			float top = ai + (half::to_float(b[i]) - ai) * fx;
+			float bot = ci + (half::to_float(e[i]) - ci) * fx;
+			out[i] = top + (bot - top) * fy;
+		}
+	}
+
+	Cube equirect_to_cube(const Hdr_Image& source, uint32_t size) noexcept {
+		Cube cube(size);
+		for_each_texel(cube, [&](size_t face, uint32_t x, uint32_t y, float* out) {
+			sample_equirect(source, cube_direction(face, x, y, size), out);
+		});
+		return cube;
+	}
+
+	// 2x2 average, the sizes are powers of two.
+	Cube downsample(const Cube& cube) noexcept {
+		Cube next(cube.size / 2);
+		for_each_texel(next, [&](size_t face, uint32_t x, uint32_t y, float* out) {
+			auto a = cube.texel(face, 2 * x + 0, 2 * y + 0);
+			auto b = cube.texel(face, 2 * x + 1, 2 * y + 0);
+			auto c = cube.texel(face, 2 * x + 0, 2 * y + 1);
+			auto e = cube.texel(face, 2 * x + 1, 2 * y + 1);
+			for (size_t i = 0; i < 3; ++i) out[i] = 0.25f * (a[i] + b[i] + c[i] + e[i]);
+		});
+		return next;
+	}
+
+	// The real L2 basis at the normalized direction d.
+	void sh_basis(const Vector3f& d, float basis[9]) noexcept {
+		basis[0] = 0.282095f;
+		basis[1] = 0.488603f * d.y;
+		basis[2] = 0.488603f * d.z;
+		basis[3] = 0.488603f * d.x;
+		basis[4] = 1.092548f * d.x * d.y;
+		basis[5] = 1.092548f * d.y * d.z;
+		basis[6] = 0.315392f * (3 * d.z * d.z - 1);
+		basis[7] = 1.092548f * d.x * d.z;
+		basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+	}
+
+	// Projection of the sky on the basis, a sum over every texel weighted by its solid angle.
+	// Each worker sums its rows in its own slot (in doubles, there are millions of terms) and we
+	// add the slots up at the end.
+	// Then the convolution with the cosine lobe is only a factor per band (Ramamoorthi and
+	// Hanrahan, pi, 2pi / 3 and pi / 4), we also divide by pi to match the old cube map.
+	Irradiance_SH project_irradiance(const Cube& cube) noexcept {
+		constexpr float Band_Factors[9] = {
+			1, 2.f / 3, 2.f / 3, 2.f / 3, 1.f / 4, 1.f / 4, 1.f / 4, 1.f / 4, 1.f / 4
+		};
+		struct Partial {
+			double coefficients[9][3]{};
+			double solid_angle{ 0 };
+		};
+
+		size_t rows = (size_t)6 * cube.size;
+		size_t min_rows = std::max((size_t)1, (size_t)4096 / cube.size);
+		std::vector<Partial> partials(parallel_worker_count(rows, min_rows));
+
+		parallel_for(rows, [&](size_t begin, size_t end, size_t worker) {
+			auto& partial = partials[worker];
+			for (size_t row = begin; row < end; ++row) {
+				size_t face = row / cube.size;
+				uint32_t y = (uint32_t)(row % cube.size);
+				float b = 2 * (y + 0.5f) / cube.size - 1;
+				for (uint32_t x = 0; x < cube.size; ++x) {
+					float a = 2 * (x + 0.5f) / cube.size - 1;
+					// The texel is 2 / size wide on the z = 1 plane, seen at a distance of
+					// sqrt(1 + a^2 + b^2) and tilted by as much.
+					float distance2 = 1 + a * a + b * b;
+					float solid_angle =
+						4.f / (cube.size * cube.size) / (distance2 * std::sqrt(distance2));
+
+					float basis[9];
+					sh_basis(cube_direction(face, (float)x, (float)y, cube.size), basis);
+					auto rgb = cube.texel(face, x, y);
+					for (size_t k = 0; k < 9; ++k) {
+						float w = basis[k] * solid_angle;
+						for (size_t c = 0; c < 3; ++c) partial.coefficients[k][c] += w * rgb[c];
+					}
+					partial.solid_angle += solid_angle;
+				}
+			}
+		}, min_rows);
+
+		Partial total;
+		for (auto& partial : partials) {
+			for (size_t k = 0; k < 9; ++k) {
+				for (size_t c = 0; c < 3; ++c) {
+					total.coefficients[k][c] += partial.coefficients[k][c];
+				}
+			}
+			total.solid_angle += partial.solid_angle;
+		}
+
+		// The texels' solid angles are only approximated, we make them add up to the sphere.
+		double normalization = 4 * Pi / total.solid_angle;
+
+		Irradiance_SH sh;
+		for (size_t k = 0; k < 9; ++k) {
+			for (size_t c = 0; c < 3; ++c) {
+				sh.coefficients[k][c] =
+					(float)(total.coefficients[k][c] * normalization * Band_Factors[k]);
+			}
+		}
+		return sh;
+	}
+
+	// http://holger.dammertz.org/stuff/notes_HammersleyOnHemisphere.html
+	float radical_inverse(uint32_t bits) noexcept {
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return (float)bits * 2.3283064365386963e-10f;
+	}
+
+	// With n = v = r, like the prefilter shader, a sample only depends on the roughness. So we
+	// importance sample the GGX lobe once in tangent space (z is the normal) and only rotate it
+	// per texel. Each sample reads the sky at the mip whose texels are as big as the solid angle
+	// it stands for, that's what keeps the count low without fireflies.
+	struct Lobe_Sample {
+		// z is n.l, also the weight.
+		Vector3f direction;
+		float lod;
+	};
+
+	std::vector<Lobe_Sample> lobe_samples(float roughness, uint32_t sky_size) noexcept {
+		float a = roughness * roughness;
+		float a2 = a * a;
+		float texel_solid_angle = 4 * Pi / (6.f * sky_size * sky_size);
+
+		std::vector<Lobe_Sample> samples;
+		for (uint32_t i = 0; i < Prefilter_Samples; ++i) {
+			float u = (float)i / Prefilter_Samples;
+			float v = radical_inverse(i);
+
+			float phi = 2 * Pi * u;
+			float cos_theta = std::sqrt((1 - v) / (1 + (a2 - 1) * v));
+			float sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+			Vector3f h = { std::cos(phi) * sin_theta, std::sin(phi) * sin_theta, cos_theta };
+			Vector3f l = { 2 * h.z * h.x, 2 * h.z * h.y, 2 * h.z * h.z - 1 };
+			if (l.z <= 0) continue;
+
+			// D * n.h / (4 * h.v) and n.h == h.v here.
+			float d = a2 / (Pi * std::pow(h.z * h.z * (a2 - 1) + 1, 2.f));
+			float pdf = d / 4 + 0.0001f;
+			float sample_solid_angle = 1 / (Prefilter_Samples * pdf + 0.0001f);
+			// One level up from the exact footprint, with this few samples it's smoother.
+			float lod = 0.5f * std::log2(sample_solid_angle / texel_solid_angle) + 1;
+
+			samples.push_back({ l, roughness == 0 ? 0 : lod });
+		}
+		return samples;
+	}
+
+	Cube prefilter(const std::vector<Cube>& chain, uint32_t size, float roughness) noexcept {
+		Cube result(size);
+
+		// A mirror, just the sky at the right resolution.
+		if (roughness == 0) {
+			float lod = std::log2((float)chain.front().size / size);
+			for_each_texel(result, [&](size_t face, uint32_t x, uint32_t y, float* out) {
+				sample_lod(chain, cube_direction(face, x, y, size), lod, out);
+			});
+			return result;
+		}
+
+		auto samples = lobe_samples(roughness, chain.front().size);
+		for_each_texel(result, [&](size_t face, uint32_t x, uint32_t y, float* out) {
+			auto n = cube_direction(face, x, y, size);
+			Vector3f up = std::abs(n.z) < 0.999f ? Vector3f{ 0, 0, 1 } : Vector3f{ 1, 0, 0 };
+			Vector3f tangent = up.cross(n);
+			tangent.normalize();
+			Vector3f bitangent = n.cross(tangent);
+
+			Vector3f sum = { 0, 0, 0 };
+			float weight = 0;
+			for (auto& s : samples) {
+				auto l =
+					tangent * s.direction.x + bitangent * s.direction.y + n * s.direction.z;
+				float rgb[3];
+				sample_lod(chain, l, s.lod, rgb);
+				sum += Vector3f{ rgb[0], rgb[1], rgb[2] } * s.direction.z;
+				weight += s.direction.z;
+			}
+			sum *= 1 / weight;
+			out[0] = sum.x;
+			out[1] = sum.y;
+			out[2] = sum.z;
+		});
+		return result;
+	}
+
+	Cube_Level to_halfs(const Cube& cube) noexcept {
+		Cube_Level level;
+		level.size = cube.size;
+		level.pixels.resize(cube.rgb.size());
+		parallel_for(cube.rgb.size(), [&](size_t begin, size_t end, size_t) {
+			half::from_float_n(cube.rgb.data() + begin, level.pixels.data() + begin, end - begin);
+		}, 1 << 16);
+		return level;
+	}
+
+	std::filesystem::path cache_path(uint64_t source_hash) noexcept {
+		char name[64];
+		snprintf(name, sizeof(name), "%016llx.env", (unsigned long long)source_hash);
+		return Cache_Dir / name;
+	}
+
+	void write_level(Writer& writer, const Cube_Level& level) noexcept {
+		writer.pod(level.size);
+		writer.array(level.pixels);
+	}
+
+	bool read_level(Reader& reader, Cube_Level& level) noexcept {
+		if (!reader.pod(level.size) || !reader.array(level.pixels)) return false;
+		return level.pixels.size() == (size_t)6 * level.size * level.size * 3;
+	}
+};
+
+Vector3f cube_direction(size_t face, float x, float y, uint32_t size) noexcept {
+	float a = 2 * (x + 0.5f) / size - 1;
+	float b = 2 * (y + 0.5f) / size - 1;
+
+	Vector3f d;
+	switch (face) {
+	case 0: d = { 1, -b, -a }; break;
+	case 1: d = { -1, -b, a }; break;
+	case 2: d = { a, 1, b }; break;
+	case 3: d = { a, -1, -b }; break;
+	case 4: d = { a, -b, 1 }; break;
+	default: d = { -a, -b, -1 }; break;
+	}
+	d.normalize();
+	return d;
+}
+
+Vector3f evaluate_irradiance(const Irradiance_SH& sh, const Vector3f& normal) noexcept {
+	float basis[9];
+	sh_basis(normal, basis);
+
+	float rgb[3] = { 0, 0, 0 };
+	for (size_t k = 0; k < 9; ++k) {
+		for (size_t c = 0; c < 3; ++c) rgb[c] += sh.coefficients[k][c] * basis[k];
+	}
+	return { std::max(rgb[0], 0.f), std::max(rgb[1], 0.f), std::max(rgb[2], 0.f) };
+}
+
+Environment_Maps build_environment(const Hdr_Image& source) noexcept {
+	auto start = std::chrono::steady_clock::now();
+
+	uint32_t size = std::clamp(
+		std::bit_ceil(std::max(source.width / 4, 1u)), Environment_Min_Size, Environment_Max_Size
+	);
+
+	// The whole chain down to 1x1, the prefilter samples every level of it. In floats that's
+	// 400Mb for 2048 faces, but it's gone as soon as we have the halfs.
+	std::vector<Cube> chain;
+	chain.push_back(equirect_to_cube(source, size));
+	while (chain.back().size > 1) chain.push_back(downsample(chain.back()));
+
+	Environment_Maps maps;
+	maps.cube = to_halfs(chain.front());
+	maps.irradiance = project_irradiance(chain.front());
+
+	uint32_t prefilter_size = std::min(Prefilter_Size, size);
+	for (size_t i = 0; i < Prefilter_Levels && (prefilter_size >> i) > 0; ++i) {
+		float roughness = (float)i / (Prefilter_Levels - 1);
+		maps.prefilter.push_back(to_halfs(prefilter(chain, prefilter_size >> i, roughness)));
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	maps.seconds = elapsed.count();
+	return maps;
+}
+
+std::optional<Hdr_Image> decode_with_stb(const void* bytes, size_t size) noexcept {
+	int width;
+	int height;
+	int channels;
+	float* rgb = stbi_loadf_from_memory(
+		(const stbi_uc*)bytes, (int)size, &width, &height, &channels, 3
+	);
+	if (!rgb) return std::nullopt;
+
+	Hdr_Image image;
+	image.width = (uint32_t)width;
+	image.height = (uint32_t)height;
+	image.pixels.resize((size_t)width * height * 3);
+	half::from_float_n(rgb, image.pixels.data(), image.pixels.size());
+	stbi_image_free(rgb);
+	return image;
+}
+
+std::optional<Environment_Maps> load_environment_cache(uint64_t source_hash) noexcept {
+	auto path = cache_path(source_hash);
+	if (!std::filesystem::is_regular_file(path)) return std::nullopt;
+
+	auto bytes = read_whole_file(path);
+	if (!bytes) return std::nullopt;
+
+	Reader reader{ *bytes };
+
+	char magic[4];
+	uint32_t version;
+	uint64_t hash;
+	if (!reader.pod(magic) || memcmp(magic, Magic, sizeof(Magic)) != 0) return std::nullopt;
+	if (!reader.pod(version) || version != Environment_Cache_Version) return std::nullopt;
+	if (!reader.pod(hash) || hash != source_hash) return std::nullopt;
+
+	Environment_Maps maps;
+	if (!read_level(reader, maps.cube)) return std::nullopt;
+	if (!reader.pod(maps.irradiance)) return std::nullopt;
+
+	uint32_t count;
+	if (!reader.pod(count) || count == 0 || count > Prefilter_Levels) return std::nullopt;
+	maps.prefilter.resize(count);
+	for (auto& level : maps.prefilter) {
+		if (!read_level(reader, level)) return std::nullopt;
+	}
+
+	return maps;
+}
+
+bool save_environment_cache(uint64_t source_hash, const Environment_Maps& maps) noexcept {
+	std::error_code ec;
+	std::filesystem::create_directories(Cache_Dir, ec);
+	if (ec) return false;
+
+	Writer writer;
+	writer.pod(Magic);
+	writer.pod(Environment_Cache_Version);
+	writer.pod(source_hash);
+
+	write_level(writer, maps.cube);
+	writer.pod(maps.irradiance);
+	writer.pod((uint32_t)maps.prefilter.size());
+	for (auto& level : maps.prefilter) write_level(writer, level);
+
+	return overwrite_file(cache_path(source_hash), writer.bytes) == 0;
+}
+
+std::optional<Environment_Maps> cached_environment(const std::filesystem::path& source) noexcept {
+	// We need the bytes to hash them anyway, so we decode from those.
+	auto bytes = read_asset(source);
+	if (!bytes) return std::nullopt;
+
+	auto source_hash = stable_hash({ bytes->data(), bytes->size() });
+	if (auto maps = load_environment_cache(source_hash)) return maps;
+
+	auto image = decode_hdr(bytes->data(), bytes->size());
+	if (!image) image = decode_with_stb(bytes->data(), bytes->size());
+	if (!image) return std::nullopt;
+
+	auto maps = build_environment(*image);
+
+	save_environment_cache(source_hash, maps);
+	return maps;
+}
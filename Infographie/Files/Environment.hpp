@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "Files/HdrImage.hpp"
+#include "Math/Vector.hpp"
+
+// Image based lighting on the cpu. From an equirectangular .hdr we make the sky cube map, the
+// irradiance for the diffuse and the GGX prefiltered chain for the specular, everything Cube_Map
+// used to render with shaders every time an environment was loaded.
+
+// The six faces back to back in GL's order (+x, -x, +y, -y, +z, -z), RGB halfs, ready for a
+// GL_RGB16F upload.
+struct Cube_Level {
+	uint32_t size{ 0 };
+	std::vector<uint16_t> pixels;
+};
+
+// The irradiance as L2 spherical harmonics, 9 rgb coefficients. They are already convolved with
+// the cosine lobe and divided by pi, so evaluating them at a normal gives what the irradiance cube
+// map used to hold. Light_Deferred.fragment has the same evaluation.
+struct Irradiance_SH {
+	float coefficients[9][3]{};
+};
+
+// max(0, sum of the coefficients times the basis at normal), normal is normalized.
+Vector3f evaluate_irradiance(const Irradiance_SH& sh, const Vector3f& normal) noexcept;
+
+struct Environment_Maps {
+	Cube_Level cube;
+	Irradiance_SH irradiance;
+	// The level i is for the roughness i / (Prefilter_Levels - 1).
+	std::vector<Cube_Level> prefilter;
+
+	// How long it took to make, 0 if it came from the cache.
+	double seconds{ 0 };
+};
+
+// The sky gets about as many texels as the source has (a quarter of its width per face), no
+// point in interpolating a 360 wide .hdr up to 2048 faces.
+constexpr uint32_t Environment_Min_Size = 64;
+constexpr uint32_t Environment_Max_Size = 2048;
+// Or the size of the sky if it's smaller.
+constexpr uint32_t Prefilter_Size = 512;
+constexpr size_t Prefilter_Levels = 10;
+// Per texel. Each sample reads a mip of the sky as wide as its lobe, so few of them is enough.
+constexpr size_t Prefilter_Samples = 64;
+
+// Direction through the center of the texel (x, y) of a face, normalized.
+Vector3f cube_direction(size_t face, float x, float y, uint32_t size) noexcept;
+
+// From the equirectangular source. Every step is split in rows between the cores.
+Environment_Maps build_environment(const Hdr_Image& source) noexcept;
+
+// stb for anything decode_hdr doesn't take (a png, an .hdr with an unusual header), converted
+// to the same halfs.
+std::optional<Hdr_Image> decode_with_stb(const void* bytes, size_t size) noexcept;
+
+// Under cache/environments/, named after the hash of the source file's bytes so the same .hdr
+// hits it wherever it is.
+constexpr uint32_t Environment_Cache_Version = 3;
+
+std::optional<Environment_Maps> load_environment_cache(uint64_t source_hash) noexcept;
+bool save_environment_cache(uint64_t source_hash, const Environment_Maps& maps) noexcept;
+
+// From the cache if we can, otherwise decoded, built and saved for the next time.
+std::optional<Environment_Maps> cached_environment(const std::filesystem::path& source) noexcept;
@@ -1,12 +1,89 @@
 #include "FileFormat.hpp"
 
 #include <array>
+#include <cstring>
+#include <unordered_map>
 
-#include "OS/FileIO.hpp"
+#include "Files/AssetPack.hpp"
 #include "Math/algorithms.hpp"
 
+bool Object_File::is_indexed() const noexcept {
+	return !indices.empty();
+}
+
+size_t Object_File::triangle_count() const noexcept {
+	return (is_indexed() ? indices.size() : vertices.size()) / 3;
+}
+
+uint32_t Object_File::index(size_t i) const noexcept {
+	return is_indexed() ? indices[i] : (uint32_t)i;
+}
+
+void Object_File::weld(bool compare_tangents) noexcept {
+	if (is_indexed()) return;
+
+	struct Key {
+		float data[14];
+		size_t size{ 0 };
+
+		bool operator==(const Key& other) const noexcept {
+			return size == other.size && memcmp(data, other.data, size * sizeof(float)) == 0;
+		}
+	};
+	struct Key_Hash {
+		size_t operator()(const Key& key) const noexcept {
+			// FNV-1a
+			uint64_t hash = 14695981039346656037ull;
+			auto bytes = (const uint8_t*)key.data;
+			for (size_t i = 0; i < key.size * sizeof(float); ++i) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			return (size_t)hash;
+		}
+	};
+
+	size_t n = vertices.size();
+	bool has_uvs = uvs.size() == n;
+	bool has_normals = normals.size() == n;
+	bool has_tangents = tangents.size() == n;
+	bool has_bitangents = bitangents.size() == n;
+
+	auto push = [](Key& key, const auto& v, size_t d) {
+		for (size_t i = 0; i < d; ++i) key.data[key.size++] = v[i];
+	};
+
+	std::unordered_map<Key, uint32_t, Key_Hash> unique;
+	unique.reserve(n);
+
+	Object_File welded;
+	welded.min = min;
+	welded.max = max;
+	welded.indices.reserve(n);
+
+	for (size_t i = 0; i < n; ++i) {
+		Key key;
+		push(key, vertices[i], 3);
+		if (has_uvs) push(key, uvs[i], 2);
+		if (has_normals) push(key, normals[i], 3);
+		if (compare_tangents && has_tangents) push(key, tangents[i], 3);
+		if (compare_tangents && has_bitangents) push(key, bitangents[i], 3);
+
+		auto [it, inserted] = unique.emplace(key, (uint32_t)welded.vertices.size());
+		if (inserted) {
+			welded.vertices.push_back(vertices[i]);
+			if (has_uvs) welded.uvs.push_back(uvs[i]);
+			if (has_normals) welded.normals.push_back(normals[i]);
+			if (has_tangents) welded.tangents.push_back(tangents[i]);
+			if (has_bitangents) welded.bitangents.push_back(bitangents[i]);
+		}
+		welded.indices.push_back(it->second);
+	}
+
+	*this = std::move(welded);
+}
+
 std::optional<Object_File> Object_File::load_file(const std::filesystem::path& path) noexcept {
-	if (!std::filesystem::is_regular_file(path)) return std::nullopt;
 	constexpr auto Line_Comment_Char = '#';
 	constexpr auto Mtllib = std::array<char, 7>{ "mtllib" };
 	constexpr auto Usemtl = std::array<char, 7>{ "usemtl" };
@@ -15,9 +92,10 @@ std::optional<Object_File> Object_File::load_file(const std::filesystem::path& p
 	constexpr auto Normal_Char = std::array<char, 3>{ "vn" };
 	constexpr auto Face_Char = 'f';
 
-	auto opt_bytes = read_whole_file(path);
+	// From the pack it's followed by a zero, the sscanf at the end of the file stop there.
+	auto opt_bytes = read_asset(path);
 	if (!opt_bytes) return std::nullopt;
-	auto& bytes = *opt_bytes;
+	auto bytes = opt_bytes->view();
 
 	Object_File obj;
 	std::vector<Vector3<Vector3u>> faces;
@@ -118,13 +196,13 @@ std::optional<Object_File> Object_File::load_file(const std::filesystem::path& p
 	std::vector<Vector2f> indexed_uvs;
 	std::vector<Vector3f> indexed_normals;
 
+	// Not static, otherwise only the first file we ever load gets a correct min/max.
+	bool first = true;
 	for (auto& f : faces) {
 		indexed_vertices.push_back(obj.vertices[f.x.x - 1]);
 		indexed_vertices.push_back(obj.vertices[f.y.x - 1]);
 		indexed_vertices.push_back(obj.vertices[f.z.x - 1]);
 
-		static bool first = true;
-
 		if (first || obj.min.x > indexed_vertices.back().x) obj.min.x = indexed_vertices.back().x;
 		if (first || obj.min.y > indexed_vertices.back().y) obj.min.y = indexed_vertices.back().y;
 		if (first || obj.min.z > indexed_vertices.back().z) obj.min.z = indexed_vertices.back().z;
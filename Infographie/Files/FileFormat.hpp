@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <cstdint>
 #include <optional>
 #include <filesystem>
 
@@ -12,9 +13,48 @@ struct Object_File {
 	std::vector<Vector3f> tangents;
 	std::vector<Vector3f> bitangents;
 
+	// Triangle list into the arrays above. When it's empty the arrays are a triangle soup (every
+	// 3 vertices is a face), which is what load_file, cube and tetraedre give you.
+	std::vector<uint32_t> indices;
+
+	// Coarser versions of the mesh, they index the same vertices. See MeshSimplify.hpp
+	struct Lod {
+		std::vector<uint32_t> indices;
+		// Geometric error relative to the radius of the mesh.
+		float error{ 0 };
+	};
+	std::vector<Lod> lods;
+
+	// Small clusters of the full mesh, each one is a contiguous range of indices. See Meshlet.hpp
+	struct Meshlet {
+		uint32_t triangle_offset{ 0 };
+		uint32_t triangle_count{ 0 };
+		uint32_t vertex_count{ 0 };
+
+		Vector3f center;
+		float radius{ 0 };
+
+		// Every face normal is within the cone. The whole cluster faces away from a viewer at p
+		// when dot(normalize(cone_apex - p), cone_axis) >= cone_cutoff, so a cutoff > 1 means
+		// it never does.
+		Vector3f cone_apex;
+		Vector3f cone_axis;
+		float cone_cutoff{ 2 };
+	};
+	std::vector<Meshlet> meshlets;
+
 	Vector3f min;
 	Vector3f max;
 
+	bool is_indexed() const noexcept;
+	size_t triangle_count() const noexcept;
+	uint32_t index(size_t i) const noexcept;
+
+	// Merge the vertices that are bit for bit identical and fill indices.
+	// If compare_tangents is false only the position, uv and normal are compared (the tangents
+	// of the first one are kept) use that when you are going to regenerate them anyway.
+	void weld(bool compare_tangents = true) noexcept;
+
 	static std::optional<Object_File> load_file(const std::filesystem::path& path) noexcept;
 	static Object_File cube(Vector3f size) noexcept;
 	static Object_File tetraedre(Vector3f size) noexcept;
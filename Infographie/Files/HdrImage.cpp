@@ -0,0 +1,178 @@
+#include "HdrImage.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+#include "Math/Half.hpp"
+#include "Utils/Parallel.hpp"
+
+namespace {
+	// 2^(e - 136) without ldexp. Under e = 10 that would be a float denormal, but even 255 times
+	// 2^-127 is way under the smallest half so we can just say 0.
+	float rgbe_scale(uint8_t e) noexcept {
+		return e > 9 ? half::bits_float((uint32_t)(e - 9) << 23) : 0.f;
+	}
+
+#ifdef HALF_SSE2
+	// One RGBE pixel, a byte in each 32 bits lane, to 4 halfs of which the first 3 are RGB. The
+	// store is 4 halfs wide, the caller makes sure there is another pixel after this one.
+	void store_pixel(__m128i rgbe, uint16_t* out) noexcept {
+		const __m128i Nine = _mm_set1_epi32(9);
+
+		__m128i e = _mm_shuffle_epi32(rgbe, _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i scale = _mm_slli_epi32(_mm_sub_epi32(e, Nine), 23);
+		scale = _mm_and_si128(scale, _mm_cmpgt_epi32(e, Nine));
+
+		__m128 rgb = _mm_mul_ps(_mm_cvtepi32_ps(rgbe), _mm_castsi128_ps(scale));
+		__m128i h = half::from_float4(rgb);
+		h = _mm_shufflelo_epi16(h, _MM_SHUFFLE(3, 3, 2, 0));
+		h = _mm_shufflehi_epi16(h, _MM_SHUFFLE(3, 3, 2, 0));
+		h = _mm_shuffle_epi32(h, _MM_SHUFFLE(3, 3, 2, 0));
+		_mm_storel_epi64((__m128i*)out, h);
+	}
+#endif
+
+	struct Cursor {
+		const uint8_t* it;
+		const uint8_t* end;
+
+		size_t left() const noexcept { return (size_t)(end - it); }
+
+		// Up to the \n, which is skipped. False if there is none.
+		bool line(std::string_view& out) noexcept {
+			auto eol = (const uint8_t*)memchr(it, '\n', left());
+			if (!eol) return false;
+
+			out = { (const char*)it, (size_t)(eol - it) };
+			it = eol + 1;
+			return true;
+		}
+	};
+
+	// "-Y height +X width", the only orientation anybody writes.
+	bool parse_resolution(std::string_view line, uint32_t& width, uint32_t& height) noexcept {
+		auto number = [&](std::string_view prefix, uint32_t& out) {
+			if (!line.starts_with(prefix)) return false;
+			line.remove_prefix(prefix.size());
+
+			auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), out);
+			if (ec != std::errc{} || out == 0) return false;
+			line.remove_prefix(ptr - line.data());
+			return true;
+		};
+		return number("-Y ", height) && number(" +X ", width) && line.empty();
+	}
+
+	// 2 2 hi lo, then each of the four channels as runs (count > 128, one byte repeated
+	// count - 128 times) and literals (count bytes as they are).
+	bool decode_scanline(Cursor& cursor, uint8_t* row, uint32_t width) noexcept {
+		if (cursor.left() < 4) return false;
+
+		auto header = cursor.it;
+		if (header[0] != 2 || header[1] != 2) return false;
+		if ((((uint32_t)header[2] << 8) | header[3]) != width) return false;
+		cursor.it += 4;
+
+		for (size_t c = 0; c < 4; ++c) {
+			uint32_t x = 0;
+			while (x < width) {
+				if (cursor.left() < 2) return false;
+
+				uint32_t count = *cursor.it++;
+				if (count > 128) {
+					count -= 128;
+					if (count > width - x) return false;
+
+					uint8_t value = *cursor.it++;
+					for (uint32_t i = 0; i < count; ++i) row[(x + i) * 4 + c] = value;
+				}
+				else {
+					if (count == 0 || count > width - x || count > cursor.left()) return false;
+
+					for (uint32_t i = 0; i < count; ++i) row[(x + i) * 4 + c] = cursor.it[i];
+					cursor.it += count;
+				}
+				x += count;
+			}
+		}
+		return true;
+	}
+};
+
+void rgbe_to_half_n(const uint8_t* rgbe, uint16_t* out, size_t n) noexcept {
+	size_t i = 0;
+#ifdef HALF_SSE2
+	// 4 pixels per load, and we stop one short of the end because of the wide store.
+	const __m128i Zero = _mm_setzero_si128();
+	for (; i + 4 < n; i += 4) {
+		__m128i bytes = _mm_loadu_si128((const __m128i*)(rgbe + i * 4));
+		__m128i lo = _mm_unpacklo_epi8(bytes, Zero);
+		__m128i hi = _mm_unpackhi_epi8(bytes, Zero);
+		store_pixel(_mm_unpacklo_epi16(lo, Zero), out + (i + 0) * 3);
+		store_pixel(_mm_unpackhi_epi16(lo, Zero), out + (i + 1) * 3);
+		store_pixel(_mm_unpacklo_epi16(hi, Zero), out + (i + 2) * 3);
+		store_pixel(_mm_unpackhi_epi16(hi, Zero), out + (i + 3) * 3);
+	}
+#endif
+	for (; i < n; ++i) {
+		float scale = rgbe_scale(rgbe[i * 4 + 3]);
+		for (size_t c = 0; c < 3; ++c) out[i * 3 + c] = half::from_float(rgbe[i * 4 + c] * scale);
+	}
+}
+
+std::optional<Hdr_Image> decode_hdr(const void* bytes, size_t size) noexcept {
+	Cursor cursor{ (const uint8_t*)bytes, (const uint8_t*)bytes + size };
+
+	std::string_view line;
+	if (!cursor.line(line) || (line != "#?RADIANCE" && line != "#?RGBE")) return std::nullopt;
+
+	// Variables until an empty line, we only care about the format. EXPOSURE and GAMMA are
+	// ignored by everybody, stb included.
+	while (true) {
+		if (!cursor.line(line)) return std::nullopt;
+		if (line.empty()) break;
+		if (line.starts_with("FORMAT=") && line != "FORMAT=32-bit_rle_rgbe") return std::nullopt;
+	}
+
+	uint32_t width;
+	uint32_t height;
+	if (!cursor.line(line) || !parse_resolution(line, width, height)) return std::nullopt;
+
+	// A corrupted header shouldn't make us allocate gigabytes.
+	size_t count = (size_t)width * height;
+	if (count > ((size_t)1 << 28)) return std::nullopt;
+
+	auto rgbe = std::make_unique_for_overwrite<uint8_t[]>(count * 4);
+
+	// If the first scanline doesn't look run length encoded none of them are.
+	bool rle =
+		width >= 8 && width < 32768 && cursor.left() >= 4 &&
+		cursor.it[0] == 2 && cursor.it[1] == 2 && (cursor.it[2] & 0x80) == 0;
+	if (rle) {
+		for (uint32_t y = 0; y < height; ++y) {
+			if (!decode_scanline(cursor, rgbe.get() + (size_t)y * width * 4, width)) {
+				return std::nullopt;
+			}
+		}
+	}
+	else {
+		if (cursor.left() < count * 4) return std::nullopt;
+		memcpy(rgbe.get(), cursor.it, count * 4);
+	}
+
+	Hdr_Image image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(count * 3);
+	parallel_for(height, [&](size_t begin, size_t end, size_t) {
+		rgbe_to_half_n(
+			rgbe.get() + begin * width * 4,
+			image.pixels.data() + begin * width * 3,
+			(end - begin) * width
+		);
+	}, std::max((size_t)1, (size_t)16384 / width));
+	return image;
+}
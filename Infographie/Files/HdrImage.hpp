@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Radiance .hdr (RGBE) decoding straight to halfs. stb goes through 32 bits floats, that's 12
+// bytes per pixel resident for something that has 4 bytes of precision and that we only ever
+// sample to make halfs anyway.
+
+// RGB halfs, width x height, row 0 is the top of the file like stb.
+struct Hdr_Image {
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+	std::vector<uint16_t> pixels;
+};
+
+// n RGBE pixels to n RGB halfs, same values as stb (mantissa * 2^(e - 136), e = 0 is black).
+void rgbe_to_half_n(const uint8_t* rgbe, uint16_t* out, size_t n) noexcept;
+
+// Only the "-Y height +X width" orientation and the rgbe format, like stb. The scanlines can be
+// flat or run length encoded (the "new" RLE, 2 2 hi lo), the old RLE isn't a thing anymore.
+// The runs are decoded on this thread to RGBE, then the rows are converted between the cores.
+std::optional<Hdr_Image> decode_hdr(const void* bytes, size_t size) noexcept;
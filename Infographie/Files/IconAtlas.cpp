@@ -0,0 +1,112 @@
+#include "IconAtlas.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+// imgui_draw.cpp has the implementation but it's static in there, so we make our own copy.
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imgui/imstb_rectpack.h"
+
+namespace {
+	uint32_t align(uint32_t x, uint32_t alignment) noexcept {
+		return (x + alignment - 1) & ~(alignment - 1);
+	}
+
+	uint32_t cell_size(uint32_t size, const Atlas_Options& options) noexcept {
+		return align(size + 2 * options.gutter, options.alignment);
+	}
+
+	// The packer works in units of alignment, that's what puts every cell on the grid.
+	bool try_pack(std::vector<stbrp_rect>& rects, uint32_t width, uint32_t height) noexcept {
+		std::vector<stbrp_node> nodes(width);
+		stbrp_context context;
+		stbrp_init_target(&context, (int)width, (int)height, nodes.data(), (int)nodes.size());
+		return stbrp_pack_rects(&context, rects.data(), (int)rects.size()) != 0;
+	}
+
+	// The whole cell, each pixel of the gutter (and of the padding up to the grid) is the
+	// nearest one of the icon.
+	void blit_cell(
+		Icon_Atlas& atlas, const Atlas_Icon& icon, const stbrp_rect& cell, const Atlas_Options& grid
+	) noexcept {
+		uint32_t x = (uint32_t)cell.x * grid.alignment;
+		uint32_t y = (uint32_t)cell.y * grid.alignment;
+		uint32_t w = (uint32_t)cell.w * grid.alignment;
+		uint32_t h = (uint32_t)cell.h * grid.alignment;
+		auto nearest = [&](uint32_t i, uint32_t size) {
+			return (uint32_t)std::clamp((int64_t)i - grid.gutter, (int64_t)0, (int64_t)size - 1);
+		};
+
+		for (uint32_t j = 0; j < h; ++j) {
+			uint32_t sy = nearest(j, icon.height);
+			auto row = atlas.rgba.data() + ((size_t)(y + j) * atlas.width + x) * 4;
+			for (uint32_t i = 0; i < w; ++i) {
+				uint32_t sx = nearest(i, icon.width);
+				auto pixel = icon.rgba + ((size_t)sy * icon.width + sx) * 4;
+				std::copy(pixel, pixel + 4, row + i * 4);
+			}
+		}
+	}
+};
+
+std::optional<Icon_Atlas> pack_icon_atlas(
+	const std::vector<Atlas_Icon>& icons, const Atlas_Options& options
+) noexcept {
+	uint32_t alignment = std::max(std::bit_ceil(options.alignment), 1u);
+	auto grid = options;
+	grid.alignment = alignment;
+
+	std::vector<stbrp_rect> rects(icons.size());
+	uint64_t area = 0;
+	uint32_t widest = alignment;
+	uint32_t tallest = alignment;
+	for (size_t i = 0; i < icons.size(); ++i) {
+		if (icons[i].width == 0 || icons[i].height == 0) return std::nullopt;
+
+		uint32_t w = cell_size(icons[i].width, grid);
+		uint32_t h = cell_size(icons[i].height, grid);
+		if (w > options.max_size || h > options.max_size) return std::nullopt;
+
+		rects[i].id = (int)i;
+		rects[i].w = (stbrp_coord)(w / alignment);
+		rects[i].h = (stbrp_coord)(h / alignment);
+		area += (uint64_t)w * h;
+		widest = std::max(widest, w);
+		tallest = std::max(tallest, h);
+	}
+
+	// From the smallest square that could hold them, growing one side at a time.
+	uint32_t side = std::bit_ceil((uint32_t)std::ceil(std::sqrt((double)area)));
+	uint32_t width = std::max(side, std::bit_ceil(widest));
+	uint32_t height = std::max(side, std::bit_ceil(tallest));
+	while (!try_pack(rects, width / alignment, height / alignment)) {
+		if (width <= height) width *= 2;
+		else height *= 2;
+		if (width > options.max_size || height > options.max_size) return std::nullopt;
+	}
+
+	Icon_Atlas atlas;
+	atlas.width = width;
+	atlas.height = height;
+	atlas.rgba.resize((size_t)width * height * 4, 0);
+	// A mip of the gutter must still be at least a texel wide.
+	int gutter_levels = options.gutter ? (int)std::bit_width(options.gutter) - 1 : 0;
+	atlas.safe_levels = (uint32_t)std::min(std::countr_zero(alignment), gutter_levels);
+
+	// stb sorts them while packing, id is how we find which is which.
+	atlas.rects.resize(icons.size());
+	for (auto& rect : rects) {
+		auto& icon = icons[rect.id];
+		blit_cell(atlas, icon, rect, grid);
+
+		auto& [key, placed] = atlas.rects[rect.id];
+		key = icon.key;
+		placed.x = (uint32_t)rect.x * alignment + options.gutter;
+		placed.y = (uint32_t)rect.y * alignment + options.gutter;
+		placed.width = icon.width;
+		placed.height = icon.height;
+	}
+	return atlas;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Small images (the tool icons) packed in a single RGBA8 one, so the ui draws all of them from
+// one texture. We pack with imgui's copy of stb_rect_pack.
+//
+// Each icon sits in a cell of its own. The cell has a gutter of the icon's edge pixels repeated
+// around it, so bilinear filtering never reads a neighbor. The cells are also aligned on a grid,
+// so the first few mips average texels of a single cell.
+
+// RGBA, 4 bytes per pixel, only read while packing.
+struct Atlas_Icon {
+	std::string key;
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+	const uint8_t* rgba{ nullptr };
+};
+
+// In pixels of the atlas, without the gutter.
+struct Atlas_Rect {
+	uint32_t x{ 0 };
+	uint32_t y{ 0 };
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+};
+
+struct Atlas_Options {
+	uint32_t gutter{ 4 };
+	// Power of two. The cells start and end on multiples of it.
+	uint32_t alignment{ 4 };
+	uint32_t max_size{ 2048 };
+};
+
+struct Icon_Atlas {
+	// Powers of two.
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+	std::vector<uint8_t> rgba;
+	// In the order of the icons given.
+	std::vector<std::pair<std::string, Atlas_Rect>> rects;
+	// How many mips under the base level keep the icons apart, box filtered. Past that the
+	// cells bleed in each other.
+	uint32_t safe_levels{ 0 };
+};
+
+// nullopt if they don't fit in max_size x max_size.
+std::optional<Icon_Atlas> pack_icon_atlas(
+	const std::vector<Atlas_Icon>& icons, const Atlas_Options& options = {}
+) noexcept;
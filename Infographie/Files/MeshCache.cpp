@@ -0,0 +1,107 @@
+#include "MeshCache.hpp"
+
+#include "Files/BinaryIO.hpp"
+#include "OS/FileIO.hpp"
+
+namespace {
+	constexpr char Magic[4] = { 'I', 'G', 'M', 'C' };
+	const std::filesystem::path Cache_Dir = "cache/meshes";
+
+	std::filesystem::path cache_path(
+		const std::filesystem::path& source, uint32_t options
+	) noexcept {
+		std::error_code ec;
+		auto absolute = std::filesystem::absolute(source, ec).generic_string();
+
+		uint64_t hash = stable_hash(absolute);
+
+		char name[64];
+		snprintf(name, sizeof(name), "%016llx_%08x.mesh", (unsigned long long)hash, options);
+		return Cache_Dir / name;
+	}
+};
+
+std::optional<Object_File> load_mesh_cache(
+	const std::filesystem::path& source, uint32_t options
+) noexcept {
+	auto source_stamp = stamp(source);
+	if (!source_stamp) return std::nullopt;
+
+	auto path = cache_path(source, options);
+	if (!std::filesystem::is_regular_file(path)) return std::nullopt;
+
+	auto bytes = read_whole_file(path);
+	if (!bytes) return std::nullopt;
+
+	Reader reader{ *bytes };
+
+	char magic[4];
+	uint32_t version;
+	uint32_t cached_options;
+	Source_Stamp cached_stamp;
+	if (!reader.pod(magic) || memcmp(magic, Magic, sizeof(Magic)) != 0) return std::nullopt;
+	if (!reader.pod(version) || version != Mesh_Cache_Version) return std::nullopt;
+	if (!reader.pod(cached_options) || cached_options != options) return std::nullopt;
+	if (!reader.pod(cached_stamp.size) || cached_stamp.size != source_stamp->size)
+		return std::nullopt;
+	if (!reader.pod(cached_stamp.time) || cached_stamp.time != source_stamp->time)
+		return std::nullopt;
+
+	Object_File object;
+	bool ok =
+		reader.pod(object.min) &&
+		reader.pod(object.max) &&
+		reader.array(object.vertices) &&
+		reader.array(object.uvs) &&
+		reader.array(object.normals) &&
+		reader.array(object.tangents) &&
+		reader.array(object.bitangents) &&
+		reader.array(object.indices);
+	if (!ok) return std::nullopt;
+
+	uint64_t lod_count;
+	if (!reader.pod(lod_count)) return std::nullopt;
+	for (uint64_t i = 0; i < lod_count; ++i) {
+		auto& lod = object.lods.emplace_back();
+		if (!reader.pod(lod.error) || !reader.array(lod.indices)) return std::nullopt;
+	}
+	if (!reader.array(object.meshlets)) return std::nullopt;
+
+	return object;
+}
+
+bool save_mesh_cache(
+	const std::filesystem::path& source, uint32_t options, const Object_File& object
+) noexcept {
+	auto source_stamp = stamp(source);
+	if (!source_stamp) return false;
+
+	std::error_code ec;
+	std::filesystem::create_directories(Cache_Dir, ec);
+	if (ec) return false;
+
+	Writer writer;
+	writer.pod(Magic);
+	writer.pod(Mesh_Cache_Version);
+	writer.pod(options);
+	writer.pod(source_stamp->size);
+	writer.pod(source_stamp->time);
+
+	writer.pod(object.min);
+	writer.pod(object.max);
+	writer.array(object.vertices);
+	writer.array(object.uvs);
+	writer.array(object.normals);
+	writer.array(object.tangents);
+	writer.array(object.bitangents);
+	writer.array(object.indices);
+
+	writer.pod((uint64_t)object.lods.size());
+	for (auto& lod : object.lods) {
+		writer.pod(lod.error);
+		writer.array(lod.indices);
+	}
+	writer.array(object.meshlets);
+
+	return overwrite_file(cache_path(source, options), writer.bytes) == 0;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+
+#include "Files/FileFormat.hpp"
+
+// Binary dump of a processed Object_File under cache/meshes/.
+// An entry is only valid for the exact source file (size and last write time) and pipeline
+// options it was made from, and for the current Mesh_Cache_Version. Stale entries are simply
+// overwritten.
+constexpr uint32_t Mesh_Cache_Version = 4;
+
+std::optional<Object_File> load_mesh_cache(
+	const std::filesystem::path& source, uint32_t options
+) noexcept;
+
+bool save_mesh_cache(
+	const std::filesystem::path& source, uint32_t options, const Object_File& object
+) noexcept;
@@ -0,0 +1,331 @@
+#include "MeshOptimize.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// We model the gpu cache as a FIFO, a vertex is a miss if it was pushed more than size misses
+	// ago. With timestamps we don't even need to store the queue.
+	struct Fifo_Cache {
+		std::vector<uint32_t> timestamps;
+		uint32_t time;
+		uint32_t size;
+
+		Fifo_Cache(size_t vertex_count, size_t size) noexcept :
+			timestamps(vertex_count, 0), time((uint32_t)size + 1), size((uint32_t)size) {}
+
+		// true on a miss.
+		bool access(uint32_t v) noexcept {
+			if (time - timestamps[v] <= size) return false;
+			timestamps[v] = time++;
+			return true;
+		}
+
+		void reset() noexcept {
+			time += size + 1;
+		}
+	};
+
+	size_t max_index(const std::vector<uint32_t>& indices) noexcept {
+		uint32_t m = 0;
+		for (auto i : indices) m = std::max(m, i);
+		return indices.empty() ? 0 : (size_t)m + 1;
+	}
+
+	// The constants are the ones from the article.
+	constexpr size_t Forsyth_Cache_Size = 32;
+	constexpr float Cache_Decay_Power = 1.5f;
+	constexpr float Last_Triangle_Score = 0.75f;
+	constexpr float Valence_Boost_Scale = 2.f;
+	constexpr float Valence_Boost_Power = 0.5f;
+
+	float vertex_score(int cache_position, uint32_t live_triangles) noexcept {
+		// Nothing left to draw with it, no point in keeping it around.
+		if (live_triangles == 0) return -1.f;
+
+		float score = 0;
+		if (cache_position >= 0) {
+			// The last triangle vertices get a fixed score, otherwise we would favor strips.
+			if (cache_position < 3) score = Last_Triangle_Score;
+			else {
+				float scaler = 1.f / (Forsyth_Cache_Size - 3);
+				score = std::pow(1.f - (cache_position - 3) * scaler, Cache_Decay_Power);
+			}
+		}
+		// Finish off the vertices with few triangles left, so we don't leave lone triangles behind.
+		score += Valence_Boost_Scale * std::pow((float)live_triangles, -Valence_Boost_Power);
+		return score;
+	}
+};
+
+float compute_acmr(
+	const std::vector<uint32_t>& indices, size_t vertex_count, float* atvr, size_t cache_size
+) noexcept {
+	size_t n = std::max(vertex_count, max_index(indices));
+	Fifo_Cache cache(n, cache_size);
+
+	size_t misses = 0;
+	for (auto i : indices) misses += cache.access(i) ? 1 : 0;
+
+	if (atvr) *atvr = vertex_count ? (float)misses / vertex_count : 0;
+	return indices.empty() ? 0 : (float)misses / (indices.size() / 3);
+}
+
+std::vector<uint32_t> optimize_vertex_cache(
+	const std::vector<uint32_t>& indices, size_t vertex_count
+) noexcept {
+	size_t n_triangles = indices.size() / 3;
+	if (n_triangles == 0) return indices;
+	vertex_count = std::max(vertex_count, max_index(indices));
+
+	// vertex -> triangles, the first live[v] are the ones not emitted yet.
+	std::vector<uint32_t> offsets(vertex_count + 1, 0);
+	for (auto i : indices) offsets[i + 1]++;
+	for (size_t v = 0; v < vertex_count; ++v) offsets[v + 1] += offsets[v];
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> live(vertex_count, 0);
+	for (size_t c = 0; c < indices.size(); ++c) {
+		auto v = indices[c];
+		adjacency[offsets[v] + live[v]++] = (uint32_t)(c / 3);
+	}
+
+	std::vector<int> cache_position(vertex_count, -1);
+	std::vector<float> scores(vertex_count);
+	for (size_t v = 0; v < vertex_count; ++v) scores[v] = vertex_score(-1, live[v]);
+
+	std::vector<float> triangle_scores(n_triangles);
+	for (size_t t = 0; t < n_triangles; ++t) {
+		triangle_scores[t] =
+			scores[indices[3 * t + 0]] + scores[indices[3 * t + 1]] + scores[indices[3 * t + 2]];
+	}
+	std::vector<uint8_t> emitted(n_triangles, 0);
+
+	auto update_score = [&](uint32_t v) {
+		float score = vertex_score(cache_position[v], live[v]);
+		float delta = score - scores[v];
+		scores[v] = score;
+		for (size_t k = offsets[v]; k < offsets[v] + live[v]; ++k) {
+			triangle_scores[adjacency[k]] += delta;
+		}
+	};
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	uint32_t cache[Forsyth_Cache_Size + 3];
+	size_t cache_count = 0;
+	// When the cache doesn't give us anything we take the next triangle in the input order,
+	// the article says it's as good as looking for the best one and it's way faster.
+	size_t input_cursor = 0;
+
+	size_t best = std::max_element(BEG_END(triangle_scores)) - std::begin(triangle_scores);
+	while (best != n_triangles) {
+		const uint32_t* triangle = &indices[3 * best];
+		result.insert(std::end(result), triangle, triangle + 3);
+		emitted[best] = 1;
+
+		for (size_t k = 0; k < 3; ++k) {
+			auto v = triangle[k];
+			auto begin = adjacency.begin() + offsets[v];
+			auto it = std::find(begin, begin + live[v], (uint32_t)best);
+			if (it == begin + live[v]) continue; // degenerate triangle, already removed.
+			std::iter_swap(it, begin + live[v] - 1);
+			live[v]--;
+		}
+
+		uint32_t new_cache[Forsyth_Cache_Size + 3];
+		size_t new_count = 0;
+		for (size_t k = 0; k < 3; ++k) {
+			if (std::find(new_cache, new_cache + new_count, triangle[k]) != new_cache + new_count)
+				continue;
+			new_cache[new_count++] = triangle[k];
+		}
+		for (size_t i = 0; i < cache_count; ++i) {
+			auto v = cache[i];
+			if (v == triangle[0] || v == triangle[1] || v == triangle[2]) continue;
+			new_cache[new_count++] = v;
+		}
+
+		for (size_t i = Forsyth_Cache_Size; i < new_count; ++i) {
+			cache_position[new_cache[i]] = -1;
+			update_score(new_cache[i]);
+		}
+		cache_count = std::min(new_count, Forsyth_Cache_Size);
+		std::copy(new_cache, new_cache + cache_count, cache);
+		for (size_t i = 0; i < cache_count; ++i) {
+			cache_position[cache[i]] = (int)i;
+			update_score(cache[i]);
+		}
+
+		best = n_triangles;
+		float best_score = -INFINITY;
+		for (size_t i = 0; i < cache_count; ++i) {
+			auto v = cache[i];
+			for (size_t k = offsets[v]; k < offsets[v] + live[v]; ++k) {
+				auto t = adjacency[k];
+				if (triangle_scores[t] > best_score) {
+					best_score = triangle_scores[t];
+					best = t;
+				}
+			}
+		}
+
+		if (best == n_triangles) {
+			while (input_cursor < n_triangles && emitted[input_cursor]) input_cursor++;
+			best = input_cursor;
+		}
+	}
+
+	return result;
+}
+
+std::vector<uint32_t> optimize_overdraw(
+	const std::vector<uint32_t>& indices,
+	const std::vector<Vector3f>& positions,
+	float threshold
+) noexcept {
+	constexpr size_t Cache_Size = 16;
+
+	size_t n_triangles = indices.size() / 3;
+	if (n_triangles == 0) return indices;
+	Fifo_Cache cache(std::max(positions.size(), max_index(indices)), Cache_Size);
+
+	auto misses = [&](size_t t) {
+		return
+			(cache.access(indices[3 * t + 0]) ? 1 : 0) +
+			(cache.access(indices[3 * t + 1]) ? 1 : 0) +
+			(cache.access(indices[3 * t + 2]) ? 1 : 0);
+	};
+
+	// Hard boundaries, where the cache is cold anyway so cutting there costs nothing.
+	std::vector<size_t> hard;
+	for (size_t t = 0; t < n_triangles; ++t) if (misses(t) == 3) hard.push_back(t);
+	hard.push_back(n_triangles);
+
+	// Soft boundaries, we cut again as soon as the cluster is almost as good as the whole
+	// hard cluster.
+	std::vector<size_t> clusters;
+	for (size_t h = 0; h + 1 < hard.size(); ++h) {
+		size_t begin = hard[h];
+		size_t end = hard[h + 1];
+
+		cache.reset();
+		size_t total = 0;
+		for (size_t t = begin; t < end; ++t) total += misses(t);
+		float acmr = (float)total / (end - begin);
+
+		cache.reset();
+		size_t start = begin;
+		size_t count = 0;
+		clusters.push_back(start);
+		for (size_t t = begin; t + 1 < end; ++t) {
+			count += misses(t);
+			if (count > threshold * acmr * (t + 1 - start)) continue;
+
+			start = t + 1;
+			count = 0;
+			clusters.push_back(start);
+			cache.reset();
+		}
+	}
+	clusters.push_back(n_triangles);
+
+	struct Cluster {
+		size_t begin;
+		size_t end;
+		float sort_key;
+	};
+	std::vector<Cluster> sorted(clusters.size() - 1);
+
+	Vector3f mesh_centroid;
+	float mesh_area = 0;
+	std::vector<Vector3f> centroids(sorted.size());
+	std::vector<Vector3f> normals(sorted.size());
+	for (size_t c = 0; c < sorted.size(); ++c) {
+		sorted[c].begin = clusters[c];
+		sorted[c].end = clusters[c + 1];
+
+		float area = 0;
+		for (size_t t = sorted[c].begin; t < sorted[c].end; ++t) {
+			auto& p0 = positions[indices[3 * t + 0]];
+			auto& p1 = positions[indices[3 * t + 1]];
+			auto& p2 = positions[indices[3 * t + 2]];
+			auto normal = (p1 - p0).cross(p2 - p0);
+			float a = normal.length();
+
+			centroids[c] += (p0 + p1 + p2) * (a / 3);
+			normals[c] += normal;
+			area += a;
+		}
+		mesh_centroid += centroids[c];
+		mesh_area += area;
+		if (area > 0) centroids[c] = centroids[c] / area;
+	}
+	if (mesh_area > 0) mesh_centroid = mesh_centroid / mesh_area;
+
+	for (size_t c = 0; c < sorted.size(); ++c) {
+		auto normal = normals[c];
+		if (normal.length2() > 0) normal.normalize();
+		sorted[c].sort_key = (centroids[c] - mesh_centroid).dot(normal);
+	}
+	std::stable_sort(BEG_END(sorted), [](const Cluster& a, const Cluster& b) {
+		return a.sort_key > b.sort_key;
+	});
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (auto& c : sorted) {
+		result.insert(std::end(result), &indices[3 * c.begin], &indices[0] + 3 * c.end);
+	}
+	return result;
+}
+
+void optimize_vertex_fetch(Object_File& object) noexcept {
+	if (!object.is_indexed()) return;
+
+	constexpr uint32_t Unused = UINT32_MAX;
+	size_t n = object.vertices.size();
+	std::vector<uint32_t> remap(n, Unused);
+	uint32_t next = 0;
+
+	auto visit = [&](const std::vector<uint32_t>& indices) {
+		for (auto i : indices) if (remap[i] == Unused) remap[i] = next++;
+	};
+	visit(object.indices);
+	for (auto& lod : object.lods) visit(lod.indices);
+	for (auto& r : remap) if (r == Unused) r = next++;
+
+	for (auto& i : object.indices) i = remap[i];
+	for (auto& lod : object.lods) for (auto& i : lod.indices) i = remap[i];
+
+	auto reorder = [&](auto& attribute) {
+		if (attribute.size() != n) return;
+		std::remove_reference_t<decltype(attribute)> reordered(n);
+		for (size_t v = 0; v < n; ++v) reordered[remap[v]] = attribute[v];
+		attribute.swap(reordered);
+	};
+	reorder(object.vertices);
+	reorder(object.uvs);
+	reorder(object.normals);
+	reorder(object.tangents);
+	reorder(object.bitangents);
+}
+
+Mesh_Optimize_Report optimize_mesh(Object_File& object) noexcept {
+	object.weld();
+
+	size_t n = object.vertices.size();
+	Mesh_Optimize_Report report;
+	report.acmr_before = compute_acmr(object.indices, n, &report.atvr_before);
+
+	auto optimize = [&](std::vector<uint32_t>& indices) {
+		indices = optimize_overdraw(optimize_vertex_cache(indices, n), object.vertices);
+	};
+	optimize(object.indices);
+	for (auto& lod : object.lods) optimize(lod.indices);
+	optimize_vertex_fetch(object);
+
+	report.acmr_after = compute_acmr(object.indices, n, &report.atvr_after);
+	return report;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "Files/FileFormat.hpp"
+
+// Reordering of an indexed mesh for the gpu, none of this changes what the mesh looks like.
+
+// Average cache miss ratio (misses per triangle, between 0.5 and 3) with a simulated FIFO
+// post-transform cache. If vertex_count is given, atvr receives misses per vertex (1 is perfect).
+float compute_acmr(
+	const std::vector<uint32_t>& indices,
+	size_t vertex_count = 0,
+	float* atvr = nullptr,
+	size_t cache_size = 16
+) noexcept;
+
+// Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+std::vector<uint32_t> optimize_vertex_cache(
+	const std::vector<uint32_t>& indices, size_t vertex_count
+) noexcept;
+
+// Sander, Nehab and Barczak "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw".
+// indices should come out of optimize_vertex_cache, we cut it into clusters where it doesn't hurt
+// the cache much (the acmr can go up by threshold) and put the ones facing out of the mesh
+// first, they are the most likely to hide the others.
+std::vector<uint32_t> optimize_overdraw(
+	const std::vector<uint32_t>& indices,
+	const std::vector<Vector3f>& positions,
+	float threshold = 1.05f
+) noexcept;
+
+// Renumber the vertices in the order they are first used (the full mesh then the lods) so the
+// vertex fetch walks the buffers forward.
+void optimize_vertex_fetch(Object_File& object) noexcept;
+
+struct Mesh_Optimize_Report {
+	float acmr_before{ 0 };
+	float acmr_after{ 0 };
+	float atvr_before{ 0 };
+	float atvr_after{ 0 };
+};
+
+// All of the above on the mesh and its lods, the report is for the full mesh.
+// The object is welded if it is a triangle soup.
+Mesh_Optimize_Report optimize_mesh(Object_File& object) noexcept;
@@ -0,0 +1,57 @@
+#include "MeshPipeline.hpp"
+
+#include <cstdio>
+
+#include "Files/MeshCache.hpp"
+#include "Files/Meshlet.hpp"
+#include "Files/MeshOptimize.hpp"
+#include "Files/MeshSimplify.hpp"
+#include "Files/MeshTangents.hpp"
+
+uint32_t Mesh_Pipeline_Options::to_bits() const noexcept {
+	uint32_t bits = 0;
+	if (smooth_tangents) bits |= 1 << 0;
+	if (generate_lods) bits |= 1 << 1;
+	if (optimize) bits |= 1 << 2;
+	if (build_meshlets) bits |= 1 << 3;
+	return bits;
+}
+
+std::optional<Object_File> load_mesh(
+	const std::filesystem::path& path, Mesh_Pipeline_Options options
+) noexcept {
+	auto bits = options.to_bits();
+	if (options.use_cache) {
+		if (auto cached = load_mesh_cache(path, bits)) return cached;
+	}
+
+	auto object = Object_File::load_file(path);
+	if (!object) return std::nullopt;
+
+	if (options.smooth_tangents) {
+		// If we don't have what it needs we keep the loader tangents.
+		generate_tangents(*object);
+	}
+
+	// After the tangents, the lods index the final vertices.
+	if (options.generate_lods) generate_lods(*object);
+
+	// And the reordering after that, it knows how to keep the lods in sync.
+	if (options.optimize) {
+		auto report = optimize_mesh(*object);
+		std::printf(
+			"Optimized: %s: acmr %.3f -> %.3f, atvr %.3f -> %.3f\n",
+			path.generic_string().c_str(),
+			report.acmr_before,
+			report.acmr_after,
+			report.atvr_before,
+			report.atvr_after
+		);
+	}
+
+	// The meshlets take their seeds in the optimized order, so they keep most of it.
+	if (options.build_meshlets) build_meshlets(*object);
+
+	if (options.use_cache) save_mesh_cache(path, bits, *object);
+	return object;
+}
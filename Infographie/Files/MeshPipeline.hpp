@@ -0,0 +1,32 @@
+#pragma once
+#include <optional>
+#include <filesystem>
+
+#include "Files/FileFormat.hpp"
+
+// What we do to a mesh between the .obj and the Model. Every step is optional and the result
+// is cached on disk (see MeshCache.hpp) keyed by the source file and these options.
+struct Mesh_Pipeline_Options {
+	// Weld the soup and replace the faceted loader tangents by smooth MikkTSpace ones.
+	bool smooth_tangents{ true };
+
+	// Build a chain of simplified index buffers (see MeshSimplify.hpp), the Model picks one
+	// depending on how big it is on screen.
+	bool generate_lods{ true };
+
+	// Reorder the triangles for the post transform cache and overdraw, and the vertices for
+	// fetch locality. See MeshOptimize.hpp
+	bool optimize{ true };
+
+	// Cut the full mesh in small clusters with culling bounds. See Meshlet.hpp
+	bool build_meshlets{ true };
+
+	bool use_cache{ true };
+
+	// Only the options changing the output, use_cache doesn't.
+	uint32_t to_bits() const noexcept;
+};
+
+std::optional<Object_File> load_mesh(
+	const std::filesystem::path& path, Mesh_Pipeline_Options options = {}
+) noexcept;
@@ -0,0 +1,298 @@
+#include "MeshSimplify.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Files/MeshTangents.hpp"
+
+namespace {
+	// Symmetric 4x4 matrix, we only store the upper half.
+	struct Quadric {
+		double a00{ 0 }, a01{ 0 }, a02{ 0 }, a03{ 0 };
+		double a11{ 0 }, a12{ 0 }, a13{ 0 };
+		double a22{ 0 }, a23{ 0 };
+		double a33{ 0 };
+
+		static Quadric plane(Vector3f n, double d) noexcept {
+			Quadric q;
+			q.a00 = n.x * n.x; q.a01 = n.x * n.y; q.a02 = n.x * n.z; q.a03 = n.x * d;
+			q.a11 = n.y * n.y; q.a12 = n.y * n.z; q.a13 = n.y * d;
+			q.a22 = n.z * n.z; q.a23 = n.z * d;
+			q.a33 = d * d;
+			return q;
+		}
+
+		Quadric& operator+=(const Quadric& o) noexcept {
+			a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+			a11 += o.a11; a12 += o.a12; a13 += o.a13;
+			a22 += o.a22; a23 += o.a23;
+			a33 += o.a33;
+			return *this;
+		}
+
+		// Sum of the squared distances from p to every plane we accumulated.
+		double eval(Vector3f p) const noexcept {
+			double x = p.x;
+			double y = p.y;
+			double z = p.z;
+			double r =
+				a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x +
+				a11 * y * y + 2 * a12 * y * z + 2 * a13 * y +
+				a22 * z * z + 2 * a23 * z +
+				a33;
+			return std::max(r, 0.0);
+		}
+	};
+
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	uint64_t edge_key(uint32_t a, uint32_t b) noexcept {
+		return ((uint64_t)a << 32) | b;
+	}
+
+	Vector3f triangle_normal(Vector3f a, Vector3f b, Vector3f c) noexcept {
+		return (b - a).cross(c - a);
+	}
+};
+
+std::vector<uint32_t> simplify(
+	const Object_File& object,
+	const std::vector<uint32_t>& indices,
+	size_t target_index_count,
+	float& error
+) noexcept {
+	error = 0;
+	if (indices.size() <= target_index_count) return indices;
+
+	const auto& positions = object.vertices;
+	size_t n = positions.size();
+
+	Vector3f min = n ? positions[0] : Vector3f{};
+	Vector3f max = min;
+	for (auto& p : positions) {
+		for (size_t i = 0; i < 3; ++i) {
+			min[i] = std::min(min[i], p[i]);
+			max[i] = std::max(max[i], p[i]);
+		}
+	}
+	float radius = (max - min).length() / 2;
+	if (!(radius > 0)) radius = 1;
+
+	// Vertices sharing a position are the same point of the surface with different attributes.
+	std::vector<uint32_t> remap(n);
+	std::vector<uint32_t> group_size(n, 0);
+	{
+		struct Hash {
+			size_t operator()(const Vector3f& p) const noexcept {
+				uint32_t b[3];
+				memcpy(b, &p.x, sizeof(b));
+				return (size_t)(b[0] * 73856093u ^ b[1] * 19349663u ^ b[2] * 83492791u);
+			}
+		};
+		struct Equal {
+			bool operator()(const Vector3f& a, const Vector3f& b) const noexcept {
+				return memcmp(&a.x, &b.x, 3 * sizeof(float)) == 0;
+			}
+		};
+		std::unordered_map<Vector3f, uint32_t, Hash, Equal> first_of;
+		first_of.reserve(n);
+		for (size_t v = 0; v < n; ++v) {
+			remap[v] = first_of.emplace(positions[v], (uint32_t)v).first->second;
+			group_size[remap[v]]++;
+		}
+	}
+
+	// locked is indexed by remapped vertex.
+	std::vector<uint8_t> locked(n, 0);
+	for (size_t v = 0; v < n; ++v) if (group_size[remap[v]] > 1) locked[remap[v]] = 1;
+	{
+		std::unordered_set<uint64_t> edges;
+		edges.reserve(indices.size());
+		for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+			for (size_t k = 0; k < 3; ++k) {
+				edges.insert(edge_key(remap[indices[t + k]], remap[indices[t + (k + 1) % 3]]));
+			}
+		}
+		// an edge without its twin is on a border.
+		for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+			for (size_t k = 0; k < 3; ++k) {
+				auto a = remap[indices[t + k]];
+				auto b = remap[indices[t + (k + 1) % 3]];
+				if (edges.count(edge_key(b, a))) continue;
+				locked[a] = 1;
+				locked[b] = 1;
+			}
+		}
+	}
+
+	std::vector<Quadric> quadrics(n);
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		auto& p0 = positions[indices[t + 0]];
+		auto& p1 = positions[indices[t + 1]];
+		auto& p2 = positions[indices[t + 2]];
+		auto normal = triangle_normal(p0, p1, p2);
+		float length = normal.length();
+		if (!(length > 0)) continue;
+		normal = normal / length;
+
+		auto q = Quadric::plane(normal, -normal.dot(p0));
+		for (size_t k = 0; k < 3; ++k) quadrics[remap[indices[t + k]]] += q;
+	}
+
+	double max_cost = 0;
+	std::vector<uint32_t> result = indices;
+	size_t target_triangles = target_index_count / 3;
+
+	std::vector<uint32_t> offsets(n + 1);
+	std::vector<uint32_t> triangles;
+	std::vector<double> best_cost(n);
+	std::vector<uint32_t> best_to(n);
+	std::vector<uint32_t> collapse_to(n);
+	std::vector<uint8_t> touched(n);
+	std::vector<Collapse> collapses;
+
+	while (result.size() / 3 > target_triangles) {
+		size_t triangle_count = result.size() / 3;
+
+		// vertex -> triangles
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (auto i : result) offsets[i + 1]++;
+		for (size_t v = 0; v < n; ++v) offsets[v + 1] += offsets[v];
+		triangles.resize(result.size());
+		{
+			std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+			for (size_t c = 0; c < result.size(); ++c) triangles[cursor[result[c]]++] = c / 3;
+		}
+
+		// Cheapest collapse for every vertex.
+		std::fill(best_cost.begin(), best_cost.end(), INFINITY);
+		for (size_t c = 0; c < result.size(); ++c) {
+			uint32_t a = result[c];
+			uint32_t b = result[c - c % 3 + (c + 1) % 3];
+			for (auto [from, to] : { std::pair{ a, b }, std::pair{ b, a } }) {
+				if (locked[remap[from]] || remap[from] == remap[to]) continue;
+
+				auto q = quadrics[remap[from]];
+				q += quadrics[remap[to]];
+				double cost = q.eval(positions[to]);
+				if (cost < best_cost[from]) {
+					best_cost[from] = cost;
+					best_to[from] = to;
+				}
+			}
+		}
+
+		collapses.clear();
+		for (uint32_t v = 0; v < n; ++v) {
+			if (std::isfinite(best_cost[v])) collapses.push_back({ v, best_to[v], best_cost[v] });
+		}
+		std::sort(BEG_END(collapses), [](const Collapse& a, const Collapse& b) {
+			return a.cost < b.cost;
+		});
+
+		for (uint32_t v = 0; v < n; ++v) collapse_to[v] = v;
+		std::fill(touched.begin(), touched.end(), 0);
+
+		// A vertex can only move once per pass and its neighbours are frozen, that way every
+		// check we do below is against the real current geometry.
+		size_t removed = 0;
+		size_t applied = 0;
+		for (auto& c : collapses) {
+			if (triangle_count - removed <= target_triangles) break;
+			if (touched[c.from] || touched[c.to]) continue;
+
+			size_t shared = 0;
+			bool flip = false;
+			for (size_t k = offsets[c.from]; k < offsets[c.from + 1] && !flip; ++k) {
+				size_t t = triangles[k];
+				uint32_t i[3] = { result[3 * t + 0], result[3 * t + 1], result[3 * t + 2] };
+				if (i[0] == c.to || i[1] == c.to || i[2] == c.to) {
+					shared++;
+					continue;
+				}
+
+				Vector3f p[3] = { positions[i[0]], positions[i[1]], positions[i[2]] };
+				auto before = triangle_normal(p[0], p[1], p[2]);
+				for (size_t j = 0; j < 3; ++j) if (i[j] == c.from) p[j] = positions[c.to];
+				auto after = triangle_normal(p[0], p[1], p[2]);
+
+				// Don't fold the surface over itself (or make a sliver).
+				flip = before.dot(after) <= 0.25f * before.length() * after.length();
+			}
+			if (flip || shared == 0) continue;
+
+			collapse_to[c.from] = c.to;
+			quadrics[remap[c.to]] += quadrics[remap[c.from]];
+			max_cost = std::max(max_cost, c.cost);
+			removed += shared;
+			applied++;
+
+			touched[c.from] = 1;
+			touched[c.to] = 1;
+			for (size_t k = offsets[c.from]; k < offsets[c.from + 1]; ++k) {
+				size_t t = triangles[k];
+				for (size_t j = 0; j < 3; ++j) touched[result[3 * t + j]] = 1;
+			}
+		}
+		if (applied == 0) break;
+
+		size_t write = 0;
+		for (size_t t = 0; t < triangle_count; ++t) {
+			uint32_t a = collapse_to[result[3 * t + 0]];
+			uint32_t b = collapse_to[result[3 * t + 1]];
+			uint32_t c = collapse_to[result[3 * t + 2]];
+			if (a == b || b == c || c == a) continue;
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	error = (float)(std::sqrt(max_cost) / radius);
+	return result;
+}
+
+void generate_lods(Object_File& object, const float* ratios, size_t ratio_count) noexcept {
+	// Without the smooth tangents the loader gives each face its own, comparing them would split
+	// every vertex and lock every edge as a border. A welded vertex would keep the tangent of
+	// whichever face came first, so the frames are made again from the welded mesh.
+	bool face_tangents = !object.is_indexed() && object.tangents.size() == object.vertices.size();
+	object.weld(false);
+	if (face_tangents) generate_tangents(object);
+	object.lods.clear();
+
+	size_t full = object.indices.size() / 3;
+	for (size_t i = 0; i < ratio_count; ++i) {
+		auto& previous = object.lods.empty() ? object.indices : object.lods.back().indices;
+		float previous_error = object.lods.empty() ? 0 : object.lods.back().error;
+
+		size_t target = std::max((size_t)(full * ratios[i]), (size_t)1) * 3;
+		float error;
+		auto lod = simplify(object, previous, target, error);
+
+		// Everything left is locked (seams, borders) or would flip, no point in going on.
+		if (lod.size() >= previous.size() * 9 / 10) break;
+
+		// Each lod is simplified from the previous one, so the errors add up.
+		object.lods.push_back({ std::move(lod), previous_error + error });
+	}
+}
+
+size_t select_lod(
+	const std::vector<float>& lod_errors, float screen_radius, float max_pixel_error
+) noexcept {
+	size_t lod = 0;
+	for (size_t i = 1; i < lod_errors.size(); ++i) {
+		if (lod_errors[i] * screen_radius > max_pixel_error) break;
+		lod = i;
+	}
+	return lod;
+}
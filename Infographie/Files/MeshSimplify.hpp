@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <iterator>
+
+#include "Files/FileFormat.hpp"
+
+// Quadric error metric simplification (Garland & Heckbert 97) by edge collapse.
+// We only ever collapse a vertex onto one of its neighbours, so the vertices are untouched and a
+// LOD is just another index buffer on the same vertex data.
+// Vertices on a uv seam (same position, different attributes) or on an open border are never
+// removed, so the texture mapping doesn't tear.
+//
+// error receives the geometric error of the result relative to the radius of the mesh.
+std::vector<uint32_t> simplify(
+	const Object_File& object,
+	const std::vector<uint32_t>& indices,
+	size_t target_index_count,
+	float& error
+) noexcept;
+
+constexpr float Default_Lod_Ratios[] = { 0.5f, 0.25f, 0.1f };
+
+// Fill object.lods, one per ratio of the full triangle count. Each lod is made from the previous
+// one, we stop early when the simplifier can't get anywhere near the target.
+// The object is welded if it is a triangle soup, its per face tangents are then replaced by smooth
+// ones (see generate_tangents).
+void generate_lods(
+	Object_File& object,
+	const float* ratios = Default_Lod_Ratios,
+	size_t ratio_count = std::size(Default_Lod_Ratios)
+) noexcept;
+
+// lod_errors[0] is the full mesh (so 0) then lod_errors[i] = object.lods[i - 1].error.
+// screen_radius is the radius in pixels of the bounding sphere of the mesh on screen.
+// Gives back the coarsest lod whose error stays under max_pixel_error pixels.
+size_t select_lod(
+	const std::vector<float>& lod_errors, float screen_radius, float max_pixel_error = 1.f
+) noexcept;
@@ -0,0 +1,161 @@
+#include "MeshTangents.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Utils/Parallel.hpp"
+
+namespace {
+	struct Face_Tangent {
+		// Normalized and already multiplied by the orientation sign, like in mikktspace.
+		Vector3f os;
+		bool orientation{ true };
+		// Zero uv area (or zero length tangent), they don't weight in but follow their vertex.
+		bool degenerate{ false };
+	};
+
+	Vector3f project(Vector3f v, Vector3f n) noexcept {
+		return v - n * n.dot(v);
+	}
+
+	Vector3f any_perpendicular(Vector3f n) noexcept {
+		Vector3f axis =
+			std::fabs(n.x) < std::fabs(n.y) ?
+			(std::fabs(n.x) < std::fabs(n.z) ? Vector3f{ 1, 0, 0 } : Vector3f{ 0, 0, 1 }) :
+			(std::fabs(n.y) < std::fabs(n.z) ? Vector3f{ 0, 1, 0 } : Vector3f{ 0, 0, 1 });
+		auto t = project(axis, n);
+		return t.normalize();
+	}
+};
+
+bool generate_tangents(Object_File& object) noexcept {
+	if (object.normals.size() != object.vertices.size()) return false;
+	if (object.uvs.size() != object.vertices.size()) return false;
+	object.weld(false);
+
+	size_t n_vertices = object.vertices.size();
+	size_t n_faces = object.indices.size() / 3;
+
+	const auto& indices = object.indices;
+	const auto& positions = object.vertices;
+	const auto& uvs = object.uvs;
+
+	std::vector<Face_Tangent> faces(n_faces);
+	parallel_for(n_faces, [&](size_t begin, size_t end, size_t) {
+		for (size_t f = begin; f < end; ++f) {
+			auto i1 = indices[3 * f + 0];
+			auto i2 = indices[3 * f + 1];
+			auto i3 = indices[3 * f + 2];
+
+			auto d1 = positions[i2] - positions[i1];
+			auto d2 = positions[i3] - positions[i1];
+			auto t21 = uvs[i2] - uvs[i1];
+			auto t31 = uvs[i3] - uvs[i1];
+
+			float signed_area = t21.x * t31.y - t21.y * t31.x;
+			auto os = t31.y * d1 - t21.y * d2;
+			float length = os.length();
+
+			auto& face = faces[f];
+			face.orientation = signed_area > 0;
+			face.degenerate = signed_area == 0 || !(length > 0) || !std::isfinite(length);
+			if (!face.degenerate) face.os = os * ((face.orientation ? 1.f : -1.f) / length);
+		}
+	}, 4096);
+
+	// vertex -> corners adjacency, corners are in increasing order for each vertex so the
+	// accumulation order (hence the result) doesn't depend on the number of threads.
+	std::vector<uint32_t> corner_offsets(n_vertices + 1, 0);
+	for (auto i : indices) corner_offsets[i + 1]++;
+	for (size_t i = 0; i < n_vertices; ++i) corner_offsets[i + 1] += corner_offsets[i];
+
+	std::vector<uint32_t> corners(indices.size());
+	{
+		std::vector<uint32_t> cursor(corner_offsets.begin(), corner_offsets.end() - 1);
+		for (size_t c = 0; c < indices.size(); ++c) corners[cursor[indices[c]]++] = (uint32_t)c;
+	}
+
+	// A vertex used by both orientations is split, the mirrored side gets a new vertex.
+	constexpr uint32_t No_Split = UINT32_MAX;
+	std::vector<uint32_t> split_of(n_vertices, No_Split);
+	std::vector<uint8_t> has_positive(n_vertices, 0);
+	size_t n_split = 0;
+	for (size_t v = 0; v < n_vertices; ++v) {
+		bool positive = false;
+		bool negative = false;
+		for (size_t k = corner_offsets[v]; k < corner_offsets[v + 1]; ++k) {
+			auto& face = faces[corners[k] / 3];
+			if (face.degenerate) continue;
+			positive |= face.orientation;
+			negative |= !face.orientation;
+		}
+		has_positive[v] = positive || !negative;
+		if (positive && negative) split_of[v] = (uint32_t)(n_vertices + n_split++);
+	}
+
+	object.vertices.reserve(n_vertices + n_split);
+	object.uvs.reserve(n_vertices + n_split);
+	object.normals.reserve(n_vertices + n_split);
+	for (size_t v = 0; v < n_vertices; ++v) {
+		if (split_of[v] == No_Split) continue;
+		object.vertices.push_back(object.vertices[v]);
+		object.uvs.push_back(object.uvs[v]);
+		object.normals.push_back(object.normals[v]);
+	}
+	object.tangents.assign(n_vertices + n_split, {});
+	object.bitangents.assign(n_vertices + n_split, {});
+
+	// We read the old indices and write the new ones to another buffer, each corner belongs to
+	// exactly one vertex so every write has a single owner.
+	std::vector<uint32_t> new_indices = indices;
+
+	parallel_for(n_vertices, [&](size_t begin, size_t end, size_t) {
+		for (size_t v = begin; v < end; ++v) {
+			auto n = object.normals[v];
+			if (n.length2() > 0) n.normalize();
+			auto p = positions[v];
+
+			// [0] is the positive orientation, [1] the mirrored one.
+			Vector3f accumulated[2];
+			for (size_t k = corner_offsets[v]; k < corner_offsets[v + 1]; ++k) {
+				uint32_t c = corners[k];
+				size_t f = c / 3;
+				auto& face = faces[f];
+
+				bool mirrored = face.degenerate ? !has_positive[v] : !face.orientation;
+				if (mirrored && split_of[v] != No_Split) new_indices[c] = split_of[v];
+				if (face.degenerate) continue;
+
+				auto next = positions[indices[3 * f + (c + 1) % 3]];
+				auto prev = positions[indices[3 * f + (c + 2) % 3]];
+				auto e1 = project(next - p, n);
+				auto e2 = project(prev - p, n);
+				if (e1.length2() == 0 || e2.length2() == 0) continue;
+				e1.normalize();
+				e2.normalize();
+				float angle = std::acos(std::clamp(e1.dot(e2), -1.f, 1.f));
+
+				auto t = project(face.os, n);
+				if (t.length2() == 0) continue;
+				accumulated[mirrored ? 1 : 0] += t.normalize() * angle;
+			}
+
+			for (size_t side = 0; side < 2; ++side) {
+				uint32_t out = (uint32_t)v;
+				if (side == 0 && !has_positive[v]) continue;
+				if (side == 1) {
+					if (split_of[v] != No_Split) out = split_of[v];
+					else if (has_positive[v]) continue;
+				}
+
+				auto t = accumulated[side];
+				t = t.length2() > 0 ? t.normalize() : any_perpendicular(n);
+				object.tangents[out] = t;
+				object.bitangents[out] = n.cross(t) * (side == 0 ? 1.f : -1.f);
+			}
+		}
+	}, 2048);
+
+	object.indices.swap(new_indices);
+	return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "Files/FileFormat.hpp"
+
+// Smooth per vertex tangent frames, following the MikkTSpace conventions so normal maps baked by
+// the usual tools (Blender, Substance, xNormal...) look right:
+// - the face tangent is projected on the vertex normal plane and weighted by the corner angle,
+// - vertices shared by faces with mirrored uvs are split, so each side keeps its own frame,
+// - the bitangent is sign * cross(N, T), with sign the handedness of the uv mapping.
+// It's not a bit exact port (the reference also splits on very different tangents inside a
+// smoothing group), but it matches it on every well behaved mesh.
+//
+// The object needs per vertex normals and uvs. A triangle soup is welded first, an indexed mesh
+// can gain vertices (the mirrored ones).
+// The face pass and the per vertex accumulation run on every core, each vertex is owned by
+// exactly one worker that gathers its corners so there is no atomics nor merge step.
+bool generate_tangents(Object_File& object) noexcept;
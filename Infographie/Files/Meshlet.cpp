@@ -0,0 +1,211 @@
+#include "Meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Ritter's bounding sphere, not the smallest one but within a few percent.
+	void bounding_sphere(
+		const std::vector<Vector3f>& positions,
+		const std::vector<uint32_t>& vertices,
+		Vector3f& center,
+		float& radius
+	) noexcept {
+		auto farthest = [&](Vector3f from) {
+			Vector3f best = from;
+			float best_distance = -1;
+			for (auto v : vertices) {
+				float d = (positions[v] - from).length2();
+				if (d > best_distance) {
+					best_distance = d;
+					best = positions[v];
+				}
+			}
+			return best;
+		};
+
+		auto a = farthest(positions[vertices[0]]);
+		auto b = farthest(a);
+		center = (a + b) / 2;
+		radius = (b - a).length() / 2;
+
+		for (auto v : vertices) {
+			float d = (positions[v] - center).length();
+			if (d <= radius) continue;
+
+			// Grow just enough to get the point, moving the center toward it.
+			float new_radius = (radius + d) / 2;
+			center += (positions[v] - center) * ((new_radius - radius) / d);
+			radius = new_radius;
+		}
+	}
+
+	void normal_cone(
+		const std::vector<Vector3f>& positions,
+		const uint32_t* indices,
+		size_t triangle_count,
+		Object_File::Meshlet& meshlet
+	) noexcept {
+		std::vector<Vector3f> normals;
+		normals.reserve(triangle_count);
+
+		Vector3f axis;
+		for (size_t t = 0; t < triangle_count; ++t) {
+			auto& p0 = positions[indices[3 * t + 0]];
+			auto& p1 = positions[indices[3 * t + 1]];
+			auto& p2 = positions[indices[3 * t + 2]];
+			auto n = (p1 - p0).cross(p2 - p0);
+			if (!(n.length2() > 0)) continue;
+			n.normalize();
+			normals.push_back(n);
+			axis += n;
+		}
+		if (normals.empty() || !(axis.length2() > 0)) return;
+		axis.normalize();
+
+		float min_dot = 1;
+		for (auto& n : normals) min_dot = std::min(min_dot, n.dot(axis));
+
+		// Past ~85 degrees the cone culls next to nothing and the apex goes to infinity.
+		if (min_dot <= 0.1f) return;
+
+		// The apex is the point behind every face plane, from there every face is seen edge on
+		// or from behind.
+		float max_t = 0;
+		size_t k = 0;
+		for (size_t t = 0; t < triangle_count; ++t) {
+			auto& p0 = positions[indices[3 * t + 0]];
+			auto& p1 = positions[indices[3 * t + 1]];
+			auto& p2 = positions[indices[3 * t + 2]];
+			if (!((p1 - p0).cross(p2 - p0).length2() > 0)) continue;
+			auto& n = normals[k++];
+
+			float dc = (meshlet.center - p0).dot(n);
+			float dn = n.dot(axis);
+			max_t = std::max(max_t, dc / dn);
+		}
+
+		meshlet.cone_axis = axis;
+		meshlet.cone_apex = meshlet.center - axis * max_t;
+		meshlet.cone_cutoff = std::sqrt(1 - min_dot * min_dot);
+	}
+};
+
+void build_meshlets(Object_File& object, size_t max_vertices, size_t max_triangles) noexcept {
+	object.weld();
+	object.meshlets.clear();
+
+	const auto& positions = object.vertices;
+	const auto& indices = object.indices;
+	size_t n_vertices = positions.size();
+	size_t n_triangles = indices.size() / 3;
+	if (n_triangles == 0) return;
+
+	std::vector<uint32_t> offsets(n_vertices + 1, 0);
+	for (auto i : indices) offsets[i + 1]++;
+	for (size_t v = 0; v < n_vertices; ++v) offsets[v + 1] += offsets[v];
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t c = 0; c < indices.size(); ++c) adjacency[cursor[indices[c]]++] = c / 3;
+	}
+
+	std::vector<uint8_t> used(n_triangles, 0);
+	// Id of the last meshlet a vertex went into, to know if it's in the current one.
+	constexpr uint32_t None = UINT32_MAX;
+	std::vector<uint32_t> meshlet_of(n_vertices, None);
+
+	std::vector<uint32_t> new_indices;
+	new_indices.reserve(indices.size());
+
+	std::vector<uint32_t> vertices;
+	size_t seed_cursor = 0;
+	while (true) {
+		while (seed_cursor < n_triangles && used[seed_cursor]) seed_cursor++;
+		if (seed_cursor == n_triangles) break;
+
+		uint32_t id = (uint32_t)object.meshlets.size();
+		Object_File::Meshlet meshlet;
+		meshlet.triangle_offset = (uint32_t)(new_indices.size() / 3);
+		vertices.clear();
+		Vector3f sum;
+
+		auto new_vertices = [&](size_t t) {
+			size_t count = 0;
+			for (size_t k = 0; k < 3; ++k) {
+				auto v = indices[3 * t + k];
+				// The same vertex twice in a triangle (degenerate) doesn't count twice.
+				bool repeated =
+					(k > 0 && v == indices[3 * t]) || (k > 1 && v == indices[3 * t + 1]);
+				if (meshlet_of[v] != id && !repeated) count++;
+			}
+			return count;
+		};
+		auto add = [&](size_t t) {
+			used[t] = 1;
+			meshlet.triangle_count++;
+			for (size_t k = 0; k < 3; ++k) {
+				auto v = indices[3 * t + k];
+				new_indices.push_back(v);
+				if (meshlet_of[v] == id) continue;
+				meshlet_of[v] = id;
+				vertices.push_back(v);
+				sum += positions[v];
+			}
+		};
+
+		add(seed_cursor);
+		while (meshlet.triangle_count < max_triangles) {
+			auto centroid = sum / (float)vertices.size();
+
+			size_t best = n_triangles;
+			size_t best_new = 4;
+			float best_distance = INFINITY;
+			for (auto v : vertices) {
+				for (size_t k = offsets[v]; k < offsets[v + 1]; ++k) {
+					auto t = adjacency[k];
+					if (used[t]) continue;
+
+					size_t extra = new_vertices(t);
+					if (vertices.size() + extra > max_vertices) continue;
+					if (extra > best_new) continue;
+
+					auto c = (
+						positions[indices[3 * t + 0]] +
+						positions[indices[3 * t + 1]] +
+						positions[indices[3 * t + 2]]
+					) / 3.f;
+					float distance = (c - centroid).length2();
+					if (extra == best_new && distance >= best_distance) continue;
+
+					best = t;
+					best_new = extra;
+					best_distance = distance;
+				}
+			}
+			if (best == n_triangles) break;
+			add(best);
+		}
+
+		meshlet.vertex_count = (uint32_t)vertices.size();
+		bounding_sphere(positions, vertices, meshlet.center, meshlet.radius);
+		normal_cone(
+			positions,
+			&new_indices[3 * meshlet.triangle_offset],
+			meshlet.triangle_count,
+			meshlet
+		);
+		object.meshlets.push_back(meshlet);
+	}
+
+	object.indices.swap(new_indices);
+}
+
+bool is_backfacing(const Object_File::Meshlet& meshlet, Vector3f viewer) noexcept {
+	if (meshlet.cone_cutoff > 1) return false;
+
+	auto to_apex = meshlet.cone_apex - viewer;
+	float length = to_apex.length();
+	if (!(length > 0)) return false;
+	return to_apex.dot(meshlet.cone_axis) >= meshlet.cone_cutoff * length;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+
+#include "Files/FileFormat.hpp"
+
+// Numbers that fit a mesh shader workgroup, and small enough for the culling to be useful.
+constexpr size_t Meshlet_Max_Vertices = 64;
+constexpr size_t Meshlet_Max_Triangles = 124;
+
+// Fill object.meshlets and reorder object.indices so each meshlet is a contiguous range of it.
+// A meshlet grows from a seed triangle by taking the neighbour that brings the fewest new
+// vertices (then the closest one), seeds are taken in the current index order so run this
+// after optimize_vertex_cache to keep its order.
+// The object is welded if it is a triangle soup. The lods are untouched.
+void build_meshlets(
+	Object_File& object,
+	size_t max_vertices = Meshlet_Max_Vertices,
+	size_t max_triangles = Meshlet_Max_Triangles
+) noexcept;
+
+// viewer is in the same space as the mesh.
+bool is_backfacing(const Object_File::Meshlet& meshlet, Vector3f viewer) noexcept;
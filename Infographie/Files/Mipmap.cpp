@@ -0,0 +1,535 @@
+#include "Mipmap.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <type_traits>
+
+#include "Files/BinaryIO.hpp"
+#include "OS/FileIO.hpp"
+#include "Utils/Parallel.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPMAP_SSE
+#endif
+
+namespace {
+	constexpr float Pi = 3.14159265358979f;
+	constexpr char Magic[4] = { 'I', 'G', 'M', 'P' };
+	const std::filesystem::path Cache_Dir = "cache/mips";
+
+	// With alpha_weighted, a color is weighted by a * (1 - e) + e rather than by a, so where
+	// everything is transparent we still get the plain average instead of 0 / 0. It's affine in
+	// a so the filtered weight comes straight from the filtered alpha, we don't store it.
+	constexpr float Alpha_Epsilon = 1.f / 1024;
+
+	// A texel is 4 floats, exactly one sse register, so every tap is a single multiply add.
+	struct Texel {
+#ifdef MIPMAP_SSE
+		__m128 v;
+
+		static Texel zero() noexcept { return { _mm_setzero_ps() }; }
+		static Texel load(const float* p) noexcept { return { _mm_loadu_ps(p) }; }
+		void store(float* p) const noexcept { _mm_storeu_ps(p, v); }
+		void add(Texel t, float w) noexcept {
+			v = _mm_add_ps(v, _mm_mul_ps(t.v, _mm_set1_ps(w)));
+		}
+#else
+		float v[4];
+
+		static Texel zero() noexcept { return { { 0, 0, 0, 0 } }; }
+		static Texel load(const float* p) noexcept { return { { p[0], p[1], p[2], p[3] } }; }
+		void store(float* p) const noexcept { for (size_t i = 0; i < 4; ++i) p[i] = v[i]; }
+		void add(Texel t, float w) noexcept { for (size_t i = 0; i < 4; ++i) v[i] += t.v[i] * w; }
+#endif
+	};
+
+	float sinc(float x) noexcept {
+		if (std::abs(x) < 1e-6f) return 1;
+		x *= Pi;
+		return std::sin(x) / x;
+	}
+
+	double bessel_i0(double x) noexcept {
+		double sum = 1;
+		double term = 1;
+		for (int k = 1; k < 64; ++k) {
+			double t = x / (2 * k);
+			term *= t * t;
+			sum += term;
+			if (term < 1e-12 * sum) break;
+		}
+		return sum;
+	}
+
+	// Radius in destination texels.
+	float support(Mip_Filter filter) noexcept {
+		return filter == Mip_Filter::Box ? 0.5f : 3.f;
+	}
+
+	float kernel(Mip_Filter filter, float x) noexcept {
+		x = std::abs(x);
+		switch (filter) {
+		case Mip_Filter::Box:
+			return x < 0.5f ? 1.f : (x == 0.5f ? 0.5f : 0.f);
+		case Mip_Filter::Kaiser: {
+			// Same width and alpha as nvtt.
+			constexpr float Width = 3;
+			constexpr double Alpha = 4;
+			static const double i0_alpha = bessel_i0(Alpha);
+			if (x >= Width) return 0;
+			float t = x / Width;
+			return sinc(x) * (float)(bessel_i0(Alpha * std::sqrt(1 - t * t)) / i0_alpha);
+		}
+		case Mip_Filter::Lanczos:
+			return x < 3 ? sinc(x) * sinc(x / 3) : 0;
+		default:
+			return 0;
+		}
+	}
+
+	// For every destination texel along one axis, which source texels it reads and how much.
+	struct Filter_Table {
+		std::vector<uint32_t> offsets{ 0 };
+		std::vector<uint32_t> taps;
+		std::vector<float> weights;
+	};
+
+	Filter_Table make_table(uint32_t src, uint32_t dst, const Mip_Options& options) noexcept {
+		Filter_Table table;
+		if (src == dst) {
+			for (uint32_t i = 0; i < dst; ++i) {
+				table.taps.push_back(i);
+				table.weights.push_back(1);
+				table.offsets.push_back((uint32_t)table.taps.size());
+			}
+			return table;
+		}
+
+		float scale = (float)src / dst;
+		float radius = support(options.filter) * scale;
+		for (uint32_t i = 0; i < dst; ++i) {
+			float center = (i + 0.5f) * scale;
+			int first = (int)std::floor(center - radius - 0.5f);
+			int last = (int)std::ceil(center + radius - 0.5f);
+
+			size_t start = table.taps.size();
+			float sum = 0;
+			for (int j = first; j <= last; ++j) {
+				float w = kernel(options.filter, (j + 0.5f - center) / scale);
+				if (w == 0) continue;
+
+				int s = (int)src;
+				int tap = options.wrap ? ((j % s) + s) % s : std::clamp(j, 0, s - 1);
+				table.taps.push_back((uint32_t)tap);
+				table.weights.push_back(w);
+				sum += w;
+			}
+			for (size_t k = start; k < table.weights.size(); ++k) table.weights[k] /= sum;
+			table.offsets.push_back((uint32_t)table.taps.size());
+		}
+		return table;
+	}
+
+	// A worker should get at least this many texels, below that spawning it costs more than it
+	// saves.
+	constexpr size_t Texels_Per_Worker = 16 * 1024;
+
+	size_t rows_per_worker(uint32_t width) noexcept {
+		return std::max(Texels_Per_Worker / std::max(width, 1u), (size_t)1);
+	}
+
+	// Separable, the rows first then the columns. The vertical pass goes a whole row at a time so
+	// it reads the memory in order.
+	void downsample(
+		const std::vector<float>& in,
+		uint32_t width,
+		uint32_t height,
+		std::vector<float>& out,
+		uint32_t out_width,
+		uint32_t out_height,
+		const Mip_Options& options,
+		std::vector<float>& scratch
+	) noexcept {
+		auto horizontal = make_table(width, out_width, options);
+		auto vertical = make_table(height, out_height, options);
+
+		scratch.resize((size_t)out_width * height * 4);
+		parallel_for(height, [&](size_t begin, size_t end, size_t) {
+			for (size_t y = begin; y < end; ++y) {
+				const float* row = &in[y * width * 4];
+				float* dst = &scratch[y * out_width * 4];
+				for (size_t x = 0; x < out_width; ++x) {
+					auto acc = Texel::zero();
+					for (size_t k = horizontal.offsets[x]; k < horizontal.offsets[x + 1]; ++k) {
+						acc.add(Texel::load(row + 4 * horizontal.taps[k]), horizontal.weights[k]);
+					}
+					acc.store(dst + 4 * x);
+				}
+			}
+		}, rows_per_worker(out_width));
+
+		out.resize((size_t)out_width * out_height * 4);
+		parallel_for(out_height, [&](size_t begin, size_t end, size_t) {
+			for (size_t y = begin; y < end; ++y) {
+				float* dst = &out[y * out_width * 4];
+				std::fill(dst, dst + out_width * 4, 0.f);
+				for (size_t k = vertical.offsets[y]; k < vertical.offsets[y + 1]; ++k) {
+					const float* row = &scratch[(size_t)vertical.taps[k] * out_width * 4];
+					float w = vertical.weights[k];
+					for (size_t x = 0; x < out_width; ++x) {
+						auto acc = Texel::load(dst + 4 * x);
+						acc.add(Texel::load(row + 4 * x), w);
+						acc.store(dst + 4 * x);
+					}
+				}
+			}
+		}, rows_per_worker(out_width));
+	}
+
+	const float* srgb_to_linear_table() noexcept {
+		static const auto table = [] {
+			std::array<float, 256> t;
+			for (size_t i = 0; i < t.size(); ++i) {
+				float c = i / 255.f;
+				t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return t;
+		}();
+		return table.data();
+	}
+
+	// Indexed by the linear value on 16 bits, fine enough that even the darkest steps of the
+	// 8 bit sRGB curve (where it's the steepest) get their own entries.
+	constexpr size_t Linear_Steps = 65535;
+
+	const uint8_t* linear_to_srgb_table() noexcept {
+		static const auto table = [] {
+			std::vector<uint8_t> t(Linear_Steps + 1);
+			for (size_t i = 0; i <= Linear_Steps; ++i) {
+				float l = (float)i / Linear_Steps;
+				float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1 / 2.4f) - 0.055f;
+				t[i] = (uint8_t)std::clamp(c * 255 + 0.5f, 0.f, 255.f);
+			}
+			return t;
+		}();
+		return table.data();
+	}
+
+	float weight_of(float alpha) noexcept {
+		return alpha * (1 - Alpha_Epsilon) + Alpha_Epsilon;
+	}
+
+	// To the linear alpha weighted texels we filter.
+	template<typename T>
+	std::vector<float> to_linear(
+		const T* rgba, uint32_t width, uint32_t height, const Mip_Options& options
+	) noexcept {
+		size_t n = (size_t)width * height;
+		std::vector<float> linear(n * 4);
+		const float* srgb = srgb_to_linear_table();
+		bool decode_srgb = options.srgb && !options.normal_map;
+
+		parallel_for(n, [&](size_t begin, size_t end, size_t) {
+			for (size_t i = begin; i < end; ++i) {
+				float* t = &linear[4 * i];
+				for (size_t c = 0; c < 4; ++c) {
+					if constexpr (std::is_same_v<T, uint8_t>) {
+						uint8_t x = rgba[4 * i + c];
+						t[c] = (decode_srgb && c < 3) ? srgb[x] : x / 255.f;
+					}
+					else {
+						t[c] = rgba[4 * i + c];
+					}
+				}
+				// Float images can have anything in there, the weight needs it in [0, 1].
+				t[3] = std::clamp(t[3], 0.f, 1.f);
+				if (options.alpha_weighted) {
+					float w = weight_of(t[3]);
+					for (size_t c = 0; c < 3; ++c) t[c] *= w;
+				}
+			}
+		}, Texels_Per_Worker);
+		return linear;
+	}
+
+	// And back to what the caller gave us.
+	template<typename T>
+	Mip_Level<T> from_linear(
+		const std::vector<float>& linear,
+		uint32_t width,
+		uint32_t height,
+		const Mip_Options& options
+	) noexcept {
+		Mip_Level<T> level;
+		level.width = width;
+		level.height = height;
+
+		size_t n = (size_t)width * height;
+		level.pixels.resize(n * 4);
+		const uint8_t* srgb = linear_to_srgb_table();
+		bool encode_srgb = options.srgb && !options.normal_map;
+
+		parallel_for(n, [&](size_t begin, size_t end, size_t) {
+			for (size_t i = begin; i < end; ++i) {
+				float t[4];
+				for (size_t c = 0; c < 4; ++c) t[c] = linear[4 * i + c];
+
+				// The negative lobes of the sinc can overshoot.
+				t[3] = std::clamp(t[3], 0.f, 1.f);
+				if (options.alpha_weighted) {
+					float w = weight_of(t[3]);
+					for (size_t c = 0; c < 3; ++c) t[c] /= w;
+				}
+
+				constexpr bool unorm = std::is_same_v<T, uint8_t>;
+				if (options.normal_map) {
+					float n[3];
+					for (size_t c = 0; c < 3; ++c) n[c] = unorm ? t[c] * 2 - 1 : t[c];
+					float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					if (length > 0) for (size_t c = 0; c < 3; ++c) n[c] /= length;
+					for (size_t c = 0; c < 3; ++c) t[c] = unorm ? n[c] * 0.5f + 0.5f : n[c];
+				}
+				else {
+					for (size_t c = 0; c < 3; ++c) t[c] = std::max(t[c], 0.f);
+				}
+
+				T* dst = &level.pixels[4 * i];
+				if constexpr (unorm) {
+					for (size_t c = 0; c < 4; ++c) {
+						float x = std::min(t[c], 1.f);
+						dst[c] = (encode_srgb && c < 3) ?
+							srgb[(size_t)(x * Linear_Steps + 0.5f)] :
+							(uint8_t)(x * 255 + 0.5f);
+					}
+				}
+				else {
+					for (size_t c = 0; c < 4; ++c) dst[c] = t[c];
+				}
+			}
+		}, Texels_Per_Worker);
+		return level;
+	}
+
+	template<typename T>
+	std::vector<Mip_Level<T>> generate(
+		const T* rgba, uint32_t width, uint32_t height, const Mip_Options& options
+	) noexcept {
+		std::vector<Mip_Level<T>> mips;
+		if (options.filter == Mip_Filter::None || width == 0 || height == 0) return mips;
+
+		// Each level comes from the previous one, from the base level every time would need
+		// huge kernels at the bottom of the chain for almost the same result.
+		auto current = to_linear(rgba, width, height, options);
+		std::vector<float> next;
+		std::vector<float> scratch;
+		while (width > 1 || height > 1) {
+			uint32_t w = std::max(width / 2, 1u);
+			uint32_t h = std::max(height / 2, 1u);
+			downsample(current, width, height, next, w, h, options, scratch);
+			mips.push_back(from_linear<T>(next, w, h, options));
+
+			current.swap(next);
+			width = w;
+			height = h;
+		}
+		return mips;
+	}
+
+	std::filesystem::path cache_path(
+		const std::filesystem::path& source, const Mip_Options& options
+	) noexcept {
+		std::error_code ec;
+		auto absolute = std::filesystem::absolute(source, ec).generic_string();
+
+		char name[64];
+		snprintf(
+			name,
+			sizeof(name),
+			"%016llx_%08x.mip",
+			(unsigned long long)stable_hash(absolute),
+			options.to_bits()
+		);
+		return Cache_Dir / name;
+	}
+};
+
+std::vector<Mip_Level<uint8_t>> generate_mips(
+	const uint8_t* rgba, uint32_t width, uint32_t height, const Mip_Options& options
+) noexcept {
+	return generate(rgba, width, height, options);
+}
+
+std::vector<Mip_Level<float>> generate_mips(
+	const float* rgba, uint32_t width, uint32_t height, const Mip_Options& options
+) noexcept {
+	return generate(rgba, width, height, options);
+}
+
+Mip_Level<uint8_t> downscale_to_fit(
+	const uint8_t* rgba,
+	uint32_t width,
+	uint32_t height,
+	uint32_t max_size,
+	const Mip_Options& options
+) noexcept {
+	Mip_Level<uint8_t> level;
+	level.width = width;
+	level.height = height;
+
+	uint32_t longest = std::max(width, height);
+	if (longest <= max_size) {
+		level.pixels.assign(rgba, rgba + (size_t)width * height * 4);
+		return level;
+	}
+	level.width = std::max((uint32_t)((uint64_t)width * max_size / longest), 1u);
+	level.height = std::max((uint32_t)((uint64_t)height * max_size / longest), 1u);
+
+	auto filtered = options;
+	if (filtered.filter == Mip_Filter::None) filtered.filter = Mip_Filter::Box;
+
+	auto linear = to_linear(rgba, width, height, filtered);
+	std::vector<float> out;
+	std::vector<float> scratch;
+	downsample(linear, width, height, out, level.width, level.height, filtered, scratch);
+	return from_linear<uint8_t>(out, level.width, level.height, filtered);
+}
+
+Mip_Level<uint8_t> box_downscale_to_fit(
+	const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t max_size
+) noexcept {
+	Mip_Level<uint8_t> level;
+	uint32_t longest = std::max(width, height);
+	uint32_t factor = (longest + std::max(max_size, 1u) - 1) / std::max(max_size, 1u);
+	factor = std::max(factor, 1u);
+	level.width = (width + factor - 1) / factor;
+	level.height = (height + factor - 1) / factor;
+	level.pixels.resize((size_t)level.width * level.height * 4);
+
+	// The blocks on the right and bottom edges can be cut short, they average what they have.
+	parallel_for(level.height, [&](size_t begin, size_t end, size_t) {
+		std::vector<uint32_t> sums((size_t)level.width * 4);
+		for (size_t y = begin; y < end; ++y) {
+			std::fill(std::begin(sums), std::end(sums), 0);
+			uint32_t y0 = (uint32_t)y * factor;
+			uint32_t y1 = std::min(y0 + factor, height);
+			for (uint32_t sy = y0; sy < y1; ++sy) {
+				auto row = rgba + (size_t)sy * width * 4;
+				for (uint32_t x = 0; x < level.width; ++x) {
+					auto sum = sums.data() + (size_t)x * 4;
+					auto from = row + (size_t)x * factor * 4;
+					auto to = row + (size_t)std::min(x * factor + factor, width) * 4;
+					for (auto p = from; p < to; p += 4) {
+						for (size_t c = 0; c < 4; ++c) sum[c] += p[c];
+					}
+				}
+			}
+
+			auto out = level.pixels.data() + y * level.width * 4;
+			for (uint32_t x = 0; x < level.width; ++x) {
+				uint32_t x0 = x * factor;
+				uint32_t count = (std::min(x0 + factor, width) - x0) * (y1 - y0);
+				for (size_t c = 0; c < 4; ++c) {
+					out[(size_t)x * 4 + c] = (uint8_t)((sums[x * 4 + c] + count / 2) / count);
+				}
+			}
+		}
+	}, rows_per_worker(width * factor));
+	return level;
+}
+
+std::optional<std::vector<Mip_Level<uint8_t>>> load_mip_cache(
+	const std::filesystem::path& source, const Mip_Options& options
+) noexcept {
+	auto source_stamp = stamp(source);
+	if (!source_stamp) return std::nullopt;
+
+	auto path = cache_path(source, options);
+	if (!std::filesystem::is_regular_file(path)) return std::nullopt;
+
+	auto bytes = read_whole_file(path);
+	if (!bytes) return std::nullopt;
+
+	Reader reader{ *bytes };
+
+	char magic[4];
+	uint32_t version;
+	uint32_t key;
+	Source_Stamp cached_stamp;
+	if (!reader.pod(magic) || memcmp(magic, Magic, sizeof(Magic)) != 0) return std::nullopt;
+	if (!reader.pod(version) || version != Mip_Cache_Version) return std::nullopt;
+	if (!reader.pod(key) || key != options.to_bits()) return std::nullopt;
+	if (!reader.pod(cached_stamp.size) || cached_stamp.size != source_stamp->size)
+		return std::nullopt;
+	if (!reader.pod(cached_stamp.time) || cached_stamp.time != source_stamp->time)
+		return std::nullopt;
+
+	uint32_t count;
+	if (!reader.pod(count)) return std::nullopt;
+
+	std::vector<Mip_Level<uint8_t>> mips(count);
+	for (auto& level : mips) {
+		bool ok =
+			reader.pod(level.width) &&
+			reader.pod(level.height) &&
+			reader.array(level.pixels);
+		if (!ok || level.pixels.size() != (size_t)level.width * level.height * 4)
+			return std::nullopt;
+	}
+	return mips;
+}
+
+bool save_mip_cache(
+	const std::filesystem::path& source,
+	const Mip_Options& options,
+	const std::vector<Mip_Level<uint8_t>>& mips
+) noexcept {
+	auto source_stamp = stamp(source);
+	if (!source_stamp) return false;
+
+	std::error_code ec;
+	std::filesystem::create_directories(Cache_Dir, ec);
+	if (ec) return false;
+
+	Writer writer;
+	writer.pod(Magic);
+	writer.pod(Mip_Cache_Version);
+	writer.pod(options.to_bits());
+	writer.pod(source_stamp->size);
+	writer.pod(source_stamp->time);
+
+	writer.pod((uint32_t)mips.size());
+	for (auto& level : mips) {
+		writer.pod(level.width);
+		writer.pod(level.height);
+		writer.array(level.pixels);
+	}
+
+	return overwrite_file(cache_path(source, options), writer.bytes) == 0;
+}
+
+std::vector<Mip_Level<uint8_t>> cached_mips(
+	const std::filesystem::path& source,
+	const uint8_t* rgba,
+	uint32_t width,
+	uint32_t height,
+	const Mip_Options& options
+) noexcept {
+	if (options.filter == Mip_Filter::None || width == 0 || height == 0) return {};
+
+	// The stamp could match a different file that happens to have the same size and time, the
+	// first level size is a cheap last check.
+	if (auto mips = load_mip_cache(source, options)) {
+		bool fits =
+			!mips->empty() &&
+			mips->front().width == std::max(width / 2, 1u) &&
+			mips->front().height == std::max(height / 2, 1u);
+		if (fits) return std::move(*mips);
+	}
+
+	auto mips = generate_mips(rgba, width, height, options);
+	save_mip_cache(source, options, mips);
+	return mips;
+}
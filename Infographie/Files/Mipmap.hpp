@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+// Cpu built mip chains, the gpu's glGenerateMipmap is a box filter done in whatever space the
+// texture is stored in, which darkens everything on an sRGB texture.
+
+enum class Mip_Filter : uint8_t {
+	None = 0, // No chain at all, just the base level.
+	Box,      // 2x2 average, the cheapest and the blurriest.
+	Kaiser,   // Windowed sinc, sharp with little ringing. The default.
+	Lanczos,  // Sharper than Kaiser but rings more on hard edges.
+	Count
+};
+
+struct Mip_Options {
+	Mip_Filter filter{ Mip_Filter::Kaiser };
+	// The 8 bit colors are sRGB encoded, we filter them in linear. Off for data textures
+	// (normals, roughness, ...). Never applies to float images.
+	bool srgb{ true };
+	// Renormalize the xyz of every texel, decoded from [0, 1] for 8 bit images.
+	bool normal_map{ false };
+	// Weight the colors by alpha, so the transparent texels don't bleed their color in.
+	bool alpha_weighted{ true };
+	// Sample across the borders as if the texture repeats, otherwise we clamp.
+	bool wrap{ false };
+
+	uint32_t to_bits() const noexcept {
+		return
+			(uint32_t)filter |
+			((uint32_t)srgb << 8) |
+			((uint32_t)normal_map << 9) |
+			((uint32_t)alpha_weighted << 10) |
+			((uint32_t)wrap << 11);
+	}
+};
+
+// RGBA, 4 T per texel.
+template<typename T>
+struct Mip_Level {
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+	std::vector<T> pixels;
+};
+
+// Every level under the base one, down to 1x1, each is the previous one halved (rounded down).
+// Works on any size, not only powers of two. Each level is split in rows between the cores.
+std::vector<Mip_Level<uint8_t>> generate_mips(
+	const uint8_t* rgba, uint32_t width, uint32_t height, const Mip_Options& options = {}
+) noexcept;
+std::vector<Mip_Level<float>> generate_mips(
+	const float* rgba, uint32_t width, uint32_t height, const Mip_Options& options = {}
+) noexcept;
+
+// A single level, straight from the base, with its longest side brought down to max_size (it's
+// never scaled up). For the thumbnails, where most of a chain would be wasted. With the filter
+// None we box filter.
+Mip_Level<uint8_t> downscale_to_fit(
+	const uint8_t* rgba,
+	uint32_t width,
+	uint32_t height,
+	uint32_t max_size,
+	const Mip_Options& options = {}
+) noexcept;
+// Rougher but a lot faster, for the previews of the huge images (where downscale_to_fit takes
+// seconds). Each texel is the plain average of a block of whole texels, straight on the 8 bit
+// values. The blocks are a whole number of texels wide, so the result is at most max_size but
+// can be down to half of it.
+Mip_Level<uint8_t> box_downscale_to_fit(
+	const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t max_size
+) noexcept;
+
+// Same thing as the mesh cache, under cache/mips/, only valid for the exact source file and
+// options it was made from.
+constexpr uint32_t Mip_Cache_Version = 1;
+
+std::optional<std::vector<Mip_Level<uint8_t>>> load_mip_cache(
+	const std::filesystem::path& source, const Mip_Options& options
+) noexcept;
+
+bool save_mip_cache(
+	const std::filesystem::path& source,
+	const Mip_Options& options,
+	const std::vector<Mip_Level<uint8_t>>& mips
+) noexcept;
+
+// From the cache if we can, otherwise generated and saved for the next time.
+std::vector<Mip_Level<uint8_t>> cached_mips(
+	const std::filesystem::path& source,
+	const uint8_t* rgba,
+	uint32_t width,
+	uint32_t height,
+	const Mip_Options& options
+) noexcept;
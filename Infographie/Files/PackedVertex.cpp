@@ -0,0 +1,477 @@
+#include "PackedVertex.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <cmath>
+
+#include "Math/Half.hpp"
+
+namespace {
+	constexpr float Snorm16_Max = 32767.f;
+	constexpr float Unorm16_Max = 65535.f;
+
+	// Octahedral mapping, see "A Survey of Efficient Representations for Independent Unit
+	// Vectors" (Cigolle et al. 2014).
+	void oct_encode(Vector3f n, int16_t out[2]) noexcept {
+		float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+		sum = std::max(sum, 1e-20f);
+
+		float x = n.x / sum;
+		float y = n.y / sum;
+		if (n.z < 0) {
+			float wx = (1 - std::fabs(y)) * (x >= 0 ? 1.f : -1.f);
+			float wy = (1 - std::fabs(x)) * (y >= 0 ? 1.f : -1.f);
+			x = wx;
+			y = wy;
+		}
+
+		x = std::clamp(x, -1.f, 1.f);
+		y = std::clamp(y, -1.f, 1.f);
+		out[0] = (int16_t)std::lrintf(x * Snorm16_Max);
+		out[1] = (int16_t)std::lrintf(y * Snorm16_Max);
+	}
+
+	Vector3f oct_decode(const int16_t in[2]) noexcept {
+		Vector3f n;
+		n.x = std::max(in[0] / Snorm16_Max, -1.f);
+		n.y = std::max(in[1] / Snorm16_Max, -1.f);
+		n.z = 1 - std::fabs(n.x) - std::fabs(n.y);
+
+		float t = std::max(-n.z, 0.f);
+		n.x += n.x >= 0 ? -t : t;
+		n.y += n.y >= 0 ? -t : t;
+		return n.normalize();
+	}
+
+	void oct_encode_n(const Vector3f* in, int16_t* out, size_t n) noexcept {
+		size_t i = 0;
+#ifdef HALF_SSE2
+		const __m128 Sign_Mask = _mm_set1_ps(-0.f);
+		const __m128 Zero = _mm_setzero_ps();
+		const __m128 One = _mm_set1_ps(1.f);
+		const __m128 Minus_One = _mm_set1_ps(-1.f);
+		const __m128 Tiny = _mm_set1_ps(1e-20f);
+		const __m128 Scale = _mm_set1_ps(Snorm16_Max);
+
+		for (; i + 4 <= n; i += 4) {
+			const Vector3f* v = in + i;
+			__m128 x = _mm_setr_ps(v[0].x, v[1].x, v[2].x, v[3].x);
+			__m128 y = _mm_setr_ps(v[0].y, v[1].y, v[2].y, v[3].y);
+			__m128 z = _mm_setr_ps(v[0].z, v[1].z, v[2].z, v[3].z);
+
+			__m128 sum = _mm_add_ps(
+				_mm_add_ps(_mm_andnot_ps(Sign_Mask, x), _mm_andnot_ps(Sign_Mask, y)),
+				_mm_andnot_ps(Sign_Mask, z)
+			);
+			sum = _mm_max_ps(sum, Tiny);
+			x = _mm_div_ps(x, sum);
+			y = _mm_div_ps(y, sum);
+
+			__m128 x_pos = _mm_cmpge_ps(x, Zero);
+			__m128 y_pos = _mm_cmpge_ps(y, Zero);
+			__m128 sx = _mm_or_ps(_mm_and_ps(x_pos, One), _mm_andnot_ps(x_pos, Minus_One));
+			__m128 sy = _mm_or_ps(_mm_and_ps(y_pos, One), _mm_andnot_ps(y_pos, Minus_One));
+			__m128 wx = _mm_mul_ps(_mm_sub_ps(One, _mm_andnot_ps(Sign_Mask, y)), sx);
+			__m128 wy = _mm_mul_ps(_mm_sub_ps(One, _mm_andnot_ps(Sign_Mask, x)), sy);
+
+			__m128 lower = _mm_cmplt_ps(z, Zero);
+			x = _mm_or_ps(_mm_and_ps(lower, wx), _mm_andnot_ps(lower, x));
+			y = _mm_or_ps(_mm_and_ps(lower, wy), _mm_andnot_ps(lower, y));
+
+			x = _mm_min_ps(_mm_max_ps(x, Minus_One), One);
+			y = _mm_min_ps(_mm_max_ps(y, Minus_One), One);
+
+			// cvtps rounds to nearest even, same as lrintf.
+			__m128i qx = _mm_cvtps_epi32(_mm_mul_ps(x, Scale));
+			__m128i qy = _mm_cvtps_epi32(_mm_mul_ps(y, Scale));
+			__m128i q = _mm_packs_epi32(_mm_unpacklo_epi32(qx, qy), _mm_unpackhi_epi32(qx, qy));
+			_mm_storeu_si128((__m128i*)(out + 2 * i), q);
+		}
+#endif
+		for (; i < n; ++i) oct_encode(in[i], out + 2 * i);
+	}
+
+	void oct_decode_n(const int16_t* in, Vector3f* out, size_t n) noexcept {
+		size_t i = 0;
+#ifdef HALF_SSE2
+		const __m128 Sign_Mask = _mm_set1_ps(-0.f);
+		const __m128 Zero = _mm_setzero_ps();
+		const __m128 One = _mm_set1_ps(1.f);
+		const __m128 Minus_One = _mm_set1_ps(-1.f);
+		const __m128 Inv_Scale = _mm_set1_ps(1.f / Snorm16_Max);
+
+		for (; i + 4 <= n; i += 4) {
+			__m128i q = _mm_loadu_si128((const __m128i*)(in + 2 * i));
+			// sign extend the int16 to int32.
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(q, q), 16);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(q, q), 16);
+			__m128 flo = _mm_cvtepi32_ps(lo);
+			__m128 fhi = _mm_cvtepi32_ps(hi);
+
+			__m128 x = _mm_shuffle_ps(flo, fhi, _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 y = _mm_shuffle_ps(flo, fhi, _MM_SHUFFLE(3, 1, 3, 1));
+			// Not a division so this can be 1 ulp off the scalar version, we renormalize anyway.
+			x = _mm_max_ps(_mm_mul_ps(x, Inv_Scale), Minus_One);
+			y = _mm_max_ps(_mm_mul_ps(y, Inv_Scale), Minus_One);
+			__m128 z = _mm_sub_ps(
+				_mm_sub_ps(One, _mm_andnot_ps(Sign_Mask, x)), _mm_andnot_ps(Sign_Mask, y)
+			);
+
+			__m128 t = _mm_max_ps(_mm_sub_ps(Zero, z), Zero);
+			__m128 x_pos = _mm_cmpge_ps(x, Zero);
+			__m128 y_pos = _mm_cmpge_ps(y, Zero);
+			// x += x >= 0 ? -t : t
+			x = _mm_add_ps(x, _mm_xor_ps(t, _mm_and_ps(x_pos, Sign_Mask)));
+			y = _mm_add_ps(y, _mm_xor_ps(t, _mm_and_ps(y_pos, Sign_Mask)));
+
+			__m128 length2 = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)
+			);
+			__m128 inv_length = _mm_div_ps(One, _mm_sqrt_ps(length2));
+			x = _mm_mul_ps(x, inv_length);
+			y = _mm_mul_ps(y, inv_length);
+			z = _mm_mul_ps(z, inv_length);
+
+			alignas(16) float xs[4];
+			alignas(16) float ys[4];
+			alignas(16) float zs[4];
+			_mm_store_ps(xs, x);
+			_mm_store_ps(ys, y);
+			_mm_store_ps(zs, z);
+			for (size_t j = 0; j < 4; ++j) out[i + j] = { xs[j], ys[j], zs[j] };
+		}
+#endif
+		for (; i < n; ++i) out[i] = oct_decode(in + 2 * i);
+	}
+
+	// The positions are a flat array of x, y, z, x, y, z... so we go through them 12 floats
+	// (4 vertices) at a time with the min/scale pattern rotating through the 3 registers.
+	void quantize_positions(
+		const Vector3f* in, uint16_t* out, size_t n, Vector3f min, Vector3f inv_extent
+	) noexcept {
+		const float* f = &in[0].x;
+		size_t n_floats = 3 * n;
+		size_t i = 0;
+#ifdef HALF_SSE2
+		const __m128 Zero = _mm_setzero_ps();
+		const __m128 Max = _mm_set1_ps(Unorm16_Max);
+		const __m128i Bias = _mm_set1_epi32(32768);
+		const __m128i Flip = _mm_set1_epi16((short)0x8000);
+
+		const __m128 min_pattern[3] = {
+			_mm_setr_ps(min.x, min.y, min.z, min.x),
+			_mm_setr_ps(min.y, min.z, min.x, min.y),
+			_mm_setr_ps(min.z, min.x, min.y, min.z),
+		};
+		const __m128 scale_pattern[3] = {
+			_mm_mul_ps(_mm_setr_ps(inv_extent.x, inv_extent.y, inv_extent.z, inv_extent.x), Max),
+			_mm_mul_ps(_mm_setr_ps(inv_extent.y, inv_extent.z, inv_extent.x, inv_extent.y), Max),
+			_mm_mul_ps(_mm_setr_ps(inv_extent.z, inv_extent.x, inv_extent.y, inv_extent.z), Max),
+		};
+
+		for (; i + 12 <= n_floats; i += 12) {
+			__m128i q[3];
+			for (size_t j = 0; j < 3; ++j) {
+				__m128 v = _mm_loadu_ps(f + i + 4 * j);
+				v = _mm_mul_ps(_mm_sub_ps(v, min_pattern[j]), scale_pattern[j]);
+				v = _mm_min_ps(_mm_max_ps(v, Zero), Max);
+				// No unsigned saturating pack in sse2, so we go through int16 and flip back.
+				q[j] = _mm_sub_epi32(_mm_cvtps_epi32(v), Bias);
+			}
+			__m128i a = _mm_xor_si128(_mm_packs_epi32(q[0], q[1]), Flip);
+			__m128i b = _mm_xor_si128(_mm_packs_epi32(q[2], q[2]), Flip);
+			_mm_storeu_si128((__m128i*)(out + i), a);
+			_mm_storel_epi64((__m128i*)(out + i + 8), b);
+		}
+#endif
+		for (; i < n_floats; ++i) {
+			size_t axis = i % 3;
+			float v = (f[i] - min[axis]) * (inv_extent[axis] * Unorm16_Max);
+			out[i] = (uint16_t)std::lrintf(std::clamp(v, 0.f, Unorm16_Max));
+		}
+	}
+
+	void dequantize_positions(
+		const uint16_t* in, Vector3f* out, size_t n, Vector3f offset, Vector3f scale
+	) noexcept {
+		float* f = &out[0].x;
+		size_t n_floats = 3 * n;
+		size_t i = 0;
+#ifdef HALF_SSE2
+		const __m128 Inv_Max = _mm_set1_ps(1.f / Unorm16_Max);
+		const __m128 offset_pattern[3] = {
+			_mm_setr_ps(offset.x, offset.y, offset.z, offset.x),
+			_mm_setr_ps(offset.y, offset.z, offset.x, offset.y),
+			_mm_setr_ps(offset.z, offset.x, offset.y, offset.z),
+		};
+		const __m128 scale_pattern[3] = {
+			_mm_mul_ps(_mm_setr_ps(scale.x, scale.y, scale.z, scale.x), Inv_Max),
+			_mm_mul_ps(_mm_setr_ps(scale.y, scale.z, scale.x, scale.y), Inv_Max),
+			_mm_mul_ps(_mm_setr_ps(scale.z, scale.x, scale.y, scale.z), Inv_Max),
+		};
+
+		for (; i + 12 <= n_floats; i += 12) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+			__m128i b = _mm_loadl_epi64((const __m128i*)(in + i + 8));
+			__m128i q[3] = {
+				_mm_unpacklo_epi16(a, _mm_setzero_si128()),
+				_mm_unpackhi_epi16(a, _mm_setzero_si128()),
+				_mm_unpacklo_epi16(b, _mm_setzero_si128()),
+			};
+			for (size_t j = 0; j < 3; ++j) {
+				__m128 v = _mm_cvtepi32_ps(q[j]);
+				v = _mm_add_ps(_mm_mul_ps(v, scale_pattern[j]), offset_pattern[j]);
+				_mm_storeu_ps(f + i + 4 * j, v);
+			}
+		}
+#endif
+		for (; i < n_floats; ++i) {
+			size_t axis = i % 3;
+			f[i] = in[i] * (scale[axis] / Unorm16_Max) + offset[axis];
+		}
+	}
+
+	template<typename Vertex_T>
+	void interleave(
+		Packed_Object_File& packed,
+		const Object_File& object,
+		const std::vector<uint16_t>& uvs,
+		const std::vector<int16_t>& normals,
+		const std::vector<int16_t>& tangents,
+		const std::vector<uint16_t>& positions
+	) noexcept {
+		auto* out = (Vertex_T*)packed.bytes.data();
+		for (size_t i = 0; i < packed.count; ++i) {
+			Vertex_T& v = out[i];
+			memset(&v, 0, sizeof(v));
+
+			if constexpr (std::is_same_v<Vertex_T, Packed_Vertex_Unorm16>) {
+				memcpy(v.position, positions.data() + 3 * i, sizeof(v.position));
+			} else {
+				memcpy(v.position, &object.vertices[i].x, sizeof(v.position));
+			}
+			memcpy(v.uv, uvs.data() + 2 * i, sizeof(v.uv));
+			memcpy(v.normal, normals.data() + 2 * i, sizeof(v.normal));
+			memcpy(v.tangent, tangents.data() + 2 * i, sizeof(v.tangent));
+
+			// The handedness is taken against the original (not quantized) frame.
+			if (i < object.bitangents.size()) {
+				auto n = i < object.normals.size() ? object.normals[i] : Vector3f{};
+				auto t = i < object.tangents.size() ? object.tangents[i] : Vector3f{};
+				if (n.cross(t).dot(object.bitangents[i]) < 0)
+					v.flags |= Packed_Vertex_Flag_Bitangent_Flip;
+			}
+		}
+	}
+
+	template<typename Vertex_T>
+	void deinterleave(
+		const Packed_Object_File& packed,
+		std::vector<uint16_t>& uvs,
+		std::vector<int16_t>& normals,
+		std::vector<int16_t>& tangents,
+		std::vector<uint16_t>& positions,
+		std::vector<bool>& flips
+	) noexcept {
+		auto* in = (const Vertex_T*)packed.bytes.data();
+		for (size_t i = 0; i < packed.count; ++i) {
+			const Vertex_T& v = in[i];
+			if constexpr (std::is_same_v<Vertex_T, Packed_Vertex_Unorm16>) {
+				memcpy(positions.data() + 3 * i, v.position, sizeof(v.position));
+			}
+			memcpy(uvs.data() + 2 * i, v.uv, sizeof(v.uv));
+			memcpy(normals.data() + 2 * i, v.normal, sizeof(v.normal));
+			memcpy(tangents.data() + 2 * i, v.tangent, sizeof(v.tangent));
+			flips[i] = v.flags & Packed_Vertex_Flag_Bitangent_Flip;
+		}
+	}
+
+	float angle_between(Vector3f a, Vector3f b) noexcept {
+		// atan2 stay precise for tiny angles where acos(dot) would just return 0.
+		return std::atan2(a.cross(b).length(), a.dot(b));
+	}
+};
+
+Packed_Object_File Packed_Object_File::pack(
+	const Object_File& object, Position_Format format
+) noexcept {
+	Packed_Object_File packed;
+	packed.format = format;
+	packed.count = object.vertices.size();
+	packed.min = object.min;
+	packed.max = object.max;
+	packed.indices = object.indices;
+	packed.lods = object.lods;
+	packed.meshlets = object.meshlets;
+
+	switch (format) {
+	case Position_Format::Float:
+		packed.stride = sizeof(Packed_Vertex_Float);
+		break;
+	case Position_Format::Unorm16:
+		packed.stride = sizeof(Packed_Vertex_Unorm16);
+		break;
+	default:
+		assert(false && "Unknown position format");
+		return packed;
+	}
+	packed.bytes.resize(packed.count * packed.stride);
+
+	// Missing attributes (no uv in the obj for instance) are packed as zeros.
+	auto padded = [n = packed.count](const auto& vec) {
+		auto copy = vec;
+		copy.resize(n);
+		return copy;
+	};
+	auto src_uvs = padded(object.uvs);
+	auto src_normals = padded(object.normals);
+	auto src_tangents = padded(object.tangents);
+
+	std::vector<uint16_t> uvs(2 * packed.count);
+	std::vector<int16_t> normals(2 * packed.count);
+	std::vector<int16_t> tangents(2 * packed.count);
+	std::vector<uint16_t> positions;
+
+	if (packed.count) half::from_float_n(&src_uvs[0].x, uvs.data(), 2 * packed.count);
+	oct_encode_n(src_normals.data(), normals.data(), packed.count);
+	oct_encode_n(src_tangents.data(), tangents.data(), packed.count);
+
+	if (format == Position_Format::Unorm16) {
+		// The min/max of the file can be stale (or just wrong), so we recompute them.
+		Vector3f min = packed.count ? object.vertices[0] : Vector3f{};
+		Vector3f max = min;
+		for (auto& v : object.vertices) {
+			for (size_t i = 0; i < 3; ++i) {
+				min[i] = std::min(min[i], v[i]);
+				max[i] = std::max(max[i], v[i]);
+			}
+		}
+
+		Vector3f extent = max - min;
+		Vector3f inv_extent;
+		for (size_t i = 0; i < 3; ++i) inv_extent[i] = extent[i] > 0 ? 1 / extent[i] : 0;
+
+		packed.position_offset = min;
+		packed.position_scale = extent;
+
+		positions.resize(3 * packed.count);
+		quantize_positions(
+			object.vertices.data(), positions.data(), packed.count, min, inv_extent
+		);
+		interleave<Packed_Vertex_Unorm16>(packed, object, uvs, normals, tangents, positions);
+	}
+	else {
+		interleave<Packed_Vertex_Float>(packed, object, uvs, normals, tangents, positions);
+	}
+
+	return packed;
+}
+
+Object_File Packed_Object_File::unpack() const noexcept {
+	Object_File object;
+	object.min = min;
+	object.max = max;
+	object.indices = indices;
+	object.lods = lods;
+	object.meshlets = meshlets;
+
+	std::vector<uint16_t> uvs(2 * count);
+	std::vector<int16_t> normals(2 * count);
+	std::vector<int16_t> tangents(2 * count);
+	std::vector<uint16_t> positions(format == Position_Format::Unorm16 ? 3 * count : 0);
+	std::vector<bool> flips(count);
+
+	object.vertices.resize(count);
+	object.uvs.resize(count);
+	object.normals.resize(count);
+	object.tangents.resize(count);
+	object.bitangents.resize(count);
+
+	if (format == Position_Format::Unorm16) {
+		deinterleave<Packed_Vertex_Unorm16>(*this, uvs, normals, tangents, positions, flips);
+		dequantize_positions(
+			positions.data(), object.vertices.data(), count, position_offset, position_scale
+		);
+	}
+	else {
+		deinterleave<Packed_Vertex_Float>(*this, uvs, normals, tangents, positions, flips);
+		auto* in = (const Packed_Vertex_Float*)bytes.data();
+		for (size_t i = 0; i < count; ++i) memcpy(&object.vertices[i].x, in[i].position, 12);
+	}
+
+	if (count) half::to_float_n(uvs.data(), &object.uvs[0].x, 2 * count);
+	oct_decode_n(normals.data(), object.normals.data(), count);
+	oct_decode_n(tangents.data(), object.tangents.data(), count);
+
+	for (size_t i = 0; i < count; ++i) {
+		object.bitangents[i] = object.normals[i].cross(object.tangents[i]);
+		if (flips[i]) object.bitangents[i] *= -1;
+	}
+
+	return object;
+}
+
+Packed_Object_File::Error Packed_Object_File::measure_error(
+	const Object_File& reference
+) const noexcept {
+	Error error;
+	auto decoded = unpack();
+
+	for (size_t i = 0; i < count && i < reference.vertices.size(); ++i) {
+		for (size_t j = 0; j < 3; ++j) {
+			float d = std::fabs(decoded.vertices[i][j] - reference.vertices[i][j]);
+			error.position[j] = std::max(error.position[j], d);
+		}
+	}
+
+	// uv error is relative, see Uv_Relative_Error.
+	for (size_t i = 0; i < count && i < reference.uvs.size(); ++i) {
+		for (size_t j = 0; j < 2; ++j) {
+			float ref = reference.uvs[i][j];
+			float d = std::fabs(decoded.uvs[i][j] - ref);
+			error.uv = std::max(error.uv, d / std::max(std::fabs(ref), 1.f / 16384.f));
+		}
+	}
+
+	// Degenerate directions (zero tangent when the obj had no uv...) don't have an angle.
+	auto valid = [](Vector3f v) { return v.length2() > 1e-12f && std::isfinite(v.length2()); };
+
+	for (size_t i = 0; i < count && i < reference.normals.size(); ++i) {
+		if (!valid(reference.normals[i])) continue;
+		error.normal = std::max(error.normal, angle_between(decoded.normals[i], reference.normals[i]));
+	}
+	for (size_t i = 0; i < count && i < reference.tangents.size(); ++i) {
+		if (!valid(reference.tangents[i])) continue;
+		error.tangent =
+			std::max(error.tangent, angle_between(decoded.tangents[i], reference.tangents[i]));
+	}
+	for (size_t i = 0; i < count && i < reference.bitangents.size(); ++i) {
+		if (!valid(reference.bitangents[i]) || !valid(decoded.bitangents[i])) continue;
+		if (decoded.bitangents[i].dot(reference.bitangents[i]) < 0) error.bitangent_flips++;
+	}
+
+	return error;
+}
+
+bool Packed_Object_File::Error::within_bounds(const Packed_Object_File& packed) const noexcept {
+	if (packed.format == Position_Format::Unorm16) {
+		for (size_t i = 0; i < 3; ++i) {
+			float lo = packed.position_offset[i];
+			float hi = packed.position_offset[i] + packed.position_scale[i];
+			// A little slack for the float rounding of the dequantization itself.
+			float bound = Position_Unorm16_Error * packed.position_scale[i];
+			bound += 1e-6f * std::max(std::fabs(lo), std::fabs(hi));
+			if (position[i] > bound) return false;
+		}
+	}
+	else if (position.x != 0 || position.y != 0 || position.z != 0) {
+		return false;
+	}
+
+	return
+		uv <= Uv_Relative_Error &&
+		normal <= Direction_Error &&
+		tangent <= Direction_Error &&
+		bitangent_flips == 0;
+}
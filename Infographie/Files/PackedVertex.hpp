@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Math/Vector.hpp"
+#include "Files/FileFormat.hpp"
+
+// Compact, interleaved version of an Object_File, this is what we upload to the gpu.
+// The full float Object_File is 56 bytes per vertex spread across five buffers, this is 20 (or
+// 28 if we keep float positions) in one.
+//
+// - positions are either plain floats or unorm16 relative to the bounding box
+//   (the shader gets position_scale/position_offset to put them back).
+// - normals and tangents are octahedral encoded in 2 snorm16.
+// - the bitangent is rebuilt as sign * cross(N, T), the sign is bit 0 of flags.
+// - uvs are halfs.
+enum class Position_Format : uint8_t {
+	Float = 0,
+	Unorm16,
+	Count
+};
+
+struct Packed_Vertex_Unorm16 {
+	uint16_t position[3];
+	uint16_t flags;
+	uint16_t uv[2];
+	int16_t normal[2];
+	int16_t tangent[2];
+};
+static_assert(sizeof(Packed_Vertex_Unorm16) == 20);
+
+struct Packed_Vertex_Float {
+	float position[3];
+	uint16_t flags;
+	uint16_t padding;
+	uint16_t uv[2];
+	int16_t normal[2];
+	int16_t tangent[2];
+};
+static_assert(sizeof(Packed_Vertex_Float) == 28);
+
+constexpr uint16_t Packed_Vertex_Flag_Bitangent_Flip = 1 << 0;
+
+struct Packed_Object_File {
+	// Worst case errors we guarantee, the position one is relative to the bounding box extent of
+	// the axis (so the absolute error is Position_Unorm16_Error * (max - min)).
+	static constexpr float Position_Unorm16_Error = 0.5f / 65535.f + 1e-6f;
+	// The half relative error, absolute error is max(|uv|, 2^-14) * Uv_Relative_Error.
+	static constexpr float Uv_Relative_Error = 1.f / 2048.f;
+	// In radians, oct16 is way under what a 8 bit normal map can express anyway.
+	// (measured max is ~6.5e-5 on random directions, the rest is margin for the float math)
+	static constexpr float Direction_Error = 1e-4f;
+
+	struct Error {
+		Vector3f position;
+		float uv{ 0 };
+		float normal{ 0 };
+		float tangent{ 0 };
+		// Number of bitangent that don't point to the same side of the (N, T) plane.
+		size_t bitangent_flips{ 0 };
+
+		bool within_bounds(const Packed_Object_File& packed) const noexcept;
+	};
+
+	Position_Format format{ Position_Format::Float };
+	size_t stride{ 0 };
+	size_t count{ 0 };
+	std::vector<uint8_t> bytes;
+	// Same as Object_File::indices, empty for a triangle soup.
+	std::vector<uint32_t> indices;
+	std::vector<Object_File::Lod> lods;
+	std::vector<Object_File::Meshlet> meshlets;
+
+	Vector3f min;
+	Vector3f max;
+
+	// to go from the unorm16 [0, 1] to the object space, identity for Position_Format::Float.
+	Vector3f position_scale{ 1, 1, 1 };
+	Vector3f position_offset{ 0, 0, 0 };
+
+	static Packed_Object_File pack(const Object_File& object, Position_Format format) noexcept;
+	Object_File unpack() const noexcept;
+
+	// Compare against the Object_File we were packed from.
+	Error measure_error(const Object_File& reference) const noexcept;
+};
@@ -0,0 +1,572 @@
+#include "PngStream.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace {
+	uint32_t read_be32(const uint8_t* p) noexcept {
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+	}
+
+	struct Span {
+		const uint8_t* begin;
+		const uint8_t* end;
+	};
+
+	// The IDAT back to back, least significant bit first like deflate wants them.
+	struct Bit_Reader {
+		const std::vector<Span>* spans{ nullptr };
+		size_t span{ 0 };
+		const uint8_t* it{ nullptr };
+		const uint8_t* end{ nullptr };
+		uint64_t buffer{ 0 };
+		uint32_t count{ 0 };
+		// Zeros we made up past the last IDAT, the refill reads ahead.
+		uint32_t padding{ 0 };
+
+		uint8_t next_byte() noexcept {
+			while (it == end) {
+				if (span == spans->size()) {
+					++padding;
+					return 0;
+				}
+				it = (*spans)[span].begin;
+				end = (*spans)[span].end;
+				++span;
+			}
+			return *it++;
+		}
+
+		void fill() noexcept {
+			while (count <= 56) {
+				buffer |= (uint64_t)next_byte() << count;
+				count += 8;
+			}
+		}
+
+		void drop(uint32_t n) noexcept {
+			buffer >>= n;
+			count -= n;
+		}
+
+		uint32_t bits(uint32_t n) noexcept {
+			fill();
+			auto value = (uint32_t)(buffer & ((1ull << n) - 1));
+			drop(n);
+			return value;
+		}
+
+		// The stored blocks start on a byte.
+		void align() noexcept {
+			drop(count % 8);
+		}
+
+		// We used some of the made up zeros, the file is cut short.
+		bool overrun() const noexcept {
+			return padding * 8 > count;
+		}
+	};
+
+	constexpr uint32_t Fast_Bits = 9;
+
+	// Canonical codes. The ones up to Fast_Bits long are a single lookup, the longer ones are
+	// walked a bit at a time like puff (zlib's reference inflate) does.
+	struct Huffman {
+		// (length << 9) | symbol, 0 when the code is longer than Fast_Bits.
+		std::array<uint16_t, 1 << Fast_Bits> fast;
+		std::array<uint16_t, 16> count;
+		// Sorted by length then by value.
+		std::array<uint16_t, 288> symbols;
+
+		// Over subscribed is corrupted, incomplete is allowed (a single distance code is).
+		bool build(const uint8_t* lengths, uint32_t n) noexcept {
+			fast.fill(0);
+			count.fill(0);
+			for (uint32_t i = 0; i < n; ++i) ++count[lengths[i]];
+			count[0] = 0;
+
+			int left = 1;
+			for (size_t len = 1; len < 16; ++len) {
+				left = (left << 1) - count[len];
+				if (left < 0) return false;
+			}
+
+			std::array<uint16_t, 16> offsets{};
+			std::array<uint32_t, 16> next{};
+			uint32_t code = 0;
+			for (size_t len = 1; len < 16; ++len) {
+				if (len + 1 < 16) offsets[len + 1] = offsets[len] + count[len];
+				code = (code + count[len - 1]) << 1;
+				next[len] = code;
+			}
+
+			for (uint32_t i = 0; i < n; ++i) {
+				uint32_t len = lengths[i];
+				if (len == 0) continue;
+				symbols[offsets[len]++] = (uint16_t)i;
+
+				uint32_t value = next[len]++;
+				if (len > Fast_Bits) continue;
+				// The stream has the codes most significant bit first.
+				uint32_t reversed = 0;
+				for (uint32_t b = 0; b < len; ++b) reversed |= ((value >> b) & 1) << (len - 1 - b);
+				for (uint32_t r = reversed; r < fast.size(); r += 1u << len) {
+					fast[r] = (uint16_t)((len << 9) | i);
+				}
+			}
+			return true;
+		}
+
+		// -1 if the bits aren't a code.
+		int decode(Bit_Reader& in) const noexcept {
+			in.fill();
+			auto entry = fast[in.buffer & (fast.size() - 1)];
+			if (entry) {
+				in.drop(entry >> 9);
+				return entry & 511;
+			}
+
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (uint32_t len = 1; len < 16; ++len) {
+				code |= (int)((in.buffer >> (len - 1)) & 1);
+				int n = count[len];
+				if (code - n < first) {
+					in.drop(len);
+					return symbols[index + (code - first)];
+				}
+				index += n;
+				first = (first + n) << 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+	};
+
+	constexpr uint16_t Length_Base[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	constexpr uint8_t Length_Extra[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	constexpr uint16_t Distance_Base[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+	constexpr uint8_t Distance_Extra[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	// Takes the inflated bytes, unfilters each scanline when it's complete and adds it to the
+	// sums of its row of blocks.
+	struct Png_Rows {
+		// Of what's streamed, the first pass when it's interlaced.
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+		uint8_t color_type{ 0 };
+		uint32_t sample_bytes{ 1 };
+		uint32_t pixel_bytes{ 1 };
+		std::array<std::array<uint8_t, 4>, 256> palette{};
+		// tRNS of the grey and rgb pngs, that value is transparent.
+		bool has_key{ false };
+		std::array<uint16_t, 3> key{};
+
+		// The filter byte then the scanline.
+		std::vector<uint8_t> row;
+		std::vector<uint8_t> previous;
+		size_t filled{ 0 };
+		uint32_t y{ 0 };
+		bool failed{ false };
+
+		uint32_t factor{ 1 };
+		std::vector<uint32_t> sums;
+		Mip_Level<uint8_t>* level{ nullptr };
+
+		void start(Mip_Level<uint8_t>& out, uint32_t max_size) noexcept {
+			row.assign(1 + (size_t)width * pixel_bytes, 0);
+			previous.assign(row.size(), 0);
+
+			uint32_t longest = std::max(width, height);
+			factor = std::max((longest + max_size - 1) / max_size, 1u);
+			level = &out;
+			level->width = (width + factor - 1) / factor;
+			level->height = (height + factor - 1) / factor;
+			level->pixels.resize((size_t)level->width * level->height * 4);
+			sums.assign((size_t)level->width * 4, 0);
+		}
+
+		bool done() const noexcept {
+			return y == height;
+		}
+
+		void put(uint8_t byte) noexcept {
+			row[filled++] = byte;
+			if (filled == row.size()) finish_row();
+		}
+
+		void finish_row() noexcept {
+			filled = 0;
+			// What's left of the stream after the first pass, or of a copy that went past the end.
+			if (done() || failed) return;
+			if (!unfilter()) {
+				failed = true;
+				return;
+			}
+			accumulate(row.data() + 1);
+			std::swap(row, previous);
+			if ((y + 1) % factor == 0 || y + 1 == height) emit_row();
+			++y;
+		}
+
+		bool unfilter() noexcept {
+			uint8_t* cur = row.data() + 1;
+			const uint8_t* up = previous.data() + 1;
+			size_t n = row.size() - 1;
+			size_t bpp = pixel_bytes;
+			switch (row[0]) {
+			case 0:
+				break;
+			case 1:
+				for (size_t i = bpp; i < n; ++i) cur[i] += cur[i - bpp];
+				break;
+			case 2:
+				for (size_t i = 0; i < n; ++i) cur[i] += up[i];
+				break;
+			case 3:
+				for (size_t i = 0; i < bpp; ++i) cur[i] += up[i] / 2;
+				for (size_t i = bpp; i < n; ++i) cur[i] += (uint8_t)((cur[i - bpp] + up[i]) / 2);
+				break;
+			case 4:
+				for (size_t i = 0; i < bpp; ++i) cur[i] += up[i];
+				for (size_t i = bpp; i < n; ++i) {
+					int a = cur[i - bpp];
+					int b = up[i];
+					int c = up[i - bpp];
+					int pa = std::abs(b - c);
+					int pb = std::abs(a - c);
+					int pc = std::abs(a + b - 2 * c);
+					cur[i] += (uint8_t)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+				}
+				break;
+			default:
+				return false;
+			}
+			return true;
+		}
+
+		void accumulate(const uint8_t* pixels) noexcept {
+			// 16 bits samples are big endian, we keep the high byte like stb does.
+			auto high = [&](const uint8_t* p, uint32_t c) { return p[c * sample_bytes]; };
+			auto sample = [&](const uint8_t* p, uint32_t c) {
+				return sample_bytes == 2 ? (uint16_t)((p[c * 2] << 8) | p[c * 2 + 1]) : p[c];
+			};
+
+			uint32_t* sum = sums.data();
+			uint32_t in_block = 0;
+			for (uint32_t x = 0; x < width; ++x) {
+				auto p = pixels + (size_t)x * pixel_bytes;
+				std::array<uint8_t, 4> rgba;
+				switch (color_type) {
+				case 0: {
+					uint8_t grey = high(p, 0);
+					bool clear = has_key && sample(p, 0) == key[0];
+					rgba = { grey, grey, grey, (uint8_t)(clear ? 0 : 255) };
+					break;
+				}
+				case 2: {
+					bool clear = has_key &&
+						sample(p, 0) == key[0] && sample(p, 1) == key[1] && sample(p, 2) == key[2];
+					rgba = { high(p, 0), high(p, 1), high(p, 2), (uint8_t)(clear ? 0 : 255) };
+					break;
+				}
+				case 3:
+					rgba = palette[p[0]];
+					break;
+				case 4:
+					rgba = { high(p, 0), high(p, 0), high(p, 0), high(p, 1) };
+					break;
+				default:
+					rgba = { high(p, 0), high(p, 1), high(p, 2), high(p, 3) };
+					break;
+				}
+				for (size_t c = 0; c < 4; ++c) sum[c] += rgba[c];
+
+				if (++in_block == factor) {
+					in_block = 0;
+					sum += 4;
+				}
+			}
+		}
+
+		// The blocks on the right and bottom edges can be cut short, they average what they have.
+		void emit_row() noexcept {
+			uint32_t y0 = y / factor * factor;
+			uint32_t rows = y + 1 - y0;
+			auto out = level->pixels.data() + (size_t)(y / factor) * level->width * 4;
+			for (uint32_t x = 0; x < level->width; ++x) {
+				uint32_t x0 = x * factor;
+				uint32_t count = (std::min(x0 + factor, width) - x0) * rows;
+				for (size_t c = 0; c < 4; ++c) {
+					out[(size_t)x * 4 + c] = (uint8_t)((sums[x * 4 + c] + count / 2) / count);
+				}
+			}
+			std::fill(std::begin(sums), std::end(sums), 0);
+		}
+	};
+
+	// The zlib stream of the IDAT, inflated until the rows have all they need.
+	class Inflater {
+	public:
+		Inflater(const std::vector<Span>& spans, Png_Rows& rows) noexcept
+			: rows(rows), window(Window_Size) {
+			in.spans = &spans;
+		}
+
+		bool run() noexcept {
+			uint32_t cmf = in.bits(8);
+			uint32_t flg = in.bits(8);
+			// Deflate, a window of at most 32 KB, the check bits right and no preset dictionary.
+			if ((cmf & 15) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flg) % 31 || (flg & 32)) {
+				return false;
+			}
+
+			bool last = false;
+			while (!last && !finished()) {
+				last = in.bits(1);
+				bool worked = false;
+				switch (in.bits(2)) {
+				case 0: worked = stored(); break;
+				case 1: worked = fixed(); break;
+				case 2: worked = dynamic(); break;
+				default: break;
+				}
+				if (!worked || in.overrun()) return false;
+			}
+			return rows.done();
+		}
+
+	private:
+		static constexpr size_t Window_Size = 32768;
+
+		Bit_Reader in;
+		Png_Rows& rows;
+		std::vector<uint8_t> window;
+		size_t total{ 0 };
+
+		bool finished() const noexcept {
+			return rows.done() || rows.failed;
+		}
+
+		void put(uint8_t byte) noexcept {
+			window[total++ & (Window_Size - 1)] = byte;
+			rows.put(byte);
+		}
+
+		bool stored() noexcept {
+			in.align();
+			uint32_t length = in.bits(16);
+			if (length != (~in.bits(16) & 0xffff)) return false;
+			for (uint32_t i = 0; i < length && !finished(); ++i) put((uint8_t)in.bits(8));
+			return true;
+		}
+
+		bool fixed() noexcept {
+			std::array<uint8_t, 288 + 30> lengths;
+			std::fill(lengths.begin(), lengths.begin() + 144, 8);
+			std::fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+			std::fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+			std::fill(lengths.begin() + 280, lengths.begin() + 288, 8);
+			std::fill(lengths.begin() + 288, lengths.end(), 5);
+
+			Huffman literals;
+			Huffman distances;
+			literals.build(lengths.data(), 288);
+			distances.build(lengths.data() + 288, 30);
+			return codes(literals, distances);
+		}
+
+		bool dynamic() noexcept {
+			uint32_t literal_count = in.bits(5) + 257;
+			uint32_t distance_count = in.bits(5) + 1;
+			uint32_t length_count = in.bits(4) + 4;
+			if (literal_count > 286 || distance_count > 30) return false;
+
+			constexpr uint8_t Order[19] = {
+				16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+			};
+			std::array<uint8_t, 19> length_lengths{};
+			for (uint32_t i = 0; i < length_count; ++i) {
+				length_lengths[Order[i]] = (uint8_t)in.bits(3);
+			}
+			Huffman length_code;
+			if (!length_code.build(length_lengths.data(), 19)) return false;
+
+			// The two tables are a single run, a repeat can go from one to the other.
+			std::array<uint8_t, 286 + 30> lengths{};
+			uint32_t n = literal_count + distance_count;
+			for (uint32_t i = 0; i < n;) {
+				int symbol = length_code.decode(in);
+				if (symbol < 0) return false;
+				if (symbol < 16) {
+					lengths[i++] = (uint8_t)symbol;
+					continue;
+				}
+
+				uint8_t value = 0;
+				uint32_t repeat = 0;
+				if (symbol == 16) {
+					if (i == 0) return false;
+					value = lengths[i - 1];
+					repeat = 3 + in.bits(2);
+				}
+				else if (symbol == 17) {
+					repeat = 3 + in.bits(3);
+				}
+				else {
+					repeat = 11 + in.bits(7);
+				}
+				if (repeat > n - i) return false;
+				for (; repeat > 0; --repeat) lengths[i++] = value;
+			}
+			// Without an end of block code we would never stop.
+			if (lengths[256] == 0) return false;
+
+			Huffman literals;
+			Huffman distances;
+			if (!literals.build(lengths.data(), literal_count)) return false;
+			if (!distances.build(lengths.data() + literal_count, distance_count)) return false;
+			return codes(literals, distances);
+		}
+
+		bool codes(const Huffman& literals, const Huffman& distances) noexcept {
+			while (!finished()) {
+				int symbol = literals.decode(in);
+				if (symbol < 0 || in.overrun()) return false;
+				if (symbol < 256) {
+					put((uint8_t)symbol);
+					continue;
+				}
+				if (symbol == 256) return true;
+
+				symbol -= 257;
+				if (symbol >= 29) return false;
+				uint32_t length = Length_Base[symbol] + in.bits(Length_Extra[symbol]);
+
+				int code = distances.decode(in);
+				if (code < 0 || code >= 30) return false;
+				uint32_t distance = Distance_Base[code] + in.bits(Distance_Extra[code]);
+				if (distance > total) return false;
+
+				for (uint32_t i = 0; i < length; ++i) {
+					put(window[(total - distance) & (Window_Size - 1)]);
+				}
+			}
+			return true;
+		}
+	};
+};
+
+std::optional<Png_Preview> stream_png_preview(
+	const void* bytes, size_t size, uint32_t max_size
+) noexcept {
+	constexpr uint8_t Signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	auto it = (const uint8_t*)bytes;
+	auto end = it + size;
+	if (size < 8 || memcmp(it, Signature, 8) != 0) return std::nullopt;
+	it += 8;
+
+	Png_Preview preview;
+	Png_Rows rows;
+	uint32_t depth = 0;
+	bool interlaced = false;
+	bool has_palette = false;
+	std::vector<Span> idat;
+
+	// length, type, data, crc. The crc isn't checked, stb doesn't either.
+	while (end - it >= 12) {
+		uint32_t length = read_be32(it);
+		std::string_view type{ (const char*)it + 4, 4 };
+		const uint8_t* data = it + 8;
+		if (length > (size_t)(end - data) - 4) return std::nullopt;
+		it = data + length + 4;
+
+		if (type == "IHDR") {
+			if (length != 13) return std::nullopt;
+			preview.width = read_be32(data);
+			preview.height = read_be32(data + 4);
+			depth = data[8];
+			rows.color_type = data[9];
+			interlaced = data[12] == 1;
+			if (preview.width == 0 || preview.height == 0) return std::nullopt;
+			if (data[10] != 0 || data[11] != 0 || data[12] > 1) return std::nullopt;
+			if (depth != 8 && !(depth == 16 && rows.color_type != 3)) return std::nullopt;
+
+			uint32_t channels = 0;
+			switch (rows.color_type) {
+			case 0: channels = 1; break;
+			case 2: channels = 3; break;
+			case 3: channels = 1; break;
+			case 4: channels = 2; break;
+			case 6: channels = 4; break;
+			default: return std::nullopt;
+			}
+			rows.sample_bytes = depth / 8;
+			rows.pixel_bytes = channels * rows.sample_bytes;
+
+			if (std::max(preview.width, preview.height) <= max_size) return std::nullopt;
+		}
+		else if (depth == 0) {
+			// IHDR is always first.
+			return std::nullopt;
+		}
+		else if (type == "PLTE") {
+			if (length % 3 != 0 || length > 256 * 3) return std::nullopt;
+			for (uint32_t i = 0; i < length / 3; ++i) {
+				rows.palette[i] = { data[i * 3], data[i * 3 + 1], data[i * 3 + 2], 255 };
+			}
+			has_palette = true;
+		}
+		else if (type == "tRNS") {
+			if (rows.color_type == 3) {
+				if (length > 256) return std::nullopt;
+				for (uint32_t i = 0; i < length; ++i) rows.palette[i][3] = data[i];
+			}
+			else if (rows.color_type == 0 && length == 2) {
+				rows.has_key = true;
+				rows.key[0] = (uint16_t)((data[0] << 8) | data[1]);
+			}
+			else if (rows.color_type == 2 && length == 6) {
+				rows.has_key = true;
+				for (size_t c = 0; c < 3; ++c) {
+					rows.key[c] = (uint16_t)((data[c * 2] << 8) | data[c * 2 + 1]);
+				}
+			}
+		}
+		else if (type == "IDAT") {
+			idat.push_back({ data, data + length });
+		}
+		else if (type == "IEND") {
+			break;
+		}
+	}
+	if (depth == 0 || idat.empty()) return std::nullopt;
+	if (rows.color_type == 3 && !has_palette) return std::nullopt;
+
+	// The first Adam7 pass starts every 8 pixels from the top left one.
+	rows.width = interlaced ? (preview.width + 7) / 8 : preview.width;
+	rows.height = interlaced ? (preview.height + 7) / 8 : preview.height;
+	// A corrupted header shouldn't make us allocate gigabytes for a scanline.
+	if ((size_t)rows.width * rows.pixel_bytes > ((size_t)1 << 28)) return std::nullopt;
+
+	rows.start(preview.level, std::max(max_size, 1u));
+	Inflater inflater{ idat, rows };
+	if (!inflater.run()) return std::nullopt;
+	return preview;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "Files/Mipmap.hpp"
+
+// The preview of a png too big to decode in one go. stb inflates all of it then hands back the
+// whole RGBA buffer (1.6 GB for a 20k x 20k scan), here the IDAT are inflated a scanline at a
+// time and each row is averaged into the preview as soon as it's unfiltered. What's resident is
+// the preview, two scanlines and the 32 KB deflate window.
+
+struct Png_Preview {
+	// Of the whole image, what the preview stands for.
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+	Mip_Level<uint8_t> level;
+};
+
+// The same blocks as box_downscale_to_fit on the decoded image. An interlaced png only needs its
+// first Adam7 pass (every 8th pixel of every 8th row, the start of the stream), so that's all we
+// inflate and the blocks are made of those pixels.
+// nullopt when it isn't a png, when it's 1, 2 or 4 bits per sample (nobody scans at that) or is
+// corrupted, and when it's already under max_size: nothing to preview, decode it normally.
+std::optional<Png_Preview> stream_png_preview(
+	const void* bytes, size_t size, uint32_t max_size
+) noexcept;
@@ -0,0 +1,190 @@
+#include "TextureFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Files/AssetPack.hpp"
+#include "Files/BinaryIO.hpp"
+#include "Files/stb_image.h"
+#include "OS/FileIO.hpp"
+
+namespace {
+	// Enough for any block and any SIMD copy out of the mapping.
+	constexpr uint64_t Level_Alignment = 16;
+	// A 32 bits size halved until 1x1 is never more than that.
+	constexpr uint32_t Max_Levels = 32;
+
+	uint64_t align(uint64_t x) noexcept {
+		return (x + Level_Alignment - 1) & ~(Level_Alignment - 1);
+	}
+
+	uint64_t level_bytes(Block_Format format, uint32_t width, uint32_t height) noexcept {
+		if (format == Block_Format::None) return (uint64_t)width * height * 4;
+		return compressed_size(format, width, height);
+	}
+
+	// Without compression the other block options don't change anything, so they don't count.
+	uint32_t block_bits(const Block_Options& blocks) noexcept {
+		return blocks.enabled ? blocks.to_bits() : 0;
+	}
+};
+
+std::filesystem::path texture_file_path(const std::filesystem::path& source) noexcept {
+	auto path = source;
+	return path.replace_extension(Texture_File_Extension);
+}
+
+namespace {
+	// Everything in the header and the level table, against the size of the bytes.
+	bool validate(Texture_File& texture, size_t size) noexcept {
+		if (size < sizeof(Texture_File_Header)) return false;
+		memcpy(&texture.header, texture.bytes, sizeof(Texture_File_Header));
+
+		auto& header = texture.header;
+		if (memcmp(header.magic, Texture_File_Header{}.magic, sizeof(header.magic)) != 0) {
+			return false;
+		}
+		if (header.version != Texture_File_Version) return false;
+		if (header.format >= Block_Format::Count) return false;
+		if (header.supercompression != Supercompression::None) return false;
+		if (header.width == 0 || header.height == 0) return false;
+		if (header.level_count == 0 || header.level_count > Max_Levels) return false;
+
+		size_t table_end =
+			sizeof(Texture_File_Header) + header.level_count * sizeof(Texture_File_Level);
+		if (size < table_end) return false;
+		texture.levels.resize(header.level_count);
+		memcpy(
+			texture.levels.data(),
+			texture.bytes + sizeof(Texture_File_Header),
+			header.level_count * sizeof(Texture_File_Level)
+		);
+
+		// Every level is the previous one halved, of exactly the size its format says, and
+		// entirely in the file. After that the upload can trust it blindly.
+		uint32_t width = header.width;
+		uint32_t height = header.height;
+		for (auto& level : texture.levels) {
+			if (level.width != width || level.height != height) return false;
+			if (level.size != level_bytes(header.format, width, height)) return false;
+			if (level.offset < table_end || level.offset > size) return false;
+			if (level.size > size - level.offset) return false;
+
+			width = std::max(width / 2, 1u);
+			height = std::max(height / 2, 1u);
+		}
+		return true;
+	}
+
+	bool made_with(
+		const Texture_File& texture, const Mip_Options& mips, const Block_Options& blocks
+	) noexcept {
+		return
+			texture.header.mip_bits == mips.to_bits() &&
+			texture.header.block_bits == block_bits(blocks);
+	}
+};
+
+std::optional<Texture_File> open_texture_file(const std::filesystem::path& path) noexcept {
+	Texture_File texture;
+	if (!texture.file.open(path)) return std::nullopt;
+
+	texture.bytes = texture.file.data();
+	if (!validate(texture, texture.file.size())) return std::nullopt;
+	return texture;
+}
+
+std::optional<Texture_File> open_texture_file(const uint8_t* bytes, size_t size) noexcept {
+	Texture_File texture;
+	texture.bytes = bytes;
+	if (!validate(texture, size)) return std::nullopt;
+	return texture;
+}
+
+std::optional<Texture_File> find_texture_file(
+	const std::filesystem::path& source, const Mip_Options& mips, const Block_Options& blocks
+) noexcept {
+	auto path = texture_file_path(source);
+
+	// The pack is made from what's converted, no need to compare it with the png.
+	if (auto packed = find_packed_asset(path)) {
+		auto texture = open_texture_file((const uint8_t*)packed->data(), packed->size());
+		if (texture && made_with(*texture, mips, blocks)) return texture;
+	}
+
+	std::error_code ec;
+	auto time = std::filesystem::last_write_time(path, ec);
+	if (ec) return std::nullopt;
+
+	// An edited png wins until it's converted again.
+	auto source_time = std::filesystem::last_write_time(source, ec);
+	if (!ec && source_time > time) return std::nullopt;
+
+	auto texture = open_texture_file(path);
+	if (!texture || !made_with(*texture, mips, blocks)) return std::nullopt;
+	return texture;
+}
+
+bool convert_texture(
+	const std::filesystem::path& source, const Mip_Options& mips, const Block_Options& blocks
+) noexcept {
+	int width;
+	int height;
+	int channels;
+	auto rgba = stbi_load(source.generic_string().c_str(), &width, &height, &channels, 4);
+	if (!rgba) return false;
+
+	Texture_File_Header header;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.mip_bits = mips.to_bits();
+	header.block_bits = block_bits(blocks);
+
+	std::vector<Texture_File_Level> levels;
+	std::vector<const uint8_t*> data;
+	auto add_level = [&](uint32_t w, uint32_t h, const uint8_t* bytes) {
+		Texture_File_Level level;
+		level.width = w;
+		level.height = h;
+		level.size = level_bytes(header.format, w, h);
+		levels.push_back(level);
+		data.push_back(bytes);
+	};
+
+	// Same code and same disk caches as Texture_Pixels, a converted texture is exactly what the
+	// png would have given.
+	auto compressed = compress_texture(
+		source, rgba, header.width, header.height, mips, blocks
+	);
+	std::vector<Mip_Level<uint8_t>> chain;
+	if (compressed.format != Block_Format::None) {
+		header.format = compressed.format;
+		for (auto& level : compressed.levels) {
+			add_level(level.width, level.height, level.blocks.data());
+		}
+	}
+	else {
+		chain = cached_mips(source, rgba, header.width, header.height, mips);
+		add_level(header.width, header.height, rgba);
+		for (auto& level : chain) add_level(level.width, level.height, level.pixels.data());
+	}
+	header.level_count = (uint32_t)levels.size();
+
+	uint64_t offset = align(sizeof(header) + levels.size() * sizeof(Texture_File_Level));
+	for (auto& level : levels) {
+		level.offset = offset;
+		offset = align(offset + level.size);
+	}
+
+	Writer writer;
+	writer.bytes.reserve((size_t)offset);
+	writer.pod(header);
+	for (auto& level : levels) writer.pod(level);
+	for (size_t i = 0; i < levels.size(); ++i) {
+		writer.bytes.resize((size_t)levels[i].offset, '\0');
+		writer.bytes.append((const char*)data[i], (size_t)levels[i].size);
+	}
+	stbi_image_free(rgba);
+
+	return overwrite_file(texture_file_path(source), writer.bytes) == 0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "Files/BlockCompress.hpp"
+#include "Files/Mipmap.hpp"
+#include "OS/MappedFile.hpp"
+
+// Our texture container, what KTX2 or DDS are for everyone else: every level exactly as
+// glTexImage2D / glCompressedTexImage2D want it, so loading one is mapping the file and handing
+// the gpu pointers into it. Made offline from the png by convert_texture (Infographie
+// --convert-textures), it sits next to the png with the .igtex extension.
+//
+// Layout, little endian:
+//   Texture_File_Header
+//   Texture_File_Level * level_count, the base level first
+//   the levels, each at a 16 bytes aligned offset from the start of the file
+
+constexpr char Texture_File_Extension[] = ".igtex";
+constexpr uint32_t Texture_File_Version = 1;
+
+// Like the KTX2 supercompression schemes, a lossless pass over the levels on top of the block
+// compression. We don't have zstd in the tree so there is only None for now, a file with anything
+// else is rejected.
+enum class Supercompression : uint8_t {
+	None = 0,
+	Count
+};
+
+struct Texture_File_Header {
+	char magic[4]{ 'I', 'G', 'T', 'X' };
+	uint32_t version{ Texture_File_Version };
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+	uint32_t level_count{ 0 };
+	// None is plain RGBA8.
+	Block_Format format{ Block_Format::None };
+	Supercompression supercompression{ Supercompression::None };
+	uint8_t padding[2]{};
+	// What it was made with, Mip_Options::to_bits and Block_Options::to_bits. A file made with
+	// other options than the ones we load with is ignored.
+	uint32_t mip_bits{ 0 };
+	uint32_t block_bits{ 0 };
+};
+static_assert(sizeof(Texture_File_Header) == 32);
+
+struct Texture_File_Level {
+	uint64_t offset{ 0 };
+	uint64_t size{ 0 };
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+};
+static_assert(sizeof(Texture_File_Level) == 24);
+
+// An open container, the levels point into the mapping. That's either its own file, or the
+// asset pack's when it comes from there (then file isn't open).
+struct Texture_File {
+	Mapped_File file;
+	const uint8_t* bytes{ nullptr };
+	Texture_File_Header header;
+	std::vector<Texture_File_Level> levels;
+
+	const uint8_t* level_data(size_t i) const noexcept { return bytes + levels[i].offset; }
+};
+
+// foo.png -> foo.igtex
+std::filesystem::path texture_file_path(const std::filesystem::path& source) noexcept;
+
+// Maps the file and checks everything in the header and the level table against its size, the
+// level data is then only touched by the upload. nullopt if it's not there or not one of ours.
+std::optional<Texture_File> open_texture_file(const std::filesystem::path& path) noexcept;
+// Same checks, on bytes that outlive the result.
+std::optional<Texture_File> open_texture_file(const uint8_t* bytes, size_t size) noexcept;
+
+// The container of source if there is one, made with those options. From the asset pack if
+// it has it, otherwise the loose one if it's not older than source (if source is still around).
+// That's what Assets_Manager calls before decoding anything.
+std::optional<Texture_File> find_texture_file(
+	const std::filesystem::path& source, const Mip_Options& mips, const Block_Options& blocks
+) noexcept;
+
+// Decodes source, makes the chain (compressed or not, through the same disk caches as the
+// runtime path) and writes it next to it. False if source can't be read or the file written.
+bool convert_texture(
+	const std::filesystem::path& source, const Mip_Options& mips, const Block_Options& blocks
+) noexcept;
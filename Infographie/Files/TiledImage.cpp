@@ -0,0 +1,184 @@
+#include "TiledImage.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+	constexpr size_t Tile_Bytes = (size_t)Tiled_Image::Tile_Size * Tiled_Image::Tile_Size * 4;
+
+	// Shared by every image, so a version says which pixels a tile has wherever it's from.
+	std::atomic<uint64_t> Last_Version{ 0 };
+
+	uint64_t next_version() noexcept {
+		return ++Last_Version;
+	}
+
+	uint32_t tile_count(uint32_t size) noexcept {
+		return (size + Tiled_Image::Tile_Size - 1) / Tiled_Image::Tile_Size;
+	}
+
+	Tiled_Image::Tile solid_tile(Rgba8 color) noexcept {
+		Tiled_Image::Tile tile;
+		tile.color = color;
+		tile.version = next_version();
+		return tile;
+	}
+
+	uint8_t* texel(std::vector<uint8_t>& pixels, uint32_t x, uint32_t y) noexcept {
+		return pixels.data() + ((size_t)y * Tiled_Image::Tile_Size + x) * 4;
+	}
+};
+
+Tiled_Image::Tiled_Image(uint32_t width, uint32_t height, Rgba8 color) noexcept {
+	resize(width, height, color);
+}
+
+uint32_t Tiled_Image::get_width() const noexcept {
+	return width;
+}
+uint32_t Tiled_Image::get_height() const noexcept {
+	return height;
+}
+uint32_t Tiled_Image::get_tiles_x() const noexcept {
+	return tiles_x;
+}
+uint32_t Tiled_Image::get_tiles_y() const noexcept {
+	return tiles_y;
+}
+
+void Tiled_Image::resize(uint32_t new_width, uint32_t new_height, Rgba8 color) noexcept {
+	uint32_t new_tiles_x = tile_count(new_width);
+	uint32_t new_tiles_y = tile_count(new_height);
+
+	std::vector<Tile> new_tiles;
+	new_tiles.reserve((size_t)new_tiles_x * new_tiles_y);
+	for (uint32_t ty = 0; ty < new_tiles_y; ++ty) {
+		for (uint32_t tx = 0; tx < new_tiles_x; ++tx) {
+			bool kept = tx < tiles_x && ty < tiles_y;
+			new_tiles.push_back(kept ? std::move(tiles[tx + ty * tiles_x]) : solid_tile(color));
+		}
+	}
+
+	uint32_t old_width = width;
+	uint32_t old_height = height;
+	width = new_width;
+	height = new_height;
+	tiles_x = new_tiles_x;
+	tiles_y = new_tiles_y;
+	tiles = std::move(new_tiles);
+
+	// The old edge tiles still have whatever was past the edge, what comes back in view is new.
+	fill_rect(std::min(old_width, width), 0, width, height, color);
+	fill_rect(0, std::min(old_height, height), width, height, color);
+}
+
+Rgba8 Tiled_Image::get_pixel(uint32_t x, uint32_t y) const noexcept {
+	auto& tile = tiles[x / Tile_Size + (y / Tile_Size) * tiles_x];
+	if (!tile.pixels) return tile.color;
+
+	auto p = texel(*tile.pixels, x % Tile_Size, y % Tile_Size);
+	return { p[0], p[1], p[2], p[3] };
+}
+
+void Tiled_Image::set_pixel(uint32_t x, uint32_t y, Rgba8 color) noexcept {
+	auto& tile = tiles[x / Tile_Size + (y / Tile_Size) * tiles_x];
+	if (!tile.pixels && tile.color == color) return;
+
+	auto& pixels = *tile_for_write(x / Tile_Size, y / Tile_Size).pixels;
+	std::copy(std::begin(color), std::end(color), texel(pixels, x % Tile_Size, y % Tile_Size));
+}
+
+void Tiled_Image::fill_rect(
+	uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, Rgba8 color
+) noexcept {
+	x1 = std::min(x1, width);
+	y1 = std::min(y1, height);
+	if (x0 >= x1 || y0 >= y1) return;
+
+	for (uint32_t ty = y0 / Tile_Size; ty <= (y1 - 1) / Tile_Size; ++ty) {
+		for (uint32_t tx = x0 / Tile_Size; tx <= (x1 - 1) / Tile_Size; ++tx) {
+			// In the tile.
+			uint32_t from_x = std::max(x0, tx * Tile_Size) - tx * Tile_Size;
+			uint32_t from_y = std::max(y0, ty * Tile_Size) - ty * Tile_Size;
+			uint32_t to_x = std::min(x1 - tx * Tile_Size, get_tile_width(tx));
+			uint32_t to_y = std::min(y1 - ty * Tile_Size, get_tile_height(ty));
+
+			auto& tile = tiles[tx + ty * tiles_x];
+			bool whole = from_x == 0 && from_y == 0;
+			whole = whole && to_x == get_tile_width(tx) && to_y == get_tile_height(ty);
+			if (whole) {
+				tile = solid_tile(color);
+				continue;
+			}
+			if (!tile.pixels && tile.color == color) continue;
+
+			auto& pixels = *tile_for_write(tx, ty).pixels;
+			for (uint32_t y = from_y; y < to_y; ++y) {
+				for (uint32_t x = from_x; x < to_x; ++x) {
+					std::copy(std::begin(color), std::end(color), texel(pixels, x, y));
+				}
+			}
+		}
+	}
+}
+
+size_t Tiled_Image::compact() noexcept {
+	size_t compacted = 0;
+	for (uint32_t ty = 0; ty < tiles_y; ++ty) {
+		for (uint32_t tx = 0; tx < tiles_x; ++tx) {
+			auto& tile = tiles[tx + ty * tiles_x];
+			if (!tile.pixels) continue;
+
+			auto& pixels = *tile.pixels;
+			auto first = texel(pixels, 0, 0);
+			bool solid = true;
+			for (uint32_t y = 0; solid && y < get_tile_height(ty); ++y) {
+				auto row = texel(pixels, 0, y);
+				for (uint32_t x = 0; x < get_tile_width(tx); ++x) {
+					if (!std::equal(first, first + 4, row + x * 4)) {
+						solid = false;
+						break;
+					}
+				}
+			}
+			if (!solid) continue;
+
+			tile = solid_tile({ first[0], first[1], first[2], first[3] });
+			compacted++;
+		}
+	}
+	return compacted;
+}
+
+const Tiled_Image::Tile& Tiled_Image::get_tile(uint32_t tx, uint32_t ty) const noexcept {
+	return tiles[tx + ty * tiles_x];
+}
+
+uint32_t Tiled_Image::get_tile_width(uint32_t tx) const noexcept {
+	return std::min(Tile_Size, width - tx * Tile_Size);
+}
+uint32_t Tiled_Image::get_tile_height(uint32_t ty) const noexcept {
+	return std::min(Tile_Size, height - ty * Tile_Size);
+}
+
+size_t Tiled_Image::allocated_bytes() const noexcept {
+	size_t bytes = 0;
+	for (auto& tile : tiles) if (tile.pixels) bytes += Tile_Bytes;
+	return bytes;
+}
+
+Tiled_Image::Tile& Tiled_Image::tile_for_write(uint32_t tx, uint32_t ty) noexcept {
+	auto& tile = tiles[tx + ty * tiles_x];
+	if (!tile.pixels) {
+		tile.pixels = std::make_shared<std::vector<uint8_t>>(Tile_Bytes);
+		for (size_t i = 0; i < Tile_Bytes; i += 4) {
+			std::copy(std::begin(tile.color), std::end(tile.color), tile.pixels->data() + i);
+		}
+	}
+	else if (tile.pixels.use_count() > 1) {
+		// A snapshot has it. Only we make copies of our tiles, so once it's 1 it stays ours.
+		tile.pixels = std::make_shared<std::vector<uint8_t>>(*tile.pixels);
+	}
+	tile.version = next_version();
+	return tile;
+}
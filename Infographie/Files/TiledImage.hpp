@@ -0,0 +1,69 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// RGBA8 image cut in Tile_Size x Tile_Size tiles, for the canvases that can be a lot bigger than
+// what's painted on them. A tile is only a color until something else is written in it, so the
+// memory follows the painted area and not the size.
+//
+// Copies share their tiles, a tile is copied on the first write to it after that. So a copy is a
+// snapshot that costs a pointer per tile, and it can be read on another thread while we paint.
+//
+// Every write gives the tile a new version, unique across all the images. Whoever mirrors the
+// tiles (in textures, say) only has to redo the ones with a version it hasn't seen.
+
+using Rgba8 = std::array<uint8_t, 4>;
+
+class Tiled_Image {
+public:
+	static constexpr uint32_t Tile_Size = 256;
+
+	struct Tile {
+		// Tile_Size * Tile_Size * 4, row after row. Null when the whole tile is color.
+		std::shared_ptr<std::vector<uint8_t>> pixels;
+		Rgba8 color{ 255, 255, 255, 255 };
+		uint64_t version{ 0 };
+	};
+
+	Tiled_Image() noexcept = default;
+	Tiled_Image(uint32_t width, uint32_t height, Rgba8 color) noexcept;
+
+	uint32_t get_width() const noexcept;
+	uint32_t get_height() const noexcept;
+	uint32_t get_tiles_x() const noexcept;
+	uint32_t get_tiles_y() const noexcept;
+
+	// What's still inside stays where it is, what's new is color. No pixel is copied, the tiles
+	// we keep are shared with the old ones.
+	void resize(uint32_t width, uint32_t height, Rgba8 color) noexcept;
+
+	// x and y must be inside.
+	Rgba8 get_pixel(uint32_t x, uint32_t y) const noexcept;
+	void set_pixel(uint32_t x, uint32_t y, Rgba8 color) noexcept;
+	// [x0, x1) x [y0, y1), clipped to the image. The tiles it covers whole become only color.
+	void fill_rect(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, Rgba8 color) noexcept;
+
+	// The tiles whose pixels are all the same color go back to being only that color. For after
+	// the big edits (a flood fill...). Returns how many did.
+	size_t compact() noexcept;
+
+	const Tile& get_tile(uint32_t tx, uint32_t ty) const noexcept;
+	// The part of the tile inside the image, the last column and row of tiles can be cut.
+	uint32_t get_tile_width(uint32_t tx) const noexcept;
+	uint32_t get_tile_height(uint32_t ty) const noexcept;
+
+	// Of the tiles with pixels, a tile shared with a snapshot counts in both.
+	size_t allocated_bytes() const noexcept;
+
+private:
+	// Makes the tile's pixels, or its own copy of them, and gives it a new version.
+	Tile& tile_for_write(uint32_t tx, uint32_t ty) noexcept;
+
+	uint32_t width{ 0 };
+	uint32_t height{ 0 };
+	uint32_t tiles_x{ 0 };
+	uint32_t tiles_y{ 0 };
+	std::vector<Tile> tiles;
+};
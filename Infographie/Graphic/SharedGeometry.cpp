@@ -0,0 +1,51 @@
+#include <GL/glew.h>
+#include "SharedGeometry.hpp"
+
+#include <array>
+
+Shared_Geometry::Shared_Geometry(Object_File o) noexcept : object(std::move(o)) {
+	glGenVertexArrays(1, &vertex_array_id);
+	glBindVertexArray(vertex_array_id);
+	defer{ glBindVertexArray(0); };
+	defer{ glBindBuffer(GL_ARRAY_BUFFER, 0); };
+
+	glGenBuffers((GLsizei)std::size(buffer_ids), buffer_ids);
+
+	auto upload = [&](GLuint attribute, const auto& data, GLint size) {
+		using T = typename std::decay_t<decltype(data)>::value_type;
+		glBindBuffer(GL_ARRAY_BUFFER, buffer_ids[attribute]);
+		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(T), data.data(), GL_STATIC_DRAW);
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribPointer(attribute, size, GL_FLOAT, GL_FALSE, 0, nullptr);
+	};
+	upload(0, object.vertices, 3);
+	upload(1, object.uvs, 2);
+	upload(2, object.normals, 3);
+	upload(3, object.tangents, 3);
+	upload(4, object.bitangents, 3);
+}
+
+Shared_Geometry::~Shared_Geometry() noexcept {
+	glDeleteBuffers((GLsizei)std::size(buffer_ids), buffer_ids);
+	glDeleteVertexArrays(1, &vertex_array_id);
+}
+
+std::shared_ptr<const Shared_Geometry> acquire_geometry(Shared_Primitive primitive) noexcept {
+	// Weak, so the gpu memory goes away with the last Model using it.
+	constexpr size_t Count = (size_t)Shared_Primitive::Count;
+	static std::array<std::weak_ptr<const Shared_Geometry>, Count> registry;
+
+	auto& slot = registry[(size_t)primitive];
+	if (auto alive = slot.lock()) return alive;
+
+	Object_File object;
+	switch (primitive) {
+	case Shared_Primitive::Unit_Cube:		object = Object_File::cube({ 1, 1, 1 });		break;
+	case Shared_Primitive::Unit_Tetraedre:	object = Object_File::tetraedre({ 1, 1, 1 });	break;
+	default:								assert(false);									break;
+	}
+
+	auto geometry = std::make_shared<const Shared_Geometry>(std::move(object));
+	slot = geometry;
+	return geometry;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <memory>
+#include <cstdint>
+
+#include "Files/FileFormat.hpp"
+
+// The procedural meshes every helper Model wants (bounding boxes, control points, lights...).
+// Each one is made at unit size and uploaded once, the Models drawing it share the vertex array
+// and get their size through their transform. It lives as long as someone holds it.
+// It needs the OpenGL context, so main thread only.
+enum class Shared_Primitive {
+	Unit_Cube = 0,
+	Unit_Tetraedre,
+	Count
+};
+
+struct Shared_Geometry {
+	Shared_Geometry(const Shared_Geometry&) = delete;
+	Shared_Geometry& operator=(const Shared_Geometry&) = delete;
+
+	Shared_Geometry(Object_File object) noexcept;
+	~Shared_Geometry() noexcept;
+
+	const Object_File object;
+
+	// The attributes are already set in the vertex array, same layout as Model::set_object.
+	uint32_t vertex_array_id{ 0 };
+	uint32_t buffer_ids[5]{};
+};
+
+std::shared_ptr<const Shared_Geometry> acquire_geometry(Shared_Primitive primitive) noexcept;
@@ -26,13 +26,22 @@
 #include "Scene/Primitive.hpp"
 #include "Scene/Bezier.hpp"
 #include "Scene/Surface.hpp"
+#include "Files/AssetPack.hpp"
+#include "Files/BrdfLut.hpp"
+#include "Files/CubemapFaces.hpp"
+#include "Files/Environment.hpp"
+#include "Files/TextureFile.hpp"
 #include "Managers/AssetsManager.hpp"
 #include "Managers/InputsManager.hpp"
 #include "Utils/TimeInfo.hpp"
+#include "Utils/Timeline.hpp"
 #include "Utils/Logs.hpp"
 
 #include "Graphic/FrameBuffer.hpp"
 
+#include <array>
+#include <chrono>
+
 // Turns out that sfml (wich we link statically) already implement stb_image
 // so we don't do taht otherwise we would get duplicate symbol.
 // #define STB_IMAGE_IMPLEMENTATION
@@ -47,6 +56,12 @@ void load_shaders() noexcept;
 void construct_managers() noexcept;
 void destroy_managers() noexcept;
 
+int bake_environments(int argc, char** argv) noexcept;
+int convert_textures(int argc, char** argv) noexcept;
+int pack_assets(int argc, char** argv) noexcept;
+int validate_blocks() noexcept;
+int validate_brdf_lut() noexcept;
+
 void update(
 	Widget3& root,
 	Images_Settings& img_settings,
@@ -77,17 +92,55 @@ void render_postprocessing(
 
 void update_debug_ui() noexcept;
 
-int main() {
+int main(int argc, char** argv) {
+	// Infographie --bake-environments a.hdr b.hdr ... fills the caches and leaves, no window, no
+	// gl, so it can run in the asset build.
+	if (argc > 1 && std::string(argv[1]) == "--bake-environments") {
+		return bake_environments(argc - 2, argv + 2);
+	}
+	// Infographie --convert-textures [--compress] [--high] [--normal-map] [--linear] files or
+	// folders..., writes an .igtex next to every image, Assets_Manager loads those instead.
+	if (argc > 1 && std::string(argv[1]) == "--convert-textures") {
+		return convert_textures(argc - 2, argv + 2);
+	}
+	// Infographie --pack-assets res.igpack files or folders..., everything under the folders goes
+	// in the pack, that's what we mount at startup if it's there.
+	if (argc > 1 && std::string(argv[1]) == "--pack-assets") {
+		return pack_assets(argc - 2, argv + 2);
+	}
+	// Infographie --validate-blocks round trips synthetic blocks through every block format and
+	// prints what didn't come back right, fails if anything didn't.
+	if (argc > 1 && std::string(argv[1]) == "--validate-blocks") {
+		return validate_blocks();
+	}
+	// Infographie --validate-brdf-lut compares the shipped lut with one integrated again with a lot
+	// more samples, fails if it's too far from it.
+	if (argc > 1 && std::string(argv[1]) == "--validate-brdf-lut") {
+		return validate_brdf_lut();
+	}
+
 	View_Matrix = new Matrix4f();
 	Projection_Matrix = new Matrix4f();
 
+	// Printed once we can draw the first frame. The loads run on the workers while the main thread
+	// makes the window, so what we wait for is the longest chain in there, not the sum.
+	Timeline startup;
+
+	auto managers_span = startup.begin("Managers");
 	construct_managers();
 	defer{ destroy_managers(); };
+	AM->set_timeline(&startup);
 
+	// Without a pack we read res/ as it is.
+	if (AM->mount_pack("res.igpack")) std::printf("Mounted res.igpack\n");
+
+	// Those only start the loads, the decoding goes on while we make the window.
 	load_textures();
 	load_objects();
 	load_shaders();
+	startup.end(managers_span);
 
+	auto window_span = startup.begin("Window", { managers_span });
 	details::Window_Struct::instance = new details::Window_Struct();
 	defer{ delete details::Window_Struct::instance; };
 
@@ -108,7 +161,9 @@ int main() {
 		context_settings
 	);
 	push_cursor(sf::Cursor::Arrow);
+	startup.end(window_span);
 
+	auto glew_span = startup.begin("GLEW", { window_span });
 	glewExperimental = true; // Needed for core profile
 	if (glewInit() != GLEW_OK) {
 		fprintf(stderr, "Failed to initialize GLEW\n");
@@ -121,13 +176,31 @@ int main() {
 		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_TRUE);
 		glDebugMessageCallback((GLDEBUGPROCARB)Common::verbose_opengl_error, NULL);
 	}
+	startup.end(glew_span);
+	// Only from there can the finish steps of the loads run.
+	AM->set_timeline(&startup, glew_span);
 
+	auto imgui_span = startup.begin("ImGui", { glew_span });
 	ImGui::SFML::Init(Window_Info.window);
+	startup.end(imgui_span);
+
+	// The gl side of the loads needs the context, so it's done here on the main thread.
+	AM->wait_all();
 
+	auto watcher_span = startup.begin("Hot reload");
+	AM->set_hot_reload(true);
+	startup.end(watcher_span);
+
+	auto targets_span = startup.begin("Render targets", { imgui_span });
 	sf::RenderTexture sf_render_texture;
 	sf_render_texture.create(UNROLL_2(Window_Info.size));
 
 	Texture_Buffer render_texture(Window_Info.size);
+	startup.end(targets_span);
+
+	// Nothing is loading anymore, what comes next isn't the startup.
+	AM->set_timeline(nullptr);
+	startup.print();
 
 	Images_Settings img_settings;
 	Camera_Settings cam_settings;
@@ -186,26 +259,37 @@ int main() {
 
 	//cam_settings.camera_ids.push_back(camera2.get_uuid());
 	{
-	img_settings.import_images_callback.push_back([&](const std::filesystem::path& path) {
-		if (!AM->load_texture(path.generic_string(), path)) return;
-		auto& texture = AM->get_texture(path.generic_string());
-		auto img_widget = scene_root.make_child<Image>(texture);
-		img_widget->set_global_position((Vector2f)Window_Info.size / 2);
-		if (!img_widget->size_ok_for_sampling()) {
-			Log.push("Please note that the sampling feature take sample of 30 px from an image\n\
-				so you won't be able to sample this image");
-			Log.show = true;
-		}
-		img_settings.images_widget_id.push_back(img_widget->get_uuid());
+	img_settings.import_images_callback.push_back([&](std::vector<std::filesystem::path> paths) {
+		// Decoded on the workers, each widget is made on the main thread once its texture is
+		// uploaded. In a batch only the first to arrive is open, a folder of photos stacked in
+		// the middle of the screen is no use.
+		auto first = std::make_shared<bool>(true);
+		AM->import_textures(std::move(paths), [&, first](const std::string& key, const auto&) {
+			std::lock_guard guard{ img_settings.mutex };
+			auto img_widget = scene_root.make_child<Image>(key);
+			img_widget->set_global_position((Vector2f)Window_Info.size / 2);
+			img_widget->set_open(*first);
+			if (*first && !img_widget->size_ok_for_sampling()) {
+				Log.push(
+					"Please note that the sampling feature take sample of 30 px from an image\n"
+					"so you won't be able to sample this image"
+				);
+				Log.show = true;
+			}
+			*first = false;
+			img_settings.images_widget_id.push_back(img_widget->get_uuid());
+		});
 	});
 	img_settings.create_images_callback.push_back([&](const sf::Image& image){
 		static size_t Counter{ 0 };
-		auto& texture = AM->create_texture(std::to_string(Counter++) + "_created_image___");
+		auto key = std::to_string(Counter++) + "_created_image___";
+		auto& texture = AM->create_texture(key);
 		if (!texture.loadFromImage(image)) {
 			Log.push("Problem creating the texture from the sampled image.");
 			return;
 		}
-		auto img_widget = scene_root.make_child<Image>(texture);
+		AM->get_image_cache().put(key, image);
+		auto img_widget = scene_root.make_child<Image>(key);
 		img_widget->set_global_position((Vector2f)Window_Info.size / 2);
 		img_settings.images_widget_id.push_back(img_widget->get_uuid());
 	});
@@ -228,21 +312,36 @@ int main() {
 		}
 	);
 	geo_settings.model_added_callback.push_back([&](const std::filesystem::path& path) {
-		if (!AM->load_object_file(path.generic_string(), path)) return;
+		auto key = path.generic_string();
+		if (!AM->load_object_file(key, path, geo_settings.mesh_pipeline)) return;
+		bool packed =
+			geo_settings.compact_vertices &&
+			AM->pack_object_file(key, Position_Format::Unorm16);
+
 		std::lock_guard guard{ function_from_another_thread_mutex };
-		function_from_another_thread.push_back([&, path] {
+		function_from_another_thread.push_back([&, path, packed] {
 			std::lock_guard guard{ geo_settings.mutex };
 
 			auto model_widget = scene_root.make_child<Model>();
 			geo_settings.models_widget_id.push_back(model_widget->get_uuid());
-			model_widget->set_object(AM->get_object_file(path.generic_string()));
+			if (packed)
+				model_widget->set_object(AM->get_packed_object_file(path.generic_string()));
+			else
+				model_widget->set_object(AM->get_object_file(path.generic_string()));
 			model_widget->set_shader(AM->get_shader("Deferred_Simple"));
 			model_widget->set_select_shader(AM->get_shader("Selected"));
 		});
 	});
 	geo_settings.texture_callback.push_back(
 		[&](Uuid_t id, std::filesystem::path path, Geometries_Settings::Texture_Type type) {
-			if (!AM->load_texture(path.generic_string(), path)) return;
+			using Enum = Geometries_Settings::Texture_Type;
+			// Only the colors are sRGB, the rest is data we must filter as is.
+			Texture_Options options;
+			options.mips.srgb = type == Enum::Main || type == Enum::Speculative;
+			options.mips.normal_map = type == Enum::Normal;
+			options.compression = geo_settings.texture_compression;
+			options.compression.normal_map = type == Enum::Normal;
+			if (!AM->load_texture(path.generic_string(), path, options)) return;
 			auto model_widget = (Model*)scene_root.find_child(id);
 
 			std::lock_guard guard{ function_from_another_thread_mutex };
@@ -301,35 +400,34 @@ int main() {
 	tex_settings.cubemap_added.push_back([&](std::filesystem::path path) {
 		if (!std::filesystem::is_directory(path)) return;
 
-		// i know i should stay away from manual memory management
-		// but i don't want to make the render thread wait to load those images
-		// and i'm not sure of the semantics of std::shared/unique_ptr just yet..
-		sf::Image* data = new sf::Image[6];
-		const auto texture_names =
-			{ "right.png", "left.png", "top.png", "bot.png", "front.png", "back.png" };
-
-		size_t i = 0;
-		for (auto& x : texture_names) {
-			if (!std::filesystem::is_regular_file(path / x)) {
-				Log.push(std::string("Missing in the cube map folder: ") + x);
-				return;
-			}
-			if (!data[i].loadFromFile((path / x).generic_string())) return;
-			++i;
+		// Decoded here so the render thread doesn't wait, the faces are moved in a shared_ptr
+		// only because std::function wants a copyable lambda.
+		std::string error;
+		auto faces = load_cubemap_faces(path, error);
+		if (!faces) {
+			Log.push(std::move(error));
+			return;
 		}
+		std::printf(
+			"Cube map: %s, 6 x %ux%u in %.0f ms\n",
+			path.generic_string().c_str(),
+			faces->size,
+			faces->size,
+			faces->seconds * 1000
+		);
 
 		std::lock_guard guard{ function_from_another_thread_mutex };
-		function_from_another_thread.push_back([&, p = path, d = data] {
-			auto cubemap = new Cube_Map();
-			scene_root.add_child(cubemap, 5);
-
-			tex_settings.cubemap_ids.push_back(cubemap->get_uuid());
-			cubemap->set_name((--p.end())->generic_string()); // <- that's code for the parent dir.
-			cubemap->set_textures(std::move(d));
-
-			// I hope this will eventually execute
-			delete[] d;
-		});
+		function_from_another_thread.push_back(
+			[&, p = path, d = std::make_shared<Cubemap_Faces>(std::move(*faces))] {
+				auto cubemap = new Cube_Map();
+				scene_root.add_child(cubemap, 5);
+
+				tex_settings.cubemap_ids.push_back(cubemap->get_uuid());
+				// That's code for the parent dir.
+				cubemap->set_name((--p.end())->generic_string());
+				cubemap->set_textures(*d);
+			}
+		);
 	});
 	tex_settings.environment_added.push_back([&](std::filesystem::path path) {
 		if (!std::filesystem::is_regular_file(path)) return;
@@ -344,8 +442,33 @@ int main() {
 			if (!cubemap->load_texture(p)) {
 				Log.push("Couldn't load cubemap");
 			}
+
+			// The cube map might be gone by then, so we look it up again.
+			AM->watch_file(p, [&, p, id = cubemap->get_uuid()] {
+				auto cubemap = (Cube_Map*)scene_root.find_child(id);
+				if (cubemap && !cubemap->load_texture(p)) Log.push("Couldn't reload cubemap");
+			});
 		});
 	});
+	AM->object_file_reloaded.push_back([&](const std::string& key) {
+		std::lock_guard guard{ geo_settings.mutex };
+
+		auto& object = AM->get_object_file(key);
+		for (auto& id : geo_settings.models_widget_id) {
+			auto model_widget = (Model*)scene_root.find_child(id);
+			if (!model_widget) continue;
+
+			if (model_widget->get_object_file() == &object) {
+				model_widget->set_object(object);
+			}
+			else if (
+				model_widget->get_packed_object_file() &&
+				model_widget->get_packed_object_file() == &AM->get_packed_object_file(key)
+			) {
+				model_widget->set_object(AM->get_packed_object_file(key));
+			}
+		}
+	});
 	top_settings.added_curve.push_back([&](size_t n_point) {
 		scene_root.make_child<Bezier>(n_point);
 	});
@@ -357,6 +480,9 @@ int main() {
 	float dt;
 	while (Window_Info.window.isOpen()) {
 		dt = dt_clock.restart().asSeconds();
+		// An import of a few hundred images shouldn't upload them all in the same frame.
+		AM->finish_async_loads(4);
+		AM->update_hot_reload();
 		IM::update(Window_Info.window);
 		if (!Window_Info.window.isOpen()) break;
 
@@ -508,7 +634,8 @@ void render(
 	texture_target.set_active();
 	texture_target.clear({ 0, 0, 0, 1 });
 
-	auto& shader_light = AM->get_shader("Deferred_Light");
+	static const auto light_key = AM->shader_key("Deferred_Light");
+	auto& shader_light = AM->get_shader(light_key);
 	shader_light.setUniform("ambient_strength", ill_settings.ambient.strength);
 	shader_light.setUniform("ambient_color", sf::Vector3f{ UNROLL_3(ill_settings.ambient.color) });
 
@@ -563,7 +690,14 @@ void render(
 void render_postprocessing(
 	Texture_Settings& settings, const sf::Texture& texture, sf::RenderTarget& target
 ) noexcept {
-	auto& shader = AM->get_shader(Texture_Settings::Tone_String[(int)settings.current_tone]);
+	static const auto tone_keys = [] {
+		std::array<Asset_Key, (size_t)Texture_Settings::Tone::Count> keys;
+		for (size_t i = 0; i < keys.size(); ++i) {
+			keys[i] = AM->shader_key(Texture_Settings::Tone_String[i]);
+		}
+		return keys;
+	}();
+	auto& shader = AM->get_shader(tone_keys[(size_t)settings.current_tone]);
 	shader.setUniform("texture", texture);
 
 	switch (settings.current_tone)
@@ -617,81 +751,259 @@ void destroy_managers() noexcept {
 }
 
 void load_textures() noexcept {
-	AM->load_texture("Primitives_Tool", "res/Primitives_Tool.png");
-	AM->load_texture("Drawings_Tool", "res/Drawings_Tool.png");
-	AM->load_texture("DT_Circle", "res/DT_Circle.png");
-	AM->load_texture("DT_Line", "res/DT_Line.png");
-	AM->load_texture("White", "res/White.png");
-	AM->load_texture("DT_Square", "res/DT_Square.png");
-	AM->load_texture("DT_Fill", "res/DT_Fill.png");
-	AM->load_texture("Cube_Icon", "res/cube_icon.png");
-	AM->load_texture("Tetra_Icon", "res/tetradre_icon.png");
-	AM->load_texture("PT_Polygon", "res/PT_Polygon.png");
-	AM->load_texture("PT_Arrow", "res/PT_Arrow.png");
-	AM->load_texture("PT_Star", "res/PT_Star.png");
-	AM->load_texture("PT_Heart", "res/PT_Heart.png");
-	AM->load_texture("PT_Rect", "res/PT_Rect.png");
+	AM->load_texture_async("White", "res/White.png");
+	AM->load_texture_async("Tetra_Icon", "res/tetradre_icon.png");
+
+	// The icons of the tools, all in one texture so the ui doesn't switch for each button.
+	AM->load_icon_atlas_async("Tool_Icons", {
+		{ "Primitives_Tool", "res/Primitives_Tool.png" },
+		{ "Drawings_Tool", "res/Drawings_Tool.png" },
+		{ "DT_Circle", "res/DT_Circle.png" },
+		{ "DT_Line", "res/DT_Line.png" },
+		{ "DT_Square", "res/DT_Square.png" },
+		{ "DT_Fill", "res/DT_Fill.png" },
+		{ "Cube_Icon", "res/cube_icon.png" },
+		{ "PT_Polygon", "res/PT_Polygon.png" },
+		{ "PT_Arrow", "res/PT_Arrow.png" },
+		{ "PT_Star", "res/PT_Star.png" },
+		{ "PT_Heart", "res/PT_Heart.png" },
+		{ "PT_Rect", "res/PT_Rect.png" },
+	});
 }
 
 void load_objects() noexcept {}
 
 void load_shaders() noexcept {
-	AM->load_shader(
+	AM->load_shader_async(
 		Texture_Settings::Tone_String[(int)Texture_Settings::Tone::Identity],
 		"res/shaders/Identity.vertex",
 		"res/shaders/Identity.fragment"
 	);
-	AM->load_shader(
+	AM->load_shader_async(
 		Texture_Settings::Tone_String[(int)Texture_Settings::Tone::BW],
 		"res/shaders/Identity.vertex",
 		"res/shaders/Black_And_White.fragment"
 	);
-	AM->load_shader(
+	AM->load_shader_async(
 		Texture_Settings::Tone_String[(int)Texture_Settings::Tone::Sepia],
 		"res/shaders/Identity.vertex",
 		"res/shaders/Sepia.fragment"
 	);
-	AM->load_shader(
+	AM->load_shader_async(
 		Texture_Settings::Tone_String[(int)Texture_Settings::Tone::Blur],
 		"res/shaders/Identity.vertex",
 		"res/shaders/Blur.fragment"
 	);
-	AM->load_shader(
+	AM->load_shader_async(
 		Texture_Settings::Tone_String[(int)Texture_Settings::Tone::Edge],
 		"res/shaders/Identity.vertex",
 		"res/shaders/Edge.fragment"
 	);
-	AM->load_shader("Skybox", "res/shaders/Skybox.vertex", "res/shaders/Skybox.fragment");
-	AM->load_shader(
+	AM->load_shader_async("Skybox", "res/shaders/Skybox.vertex", "res/shaders/Skybox.fragment");
+	AM->load_shader_async(
 		"Selected",
 		"res/shaders/Simple_Deferred.vertex",
 		"res/shaders/Simple_Deferred.fragment",
 		"res/shaders/Implode.geometry"
 	);
-	AM->load_shader(
+	AM->load_shader_async(
 		"Deferred_Simple",
 		"res/shaders/Simple_Deferred.vertex",
 		"res/shaders/Simple_Deferred.fragment"
 	);
-	AM->load_shader(
+	AM->load_shader_async(
 		"Simple",
 		"res/shaders/Simple.vertex",
 		"res/shaders/Simple.fragment"
 	);
-	AM->load_shader(
+	AM->load_shader_async(
 		"Deferred_Light",
 		"res/shaders/Light_Deferred.vertex",
 		"res/shaders/Light_Deferred.fragment"
 	);
-	AM->load_shader(
+	AM->load_shader_async(
 		"Deferred_Debug",
 		"res/shaders/FBO_Debug.vertex",
 		"res/shaders/FBO_Debug.fragment"
 	);
-	AM->load_shader("Light_Box", "res/shaders/Light_Box.vertex", "res/shaders/Light_Box.fragment");
-	AM->load_shader("HDR", "res/shaders/HDR.vertex", "res/shaders/HDR.fragment");
-	AM->load_shader("SSAO", "res/shaders/HDR.vertex", "res/shaders/ssao.fragment");
-	AM->load_shader("SSAO_Blur", "res/shaders/HDR.vertex", "res/shaders/SSAO_blur.fragment");
+	AM->load_shader_async(
+		"Light_Box", "res/shaders/Light_Box.vertex", "res/shaders/Light_Box.fragment"
+	);
+	AM->load_shader_async("HDR", "res/shaders/HDR.vertex", "res/shaders/HDR.fragment");
+	AM->load_shader_async("SSAO", "res/shaders/HDR.vertex", "res/shaders/ssao.fragment");
+	AM->load_shader_async("SSAO_Blur", "res/shaders/HDR.vertex", "res/shaders/SSAO_blur.fragment");
+}
+
+int bake_environments(int argc, char** argv) noexcept {
+	// Relative to where we were called from, before we move to where the res/ and cache/ are.
+	std::vector<std::filesystem::path> sources;
+	for (int i = 0; i < argc; ++i) sources.push_back(std::filesystem::absolute(argv[i]));
+	std::filesystem::current_path(Base_Working_Directory);
+
+	int result = 0;
+	for (auto& source : sources) {
+		auto maps = cached_environment(source);
+		if (!maps) {
+			fprintf(stderr, "Can't bake %s\n", source.generic_string().c_str());
+			result = 1;
+			continue;
+		}
+
+		if (maps->seconds > 0) {
+			printf(
+				"%s: %u faces, %zu prefilter levels in %.0f ms\n",
+				source.filename().generic_string().c_str(),
+				maps->cube.size,
+				maps->prefilter.size(),
+				maps->seconds * 1000
+			);
+		} else {
+			printf("%s: already cached\n", source.filename().generic_string().c_str());
+		}
+	}
+
+	cached_brdf_lut("res/textures/brdf_lut.bin", Brdf_Lut_Kind::Multi_Scatter);
+	return result;
+}
+
+int convert_textures(int argc, char** argv) noexcept {
+	// The options have to be the ones the texture is loaded with, otherwise the .igtex is
+	// ignored. The defaults are those of load_texture.
+	Mip_Options mips;
+	Block_Options blocks;
+	std::vector<std::filesystem::path> sources;
+	for (int i = 0; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--compress") blocks.enabled = true;
+		else if (arg == "--high") blocks.quality = Block_Quality::High;
+		else if (arg == "--normal-map") {
+			mips.normal_map = true;
+			blocks.normal_map = true;
+		}
+		else if (arg == "--linear") mips.srgb = false;
+		else sources.push_back(std::filesystem::absolute(arg));
+	}
+	std::filesystem::current_path(Base_Working_Directory);
+
+	// Only the images directly in the folders, not the ones of the subfolders.
+	auto is_image = [](const std::filesystem::path& path) {
+		auto ext = path.extension().generic_string();
+		return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tga";
+	};
+	std::vector<std::filesystem::path> files;
+	for (auto& source : sources) {
+		std::error_code ec;
+		if (!std::filesystem::is_directory(source, ec)) {
+			files.push_back(source);
+			continue;
+		}
+		for (auto& entry : std::filesystem::directory_iterator(source, ec)) {
+			if (entry.is_regular_file(ec) && is_image(entry.path())) files.push_back(entry.path());
+		}
+	}
+
+	int result = 0;
+	for (auto& file : files) {
+		auto start = std::chrono::steady_clock::now();
+		bool converted = convert_texture(file, mips, blocks);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		if (!converted) {
+			fprintf(stderr, "Can't convert %s\n", file.generic_string().c_str());
+			result = 1;
+			continue;
+		}
+		printf(
+			"%s -> %s in %.0f ms\n",
+			file.filename().generic_string().c_str(),
+			texture_file_path(file).filename().generic_string().c_str(),
+			elapsed.count() * 1000
+		);
+	}
+	return result;
+}
+
+int pack_assets(int argc, char** argv) noexcept {
+	if (argc < 1) {
+		fprintf(stderr, "Usage: --pack-assets pack files or folders...\n");
+		return 1;
+	}
+
+	auto pack = std::filesystem::absolute(argv[0]);
+	std::vector<std::filesystem::path> sources;
+	for (int i = 1; i < argc; ++i) sources.push_back(std::filesystem::absolute(argv[i]));
+	// The names in the pack are relative to there, that's where we look them up from.
+	std::filesystem::current_path(Base_Working_Directory);
+
+	std::vector<std::filesystem::path> files;
+	for (auto& source : sources) {
+		std::error_code ec;
+		if (!std::filesystem::is_directory(source, ec)) {
+			files.push_back(source);
+			continue;
+		}
+		for (auto& entry : std::filesystem::recursive_directory_iterator(source, ec)) {
+			if (!entry.is_regular_file(ec)) continue;
+			// Not an older pack in the pack.
+			if (entry.path().extension() == Asset_Pack_Extension) continue;
+			files.push_back(entry.path());
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	if (!write_asset_pack(pack, files)) {
+		fprintf(stderr, "Can't write %s\n", pack.generic_string().c_str());
+		return 1;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::error_code ec;
+	printf(
+		"%s: %zu files, %.1f Mb in %.0f ms\n",
+		pack.filename().generic_string().c_str(),
+		files.size(),
+		std::filesystem::file_size(pack, ec) / (1024.0 * 1024.0),
+		elapsed.count() * 1000
+	);
+	return 0;
+}
+
+int validate_blocks() noexcept {
+	auto failures = validate_block_compression();
+	for (auto& x : failures) fprintf(stderr, "%s\n", x.c_str());
+	if (!failures.empty()) return 1;
+
+	printf("Block compression: every check passed\n");
+	return 0;
+}
+
+int validate_brdf_lut() noexcept {
+	std::filesystem::current_path(Base_Working_Directory);
+
+	auto lut = load_brdf_lut("res/textures/brdf_lut.bin");
+	if (!lut) {
+		fprintf(stderr, "Can't read res/textures/brdf_lut.bin\n");
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	auto error = compare_brdf_lut(*lut);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	bool ok = error.max_error <= Brdf_Lut_Max_Tolerance && error.rmse <= Brdf_Lut_Rmse_Tolerance;
+	printf(
+		"Brdf lut against %u samples: rmse %.5f (%.5f allowed), max %.5f (%.5f allowed) at n.v "
+		"%.3f roughness %.3f, in %.1f s\n",
+		Brdf_Lut_Reference_Samples,
+		error.rmse,
+		Brdf_Lut_Rmse_Tolerance,
+		error.max_error,
+		Brdf_Lut_Max_Tolerance,
+		error.n_dot_v,
+		error.roughness,
+		elapsed.count()
+	);
+	return ok ? 0 : 1;
 }
 
 void update_debug_ui() noexcept {
@@ -699,6 +1011,8 @@ void update_debug_ui() noexcept {
 	if (!Show_Render_Debug && ImGui::Button("Show render debug")) Show_Render_Debug = true;
 
 	if (!Log.data.empty() && ImGui::Button("Show logs")) Log.show = true;
+	bool hot_reload = AM->is_hot_reload();
+	if (ImGui::Checkbox("Hot reload", &hot_reload)) AM->set_hot_reload(hot_reload);
 	ImGui::Checkbox("Demo", &show_demo_window);
 	if (show_demo_window) ImGui::ShowDemoWindow();
 }
@@ -0,0 +1,122 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+// Interned asset key, resolve it once from the string and keep it around, looking it up is then
+// just indexing in an array.
+struct Asset_Key {
+	static constexpr uint32_t None = UINT32_MAX;
+	uint32_t id{ None };
+
+	bool valid() const noexcept { return id != None; }
+};
+
+// Every asset of one type. The slots live in blocks that are never moved nor freed before the
+// registry is, so a reference on an asset stays valid and the lookup by key never takes a lock:
+// it's an atomic load of the block and one of the slot state.
+// Interning a new key and filling a slot are serialized, the first is behind a mutex and the
+// second goes through the slot state (only one thread gets to load a given key at a time).
+template<typename T>
+class Asset_Registry {
+public:
+	Asset_Registry() noexcept = default;
+	~Asset_Registry() noexcept {
+		for (auto& b : blocks) delete[] b.load(std::memory_order_relaxed);
+	}
+
+	Asset_Registry(const Asset_Registry&) = delete;
+	Asset_Registry& operator=(const Asset_Registry&) = delete;
+
+	// Give back the key of this string, making an empty slot for it the first time.
+	Asset_Key intern(const std::string& key) noexcept {
+		if (auto found = find(key); found.valid()) return found;
+
+		std::unique_lock lock{ keys_mutex };
+		auto it = keys.find(key);
+		if (it != std::end(keys)) return it->second;
+
+		uint32_t id = count;
+		assert(id < Max_Blocks * Block_Size && "Too many assets");
+		auto& block = blocks[id >> Block_Bits];
+		if (!block.load(std::memory_order_relaxed)) {
+			block.store(new Slot[Block_Size], std::memory_order_release);
+		}
+		count++;
+
+		keys.emplace(key, Asset_Key{ id });
+		return { id };
+	}
+
+	// Doesn't make a slot, the key is not valid if the string was never interned.
+	Asset_Key find(const std::string& key) const noexcept {
+		std::shared_lock lock{ keys_mutex };
+		auto it = keys.find(key);
+		return it != std::end(keys) ? it->second : Asset_Key{};
+	}
+
+	bool is_ready(Asset_Key key) const noexcept {
+		if (!key.valid()) return false;
+		return slot(key).state.load(std::memory_order_acquire) == State::Ready;
+	}
+
+	T& get(Asset_Key key) noexcept {
+		assert(is_ready(key) && "Asset isn't loaded");
+		return slot(key).value;
+	}
+
+	// Start filling the slot, we get nullptr back if it is already loaded (unless reload).
+	// If another thread is loading it we wait for it, and try ourselves if it failed.
+	// Every non null result must be followed by an end_load.
+	T* begin_load(Asset_Key key, bool reload = false) noexcept {
+		auto& s = slot(key);
+		while (true) {
+			auto state = s.state.load(std::memory_order_acquire);
+			if (state == State::Loading) {
+				s.state.wait(State::Loading, std::memory_order_acquire);
+				continue;
+			}
+			if (state == State::Ready && !reload) return nullptr;
+
+			if (s.state.compare_exchange_weak(state, State::Loading, std::memory_order_acquire))
+				return &s.value;
+		}
+	}
+
+	void end_load(Asset_Key key, bool loaded) noexcept {
+		auto& s = slot(key);
+		s.state.store(loaded ? State::Ready : State::Empty, std::memory_order_release);
+		s.state.notify_all();
+	}
+
+private:
+	enum class State : uint8_t {
+		Empty = 0,
+		Loading,
+		Ready
+	};
+
+	struct Slot {
+		std::atomic<State> state{ State::Empty };
+		T value;
+	};
+
+	static constexpr size_t Block_Bits = 8;
+	static constexpr size_t Block_Size = (size_t)1 << Block_Bits;
+	static constexpr size_t Max_Blocks = 1024;
+
+	Slot& slot(Asset_Key key) const noexcept {
+		auto block = blocks[key.id >> Block_Bits].load(std::memory_order_acquire);
+		return block[key.id & (Block_Size - 1)];
+	}
+
+	std::atomic<Slot*> blocks[Max_Blocks]{};
+
+	mutable std::shared_mutex keys_mutex;
+	std::unordered_map<std::string, Asset_Key> keys;
+	uint32_t count{ 0 };
+};
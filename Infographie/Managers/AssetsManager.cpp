@@ -1,6 +1,11 @@
 #include "AssetsManager.hpp"
 #include "Common.hpp"
 
+#include "Files/PngStream.hpp"
+#include "OS/FileIO.hpp"
+#include "Utils/TimeInfo.hpp"
+
+#include <chrono>
 #include <filesystem>
 #include <cassert>
 #include <fstream>
@@ -20,20 +25,398 @@ void stubSetConsoleTextAttibute() {
 };
 #endif
 
+namespace {
+	// The async loads print everything at once from the main thread, so the lines of two assets
+	// finishing together don't get mixed.
+	void print_load(const char* action, const std::string& what, bool loaded) noexcept {
+		stubSetConsoleTextAttribute(
+			GetStdHandle(STD_OUTPUT_HANDLE),
+			FOREGROUND_RED | FOREGROUND_BLUE
+		);
+		std::printf("%s: ", action);
+		stubSetConsoleTextAttribute(
+			GetStdHandle(STD_OUTPUT_HANDLE),
+			FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE
+		);
+		std::printf("%s ", what.c_str());
+		if (!loaded) {
+			stubSetConsoleTextAttribute(
+				GetStdHandle(STD_OUTPUT_HANDLE),
+				FOREGROUND_RED
+			);
+			printf("Couldn't load file /!\\\n");
+		}
+		else {
+			stubSetConsoleTextAttribute(
+				GetStdHandle(STD_OUTPUT_HANDLE),
+				FOREGROUND_GREEN
+			);
+			printf("Succes !\n");
+		}
+		stubSetConsoleTextAttribute(
+			GetStdHandle(STD_OUTPUT_HANDLE),
+			FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE
+		);
+	}
+
+	// We can only read the files on a worker, compiling needs the gl context.
+	struct Shader_Sources {
+		std::string vertex;
+		std::string fragment;
+		std::string geometry;
+
+		// geometry is optional.
+		bool read(
+			const std::filesystem::path& vertex_path,
+			const std::filesystem::path& fragment_path,
+			const std::filesystem::path& geometry_path
+		) noexcept {
+			auto read_file = [](const std::filesystem::path& path, std::string& source) {
+				auto file = read_asset(path);
+				if (!file) return false;
+				source.assign(file->data(), file->size());
+				return true;
+			};
+			if (!read_file(vertex_path, vertex)) return false;
+			if (!read_file(fragment_path, fragment)) return false;
+			if (!geometry_path.empty() && !read_file(geometry_path, geometry)) return false;
+			return true;
+		}
+
+		bool compile(sf::Shader& shader) const noexcept {
+			return geometry.empty() ?
+				shader.loadFromMemory(vertex, fragment) :
+				shader.loadFromMemory(vertex, geometry, fragment);
+		}
+	};
+
+	// Through the pack, sfml would open the file itself. Not for fonts, they keep the bytes.
+	template<typename T>
+	bool load_asset(T& x, const std::filesystem::path& path) noexcept {
+		auto asset = read_asset(path);
+		return asset && x.loadFromMemory(asset->data(), asset->size());
+	}
+
+	GLenum gl_format(Block_Format format) noexcept {
+		switch (format) {
+		case Block_Format::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case Block_Format::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case Block_Format::BC4: return GL_COMPRESSED_RED_RGTC1;
+		case Block_Format::BC5: return GL_COMPRESSED_RG_RGTC2;
+		case Block_Format::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+		default: return GL_RGBA8;
+		}
+	}
+
+	// Main thread, the levels are uploaded. Where the sampling should stop and how it goes
+	// between the levels.
+	void finish_levels(const sf::Texture& texture, size_t last_level) noexcept {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)last_level);
+		if (last_level > 0) {
+			glTexParameteri(
+				GL_TEXTURE_2D,
+				GL_TEXTURE_MIN_FILTER,
+				texture.isSmooth() ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST
+			);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		// Same as sfml does, so the other contexts see it right away.
+		glFlush();
+	}
+
+	// What a texture is made of before the upload, all of it can be done on a worker.
+	struct Texture_Pixels {
+		sf::Image image;
+		std::vector<Mip_Level<uint8_t>> mips;
+		// When it's compressed we don't need the mips, they are in there.
+		Compressed_Texture blocks;
+		// The converted file, if there is one we don't decode anything, every level is uploaded
+		// straight from the mapping. image stays empty.
+		std::optional<Texture_File> container;
+		// Empty unless the options ask for one.
+		Mip_Level<uint8_t> thumbnail;
+		// Only for the images bigger than the preview_size, what we upload first. There are no
+		// mips then, the manager refines it from image (or decodes it first when the preview was
+		// streamed out of the png, image is empty then).
+		Mip_Level<uint8_t> preview;
+		// Of the image the preview stands for.
+		sf::Vector2u full_size;
+
+		bool load(const std::filesystem::path& path, const Texture_Options& options) noexcept {
+			container = find_texture_file(path, options.mips, options.compression);
+			if (container) {
+				// The upload reads it on the main thread, better if it's not waiting on the disk.
+				container->file.prefetch();
+				if (options.thumbnail_size) make_thumbnail(options);
+				return true;
+			}
+
+			auto bytes = read_asset(path);
+			if (!bytes) return false;
+			// A png that big is never decoded whole here, we only stream the preview out of it.
+			if (options.preview_size) {
+				auto streamed =
+					stream_png_preview(bytes->data(), bytes->size(), options.preview_size);
+				if (streamed) {
+					preview = std::move(streamed->level);
+					full_size = { streamed->width, streamed->height };
+					if (options.thumbnail_size) make_thumbnail(options);
+					return true;
+				}
+			}
+			if (!image.loadFromMemory(bytes->data(), bytes->size())) return false;
+			bytes.reset();
+
+			auto size = image.getSize();
+			auto rgba = image.getPixelsPtr();
+			// The chain of something that big would take longer than the decoding did. The other
+			// formats can only be decoded whole, the preview comes after that.
+			if (options.preview_size && std::max(size.x, size.y) > options.preview_size) {
+				preview = box_downscale_to_fit(rgba, size.x, size.y, options.preview_size);
+				full_size = size;
+				if (options.thumbnail_size) make_thumbnail(options);
+				return true;
+			}
+			blocks = compress_texture(path, rgba, size.x, size.y, options.mips, options.compression);
+			if (blocks.format == Block_Format::None) {
+				mips = cached_mips(path, rgba, size.x, size.y, options.mips);
+			}
+			if (options.thumbnail_size) make_thumbnail(options);
+			return true;
+		}
+
+		// From the smallest level still bigger than the thumbnail, the chain did most of the
+		// filtering already. A compressed container has no pixels we can read, so no thumbnail.
+		void make_thumbnail(const Texture_Options& options) noexcept {
+			const uint8_t* rgba = nullptr;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			// The levels come from the biggest to the smallest.
+			auto consider = [&](const uint8_t* level, uint32_t w, uint32_t h) {
+				if (rgba && std::max(w, h) < options.thumbnail_size) return;
+				rgba = level;
+				width = w;
+				height = h;
+			};
+
+			if (container) {
+				if (container->header.format != Block_Format::None) return;
+				for (size_t i = 0; i < container->levels.size(); ++i) {
+					auto& level = container->levels[i];
+					consider(container->level_data(i), level.width, level.height);
+				}
+			}
+			else {
+				consider(image.getPixelsPtr(), image.getSize().x, image.getSize().y);
+				if (refining()) consider(preview.pixels.data(), preview.width, preview.height);
+				for (auto& level : mips) consider(level.pixels.data(), level.width, level.height);
+			}
+			if (!rgba || width == 0 || height == 0) return;
+
+			thumbnail = downscale_to_fit(rgba, width, height, options.thumbnail_size, options.mips);
+		}
+
+		// gl thread. sfml makes the texture, then we put the rest of the chain under its base
+		// level, or replace every level by the compressed ones.
+		bool upload(sf::Texture& texture) const noexcept {
+			if (container) return upload_container(texture);
+			if (refining()) {
+				if (!texture.create(preview.width, preview.height)) return false;
+				texture.update(preview.pixels.data());
+				return true;
+			}
+
+			bool compressed = blocks.format != Block_Format::None;
+			auto size = image.getSize();
+			if (!(compressed ? texture.create(size.x, size.y) : texture.loadFromImage(image)))
+				return false;
+			if (!compressed && mips.empty()) return true;
+
+			// Off the main thread sfml only has a context active inside its own calls.
+			std::optional<sf::Context> context;
+			if (!sf::Context::getActiveContext()) context.emplace();
+
+			glBindTexture(GL_TEXTURE_2D, texture.getNativeHandle());
+			size_t last_level = 0;
+			if (compressed) {
+				for (size_t i = 0; i < blocks.levels.size(); ++i) {
+					auto& level = blocks.levels[i];
+					glCompressedTexImage2D(
+						GL_TEXTURE_2D,
+						(GLint)i,
+						gl_format(blocks.format),
+						level.width,
+						level.height,
+						0,
+						(GLsizei)level.blocks.size(),
+						level.blocks.data()
+					);
+				}
+				last_level = blocks.levels.size() - 1;
+			}
+			else {
+				for (size_t i = 0; i < mips.size(); ++i) {
+					auto& level = mips[i];
+					glTexImage2D(
+						GL_TEXTURE_2D,
+						(GLint)i + 1,
+						GL_RGBA8,
+						level.width,
+						level.height,
+						0,
+						GL_RGBA,
+						GL_UNSIGNED_BYTE,
+						level.pixels.data()
+					);
+				}
+				last_level = mips.size();
+			}
+			finish_levels(texture, last_level);
+			return true;
+		}
+
+		bool upload_container(sf::Texture& texture) const noexcept {
+			auto& header = container->header;
+			if (!texture.create(header.width, header.height)) return false;
+
+			std::optional<sf::Context> context;
+			if (!sf::Context::getActiveContext()) context.emplace();
+
+			glBindTexture(GL_TEXTURE_2D, texture.getNativeHandle());
+			for (size_t i = 0; i < container->levels.size(); ++i) {
+				auto& level = container->levels[i];
+				if (header.format == Block_Format::None) {
+					glTexImage2D(
+						GL_TEXTURE_2D,
+						(GLint)i,
+						GL_RGBA8,
+						level.width,
+						level.height,
+						0,
+						GL_RGBA,
+						GL_UNSIGNED_BYTE,
+						container->level_data(i)
+					);
+				}
+				else {
+					glCompressedTexImage2D(
+						GL_TEXTURE_2D,
+						(GLint)i,
+						gl_format(header.format),
+						level.width,
+						level.height,
+						0,
+						(GLsizei)level.size,
+						container->level_data(i)
+					);
+				}
+			}
+			finish_levels(texture, container->levels.size() - 1);
+			return true;
+		}
+
+		// We only have pixels to keep when we decoded the whole png. From the container or a
+		// streamed preview, what the cache has can be from before (a png we reload now that it's
+		// converted, or that changed), so it's dropped and the png is read again on the next get.
+		// What went in the cache, the refinement reads from it.
+		std::shared_ptr<const sf::Image> keep_pixels(
+			Image_Cache& cache, const std::string& key, const std::filesystem::path& path
+		) noexcept {
+			if (container || streamed()) {
+				cache.remove(key);
+				cache.add(key, path);
+				return nullptr;
+			}
+			auto kept = std::make_shared<const sf::Image>(std::move(image));
+			cache.put(key, kept);
+			return kept;
+		}
+
+		bool refining() const noexcept {
+			return !preview.pixels.empty();
+		}
+
+		bool streamed() const noexcept {
+			return refining() && image.getSize().x == 0;
+		}
+
+		// Main thread, goes under the print_load line.
+		void print_compression() const noexcept {
+			constexpr const char* Names[] = { "", "BC1", "BC3", "BC4", "BC5", "BC7" };
+			static_assert(std::size(Names) == (size_t)Block_Format::Count);
+			if (container) {
+				std::printf(
+					"\t%s%s%zu levels (%s)\n",
+					Names[(size_t)container->header.format],
+					container->header.format == Block_Format::None ? "" : ", ",
+					container->levels.size(),
+					Texture_File_Extension
+				);
+				return;
+			}
+			if (refining()) {
+				std::printf(
+					"\tpreview %ux%u%s, refined from there\n",
+					preview.width,
+					preview.height,
+					streamed() ? " streamed from the png" : ""
+				);
+				return;
+			}
+			if (blocks.format == Block_Format::None) return;
+
+			std::printf(
+				"\t%s, %zu levels, %.2f dB",
+				Names[(size_t)blocks.format],
+				blocks.levels.size(),
+				blocks.psnr
+			);
+			if (blocks.seconds > 0) {
+				std::printf(", %.1f Mtexel/s\n", blocks.texel_count / blocks.seconds / 1e6);
+			}
+			else {
+				std::printf(" (cached)\n");
+			}
+		}
+	};
+
+	// The same file must give the same string however it was named.
+	std::string watch_key(const std::filesystem::path& path) noexcept {
+		std::error_code ec;
+		auto absolute = std::filesystem::absolute(path, ec);
+		return (ec ? path : absolute).lexically_normal().generic_string();
+	}
+
+	// Everything in a timeline has a name, the jobs of when_ready don't come with one.
+	std::string job_name(const Asset_Job& job, uint32_t id) noexcept {
+		return job.name.empty() ? "job " + std::to_string(id) : job.name;
+	}
+};
+
 bool Assets_Manager::have_texture(const std::string& key) noexcept {
-	return textures.find(key) != std::end(textures);
+	return textures.is_ready(textures.find(key));
 }
 
 sf::Texture& Assets_Manager::create_texture(const std::string& key) noexcept {
-	assert(textures.find(key) == std::end(textures));
-	return textures[key];
+	auto id = textures.intern(key);
+	auto ref = textures.begin_load(id);
+	assert(ref && "Texture already exist");
+	textures.end_load(id, true);
+
+	// There is no file behind it, so the pixels come back from the gpu (on the gl thread).
+	image_cache.add(key, [ref](sf::Image& image) {
+		image = ref->copyToImage();
+		return image.getSize().x > 0;
+	});
+	return *ref;
 }
 
 bool Assets_Manager::load_texture(
-	const std::string& key, const std::filesystem::path& path
+	const std::string& key, const std::filesystem::path& path, Texture_Options options
 ) noexcept {
-	if (textures.find(key) != std::end(textures))
-		return true;
+	auto id = textures.intern(key);
+	auto ref = textures.begin_load(id);
+	if (!ref) return true;
 
 	stubSetConsoleTextAttribute(
 		GetStdHandle(STD_OUTPUT_HANDLE), 
@@ -44,11 +427,25 @@ bool Assets_Manager::load_texture(
 		GetStdHandle(STD_OUTPUT_HANDLE), 
 		FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE
 	);
-	auto &ref = textures[key];
-	ref.setSmooth(true);
+	ref->setSmooth(true);
 	std::printf("%s: %ls ", key.c_str(), path.c_str());
 
-	const bool loaded = ref.loadFromFile(path.generic_string());
+	// We decode it ourselves to keep the pixels in the image cache.
+	Texture_Pixels pixels;
+	const bool loaded = pixels.load(path, options) && pixels.upload(*ref);
+	textures.end_load(id, loaded);
+	if (loaded) {
+		put_thumbnail(key, pixels.thumbnail);
+		image_cache.add(key, path);
+		auto kept = pixels.keep_pixels(image_cache, key, path);
+		if (pixels.refining()) {
+			refine_texture(key, path, std::move(kept), pixels.full_size, options);
+		}
+		auto reload = [this, key, path, options] { reload_texture(key, path, options); };
+		add_reload(path, reload);
+		// Converting it again is a change too.
+		add_reload(texture_file_path(path), reload);
+	}
 	if(!loaded) {
 		stubSetConsoleTextAttribute(
 			GetStdHandle(STD_OUTPUT_HANDLE), 
@@ -67,21 +464,59 @@ bool Assets_Manager::load_texture(
 		GetStdHandle(STD_OUTPUT_HANDLE), 
 		FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE
 	);
+	if (loaded) pixels.print_compression();
 	return loaded;
 }
 
 /*const*/ sf::Texture& Assets_Manager::get_texture(const std::string &key) noexcept {
-	auto it = textures.find(key);
-	assert(it != std::end(textures) && "Texture don't exist");
-	return it->second;
+	auto id = textures.find(key);
+	assert(textures.is_ready(id) && "Texture don't exist");
+	return textures.get(id);
+}
+Asset_Key Assets_Manager::texture_key(const std::string& key) noexcept {
+	return textures.intern(key);
+}
+/*const*/ sf::Texture& Assets_Manager::get_texture(Asset_Key key) noexcept {
+	return textures.get(key);
+}
+std::shared_ptr<const sf::Image> Assets_Manager::get_texture_pixels(
+	const std::string& key
+) noexcept {
+	return image_cache.get(key);
+}
+Image_Cache& Assets_Manager::get_image_cache() noexcept {
+	return image_cache;
+}
+const sf::Texture* Assets_Manager::get_thumbnail(const std::string& key) noexcept {
+	auto id = textures.find(key + Thumbnail_Suffix);
+	if (textures.is_ready(id)) return &textures.get(id);
+	id = textures.find(key);
+	if (textures.is_ready(id)) return &textures.get(id);
+	return nullptr;
+}
+void Assets_Manager::put_thumbnail(
+	const std::string& key, const Mip_Level<uint8_t>& thumbnail
+) noexcept {
+	if (thumbnail.pixels.empty()) return;
+
+	auto id = textures.intern(key + Thumbnail_Suffix);
+	auto ref = textures.begin_load(id, true);
+	bool created = ref->getSize() == sf::Vector2u{ thumbnail.width, thumbnail.height };
+	if (!created) created = ref->create(thumbnail.width, thumbnail.height);
+	if (created) {
+		ref->update(thumbnail.pixels.data());
+		ref->setSmooth(true);
+	}
+	textures.end_load(id, created);
 }
 
 bool Assets_Manager::have_image(const std::string& key) noexcept {
-	return images.find(key) != std::end(images);
+	return images.is_ready(images.find(key));
 }
 bool Assets_Manager::load_image(const std::string &key, const std::string &path) noexcept {
-	if (images.find(key) != std::end(images))
-		return true;
+	auto id = images.intern(key);
+	auto ref = images.begin_load(id);
+	if (!ref) return true;
 
 	stubSetConsoleTextAttribute(
 		GetStdHandle(STD_OUTPUT_HANDLE), 
@@ -93,9 +528,9 @@ bool Assets_Manager::load_image(const std::string &key, const std::string &path)
 		FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE
 	);
 	std::printf("%s: %s ", key.c_str(), path.c_str());
-	auto& ref = images[key];
 
-	const bool loaded = ref.loadFromFile(path);
+	const bool loaded = load_asset(*ref, path);
+	images.end_load(id, loaded);
 	if(!loaded) {
 		stubSetConsoleTextAttribute(
 			GetStdHandle(STD_OUTPUT_HANDLE), 
@@ -117,17 +552,18 @@ bool Assets_Manager::load_image(const std::string &key, const std::string &path)
 }
 
 const sf::Image& Assets_Manager::get_image(const std::string &key) noexcept {
-	auto it = images.find(key);
-	assert(it != std::end(images) && "Image don't exist");
-	return it->second;
+	auto id = images.find(key);
+	assert(images.is_ready(id) && "Image don't exist");
+	return images.get(id);
 }
 
 bool Assets_Manager::have_font(const std::string& key) noexcept {
-	return fonts.find(key) != std::end(fonts);
+	return fonts.is_ready(fonts.find(key));
 }
 bool Assets_Manager::load_font(const std::string &key, const std::string &path) noexcept {
-	if (fonts.find(key) != std::end(fonts))
-		return true;
+	auto id = fonts.intern(key);
+	auto ref = fonts.begin_load(id);
+	if (!ref) return true;
 	
 	stubSetConsoleTextAttribute(
 		GetStdHandle(STD_OUTPUT_HANDLE), 
@@ -139,9 +575,13 @@ bool Assets_Manager::load_font(const std::string &key, const std::string &path)
 		FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE
 	);
 	std::printf("%s: %s ", key.c_str(), path.c_str());
-	auto& ref = fonts[key];
 
-	const bool loaded = ref.loadFromFile(path);
+	// sfml reads the font as it needs the glyphs, from the pack it can keep pointing in there.
+	auto packed = find_packed_asset(path);
+	const bool loaded = packed ?
+		ref->loadFromMemory(packed->data(), packed->size()) :
+		ref->loadFromFile(path);
+	fonts.end_load(id, loaded);
 	if(!loaded) {
 		stubSetConsoleTextAttribute(
 			GetStdHandle(STD_OUTPUT_HANDLE), 
@@ -163,20 +603,21 @@ bool Assets_Manager::load_font(const std::string &key, const std::string &path)
 }
 
 const sf::Font& Assets_Manager::get_font(const std::string &key) noexcept {
-	auto it = fonts.find(key);
-	assert(it != std::end(fonts) && "Font don't exist");
-	return it->second;
+	auto id = fonts.find(key);
+	assert(fonts.is_ready(id) && "Font don't exist");
+	return fonts.get(id);
 }
 
 
 bool Assets_Manager::have_object_file(const std::string& key) noexcept {
-	return objects.find(key) != std::end(objects);
+	return objects.is_ready(objects.find(key));
 }
 bool Assets_Manager::load_object_file(
-	const std::string& key, const std::filesystem::path& path
+	const std::string& key, const std::filesystem::path& path, Mesh_Pipeline_Options options
 ) noexcept {
-	if (objects.find(key) != std::end(objects))
-		return true;
+	auto id = objects.intern(key);
+	auto ref = objects.begin_load(id);
+	if (!ref) return true;
 
 	stubSetConsoleTextAttribute(
 		GetStdHandle(STD_OUTPUT_HANDLE),
@@ -188,9 +629,13 @@ bool Assets_Manager::load_object_file(
 		FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE
 	);
 	std::printf("%s: %s ", key.c_str(), path.generic_string().c_str());
-	auto& ref = objects[key];
 
-	auto loaded = Object_File::load_file(path);
+	auto loaded = load_mesh(path, options);
+	if (loaded) *ref = std::move(*loaded);
+	objects.end_load(id, loaded.has_value());
+	if (loaded) {
+		add_reload(path, [this, key, path, options] { reload_object_file(key, path, options); });
+	}
 	if (!loaded) {
 		stubSetConsoleTextAttribute(
 			GetStdHandle(STD_OUTPUT_HANDLE),
@@ -199,7 +644,6 @@ bool Assets_Manager::load_object_file(
 		printf("Couldn't load file /!\\\n");
 	}
 	else {
-		ref = *loaded;
 		stubSetConsoleTextAttribute(
 			GetStdHandle(STD_OUTPUT_HANDLE),
 			FOREGROUND_GREEN
@@ -213,21 +657,64 @@ bool Assets_Manager::load_object_file(
 	return loaded.has_value();
 }
 const Object_File& Assets_Manager::get_object_file(const std::string& key) noexcept {
-	auto it = objects.find(key);
-	assert(it != std::end(objects) && "Object File don't exist (wasn't loaded)");
-	return it->second;
+	auto id = objects.find(key);
+	assert(objects.is_ready(id) && "Object File don't exist (wasn't loaded)");
+	return objects.get(id);
+}
+
+bool Assets_Manager::pack_object_file(const std::string& key, Position_Format format) noexcept {
+	auto object_id = objects.find(key);
+	if (!objects.is_ready(object_id)) return false;
+	auto& object = objects.get(object_id);
+
+	auto id = packed_objects.intern(key);
+	if (packed_objects.is_ready(id) && packed_objects.get(id).format == format) return true;
+
+	auto packed = Packed_Object_File::pack(object, format);
+	auto error = packed.measure_error(object);
+	std::printf(
+		"Packed: %s: %zu -> %zu bytes per vertex, position error %f %f %f\n",
+		key.c_str(),
+		sizeof(Vector2f) + 4 * sizeof(Vector3f),
+		packed.stride,
+		error.position.x,
+		error.position.y,
+		error.position.z
+	);
+	if (!error.within_bounds(packed)) {
+		stubSetConsoleTextAttribute(
+			GetStdHandle(STD_OUTPUT_HANDLE),
+			FOREGROUND_RED
+		);
+		printf("Packing error out of bounds /!\\\n");
+		stubSetConsoleTextAttribute(
+			GetStdHandle(STD_OUTPUT_HANDLE),
+			FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE
+		);
+	}
+
+	auto ref = packed_objects.begin_load(id, true);
+	*ref = std::move(packed);
+	packed_objects.end_load(id, true);
+	return true;
+}
+const Packed_Object_File& Assets_Manager::get_packed_object_file(const std::string& key) noexcept {
+	auto id = packed_objects.find(key);
+	assert(packed_objects.is_ready(id) && "Object File wasn't packed");
+	return packed_objects.get(id);
 }
 
 bool Assets_Manager::have_shader(const std::string& key) noexcept {
-	return shaders.find(key) != std::end(shaders);
+	return shaders.is_ready(shaders.find(key));
 }
 bool Assets_Manager::load_shader(
 	const std::string& key,
 	const std::filesystem::path& vertex,
 	const std::filesystem::path& fragment
 ) noexcept {
-	if (shaders.find(key) != std::end(shaders))
-		return true;
+	auto id = shaders.intern(key);
+	auto ref = shaders.begin_load(id);
+	if (!ref) return true;
 
 	stubSetConsoleTextAttribute(
 		GetStdHandle(STD_OUTPUT_HANDLE),
@@ -244,9 +731,11 @@ bool Assets_Manager::load_shader(
 		vertex.generic_string().c_str(),
 		fragment.generic_string().c_str()
 	);
-	auto & ref = shaders[key];
 
-	auto loaded = ref.loadFromFile(vertex.generic_string(), fragment.generic_string());
+	Shader_Sources sources;
+	auto loaded = sources.read(vertex, fragment, {}) && sources.compile(*ref);
+	shaders.end_load(id, loaded);
+	if (loaded) add_shader_reload(key, vertex, fragment, {});
 	if (!loaded) {
 		stubSetConsoleTextAttribute(
 			GetStdHandle(STD_OUTPUT_HANDLE),
@@ -273,8 +762,9 @@ bool Assets_Manager::load_shader(
 	const std::filesystem::path& fragment,
 	const std::filesystem::path& geometry
 ) noexcept {
-	if (shaders.find(key) != std::end(shaders))
-		return true;
+	auto id = shaders.intern(key);
+	auto ref = shaders.begin_load(id);
+	if (!ref) return true;
 
 	stubSetConsoleTextAttribute(
 		GetStdHandle(STD_OUTPUT_HANDLE),
@@ -291,11 +781,11 @@ bool Assets_Manager::load_shader(
 		vertex.generic_string().c_str(),
 		fragment.generic_string().c_str()
 	);
-	auto & ref = shaders[key];
 
-	auto loaded = ref.loadFromFile(
-		vertex.generic_string(), geometry.generic_string(), fragment.generic_string()
-	);
+	Shader_Sources sources;
+	auto loaded = sources.read(vertex, fragment, geometry) && sources.compile(*ref);
+	shaders.end_load(id, loaded);
+	if (loaded) add_shader_reload(key, vertex, fragment, geometry);
 	if (!loaded) {
 		stubSetConsoleTextAttribute(
 			GetStdHandle(STD_OUTPUT_HANDLE),
@@ -317,8 +807,842 @@ bool Assets_Manager::load_shader(
 	return loaded;
 }
 sf::Shader& Assets_Manager::get_shader(const std::string& key) noexcept {
-	auto it = shaders.find(key);
-	assert(it != std::end(shaders) && "Object File don't exist (wasn't loaded)");
+	auto id = shaders.find(key);
+	assert(shaders.is_ready(id) && "Object File don't exist (wasn't loaded)");
+	return shaders.get(id);
+}
+Asset_Key Assets_Manager::shader_key(const std::string& key) noexcept {
+	return shaders.intern(key);
+}
+sf::Shader& Assets_Manager::get_shader(Asset_Key key) noexcept {
+	return shaders.get(key);
+}
+
+
+std::optional<Asset_Handle> Assets_Manager::find_async_load(
+	const std::string& async_key, bool loaded
+) noexcept {
+	auto it = async_keys.find(async_key);
+	// A failed load can be tried again.
+	if (it != std::end(async_keys) && jobs[it->second.id].state != Asset_State::Failed)
+		return it->second;
+	if (!loaded) return std::nullopt;
+
+	// Loaded synchronously, we make a job that is done already so it can be waited on.
+	uint32_t id = next_job_id++;
+	jobs[id].state = Asset_State::Ready;
+	async_keys[async_key] = { id };
+	return Asset_Handle{ id };
+}
+
+Asset_Handle Assets_Manager::load_texture_async(
+	const std::string& key,
+	const std::filesystem::path& path,
+	std::vector<Asset_Handle> dependencies,
+	Texture_Options options
+) noexcept {
+	auto async_key = "texture:" + key;
+	{
+		std::lock_guard guard{ jobs_mutex };
+		if (auto handle = find_async_load(async_key, have_texture(key))) return *handle;
+	}
+
+	auto job = texture_job(key, path, options);
+	job.dependencies = std::move(dependencies);
+
+	auto handle = push_job(std::move(job));
+	std::lock_guard guard{ jobs_mutex };
+	async_keys[async_key] = handle;
+	return handle;
+}
+
+Asset_Job Assets_Manager::texture_job(
+	const std::string& key, const std::filesystem::path& path, Texture_Options options
+) noexcept {
+	// The decoding and the mips are the slow part, only the upload needs the gl context.
+	auto pixels = std::make_shared<Texture_Pixels>();
+	Asset_Job job;
+	job.name = "texture " + key;
+	job.work = [pixels, path, options] {
+		return pixels->load(path, options);
+	};
+	job.finish = [this, pixels, key, path, options](bool worked) {
+		auto id = textures.intern(key);
+		auto ref = textures.begin_load(id);
+		if (!ref) return true;
+
+		ref->setSmooth(true);
+		bool loaded = worked && pixels->upload(*ref);
+		textures.end_load(id, loaded);
+		if (loaded) {
+			put_thumbnail(key, pixels->thumbnail);
+			image_cache.add(key, path);
+			auto kept = pixels->keep_pixels(image_cache, key, path);
+			if (pixels->refining()) {
+				refine_texture(key, path, std::move(kept), pixels->full_size, options);
+			}
+			auto reload = [this, key, path, options] { reload_texture(key, path, options); };
+			add_reload(path, reload);
+			// Converting it again is a change too.
+			add_reload(texture_file_path(path), reload);
+		}
+
+		print_load("Loading", key + ": " + path.generic_string(), loaded);
+		if (loaded) pixels->print_compression();
+		return loaded;
+	};
+	return job;
+}
+
+Asset_Handle Assets_Manager::load_image_async(
+	const std::string& key, const std::string& path
+) noexcept {
+	auto async_key = "image:" + key;
+	{
+		std::lock_guard guard{ jobs_mutex };
+		if (auto handle = find_async_load(async_key, have_image(key))) return *handle;
+	}
+
+	auto image = std::make_shared<sf::Image>();
+	Asset_Job job;
+	job.name = "image " + key;
+	job.work = [image, path] {
+		return load_asset(*image, path);
+	};
+	job.finish = [this, image, key, path](bool worked) {
+		auto id = images.intern(key);
+		if (auto ref = worked ? images.begin_load(id) : nullptr) {
+			*ref = std::move(*image);
+			images.end_load(id, true);
+		}
+
+		print_load("Loading", key + ": " + path, worked);
+		return worked;
+	};
+
+	auto handle = push_job(std::move(job));
+	std::lock_guard guard{ jobs_mutex };
+	async_keys[async_key] = handle;
+	return handle;
+}
+
+Asset_Handle Assets_Manager::load_icon_atlas_async(
+	const std::string& key, std::vector<Icon_File> files
+) noexcept {
+	auto async_key = "atlas:" + key;
+	{
+		std::lock_guard guard{ jobs_mutex };
+		if (auto handle = find_async_load(async_key, have_texture(key))) return *handle;
+	}
+
+	auto handle = push_job(icon_atlas_job(key, std::move(files), false));
+	std::lock_guard guard{ jobs_mutex };
+	async_keys[async_key] = handle;
+	return handle;
+}
+
+Asset_Handle Assets_Manager::load_object_file_async(
+	const std::string& key, const std::filesystem::path& path, Mesh_Pipeline_Options options
+) noexcept {
+	auto async_key = "object:" + key;
+	{
+		std::lock_guard guard{ jobs_mutex };
+		if (auto handle = find_async_load(async_key, have_object_file(key))) return *handle;
+	}
+
+	auto object = std::make_shared<std::optional<Object_File>>();
+	Asset_Job job;
+	job.name = "object " + key;
+	job.work = [object, path, options] {
+		*object = load_mesh(path, options);
+		return object->has_value();
+	};
+	job.finish = [this, object, key, path, options](bool worked) {
+		auto id = objects.intern(key);
+		if (auto ref = worked ? objects.begin_load(id) : nullptr) {
+			*ref = std::move(**object);
+			objects.end_load(id, true);
+			add_reload(path, [this, key, path, options] {
+				reload_object_file(key, path, options);
+			});
+		}
+
+		print_load("Loading", key + ": " + path.generic_string(), worked);
+		return worked;
+	};
+
+	auto handle = push_job(std::move(job));
+	std::lock_guard guard{ jobs_mutex };
+	async_keys[async_key] = handle;
+	return handle;
+}
+
+Asset_Handle Assets_Manager::load_shader_async(
+	const std::string& key,
+	const std::filesystem::path& vertex,
+	const std::filesystem::path& fragment,
+	const std::filesystem::path& geometry
+) noexcept {
+	auto async_key = "shader:" + key;
+	{
+		std::lock_guard guard{ jobs_mutex };
+		if (auto handle = find_async_load(async_key, have_shader(key))) return *handle;
+	}
+
+	auto sources = std::make_shared<Shader_Sources>();
+	Asset_Job job;
+	job.name = "shader " + key;
+	job.work = [sources, vertex, fragment, geometry] {
+		return sources->read(vertex, fragment, geometry);
+	};
+	job.finish = [this, sources, key, vertex, fragment, geometry](bool worked) {
+		auto id = shaders.intern(key);
+		auto ref = shaders.begin_load(id);
+		if (!ref) return true;
+
+		bool loaded = worked && sources->compile(*ref);
+		shaders.end_load(id, loaded);
+		if (loaded) add_shader_reload(key, vertex, fragment, geometry);
+
+		print_load(
+			"Loading", key + ": " + vertex.generic_string() + " " + fragment.generic_string(), loaded
+		);
+		return loaded;
+	};
+
+	auto handle = push_job(std::move(job));
+	std::lock_guard guard{ jobs_mutex };
+	async_keys[async_key] = handle;
+	return handle;
+}
+
+Asset_Handle Assets_Manager::when_ready(
+	std::vector<Asset_Handle> dependencies, std::function<bool()> finish
+) noexcept {
+	Asset_Job job;
+	job.dependencies = std::move(dependencies);
+	job.finish = [finish = std::move(finish)](bool) { return finish(); };
+	return push_job(std::move(job));
+}
+
+void Assets_Manager::import_textures(
+	std::vector<std::filesystem::path> paths,
+	std::function<void(const std::string& key, const std::filesystem::path& path)> on_loaded
+) noexcept {
+	auto batch = std::make_shared<Import_Batch>();
+	batch->paths = std::move(paths);
+	batch->on_loaded = std::move(on_loaded);
+	// We can be called from anywhere (the file dialog has its own thread), the batch is only
+	// ever touched in the finish steps.
+	when_ready({}, [this, batch] {
+		start_imports(batch);
+		return true;
+	});
+}
+
+void Assets_Manager::start_imports(std::shared_ptr<Import_Batch> batch) noexcept {
+	while (batch->in_flight < Max_Imports_In_Flight && batch->next < batch->paths.size()) {
+		auto path = batch->paths[batch->next++];
+		// The path is the key, importing the same file twice gives the same texture.
+		auto key = path.generic_string();
+		auto async_key = "texture:" + key;
+		std::optional<Asset_Handle> known;
+		{
+			std::lock_guard guard{ jobs_mutex };
+			known = find_async_load(async_key, have_texture(key));
+		}
+		if (known) {
+			// Already there or on its way, it doesn't count in the ones we decode.
+			when_ready({ *known }, [batch, key, path] {
+				batch->on_loaded(key, path);
+				return true;
+			});
+			continue;
+		}
+
+		Texture_Options options;
+		options.thumbnail_size = Import_Thumbnail_Size;
+		options.preview_size = Import_Preview_Size;
+		auto job = texture_job(key, path, options);
+		job.finish = [this, batch, key, path, finish = std::move(job.finish)](bool worked) {
+			bool loaded = finish(worked);
+			batch->in_flight--;
+			if (loaded) batch->on_loaded(key, path);
+			start_imports(batch);
+			return loaded;
+		};
+
+		batch->in_flight++;
+		auto handle = push_job(std::move(job));
+		std::lock_guard guard{ jobs_mutex };
+		async_keys[async_key] = handle;
+	}
+}
+
+Asset_Handle Assets_Manager::push_job(Asset_Job job) noexcept {
+	std::lock_guard guard{ jobs_mutex };
+	uint32_t id = next_job_id++;
+	pending_jobs++;
+
+	auto& entry = jobs[id];
+	entry.job = std::move(job);
+
+	bool failed = false;
+	for (auto dependency : entry.job.dependencies) {
+		auto it = jobs.find(dependency.id);
+		if (it == std::end(jobs) || it->second.state == Asset_State::Failed) {
+			failed = true;
+			break;
+		}
+		if (it->second.state == Asset_State::Ready) continue;
+
+		it->second.dependents.push_back(id);
+		entry.waiting_on++;
+	}
+
+	// The dependencies we already registered with will see that we are not Pending anymore.
+	if (failed) complete(id, false);
+	else if (entry.waiting_on == 0) submit(id);
+	return { id };
+}
+
+void Assets_Manager::submit(uint32_t id) noexcept {
+	auto& entry = jobs[id];
+
+	if (!entry.job.work) {
+		entry.worked = true;
+		worked_jobs.push_back(id);
+		job_worked.notify_all();
+		return;
+	}
+
+	// The dependencies are all finished, that's what the work waited for.
+	std::vector<size_t> after;
+	if (timeline) {
+		for (auto dependency : entry.job.dependencies) {
+			auto span = jobs[dependency.id].finish_span;
+			if (span != Timeline::None) after.push_back(span);
+		}
+	}
+
+	if (!pool) pool = std::make_unique<Thread_Pool>();
+	pool->push([
+		this,
+		id,
+		work = std::move(entry.job.work),
+		recording = timeline,
+		name = job_name(entry.job, id),
+		after = std::move(after)
+	]() mutable {
+		auto span = Timeline::None;
+		if (recording) span = recording->begin(std::move(name), std::move(after));
+		bool worked = work();
+		if (recording) recording->end(span);
+		{
+			std::lock_guard guard{ jobs_mutex };
+			jobs[id].worked = worked;
+			jobs[id].work_span = span;
+			worked_jobs.push_back(id);
+		}
+		job_worked.notify_all();
+	});
+}
+
+void Assets_Manager::complete(uint32_t id, bool ok) noexcept {
+	auto& entry = jobs[id];
+	entry.state = ok ? Asset_State::Ready : Asset_State::Failed;
+	entry.job = {};
+	pending_jobs--;
+
+	auto dependents = std::move(entry.dependents);
+	for (auto d : dependents) {
+		auto& dependent = jobs[d];
+		if (dependent.state != Asset_State::Pending) continue;
+
+		if (!ok) complete(d, false);
+		else if (--dependent.waiting_on == 0) submit(d);
+	}
+}
+
+std::optional<Icon> Assets_Manager::get_icon(const std::string& key) noexcept {
+	auto it = icons.find(key);
+	if (it == std::end(icons)) return std::nullopt;
 	return it->second;
 }
 
+Asset_State Assets_Manager::get_state(Asset_Handle handle) noexcept {
+	std::lock_guard guard{ jobs_mutex };
+	auto it = jobs.find(handle.id);
+	return it == std::end(jobs) ? Asset_State::Failed : it->second.state;
+}
+
+size_t Assets_Manager::finish_async_loads(double budget_ms) noexcept {
+	std::vector<uint32_t> ready;
+	{
+		std::lock_guard guard{ jobs_mutex };
+		ready.swap(worked_jobs);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	size_t finished = 0;
+	for (auto id : ready) {
+		if (budget_ms > 0 && finished > 0) {
+			auto spent = std::chrono::steady_clock::now() - start;
+			if (std::chrono::duration<double, std::milli>(spent).count() > budget_ms) break;
+		}
+		finished++;
+
+		std::function<bool(bool)> finish;
+		bool worked;
+		Timeline* recording;
+		std::string name;
+		std::vector<size_t> after;
+		{
+			std::lock_guard guard{ jobs_mutex };
+			auto& entry = jobs[id];
+			finish = std::move(entry.job.finish);
+			worked = entry.worked;
+			entry.finish_span = entry.work_span;
+
+			recording = finish ? timeline : nullptr;
+			if (recording) {
+				name = job_name(entry.job, id) + " (gl)";
+				after.push_back(timeline_context);
+				after.push_back(entry.work_span);
+				for (auto dependency : entry.job.dependencies) {
+					after.push_back(jobs[dependency.id].finish_span);
+				}
+				std::erase(after, Timeline::None);
+			}
+		}
+
+		// Without the lock, finish is free to start other loads.
+		auto span = Timeline::None;
+		if (recording) span = recording->begin(std::move(name), std::move(after));
+		bool ok = finish ? finish(worked) : worked;
+		if (recording) recording->end(span);
+
+		std::lock_guard guard{ jobs_mutex };
+		if (recording) jobs[id].finish_span = span;
+		complete(id, ok);
+	}
+
+	if (finished < ready.size()) {
+		// Ahead of whatever came in since, they were ready before.
+		std::lock_guard guard{ jobs_mutex };
+		worked_jobs.insert(
+			std::begin(worked_jobs), std::begin(ready) + finished, std::end(ready)
+		);
+	}
+	return finished;
+}
+
+Asset_State Assets_Manager::wait(Asset_Handle handle) noexcept {
+	while (true) {
+		finish_async_loads();
+
+		std::unique_lock lock{ jobs_mutex };
+		auto it = jobs.find(handle.id);
+		if (it == std::end(jobs)) return Asset_State::Failed;
+		if (it->second.state != Asset_State::Pending) return it->second.state;
+
+		job_worked.wait(lock, [&] { return !worked_jobs.empty(); });
+	}
+}
+
+void Assets_Manager::wait_all() noexcept {
+	while (true) {
+		finish_async_loads();
+
+		std::unique_lock lock{ jobs_mutex };
+		if (pending_jobs == 0) return;
+
+		job_worked.wait(lock, [&] { return !worked_jobs.empty(); });
+	}
+}
+
+void Assets_Manager::set_timeline(Timeline* timeline, size_t context_span) noexcept {
+	std::lock_guard guard{ jobs_mutex };
+	this->timeline = timeline;
+	timeline_context = context_span;
+}
+
+bool Assets_Manager::mount_pack(const std::filesystem::path& path) noexcept {
+	return mount_asset_pack(path);
+}
+
+void Assets_Manager::set_hot_reload(bool enable) noexcept {
+	std::lock_guard guard{ reload_mutex };
+	set_loose_assets_first(enable);
+	if (!enable) {
+		watcher.reset();
+		pending_reloads.clear();
+		return;
+	}
+	if (watcher) return;
+
+	watcher = std::make_unique<File_Watcher>();
+	for (auto& [file, _] : reloads) watcher->watch(std::filesystem::path(file).parent_path());
+}
+bool Assets_Manager::is_hot_reload() noexcept {
+	std::lock_guard guard{ reload_mutex };
+	return watcher != nullptr;
+}
+
+void Assets_Manager::watch_file(
+	const std::filesystem::path& path, std::function<void()> on_change
+) noexcept {
+	add_reload(path, std::move(on_change));
+}
+
+void Assets_Manager::update_hot_reload() noexcept {
+	std::vector<std::function<void()>> to_run;
+	{
+		std::lock_guard guard{ reload_mutex };
+		if (!watcher) return;
+
+		auto now = get_milliseconds_epoch();
+		for (auto& path : watcher->read_changes()) {
+			auto file = path.lexically_normal().generic_string();
+			if (reloads.find(file) != std::end(reloads)) pending_reloads[file] = now;
+		}
+
+		// We wait for the file to be left alone for a bit, an editor can write it several times
+		// for one save and we don't want to read it half written.
+		for (auto it = std::begin(pending_reloads); it != std::end(pending_reloads);) {
+			if (now - it->second < Hot_Reload_Debounce_Ms) {
+				++it;
+				continue;
+			}
+
+			auto& file_reloads = reloads[it->first];
+			to_run.insert(std::end(to_run), BEG_END(file_reloads));
+			it = pending_reloads.erase(it);
+		}
+	}
+
+	for (auto& f : to_run) f();
+}
+
+void Assets_Manager::add_reload(
+	const std::filesystem::path& path, std::function<void()> reload
+) noexcept {
+	auto file = watch_key(path);
+
+	std::lock_guard guard{ reload_mutex };
+	reloads[file].push_back(std::move(reload));
+	if (watcher) watcher->watch(std::filesystem::path(file).parent_path());
+}
+
+void Assets_Manager::add_shader_reload(
+	const std::string& key,
+	const std::filesystem::path& vertex,
+	const std::filesystem::path& fragment,
+	const std::filesystem::path& geometry
+) noexcept {
+	auto reload = [this, key, vertex, fragment, geometry] {
+		reload_shader(key, vertex, fragment, geometry);
+	};
+	add_reload(vertex, reload);
+	add_reload(fragment, reload);
+	if (!geometry.empty()) add_reload(geometry, reload);
+}
+
+void Assets_Manager::reload_texture(
+	const std::string& key, const std::filesystem::path& path, Texture_Options options
+) noexcept {
+	auto pixels = std::make_shared<Texture_Pixels>();
+	Asset_Job job;
+	job.name = "texture " + key;
+	job.work = [pixels, path, options] {
+		return pixels->load(path, options);
+	};
+	job.finish = [this, pixels, key, path, options](bool worked) {
+		// Same sf::Texture, everyone pointing to it gets the new one.
+		if (worked) {
+			auto id = textures.intern(key);
+			auto ref = textures.begin_load(id, true);
+			worked = pixels->upload(*ref);
+			textures.end_load(id, true);
+		}
+		if (worked) {
+			put_thumbnail(key, pixels->thumbnail);
+			auto kept = pixels->keep_pixels(image_cache, key, path);
+			// The one we might be refining is from the old file.
+			if (pixels->refining()) {
+				refine_texture(key, path, std::move(kept), pixels->full_size, options);
+			}
+			else refinements.erase(key);
+		}
+
+		print_load("Reloading", key + ": " + path.generic_string(), worked);
+		if (worked) pixels->print_compression();
+		return worked;
+	};
+	push_job(std::move(job));
+}
+
+struct Assets_Manager::Texture_Refinement {
+	std::string key;
+	std::filesystem::path path;
+	// Null until the first step decodes the file when the preview was streamed out of it.
+	std::shared_ptr<const sf::Image> pixels;
+	// The first step just did, the cache gets it.
+	bool decoded{ false };
+	// Longest side of each step, the last one is the full size (or the biggest the gpu takes).
+	std::vector<uint32_t> stages;
+	size_t stage{ 0 };
+	// Made on a worker for the current step, empty when it's the image itself.
+	Mip_Level<uint8_t> level;
+	// Filled a band at a time, then swapped with the one everyone uses.
+	sf::Texture texture;
+	uint32_t next_row{ 0 };
+};
+
+void Assets_Manager::refine_texture(
+	const std::string& key,
+	const std::filesystem::path& path,
+	std::shared_ptr<const sf::Image> pixels,
+	sf::Vector2u size,
+	const Texture_Options& options
+) noexcept {
+	auto refinement = std::make_shared<Texture_Refinement>();
+	refinement->key = key;
+	refinement->path = path;
+	refinement->pixels = std::move(pixels);
+
+	uint32_t longest = std::min(std::max(size.x, size.y), sf::Texture::getMaximumSize());
+	for (uint32_t stage = options.preview_size * 4; stage < longest; stage *= 4) {
+		refinement->stages.push_back(stage);
+	}
+	refinement->stages.push_back(longest);
+
+	refinements[key] = refinement;
+	refine_stage(std::move(refinement));
+}
+
+void Assets_Manager::refine_stage(std::shared_ptr<Texture_Refinement> refinement) noexcept {
+	Asset_Job job;
+	job.name = "refine " + refinement->key;
+	job.work = [refinement] {
+		if (!refinement->pixels) {
+			auto image = std::make_shared<sf::Image>();
+			if (!load_asset(*image, refinement->path)) return false;
+			refinement->pixels = std::move(image);
+			refinement->decoded = true;
+		}
+
+		auto& pixels = *refinement->pixels;
+		auto size = pixels.getSize();
+		auto stage = refinement->stages[refinement->stage];
+		if (std::max(size.x, size.y) <= stage) return true;
+
+		refinement->level = box_downscale_to_fit(pixels.getPixelsPtr(), size.x, size.y, stage);
+		return true;
+	};
+	job.finish = [this, refinement](bool worked) {
+		auto it = refinements.find(refinement->key);
+		if (it == std::end(refinements) || it->second != refinement) return true;
+		if (!worked) {
+			// We keep the preview.
+			refinements.erase(it);
+			return false;
+		}
+		if (refinement->decoded) {
+			image_cache.put(refinement->key, refinement->pixels);
+			refinement->decoded = false;
+		}
+
+		auto& level = refinement->level;
+		auto size = level.pixels.empty()
+			? refinement->pixels->getSize()
+			: sf::Vector2u{ level.width, level.height };
+		if (!refinement->texture.create(size.x, size.y)) {
+			// We keep what we have.
+			refinements.erase(it);
+			return false;
+		}
+		refinement->next_row = 0;
+		upload_band(refinement);
+		return true;
+	};
+	push_job(std::move(job));
+}
+
+void Assets_Manager::upload_band(std::shared_ptr<Texture_Refinement> refinement) noexcept {
+	auto it = refinements.find(refinement->key);
+	if (it == std::end(refinements) || it->second != refinement) return;
+
+	auto& level = refinement->level;
+	auto rgba = level.pixels.empty() ? refinement->pixels->getPixelsPtr() : level.pixels.data();
+	auto& texture = refinement->texture;
+	auto size = texture.getSize();
+	auto row = refinement->next_row;
+
+	auto rows = (uint32_t)std::max(Refine_Band_Bytes / ((size_t)size.x * 4), (size_t)1);
+	rows = std::min(rows, size.y - row);
+	texture.update(rgba + (size_t)row * size.x * 4, size.x, rows, 0, row);
+	refinement->next_row += rows;
+
+	if (refinement->next_row < size.y) {
+		// A job of its own so it waits for the next finish_async_loads, that's what spreads the
+		// upload over the frames.
+		Asset_Job job;
+		job.name = "upload " + refinement->key;
+		job.finish = [this, refinement](bool) {
+			upload_band(refinement);
+			return true;
+		};
+		push_job(std::move(job));
+		return;
+	}
+
+	// A chain of our own is what we are avoiding at that size, the gpu makes it.
+	texture.setSmooth(true);
+	texture.generateMipmap();
+	// Same sf::Texture, everyone pointing to it gets the new one.
+	auto id = textures.intern(refinement->key);
+	auto ref = textures.begin_load(id, true);
+	ref->swap(texture);
+	textures.end_load(id, true);
+	level = {};
+
+	auto what = std::to_string(size.x) + "x" + std::to_string(size.y);
+	print_load("Refined", refinement->key + ": " + what, true);
+	if (++refinement->stage < refinement->stages.size()) refine_stage(std::move(refinement));
+	else refinements.erase(it);
+}
+
+Asset_Job Assets_Manager::icon_atlas_job(
+	const std::string& key, std::vector<Icon_File> files, bool reload
+) noexcept {
+	// Decoded, packed and the mips made on a worker, after that it's a texture like the others.
+	auto pixels = std::make_shared<Texture_Pixels>();
+	auto rects = std::make_shared<std::vector<std::pair<std::string, Atlas_Rect>>>();
+	Asset_Job job;
+	job.name = "atlas " + key;
+	job.work = [pixels, rects, files] {
+		std::vector<sf::Image> images(files.size());
+		std::vector<Atlas_Icon> icons;
+		for (size_t i = 0; i < files.size(); ++i) {
+			if (!load_asset(images[i], files[i].path)) return false;
+			auto size = images[i].getSize();
+			icons.push_back({ files[i].key, size.x, size.y, images[i].getPixelsPtr() });
+		}
+
+		auto atlas = pack_icon_atlas(icons);
+		if (!atlas) return false;
+		pixels->image.create(atlas->width, atlas->height, atlas->rgba.data());
+
+		// Box, it's the one that stays in its 2x2 texels, and only as far as the cells are apart.
+		Mip_Options mips;
+		mips.filter = Mip_Filter::Box;
+		pixels->mips = generate_mips(atlas->rgba.data(), atlas->width, atlas->height, mips);
+		pixels->mips.resize(std::min(pixels->mips.size(), (size_t)atlas->safe_levels));
+
+		*rects = std::move(atlas->rects);
+		return true;
+	};
+	job.finish = [this, pixels, rects, key, files, reload](bool worked) {
+		auto id = textures.intern(key);
+		auto ref = textures.begin_load(id, reload);
+		if (!ref) return true;
+
+		ref->setSmooth(true);
+		bool loaded = worked && pixels->upload(*ref);
+		// A reload that failed leaves the previous atlas as it was.
+		textures.end_load(id, loaded || reload);
+		if (loaded) {
+			for (auto& [icon, rect] : *rects) {
+				icons[icon] = {
+					ref, { (int)rect.x, (int)rect.y, (int)rect.width, (int)rect.height }
+				};
+			}
+		}
+		if (loaded && !reload) {
+			for (auto& file : files) {
+				add_reload(file.path, [this, key, files] {
+					push_job(icon_atlas_job(key, files, true));
+				});
+			}
+		}
+
+		auto size = pixels->image.getSize();
+		print_load(
+			reload ? "Reloading" : "Loading",
+			key + ": " + std::to_string(files.size()) + " icons in " +
+				std::to_string(size.x) + "x" + std::to_string(size.y),
+			loaded
+		);
+		return loaded;
+	};
+	return job;
+}
+
+void Assets_Manager::reload_shader(
+	const std::string& key,
+	const std::filesystem::path& vertex,
+	const std::filesystem::path& fragment,
+	const std::filesystem::path& geometry
+) noexcept {
+	auto sources = std::make_shared<Shader_Sources>();
+	Asset_Job job;
+	job.name = "shader " + key;
+	job.work = [sources, vertex, fragment, geometry] {
+		return sources->read(vertex, fragment, geometry);
+	};
+	job.finish = [this, sources, key, vertex, fragment](bool worked) {
+		// A typo in the shader shouldn't leave us without one, and an sf::Shader can't be moved,
+		// so we compile it once on the side to check it.
+		sf::Shader check;
+		worked = worked && sources->compile(check);
+		if (worked) {
+			auto id = shaders.intern(key);
+			auto ref = shaders.begin_load(id, true);
+			worked = sources->compile(*ref);
+			shaders.end_load(id, true);
+		}
+
+		print_load(
+			"Reloading",
+			key + ": " + vertex.generic_string() + " " + fragment.generic_string(),
+			worked
+		);
+		return worked;
+	};
+	push_job(std::move(job));
+}
+
+void Assets_Manager::reload_object_file(
+	const std::string& key, const std::filesystem::path& path, Mesh_Pipeline_Options options
+) noexcept {
+	auto object = std::make_shared<std::optional<Object_File>>();
+	Asset_Job job;
+	job.name = "object " + key;
+	job.work = [object, path, options] {
+		*object = load_mesh(path, options);
+		return object->has_value();
+	};
+	job.finish = [this, object, key, path](bool worked) {
+		print_load("Reloading", key + ": " + path.generic_string(), worked);
+		if (!worked) return false;
+
+		auto id = objects.intern(key);
+		auto ref = objects.begin_load(id, true);
+		*ref = std::move(**object);
+		objects.end_load(id, true);
+
+		auto packed_id = packed_objects.find(key);
+		if (packed_objects.is_ready(packed_id)) {
+			auto packed = packed_objects.begin_load(packed_id, true);
+			auto format = packed->format;
+			*packed = Packed_Object_File::pack(*ref, format);
+			packed_objects.end_load(packed_id, true);
+		}
+
+		// The models have their own copy on the gpu.
+		for (auto& f : object_file_reloaded) f(key);
+		return true;
+	};
+	push_job(std::move(job));
+}
@@ -2,22 +2,114 @@
 #include <unordered_map>
 #include <memory>
 #include <filesystem>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <optional>
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
 
 #include "Files/FileFormat.hpp"
+#include "Files/PackedVertex.hpp"
+#include "Files/MeshPipeline.hpp"
+#include "Files/AssetPack.hpp"
+#include "Files/BlockCompress.hpp"
+#include "Files/IconAtlas.hpp"
+#include "Files/Mipmap.hpp"
+#include "Files/TextureFile.hpp"
+#include "Utils/ThreadPool.hpp"
+#include "Utils/Timeline.hpp"
+#include "Managers/AssetRegistry.hpp"
+#include "Managers/ImageCache.hpp"
+#include "OS/FileWatcher.hpp"
+
+// Handle on an asynchronous load, 0 is never a valid job.
+struct Asset_Handle {
+	uint32_t id{ 0 };
+};
+
+enum class Asset_State {
+	Pending = 0,
+	Ready,
+	Failed,
+	Count
+};
+
+struct Asset_Job {
+	// Runs on a worker thread, this is where the slow part goes (decoding, parsing, the mesh
+	// pipeline...). It must not touch the gl.
+	std::function<bool()> work;
+	// Runs on the main thread in finish_async_loads with what work returned, this is where we
+	// upload to the gpu and put the result in the manager. Returns whether the asset is usable.
+	std::function<bool(bool worked)> finish;
+	// work won't start before all of them are Ready, if one of them fails so does this job
+	// (and neither work nor finish are called).
+	std::vector<Asset_Handle> dependencies;
+	// What the timeline calls it, if one is set.
+	std::string name;
+};
+
+// How a texture file becomes a gl texture. Both are built on the cpu and cached on disk, or
+// converted ahead of time to an .igtex next to the file, which we then load instead.
+struct Texture_Options {
+	Mip_Options mips;
+	Block_Options compression;
+	// Above 0 we also make a copy at most that big on its longest side, for the lists. It's a
+	// texture of its own under key + Thumbnail_Suffix, see get_thumbnail.
+	uint32_t thumbnail_size{ 0 };
+	// Above 0, an image bigger than that on its longest side is first uploaded at most that big,
+	// the texture is Ready with it. We then refine it in the background, each step 4 times
+	// bigger, up to the full size (or what the gpu can take). The texture is replaced in place
+	// each time, there are no mips nor compression on those. A png is only decoded whole by the
+	// first step, the preview is streamed out of it (see stream_png_preview).
+	uint32_t preview_size{ 0 };
+};
+
+constexpr char Thumbnail_Suffix[] = "#thumbnail";
+
+// A file to put in an icon atlas, and the key to ask it back with.
+struct Icon_File {
+	std::string key;
+	std::filesystem::path path;
+};
+
+// Where an icon is in its atlas, rect is in the pixels of texture (like a sprite's).
+struct Icon {
+	const sf::Texture* texture{ nullptr };
+	sf::IntRect rect;
+
+	// The same in [0, 1], for whoever draws it with their own uvs.
+	sf::FloatRect uv() const noexcept {
+		auto w = (float)texture->getSize().x;
+		auto h = (float)texture->getSize().y;
+		return { rect.left / w, rect.top / h, rect.width / w, rect.height / h };
+	}
+};
 
 class Assets_Manager {
 public:
 	bool have_texture(const std::string& key) noexcept;
-	bool load_texture(const std::string& key, const std::filesystem::path& path) noexcept;
+	bool load_texture(
+		const std::string& key, const std::filesystem::path& path, Texture_Options options = {}
+	) noexcept;
 	// TODO<
 	// is const really nedded here ?
 	// i don't want somebody to change a texture for everyone else
 	// but then i can't set the smoothness of a texture for instance
 	/*const*/ sf::Texture& get_texture(const std::string& key) noexcept; 
+	// Resolve the string once and keep the key for the lookups every frame.
+	Asset_Key texture_key(const std::string& key) noexcept;
+	/*const*/ sf::Texture& get_texture(Asset_Key key) noexcept;
+	// Cpu copy of the texture pixels, it goes through the image cache so it can be evicted when
+	// nobody holds it, and comes back from the file (or from the gpu for created textures).
+	std::shared_ptr<const sf::Image> get_texture_pixels(const std::string& key) noexcept;
+	Image_Cache& get_image_cache() noexcept;
 	sf::Texture& create_texture(const std::string& key) noexcept;
+	// The thumbnail of the texture if it was loaded with one, the texture itself otherwise,
+	// nullptr if there is neither.
+	const sf::Texture* get_thumbnail(const std::string& key) noexcept;
 	bool have_image(const std::string& key) noexcept;
 	bool load_image(const std::string& key, const std::string& path) noexcept;
 	const sf::Image& get_image(const std::string& key) noexcept;
@@ -27,9 +119,17 @@ public:
 	const sf::Font& get_font(const std::string& key) noexcept;
 
 	bool have_object_file(const std::string& key) noexcept;
-	bool load_object_file(const std::string& key, const std::filesystem::path& path) noexcept;
+	bool load_object_file(
+		const std::string& key,
+		const std::filesystem::path& path,
+		Mesh_Pipeline_Options options = {}
+	) noexcept;
 	const Object_File& get_object_file(const std::string& key) noexcept;
 
+	// Pack an already loaded object file, the result is kept under the same key.
+	bool pack_object_file(const std::string& key, Position_Format format) noexcept;
+	const Packed_Object_File& get_packed_object_file(const std::string& key) noexcept;
+
 	bool have_shader(const std::string& key) noexcept;
 	bool load_shader(
 		const std::string& key,
@@ -43,11 +143,202 @@ public:
 		const std::filesystem::path& geometry
 	) noexcept;
 	sf::Shader& get_shader(const std::string& key) noexcept;
+	Asset_Key shader_key(const std::string& key) noexcept;
+	sf::Shader& get_shader(Asset_Key key) noexcept;
+
+	// Asynchronous versions of the above. The asset is in the manager once the handle is Ready, the
+	// gl side of it is done on the main thread by finish_async_loads.
+	// Loading a key that is already there (or on its way) gives back a handle on it.
+	Asset_Handle load_texture_async(
+		const std::string& key,
+		const std::filesystem::path& path,
+		std::vector<Asset_Handle> dependencies = {},
+		Texture_Options options = {}
+	) noexcept;
+	Asset_Handle load_image_async(const std::string& key, const std::string& path) noexcept;
+	// Every file packed in a single texture under key (see pack_icon_atlas), so the ui can draw
+	// all of them without changing texture. Each icon is then asked for by its own key.
+	Asset_Handle load_icon_atlas_async(
+		const std::string& key, std::vector<Icon_File> files
+	) noexcept;
+	Asset_Handle load_object_file_async(
+		const std::string& key,
+		const std::filesystem::path& path,
+		Mesh_Pipeline_Options options = {}
+	) noexcept;
+	// geometry is optional.
+	Asset_Handle load_shader_async(
+		const std::string& key,
+		const std::filesystem::path& vertex,
+		const std::filesystem::path& fragment,
+		const std::filesystem::path& geometry = {}
+	) noexcept;
+
+	// Loads a batch of image files as textures, keyed by their path, with their thumbnails. They
+	// are decoded on the workers but only Max_Imports_In_Flight at a time, so a folder of photos
+	// isn't entirely in memory waiting for its upload. on_loaded is called on the main thread
+	// for each one that loaded, in no particular order.
+	void import_textures(
+		std::vector<std::filesystem::path> paths,
+		std::function<void(const std::string& key, const std::filesystem::path& path)> on_loaded
+	) noexcept;
+
+	// For whatever is built on top of other assets, say a material that needs its textures:
+	// finish is called on the main thread once every dependency is Ready.
+	Asset_Handle when_ready(
+		std::vector<Asset_Handle> dependencies, std::function<bool()> finish
+	) noexcept;
+	Asset_Handle push_job(Asset_Job job) noexcept;
+
+	// Main thread, nullopt until its atlas is loaded.
+	std::optional<Icon> get_icon(const std::string& key) noexcept;
+
+	Asset_State get_state(Asset_Handle handle) noexcept;
+	// Main thread, once per frame. Run the finish step of the jobs whose work is done and start
+	// the ones that were waiting on them. Returns how many jobs were finished.
+	// With a budget we stop once it's spent (after at least one) and leave the rest for the
+	// next call, so a pile of uploads doesn't make a frame last forever. 0 is no budget.
+	size_t finish_async_loads(double budget_ms = 0) noexcept;
+	// Main thread, blocks until the job is done (and finishes everything else in the meantime).
+	Asset_State wait(Asset_Handle handle) noexcept;
+	void wait_all() noexcept;
+
+	// While it's set, every job records its work and its finish step in timeline, with what
+	// they waited for. The finish steps also wait for context_span, the one making the gl
+	// context. Main thread, the timeline must outlive the jobs started while it's set.
+	void set_timeline(Timeline* timeline, size_t context_span = Timeline::None) noexcept;
+
+	// Every load looks in the pack first, then on the disk (see read_asset). Main thread, before
+	// loading anything. False if there is no pack there, or it's not one of ours.
+	bool mount_pack(const std::filesystem::path& path) noexcept;
+
+	// Hot reload. We remember the files of every asset loaded from disk, once it's enabled they
+	// are watched and when one is written to, the asset is reloaded in place (same object, so
+	// every reference on it stays valid). The reload itself goes through the async jobs.
+	// While it's on, the loose files come before the pack, they are what is being edited.
+	void set_hot_reload(bool enable) noexcept;
+	bool is_hot_reload() noexcept;
+	// Main thread, once per frame.
+	void update_hot_reload() noexcept;
+	// For what is made from a file but isn't an asset here (a cube map...). on_change is called
+	// from update_hot_reload.
+	void watch_file(const std::filesystem::path& path, std::function<void()> on_change) noexcept;
+	// Called with the key of every object file reloaded (main thread), the models using it need
+	// to upload it again. If it was packed, the packed one is up to date too.
+	std::vector<std::function<void(const std::string& key)>> object_file_reloaded;
 
 private:
-	std::unordered_map<std::string, sf::Texture> textures;
-	std::unordered_map<std::string, Object_File> objects;
-	std::unordered_map<std::string, sf::Shader> shaders;
-	std::unordered_map<std::string, sf::Image> images;
-	std::unordered_map<std::string, sf::Font> fonts;
+	// The time a file must stay untouched before we reload it.
+	static constexpr uint64_t Hot_Reload_Debounce_Ms = 200;
+	static constexpr size_t Max_Imports_In_Flight = 8;
+	static constexpr uint32_t Import_Thumbnail_Size = 96;
+	static constexpr uint32_t Import_Preview_Size = 1024;
+	// While a texture is refined, about that much of it is uploaded per finish step.
+	static constexpr size_t Refine_Band_Bytes = 8 * 1024 * 1024;
+
+	// Main thread only, it's touched by the finish steps.
+	struct Import_Batch {
+		std::vector<std::filesystem::path> paths;
+		size_t next{ 0 };
+		size_t in_flight{ 0 };
+		std::function<void(const std::string& key, const std::filesystem::path& path)> on_loaded;
+	};
+	void start_imports(std::shared_ptr<Import_Batch> batch) noexcept;
+	Asset_Job texture_job(
+		const std::string& key, const std::filesystem::path& path, Texture_Options options
+	) noexcept;
+	// Made or replaced in place, like the texture.
+	void put_thumbnail(const std::string& key, const Mip_Level<uint8_t>& thumbnail) noexcept;
+
+	// See Texture_Options::preview_size.
+	struct Texture_Refinement;
+	// pixels can be null, the first step decodes path then. size is the one of the whole image.
+	void refine_texture(
+		const std::string& key,
+		const std::filesystem::path& path,
+		std::shared_ptr<const sf::Image> pixels,
+		sf::Vector2u size,
+		const Texture_Options& options
+	) noexcept;
+	void refine_stage(std::shared_ptr<Texture_Refinement> refinement) noexcept;
+	void upload_band(std::shared_ptr<Texture_Refinement> refinement) noexcept;
+
+	void add_reload(const std::filesystem::path& path, std::function<void()> reload) noexcept;
+	void add_shader_reload(
+		const std::string& key,
+		const std::filesystem::path& vertex,
+		const std::filesystem::path& fragment,
+		const std::filesystem::path& geometry
+	) noexcept;
+	void reload_texture(
+		const std::string& key, const std::filesystem::path& path, Texture_Options options
+	) noexcept;
+	void reload_shader(
+		const std::string& key,
+		const std::filesystem::path& vertex,
+		const std::filesystem::path& fragment,
+		const std::filesystem::path& geometry
+	) noexcept;
+	void reload_object_file(
+		const std::string& key, const std::filesystem::path& path, Mesh_Pipeline_Options options
+	) noexcept;
+	// The atlas is made again as a whole when any of its files changes.
+	Asset_Job icon_atlas_job(
+		const std::string& key, std::vector<Icon_File> files, bool reload
+	) noexcept;
+
+	std::mutex reload_mutex;
+	std::unique_ptr<File_Watcher> watcher;
+	// Normalized path of a file -> what to do when it changes.
+	std::unordered_map<std::string, std::vector<std::function<void()>>> reloads;
+	// Normalized path -> time in ms of the last write we saw.
+	std::unordered_map<std::string, uint64_t> pending_reloads;
+
+	struct Job_Entry {
+		Asset_Job job;
+		Asset_State state{ Asset_State::Pending };
+		bool worked{ false };
+		size_t waiting_on{ 0 };
+		std::vector<uint32_t> dependents;
+		// In the timeline, the finish one is the work one for the jobs without a finish step.
+		size_t work_span{ Timeline::None };
+		size_t finish_span{ Timeline::None };
+	};
+
+	// All of those need the jobs_mutex to be held.
+	// The handle to give back if async_key is loaded (or being loaded) already.
+	std::optional<Asset_Handle> find_async_load(const std::string& async_key, bool loaded) noexcept;
+	void submit(uint32_t id) noexcept;
+	void complete(uint32_t id, bool ok) noexcept;
+
+	std::mutex jobs_mutex;
+	std::condition_variable job_worked;
+	std::unordered_map<uint32_t, Job_Entry> jobs;
+	// Done on a worker, waiting for their finish step.
+	std::vector<uint32_t> worked_jobs;
+	// Handle of the last async load of every key, prefixed by the kind of asset.
+	std::unordered_map<std::string, Asset_Handle> async_keys;
+	uint32_t next_job_id{ 1 };
+	size_t pending_jobs{ 0 };
+	Timeline* timeline{ nullptr };
+	size_t timeline_context{ Timeline::None };
+
+	// Those can be read from any thread, and loaded from any thread too.
+	Asset_Registry<sf::Texture> textures;
+	Asset_Registry<Object_File> objects;
+	Asset_Registry<Packed_Object_File> packed_objects;
+	Asset_Registry<sf::Shader> shaders;
+	Asset_Registry<sf::Image> images;
+	Asset_Registry<sf::Font> fonts;
+
+	Image_Cache image_cache;
+
+	// Main thread only, filled by the finish step of the atlases.
+	std::unordered_map<std::string, Icon> icons;
+	// Main thread only, the textures still being refined. A reload replaces the one of its key,
+	// the old one sees it's not in there anymore and stops.
+	std::unordered_map<std::string, std::shared_ptr<Texture_Refinement>> refinements;
+
+	// Last so it's destroyed first, the workers still reference everything above.
+	std::unique_ptr<Thread_Pool> pool;
 };
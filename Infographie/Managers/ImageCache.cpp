@@ -0,0 +1,136 @@
+#include "ImageCache.hpp"
+
+#include "Files/AssetPack.hpp"
+
+namespace {
+	size_t image_bytes(const sf::Image& image) noexcept {
+		return (size_t)image.getSize().x * image.getSize().y * 4;
+	}
+};
+
+Image_Cache::Image_Cache(size_t budget_bytes) noexcept {
+	stats.budget_bytes = budget_bytes;
+}
+
+void Image_Cache::add(const std::string& key, Loader loader) noexcept {
+	std::lock_guard guard{ mutex };
+	auto& entry = entries[key];
+	entry.loader = std::move(loader);
+}
+
+void Image_Cache::add(const std::string& key, const std::filesystem::path& path) noexcept {
+	add(key, [path](sf::Image& image) {
+		auto asset = read_asset(path);
+		return asset && image.loadFromMemory(asset->data(), asset->size());
+	});
+}
+
+void Image_Cache::put(const std::string& key, sf::Image image) noexcept {
+	put(key, std::make_shared<const sf::Image>(std::move(image)));
+}
+
+void Image_Cache::put(const std::string& key, std::shared_ptr<const sf::Image> image) noexcept {
+	std::lock_guard guard{ mutex };
+	auto it = entries.find(key);
+	if (it == std::end(entries)) return;
+
+	make_resident(it->second, key, std::move(image));
+	evict_to_budget();
+}
+
+void Image_Cache::remove(const std::string& key) noexcept {
+	std::lock_guard guard{ mutex };
+	auto it = entries.find(key);
+	if (it == std::end(entries)) return;
+
+	if (it->second.image) {
+		stats.resident_bytes -= it->second.bytes;
+		stats.resident_count--;
+		lru.erase(it->second.lru);
+	}
+	entries.erase(it);
+}
+
+std::shared_ptr<const sf::Image> Image_Cache::get(const std::string& key) noexcept {
+	Loader loader;
+	{
+		std::lock_guard guard{ mutex };
+		auto it = entries.find(key);
+		if (it == std::end(entries)) return nullptr;
+
+		auto& entry = it->second;
+		if (entry.image) {
+			stats.hits++;
+			lru.splice(std::begin(lru), lru, entry.lru);
+			return entry.image;
+		}
+		stats.misses++;
+		loader = entry.loader;
+	}
+
+	// We don't hold the lock while we read the file, it can take a while.
+	sf::Image image;
+	if (!loader || !loader(image)) return nullptr;
+
+	std::lock_guard guard{ mutex };
+	auto it = entries.find(key);
+	if (it == std::end(entries)) return nullptr;
+
+	// Someone else might have loaded it in the meantime.
+	auto& entry = it->second;
+	if (!entry.image) {
+		make_resident(entry, key, std::make_shared<const sf::Image>(std::move(image)));
+	}
+	else {
+		lru.splice(std::begin(lru), lru, entry.lru);
+	}
+
+	auto result = entry.image;
+	evict_to_budget();
+	return result;
+}
+
+void Image_Cache::set_budget(size_t budget_bytes) noexcept {
+	std::lock_guard guard{ mutex };
+	stats.budget_bytes = budget_bytes;
+	evict_to_budget();
+}
+
+Image_Cache::Stats Image_Cache::get_stats() const noexcept {
+	std::lock_guard guard{ mutex };
+	return stats;
+}
+
+void Image_Cache::make_resident(
+	Entry& entry, const std::string& key, std::shared_ptr<const sf::Image> image
+) noexcept {
+	if (entry.image) {
+		stats.resident_bytes -= entry.bytes;
+		lru.erase(entry.lru);
+	}
+	else {
+		stats.resident_count++;
+	}
+
+	entry.bytes = image_bytes(*image);
+	entry.image = std::move(image);
+	lru.push_front(key);
+	entry.lru = std::begin(lru);
+	stats.resident_bytes += entry.bytes;
+}
+
+void Image_Cache::evict_to_budget() noexcept {
+	auto it = std::end(lru);
+	while (stats.resident_bytes > stats.budget_bytes && it != std::begin(lru)) {
+		--it;
+		auto& entry = entries[*it];
+		// Someone is using it, we can't free it anyway.
+		if (entry.image.use_count() > 1) continue;
+
+		entry.image.reset();
+		stats.resident_bytes -= entry.bytes;
+		stats.resident_count--;
+		stats.evictions++;
+		it = lru.erase(it);
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <SFML/Graphics/Image.hpp>
+
+// Cpu side copy of the pixels of our textures, kept under a memory budget.
+// Every key comes with a way to get its pixels back (most of the time reading the file again), so
+// when we go over budget we just drop the least recently used images and reload them on the next
+// get. An image is never dropped while someone holds the shared_ptr get gave back.
+class Image_Cache {
+public:
+	static constexpr size_t Default_Budget = 256 * 1024 * 1024;
+
+	// Fills the image, false on failure.
+	using Loader = std::function<bool(sf::Image&)>;
+
+	struct Stats {
+		size_t hits{ 0 };
+		size_t misses{ 0 };
+		size_t evictions{ 0 };
+		size_t resident_bytes{ 0 };
+		size_t resident_count{ 0 };
+		size_t budget_bytes{ 0 };
+	};
+
+	explicit Image_Cache(size_t budget_bytes = Default_Budget) noexcept;
+
+	// Doesn't load anything, the pixels are only read on the first get.
+	void add(const std::string& key, Loader loader) noexcept;
+	void add(const std::string& key, const std::filesystem::path& path) noexcept;
+	// We already have the pixels (say we just decoded them to make the texture), keep them so the
+	// next get is a hit. The key must have been added first.
+	void put(const std::string& key, sf::Image image) noexcept;
+	// Same, shared with whoever gave it. It's not dropped as long as they hold it.
+	void put(const std::string& key, std::shared_ptr<const sf::Image> image) noexcept;
+	void remove(const std::string& key) noexcept;
+
+	// nullptr if the key is unknown or the loader failed.
+	std::shared_ptr<const sf::Image> get(const std::string& key) noexcept;
+
+	void set_budget(size_t budget_bytes) noexcept;
+	Stats get_stats() const noexcept;
+
+private:
+	struct Entry {
+		Loader loader;
+		std::shared_ptr<const sf::Image> image;
+		size_t bytes{ 0 };
+		// Only meaningful while image is there.
+		std::list<std::string>::iterator lru;
+	};
+
+	// All of those need the mutex to be held.
+	void make_resident(
+		Entry& entry, const std::string& key, std::shared_ptr<const sf::Image> image
+	) noexcept;
+	void evict_to_budget() noexcept;
+
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, Entry> entries;
+	// Keys of the resident images, most recently used first.
+	std::list<std::string> lru;
+	Stats stats;
+};
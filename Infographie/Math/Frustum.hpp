@@ -0,0 +1,32 @@
+#pragma once
+#include "Vector.hpp"
+#include "Matrix.hpp"
+
+struct Frustum {
+	// (a, b, c, d) with a x + b y + c z + d >= 0 inside and (a, b, c) normalized.
+	// Left, right, bottom, top, near, far.
+	Vector4f planes[6];
+
+	// Gribb & Hartmann, from a clip = m * p matrix. Give it proj * view and the planes are in
+	// world space, proj * view * model and they are in model space.
+	static Frustum from_matrix(const Matrix4f& m) noexcept {
+		Frustum f;
+		for (size_t i = 0; i < 3; ++i) {
+			f.planes[2 * i + 0] = m[3] + m[i];
+			f.planes[2 * i + 1] = m[3] - m[i];
+		}
+		for (auto& p : f.planes) {
+			float length = Vector3f{ p.x, p.y, p.z }.length();
+			if (length > 0) p = p / length;
+		}
+		return f;
+	}
+
+	// Conservative, a sphere near a corner can be outside and still pass.
+	bool is_outside(Vector3f center, float radius) const noexcept {
+		for (auto& p : planes) {
+			if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius) return true;
+		}
+		return false;
+	}
+};
@@ -0,0 +1,212 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define HALF_SSE2
+#include <emmintrin.h>
+#endif
+
+// MSVC doesn't define __F16C__, but every cpu that can run /arch:AVX2 code has F16C.
+#if defined(__F16C__) || defined(__AVX2__)
+#define HALF_F16C
+#include <immintrin.h>
+#endif
+
+// We don't build with /arch:AVX2, the exe has to run on the cpus without it. MSVC lets us use
+// the F16C intrinsics anyway, so there we ask the cpu once and take them when it has them.
+#if !defined(HALF_F16C) && defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define HALF_F16C_RUNTIME
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+// IEEE 754 binary16 conversions.
+// The scalar version, the SSE2 version and F16C produce the exact same bits (round to nearest
+// even, denormals and inf preserved) so we can mix them freely. Only NaN payloads may differ.
+// Courtesy of Fabian Giesen's half conversion gist.
+namespace half {
+	// F16C and the os saving the ymm registers, the instructions are VEX encoded.
+	inline bool has_f16c() noexcept {
+#if defined(HALF_F16C)
+		return true;
+#elif defined(HALF_F16C_RUNTIME)
+		static const bool F16C = [] {
+			int info[4];
+			__cpuid(info, 1);
+			constexpr int Osxsave = 1 << 27;
+			constexpr int Avx = 1 << 28;
+			constexpr int F16c = 1 << 29;
+			constexpr int Needed = Osxsave | Avx | F16c;
+			if ((info[2] & Needed) != Needed) return false;
+			return (_xgetbv(0) & 6) == 6;
+		}();
+		return F16C;
+#else
+		return false;
+#endif
+	}
+
+	inline uint32_t float_bits(float f) noexcept {
+		uint32_t u;
+		memcpy(&u, &f, sizeof(u));
+		return u;
+	}
+	inline float bits_float(uint32_t u) noexcept {
+		float f;
+		memcpy(&f, &u, sizeof(f));
+		return f;
+	}
+
+	inline uint16_t from_float(float f) noexcept {
+		constexpr uint32_t F32_Infty = 255 << 23;
+		constexpr uint32_t F16_Max = (127 + 16) << 23;
+		constexpr uint32_t Denorm_Magic = ((127 - 15) + (23 - 10) + 1) << 23;
+		constexpr uint32_t Sign_Mask = 0x80000000u;
+
+		uint32_t u = float_bits(f);
+		uint32_t sign = u & Sign_Mask;
+		u ^= sign;
+
+		uint16_t o;
+		if (u >= F16_Max) {
+			// Inf or NaN (all exponent bits set), NaN->qNaN and Inf->Inf
+			o = (u > F32_Infty) ? 0x7e00 : 0x7c00;
+		}
+		else if (u < (113 << 23)) {
+			// Resulting fp16 is subnormal or zero, use a magic value to align our 10 mantissa
+			// bits at the bottom of the float. as long as FP addition is round-to-nearest-even
+			// this just works.
+			float r = bits_float(u) + bits_float(Denorm_Magic);
+			o = (uint16_t)(float_bits(r) - Denorm_Magic);
+		}
+		else {
+			uint32_t mant_odd = (u >> 13) & 1;
+			// update exponent, rounding bias part 1
+			u += ((uint32_t)(15 - 127) << 23) + 0xfff;
+			// rounding bias part 2
+			u += mant_odd;
+			o = (uint16_t)(u >> 13);
+		}
+		return (uint16_t)(o | (sign >> 16));
+	}
+
+	inline float to_float(uint16_t h) noexcept {
+		constexpr uint32_t Shifted_Exp = 0x7c00 << 13;
+		uint32_t o = ((uint32_t)h & 0x7fff) << 13;
+		uint32_t exp = Shifted_Exp & o;
+		o += (uint32_t)(127 - 15) << 23;
+
+		if (exp == Shifted_Exp) {
+			// Inf/NaN, extra exp adjust
+			o += (uint32_t)(128 - 16) << 23;
+		}
+		else if (exp == 0) {
+			// Zero/Denormal, extra exp adjust and renormalize
+			o += 1 << 23;
+			o = float_bits(bits_float(o) - bits_float(113 << 23));
+		}
+
+		return bits_float(o | (((uint32_t)h & 0x8000) << 16));
+	}
+
+#ifdef HALF_SSE2
+	// 4 floats -> 4 halfs, each in the low 16 bits of a 32 bits lane.
+	inline __m128i from_float4(__m128 f) noexcept {
+#ifdef HALF_F16C
+		return _mm_cvtepu16_epi32(_mm_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT));
+#else
+#ifdef HALF_F16C_RUNTIME
+		if (has_f16c()) return _mm_cvtepu16_epi32(_mm_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT));
+#endif
+		const __m128i Sign_Mask = _mm_set1_epi32((int)0x80000000u);
+		const __m128i F32_Infty = _mm_set1_epi32(255 << 23);
+		const __m128i F16_Max = _mm_set1_epi32((127 + 16) << 23);
+		const __m128i Denorm_Magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+		const __m128i Normal_Min = _mm_set1_epi32(113 << 23);
+		const __m128i Exp_Bias = _mm_set1_epi32((int)(((uint32_t)(15 - 127) << 23) + 0xfff));
+		const __m128i One = _mm_set1_epi32(1);
+		const __m128i Inf = _mm_set1_epi32(0x7c00);
+		const __m128i Nan = _mm_set1_epi32(0x7e00);
+
+		__m128i u = _mm_castps_si128(f);
+		__m128i sign = _mm_and_si128(u, Sign_Mask);
+		u = _mm_xor_si128(u, sign);
+
+		// denormal path
+		__m128 denorm_f = _mm_add_ps(_mm_castsi128_ps(u), _mm_castsi128_ps(Denorm_Magic));
+		__m128i denorm = _mm_sub_epi32(_mm_castps_si128(denorm_f), Denorm_Magic);
+
+		// normal path
+		__m128i mant_odd = _mm_and_si128(_mm_srli_epi32(u, 13), One);
+		__m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(u, Exp_Bias), mant_odd), 13);
+
+		// inf/nan path, the comparisons are signed but u has no sign bit anymore.
+		__m128i is_nan = _mm_cmpgt_epi32(u, F32_Infty);
+		__m128i infnan = _mm_or_si128(_mm_and_si128(is_nan, Nan), _mm_andnot_si128(is_nan, Inf));
+
+		__m128i is_big = _mm_cmpgt_epi32(u, _mm_sub_epi32(F16_Max, One));
+		__m128i is_small = _mm_cmpgt_epi32(Normal_Min, u);
+
+		__m128i o = _mm_or_si128(_mm_and_si128(is_small, denorm), _mm_andnot_si128(is_small, normal));
+		o = _mm_or_si128(_mm_and_si128(is_big, infnan), _mm_andnot_si128(is_big, o));
+
+		return _mm_or_si128(o, _mm_srli_epi32(sign, 16));
+#endif
+	}
+
+	// 4 halfs (in the low 16 bits of each 32 bits lane) -> 4 floats.
+	inline __m128 to_float4(__m128i h) noexcept {
+#ifdef HALF_F16C
+		return _mm_cvtph_ps(_mm_packus_epi32(h, h));
+#else
+#ifdef HALF_F16C_RUNTIME
+		if (has_f16c()) return _mm_cvtph_ps(_mm_packus_epi32(h, h));
+#endif
+		const __m128i No_Sign = _mm_set1_epi32(0x7fff);
+		const __m128 Magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+		const __m128i Was_Infnan = _mm_set1_epi32(0x7bff);
+		const __m128 Exp_Infnan = _mm_castsi128_ps(_mm_set1_epi32(255 << 23));
+
+		__m128i expmant = _mm_and_si128(No_Sign, h);
+		__m128i justsign = _mm_xor_si128(h, expmant);
+		__m128i shifted = _mm_slli_epi32(expmant, 13);
+		__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(shifted), Magic);
+		__m128i b_wasinfnan = _mm_cmpgt_epi32(expmant, Was_Infnan);
+		__m128i sign = _mm_slli_epi32(justsign, 16);
+		__m128 infnanexp = _mm_and_ps(_mm_castsi128_ps(b_wasinfnan), Exp_Infnan);
+		__m128 sign_inf = _mm_or_ps(_mm_castsi128_ps(sign), infnanexp);
+		return _mm_or_ps(scaled, sign_inf);
+#endif
+	}
+#endif
+
+	// Bulk conversions, n doesn't need to be a multiple of anything.
+	inline void from_float_n(const float* in, uint16_t* out, size_t n) noexcept {
+		size_t i = 0;
+#ifdef HALF_SSE2
+		for (; i + 4 <= n; i += 4) {
+			__m128i h = from_float4(_mm_loadu_ps(in + i));
+			// the values are < 0x10000 so a signed saturating pack would clamp them, we shuffle
+			// the low halves together instead.
+			h = _mm_shufflelo_epi16(h, _MM_SHUFFLE(3, 3, 2, 0));
+			h = _mm_shufflehi_epi16(h, _MM_SHUFFLE(3, 3, 2, 0));
+			h = _mm_shuffle_epi32(h, _MM_SHUFFLE(3, 3, 2, 0));
+			_mm_storel_epi64((__m128i*)(out + i), h);
+		}
+#endif
+		for (; i < n; ++i) out[i] = from_float(in[i]);
+	}
+
+	inline void to_float_n(const uint16_t* in, float* out, size_t n) noexcept {
+		size_t i = 0;
+#ifdef HALF_SSE2
+		for (; i + 4 <= n; i += 4) {
+			__m128i h = _mm_loadl_epi64((const __m128i*)(in + i));
+			h = _mm_unpacklo_epi16(h, _mm_setzero_si128());
+			_mm_storeu_ps(out + i, to_float4(h));
+		}
+#endif
+		for (; i < n; ++i) out[i] = to_float(in[i]);
+	}
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+// Tells which files of some directories were written to. It only reports raw events, a save from
+// an editor can show up as a burst of them so it's up to the caller to wait for things to settle.
+// Not thread safe, use it from one thread.
+class File_Watcher {
+public:
+	File_Watcher() noexcept;
+	~File_Watcher() noexcept;
+
+	File_Watcher(const File_Watcher&) = delete;
+	File_Watcher& operator=(const File_Watcher&) = delete;
+
+	// Not recursive. Watching the same directory twice is fine.
+	bool watch(const std::filesystem::path& directory) noexcept;
+
+	// Never blocks, the files that changed since the last call (maybe several times the same).
+	std::vector<std::filesystem::path> read_changes() noexcept;
+
+private:
+	struct Platform;
+	std::unique_ptr<Platform> platform;
+};
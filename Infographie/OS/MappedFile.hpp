@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+
+// A whole file mapped read only. The pages are only read when touched, so opening is cheap
+// whatever the size, and the os can drop them under pressure since they are backed by the file.
+class Mapped_File {
+public:
+	Mapped_File() noexcept = default;
+	~Mapped_File() noexcept { close(); }
+
+	Mapped_File(Mapped_File&& other) noexcept { *this = std::move(other); }
+	Mapped_File& operator=(Mapped_File&& other) noexcept {
+		if (this == &other) return *this;
+		close();
+
+		bytes = std::exchange(other.bytes, nullptr);
+		length = std::exchange(other.length, 0);
+		opened = std::exchange(other.opened, false);
+		return *this;
+	}
+
+	// Closes whatever was open before. An empty file opens fine, with a nullptr data.
+	bool open(const std::filesystem::path& path) noexcept;
+	void close() noexcept;
+
+	// Ask the os to start reading all of it in the background, so whoever reads it next (say
+	// the gl thread) doesn't wait on the disk.
+	void prefetch() const noexcept;
+
+	bool is_open() const noexcept { return opened; }
+	const uint8_t* data() const noexcept { return bytes; }
+	size_t size() const noexcept { return length; }
+
+private:
+	const uint8_t* bytes{ nullptr };
+	size_t length{ 0 };
+	bool opened{ false };
+};
@@ -5,6 +5,7 @@
 #include <functional>
 #include <filesystem>
 #include <unordered_map>
+#include <vector>
 
 struct Open_File_Opts {
 	void* owner{ nullptr };
@@ -31,6 +32,9 @@ struct Open_File_Result {
 
 	std::filesystem::path filepath;
 	std::filesystem::path filename;
+	// Every file selected, the one in filepath if there is only one. With more than one (and
+	// allow_multiple) filepath is their folder and filename is the first one's.
+	std::vector<std::filesystem::path> filepaths;
 };
 
 extern void open_dir_async(
@@ -0,0 +1,65 @@
+#ifdef __linux__
+
+#include "OS/FileWatcher.hpp"
+
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+struct File_Watcher::Platform {
+	int fd{ -1 };
+	std::unordered_map<int, std::filesystem::path> directories;
+};
+
+File_Watcher::File_Watcher() noexcept : platform(std::make_unique<Platform>()) {
+	platform->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+File_Watcher::~File_Watcher() noexcept {
+	if (platform->fd >= 0) close(platform->fd);
+}
+
+bool File_Watcher::watch(const std::filesystem::path& directory) noexcept {
+	if (platform->fd < 0) return false;
+
+	// Most editors either write the file in place (modify then close) or write a temporary one
+	// and rename it over the original (moved to).
+	auto wd = inotify_add_watch(
+		platform->fd,
+		directory.c_str(),
+		IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE
+	);
+	if (wd < 0) return false;
+
+	// Adding the same directory again gives back the same descriptor.
+	platform->directories[wd] = directory;
+	return true;
+}
+
+std::vector<std::filesystem::path> File_Watcher::read_changes() noexcept {
+	std::vector<std::filesystem::path> changes;
+	if (platform->fd < 0) return changes;
+
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+		auto length = read(platform->fd, buffer, sizeof(buffer));
+		// EAGAIN, nothing left to read.
+		if (length <= 0) break;
+
+		for (ssize_t i = 0; i < length;) {
+			auto event = (const inotify_event*)(buffer + i);
+			i += sizeof(inotify_event) + event->len;
+
+			if (event->len == 0 || (event->mask & IN_ISDIR)) continue;
+			auto it = platform->directories.find(event->wd);
+			if (it == std::end(platform->directories)) continue;
+
+			changes.push_back(it->second / event->name);
+		}
+	}
+	return changes;
+}
+
+#endif
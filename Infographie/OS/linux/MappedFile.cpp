@@ -0,0 +1,48 @@
+#ifdef __linux__
+
+#include "OS/MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool Mapped_File::open(const std::filesystem::path& path) noexcept {
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		::close(fd);
+		return false;
+	}
+
+	if (info.st_size > 0) {
+		void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view == MAP_FAILED) {
+			::close(fd);
+			return false;
+		}
+		bytes = (const uint8_t*)view;
+		length = (size_t)info.st_size;
+	}
+	::close(fd);
+
+	opened = true;
+	return true;
+}
+
+void Mapped_File::close() noexcept {
+	if (bytes) munmap((void*)bytes, length);
+	bytes = nullptr;
+	length = 0;
+	opened = false;
+}
+
+void Mapped_File::prefetch() const noexcept {
+	if (bytes) madvise((void*)bytes, length, MADV_WILLNEED);
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifdef _WIN32
+
+#include "OS/FileWatcher.hpp"
+
+#include <unordered_map>
+
+#include <Windows.h>
+
+// The change notifications only tell us that something in the directory changed, so we keep the
+// write time of every file and look for the ones that moved when we are signaled.
+struct File_Watcher::Platform {
+	struct Directory {
+		HANDLE handle{ INVALID_HANDLE_VALUE };
+		std::filesystem::path path;
+		std::unordered_map<std::string, std::filesystem::file_time_type> write_times;
+	};
+	std::vector<Directory> directories;
+
+	static void scan(Directory& d, std::vector<std::filesystem::path>* changes) noexcept {
+		std::error_code ec;
+		for (auto& entry : std::filesystem::directory_iterator(d.path, ec)) {
+			if (!entry.is_regular_file(ec)) continue;
+
+			auto time = entry.last_write_time(ec);
+			auto& known = d.write_times[entry.path().filename().generic_string()];
+			if (known != time && changes) changes->push_back(entry.path());
+			known = time;
+		}
+	}
+};
+
+File_Watcher::File_Watcher() noexcept : platform(std::make_unique<Platform>()) {}
+
+File_Watcher::~File_Watcher() noexcept {
+	for (auto& d : platform->directories) FindCloseChangeNotification(d.handle);
+}
+
+bool File_Watcher::watch(const std::filesystem::path& directory) noexcept {
+	for (auto& d : platform->directories) if (d.path == directory) return true;
+
+	Platform::Directory d;
+	d.path = directory;
+	d.handle = FindFirstChangeNotificationW(
+		directory.c_str(),
+		FALSE,
+		FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME
+	);
+	if (d.handle == INVALID_HANDLE_VALUE) return false;
+
+	Platform::scan(d, nullptr);
+	platform->directories.push_back(std::move(d));
+	return true;
+}
+
+std::vector<std::filesystem::path> File_Watcher::read_changes() noexcept {
+	std::vector<std::filesystem::path> changes;
+	for (auto& d : platform->directories) {
+		while (WaitForSingleObject(d.handle, 0) == WAIT_OBJECT_0) {
+			Platform::scan(d, &changes);
+			if (!FindNextChangeNotification(d.handle)) break;
+		}
+	}
+	return changes;
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifdef _WIN32
+
+#include "OS/MappedFile.hpp"
+
+#include <Windows.h>
+
+bool Mapped_File::open(const std::filesystem::path& path) noexcept {
+	close();
+
+	HANDLE file = CreateFileW(
+		path.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr
+	);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		return false;
+	}
+
+	// CreateFileMapping refuses empty files.
+	if (size.QuadPart > 0) {
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) {
+			CloseHandle(file);
+			return false;
+		}
+
+		// The view keeps the mapping and the file alive, we don't need the handles after this.
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (!view) {
+			CloseHandle(file);
+			return false;
+		}
+		bytes = (const uint8_t*)view;
+		length = (size_t)size.QuadPart;
+	}
+	CloseHandle(file);
+
+	opened = true;
+	return true;
+}
+
+void Mapped_File::close() noexcept {
+	if (bytes) UnmapViewOfFile(bytes);
+	bytes = nullptr;
+	length = 0;
+	opened = false;
+}
+
+void Mapped_File::prefetch() const noexcept {
+	if (!bytes) return;
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = (void*)bytes;
+	range.NumberOfBytes = length;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#endif
@@ -43,14 +43,17 @@ void open_file_async(
 
 Open_File_Result open_file(Open_File_Opts opts) noexcept {
 	constexpr auto BUFFER_SIZE = 512;
+	// Every name selected goes in there, a folder of photos is a lot of them.
+	constexpr auto MULTIPLE_BUFFER_SIZE = 64 * 1024;
+	auto filepath_size = opts.allow_multiple ? MULTIPLE_BUFFER_SIZE : BUFFER_SIZE;
 
-	char* filepath = new char[BUFFER_SIZE];
+	char* filepath = new char[filepath_size];
 	memcpy(
 		filepath,
 		opts.filepath.string().c_str(),
 		opts.filepath.string().size() + 1
 	);
-	defer{ delete filepath; };
+	defer{ delete[] filepath; };
 
 	char* filename = new char[BUFFER_SIZE];
 	memcpy(
@@ -70,12 +73,13 @@ Open_File_Result open_file(Open_File_Opts opts) noexcept {
 	ofn.hwndOwner = (HWND)opts.owner;
 	ofn.lpstrFilter = filters;
 	ofn.lpstrFile = filepath;
-	ofn.nMaxFile = BUFFER_SIZE;
+	ofn.nMaxFile = filepath_size;
 	ofn.lpstrFileTitle = filename;
 	ofn.nMaxFileTitle = BUFFER_SIZE;
+	// Without OFN_EXPLORER the multiple names are separated by spaces.
 	ofn.Flags =
-		(opts.allow_multiple ? OFN_ALLOWMULTISELECT : 0) ||
-		(opts.prompt_for_create ? OFN_CREATEPROMPT : 0) ||
+		(opts.allow_multiple ? OFN_ALLOWMULTISELECT | OFN_EXPLORER : 0) |
+		(opts.prompt_for_create ? OFN_CREATEPROMPT : 0) |
 		(opts.allow_redirect_link ? 0 : OFN_NODEREFERENCELINKS);
 
 	Open_File_Result result;
@@ -86,6 +90,19 @@ Open_File_Result open_file(Open_File_Opts opts) noexcept {
 		// To make sure they are generic.
 		result.filename = std::filesystem::path{ filename };
 		result.filepath = std::filesystem::path{ filepath };
+
+		// With more than one it's the folder then each name, all null terminated and one more
+		// null at the end. With a single one it's its whole path, like without allow_multiple.
+		bool several = opts.allow_multiple && filepath[ofn.nFileOffset - 1] == '\0';
+		if (several) {
+			for (auto name = filepath + ofn.nFileOffset; *name; name += strlen(name) + 1) {
+				result.filepaths.push_back(result.filepath / name);
+			}
+			result.filename = result.filepaths.front().filename();
+		}
+		else {
+			result.filepaths.push_back(result.filepath);
+		}
 	}
 	else {
 		result.succeded = false;
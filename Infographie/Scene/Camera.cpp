@@ -64,8 +64,10 @@ void Camera::render(Texture_Buffer& target) noexcept {
 	// (Not the blur)
 	auto samples = generate_ssao_samples(ray_tracing_settings.kernel_sample_count);
 	auto noise_texture = get_noise_texture();
-	auto& ssao_shader = AM->get_shader("SSAO");
-	auto& ssao_shader_blur = AM->get_shader("SSAO_Blur");
+	static const auto ssao_key = AM->shader_key("SSAO");
+	static const auto ssao_blur_key = AM->shader_key("SSAO_Blur");
+	auto& ssao_shader = AM->get_shader(ssao_key);
+	auto& ssao_shader_blur = AM->get_shader(ssao_blur_key);
 
 	ssao_buffer.set_active_ssao();
 	g_buffer.set_active_texture();
@@ -142,7 +144,8 @@ void Camera::render(Texture_Buffer& target) noexcept {
 	glClearColor(UNROLL_3(Window_Info.clear_color), 1);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	auto& shader_light = AM->get_shader("Deferred_Light");
+	static const auto light_key = AM->shader_key("Deferred_Light");
+	auto& shader_light = AM->get_shader(light_key);
 
 	shader_light.setUniform("gPosition", 0);
 	shader_light.setUniform("gNormal", 1);
@@ -157,12 +160,17 @@ void Camera::render(Texture_Buffer& target) noexcept {
 
 	if (active_cubemap) {
 		shader_light.setUniform("use_ibl", 1);
-		shader_light.setUniform("irradianceMap", 7);
 		shader_light.setUniform("prefilterMap", 8);
 		shader_light.setUniform("brdfLUT", 9);
 
-		glActiveTexture(GL_TEXTURE7);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, active_cubemap->get_irradiance_id());
+		auto& sh = active_cubemap->get_irradiance();
+		sf::Glsl::Vec3 coefficients[9];
+		for (size_t i = 0; i < 9; ++i) {
+			auto& rgb = sh.coefficients[i];
+			coefficients[i] = { rgb[0], rgb[1], rgb[2] };
+		}
+		shader_light.setUniformArray("irradiance_sh", coefficients, 9);
+
 		glActiveTexture(GL_TEXTURE8);
 		glBindTexture(GL_TEXTURE_CUBE_MAP, active_cubemap->get_prefilter_id());
 		glActiveTexture(GL_TEXTURE9);
@@ -179,7 +187,8 @@ void Camera::render(Texture_Buffer& target) noexcept {
 	
 	hdr_buffer.set_active_texture();
 
-	auto& shader_hdr = AM->get_shader("HDR");
+	static const auto hdr_key = AM->shader_key("HDR");
+	auto& shader_hdr = AM->get_shader(hdr_key);
 
 	shader_hdr.setUniform("gamma", gamma);
 	shader_hdr.setUniform("exposure", exposure);
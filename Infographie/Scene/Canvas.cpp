@@ -5,12 +5,16 @@
 
 size_t Canvas::Total_N{ 0 };
 
+namespace {
+	Rgba8 to_rgba(sf::Color color) noexcept {
+		return { color.r, color.g, color.b, color.a };
+	}
+};
+
 Canvas::Canvas(const Drawing_Settings& settings) noexcept : settings(settings) {
 	Total_N++;
 	n = Total_N;
 
-	sprite.setTexture(texture);
-
 	on_click.began = [&] {
 		click_cursor = push_cursor(sf::Cursor::Hand);
 		return true;
@@ -54,24 +58,33 @@ Canvas::Canvas(const Drawing_Settings& settings) noexcept : settings(settings) {
 	};
 }
 
-void Canvas::update(float) noexcept {
-	sprite.setPosition(get_global_position());
-}
+void Canvas::update(float) noexcept {}
 
 void Canvas::render(sf::RenderTarget& target) noexcept {
 	auto last_view = target.getView();
 	target.setView(target.getDefaultView());
 
-	if (!texture_cached) {
-		defer{ texture_cached = true; };
-	
-		texture.loadFromImage(image);
-		sprite = sf::Sprite{ texture };
-		sprite.setPosition(get_global_position());
+	upload_tiles();
+
+	sf::RenderStates states;
+	states.transform.translate(get_global_position());
+	target.draw(solid_tiles, states);
+	for (uint32_t ty = 0; ty < image.get_tiles_y(); ++ty) {
+		for (uint32_t tx = 0; tx < image.get_tiles_x(); ++tx) {
+			auto& texture = tile_textures[tx + ty * image.get_tiles_x()].texture;
+			if (!texture) continue;
+
+			sf::Sprite sprite{ *texture, {
+				0, 0, (int)image.get_tile_width(tx), (int)image.get_tile_height(ty)
+			} };
+			sprite.setPosition(
+				get_global_position() +
+				Vector2f{ (float)tx, (float)ty } * (float)Tiled_Image::Tile_Size
+			);
+			target.draw(sprite);
+		}
 	}
 
-	target.draw(sprite);
-
 	if (line_start_point) {
 		constexpr auto radius = 5.f;
 		sf::CircleShape marker{ radius };
@@ -97,35 +110,25 @@ void Canvas::render(sf::RenderTarget& target) noexcept {
 }
 
 void Canvas::set_size(const Vector2f& s) noexcept {
-	uint8_t* pixels = new uint8_t[(size_t)s.x * (size_t)s.y * 4];
-	auto old_pixels = image.getPixelsPtr();
-	defer{ delete[] pixels; };
-
-	memset(pixels, 255, (size_t)s.x * (size_t)s.y * 4);
-	for (size_t x = 0; x < 4 * (size_t)std::min(s.x, size.x); x += 4) {
-		for (size_t y = 0; y < 4 * (size_t)std::min(s.y, size.y); y += 4) {
-			pixels[(x + y * (size_t)s.y) + 0] = old_pixels[(x + y * image.getSize().y) + 0];
-			pixels[(x + y * (size_t)s.y) + 1] = old_pixels[(x + y * image.getSize().y) + 1];
-			pixels[(x + y * (size_t)s.y) + 2] = old_pixels[(x + y * image.getSize().y) + 2];
-			pixels[(x + y * (size_t)s.y) + 3] = old_pixels[(x + y * image.getSize().y) + 3];
-		}
-	}
-
+	// The tiles we keep are not copied, only the new ones are made (and white, so nothing to
+	// allocate).
 	Widget::set_size(s);
-	image.create(UNROLL_2_P(s, size_t), pixels);
-	texture_cached = false;
+	image.resize(UNROLL_2_P(s, uint32_t), { 255, 255, 255, 255 });
+	// The tile grid changed, every texture is made again.
+	tile_textures.clear();
 }
 void Canvas::set_size(const Vector2u& s) noexcept {
 	set_size(Vector2f{ UNROLL_2_P(s, float) });
 }
 
 void Canvas::paint_pixels(const std::vector<Vector2u>& pixels, Vector4f color) noexcept {
+	auto rgba = to_rgba((sf::Color)color);
 	for (auto& x : pixels) {
-		image.setPixel(x.x, x.y, color);
+		image.set_pixel(x.x, x.y, rgba);
 	}
 }
 
-sf::Image& Canvas::get_image() noexcept {
+const Tiled_Image& Canvas::get_image() const noexcept {
 	return image;
 }
 
@@ -140,13 +143,14 @@ void Canvas::fill_circle(Vector2u p, size_t radius, Vector4f color) noexcept {
 	start.x = std::max(radius, p.x) - radius;
 	start.y = std::max(radius, p.y) - radius;
 
-	end.x = std::min(p.x + radius, image.getSize().x);
-	end.y = std::min(p.y + radius, image.getSize().y);
+	end.x = std::min(p.x + radius, image.get_width());
+	end.y = std::min(p.y + radius, image.get_height());
 
+	auto rgba = to_rgba((sf::Color)color);
 	for (size_t x = start.x; x < end.x; ++x) {
 		for (size_t y = start.y; y < end.y; ++y) {
 			if ((x - p.x) * (x - p.x) + (y - p.y) * (y - p.y) < radius * radius) {
-				image.setPixel(x, y, (sf::Color)color);
+				image.set_pixel(x, y, rgba);
 			}
 		}
 	}
@@ -163,7 +167,7 @@ void Canvas::fill_line(Vector2u A, Vector2u B, Vector4f color) noexcept {
 		auto y = A.y;
 
 		for (size_t x = A.x; x < B.x; ++x) {
-			image.setPixel(x, y, (sf::Color)color);
+			image.set_pixel(x, y, to_rgba((sf::Color)color));
 			if (D > 0) {
 				y = y + yi;
 				D = D - 2 * dt.x;
@@ -182,7 +186,7 @@ void Canvas::fill_line(Vector2u A, Vector2u B, Vector4f color) noexcept {
 		auto x = A.x;
 
 		for (size_t y = A.y; y < B.y; ++y) {
-			image.setPixel(x, y, (sf::Color)color);
+			image.set_pixel(x, y, to_rgba((sf::Color)color));
 			if (D > 0) {
 				x = x + xi;
 				D = D - 2 * dt.y;
@@ -201,7 +205,11 @@ void Canvas::fill_line(Vector2u A, Vector2u B, Vector4f color) noexcept {
 }
 
 void Canvas::flood_fill(Vector2u p, Vector4u color, float tolerance) noexcept {
-	Vector4u og_color{ COLOR_UNROLL(image.getPixel(p.x, p.y)) };
+	auto at = [&](Vector2u p) {
+		auto rgba = image.get_pixel(p.x, p.y);
+		return Vector4u{ rgba[0], rgba[1], rgba[2], rgba[3] };
+	};
+	Vector4u og_color = at(p);
 
 	std::vector<Vector2u> open;
 	open.push_back(p);
@@ -217,40 +225,82 @@ void Canvas::flood_fill(Vector2u p, Vector4u color, float tolerance) noexcept {
 		auto last = open.back();
 		open.pop_back();
 
-		Vector4u image_color{ COLOR_UNROLL(image.getPixel(last.x, last.y)) };
+		Vector4u image_color = at(last);
 
 		if (image_color == color) continue;
 		if (!test(og_color, image_color)) continue;
 
-		image.setPixel(last.x, last.y, sf::Color{ COLOR_UNROLL_P(color, uint8_t) });
+		image.set_pixel(last.x, last.y, { COLOR_UNROLL_P(color, uint8_t) });
 
 		if (last.x > 0)
 			open.push_back(last + Vector2i{ -1, 0 });
 
-		if (last.x + 1 < image.getSize().x)
+		if (last.x + 1 < image.get_width())
 			open.push_back(last + Vector2i{ +1, 0 });
 	
 		if (last.y > 0)
 			open.push_back(last + Vector2i{ 0, -1 });
 
-		if (last.y + 1 < image.getSize().y)
+		if (last.y + 1 < image.get_height())
 			open.push_back(last + Vector2i{ 0, +1 });
 	}
 
+	// A fill of a blank area leaves whole tiles of its color.
+	image.compact();
 }
 
 void Canvas::fill_square(Vector2u center, size_t s, Vector4f color) noexcept {
-	for (
-		size_t x = std::max((int)center.x - (int)s / 2, 0);
-		x < std::min(center.x + s / 2, image.getSize().x);
-		++x
-	) {
-		for (
-			size_t y = std::max((int)center.y - (int)s / 2, 0);
-			y < std::min(center.y + s / 2, image.getSize().y);
-			++y
-		) {
-			image.setPixel(x, y, color);
+	image.fill_rect(
+		(uint32_t)std::max((int)center.x - (int)s / 2, 0),
+		(uint32_t)std::max((int)center.y - (int)s / 2, 0),
+		(uint32_t)(center.x + s / 2),
+		(uint32_t)(center.y + s / 2),
+		to_rgba((sf::Color)color)
+	);
+}
+
+void Canvas::upload_tiles() noexcept {
+	auto tiles_x = image.get_tiles_x();
+	auto tiles_y = image.get_tiles_y();
+	tile_textures.resize((size_t)tiles_x * tiles_y);
+
+	bool changed = false;
+	for (uint32_t ty = 0; ty < tiles_y; ++ty) {
+		for (uint32_t tx = 0; tx < tiles_x; ++tx) {
+			auto& tile = image.get_tile(tx, ty);
+			auto& mirror = tile_textures[tx + ty * tiles_x];
+			if (mirror.version == tile.version) continue;
+			mirror.version = tile.version;
+			changed = true;
+
+			if (!tile.pixels) {
+				mirror.texture.reset();
+				continue;
+			}
+			if (!mirror.texture) {
+				mirror.texture = std::make_unique<sf::Texture>();
+				mirror.texture->create(Tiled_Image::Tile_Size, Tiled_Image::Tile_Size);
+			}
+			mirror.texture->update(tile.pixels->data());
+		}
+	}
+	if (!changed) return;
+
+	solid_tiles.clear();
+	for (uint32_t ty = 0; ty < tiles_y; ++ty) {
+		for (uint32_t tx = 0; tx < tiles_x; ++tx) {
+			auto& tile = image.get_tile(tx, ty);
+			if (tile.pixels) continue;
+
+			sf::Color color{ tile.color[0], tile.color[1], tile.color[2], tile.color[3] };
+			float x = (float)tx * Tiled_Image::Tile_Size;
+			float y = (float)ty * Tiled_Image::Tile_Size;
+			float w = (float)image.get_tile_width(tx);
+			float h = (float)image.get_tile_height(ty);
+			solid_tiles.append({ { x, y }, color });
+			solid_tiles.append({ { x + w, y }, color });
+			solid_tiles.append({ { x + w, y + h }, color });
+			solid_tiles.append({ { x, y + h }, color });
 		}
 	}
 }
@@ -263,11 +313,9 @@ void Canvas::action_on_canvas() noexcept {
 
 		if constexpr (std::is_same_v<type_t, Drawing_Settings::DT_Circle>) {
 			fill_circle(mouse_canvas_pos, x.size, x.color);
-			texture_cached = false;
 		}
 		if constexpr (std::is_same_v<type_t, Drawing_Settings::DT_Fill>) {
 			flood_fill(mouse_canvas_pos, (Vector4u)(x.color * 255), x.tolerance);
-			texture_cached = false;
 		}
 		if constexpr (std::is_same_v<type_t, Drawing_Settings::DT_Line>) {
 			if (!IM::isMouseJustPressed(sf::Mouse::Left)) return;
@@ -276,13 +324,11 @@ void Canvas::action_on_canvas() noexcept {
 			}
 			else {
 				fill_line(*line_start_point, mouse_canvas_pos, x.color);
-				texture_cached = false;
 				line_start_point.reset();
 			}
 		}
 		if constexpr (std::is_same_v<type_t, Drawing_Settings::DT_Square>) {
 			fill_square(mouse_canvas_pos, x.size, x.color);
-			texture_cached = false;
 		}
 
 	}, settings.drawing_tool);
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <memory>
 #include <optional>
 
 #include "Widget.hpp"
 #include "UI/Drawings.hpp"
+#include "Files/TiledImage.hpp"
 
 class Canvas : public Widget {
 public:
@@ -18,7 +20,8 @@ public:
 	void set_size(const Vector2u& size) noexcept;
 
 	void paint_pixels(const std::vector<Vector2u>& pixels, Vector4f color) noexcept;
-	sf::Image& get_image() noexcept;
+	// A copy of it is a snapshot, see Tiled_Image.
+	const Tiled_Image& get_image() const noexcept;
 
 	size_t get_n() const noexcept;
 private:
@@ -29,19 +32,27 @@ private:
 	void flood_fill(Vector2u pos, Vector4u color, float tolerance) noexcept;
 
 	void action_on_canvas() noexcept;
+	// The tiles changed since the last frame go to their texture, tile by tile.
+	void upload_tiles() noexcept;
 
 	const Drawing_Settings& settings;
 
 	size_t n{ 0 };
 
-	bool texture_cached{ false };
 	bool mouse_is_in_canvas{ false };
 	std::optional<Vector2u> line_start_point;
 
-	sf::Sprite sprite;
-	sf::Texture texture;
-	sf::RenderTexture render_texture;
-	sf::Image image;
+	// Mirrors a tile of the image, only the ones with pixels have a texture. The ones that are
+	// a single color are drawn as quads.
+	struct Tile_Texture {
+		std::unique_ptr<sf::Texture> texture;
+		// Of the tile it was made from.
+		uint64_t version{ 0 };
+	};
+
+	Tiled_Image image;
+	std::vector<Tile_Texture> tile_textures;
+	sf::VertexArray solid_tiles{ sf::Quads };
 
 	sf::Cursor* click_cursor{ nullptr };
 	sf::Cursor* hover_cursor{nullptr};
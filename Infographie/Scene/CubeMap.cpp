@@ -1,29 +1,67 @@
 #include <GL/glew.h>
+#include <cstdio>
 
 #include "CubeMap.hpp"
 
 #include "Managers/AssetsManager.hpp"
 
-#include "Files/stb_image.h"
+#include "Files/BrdfLut.hpp"
+#include "Files/CubemapFaces.hpp"
+#include "Files/Environment.hpp"
 
 #include "Math/Matrix.hpp"
 
 #include "OS/PathDefinition.hpp"
 
+namespace {
+	// The six faces of a level of a cube map texture, from the RGB halfs.
+	void upload_cube_level(GLint level, const Cube_Level& cube) noexcept {
+		for (unsigned int i = 0; i < 6; ++i) {
+			glTexImage2D(
+				GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+				level,
+				GL_RGB16F,
+				cube.size,
+				cube.size,
+				0,
+				GL_RGB,
+				GL_HALF_FLOAT,
+				cube.pixels.data() + (size_t)i * cube.size * cube.size * 3
+			);
+		}
+	}
+
+	// On the bound cube map.
+	void set_cube_parameters(GLint last_level) noexcept {
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexParameteri(
+			GL_TEXTURE_CUBE_MAP,
+			GL_TEXTURE_MIN_FILTER,
+			last_level > 0 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR
+		);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, last_level);
+	}
+};
+
 std::optional<size_t> Cube_Map::brdf_lut_id = std::nullopt;
 
 Cube_Map::Cube_Map() noexcept : Widget3() {
 	glGenTextures(1, &texture_id);
 
-	cube_model.set_object_copy(Object_File::cube({ 5, 5, 5 }));
+	cube_model.set_shared_geometry(Shared_Primitive::Unit_Cube, { 5, 5, 5 });
 	cube_model.set_shader(AM->get_shader("Skybox"));
 }
 
 void Cube_Map::last_opengl_render() noexcept {
 	glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
 
-	sf::Shader::bind(&AM->get_shader("Skybox"));
-	AM->get_shader("Skybox").setUniform("skybox", 0);
+	static const auto skybox_key = AM->shader_key("Skybox");
+	auto& skybox_shader = AM->get_shader(skybox_key);
+	sf::Shader::bind(&skybox_shader);
+	skybox_shader.setUniform("skybox", 0);
 
 	// we short circuit the normal render cycle because a skybox doesn't have a position
 	// (or i guess, the camera position), doesn't rotate or in a general way transform
@@ -35,407 +73,245 @@ void Cube_Map::last_opengl_render() noexcept {
 
 [[nodiscard]]
 bool Cube_Map::load_texture(std::filesystem::path path) noexcept {
-	constexpr Vector2u Cubemap_Texture_Size{ 2048, 2048 };
-	constexpr size_t Max_Mip_Levels = 10;
-
 	if (!std::filesystem::is_regular_file(path)) return false;
 
 	std::filesystem::current_path(Base_Working_Directory);
 
-	if (!AM->have_shader("Irradiance")) {
-		AM->load_shader(
-			"Irradiance", "res/shaders/cubemap.vertex", "res/shaders/irradiance.fragment"
+	// The sky, the irradiance and the prefiltered chain are made on the cpu once per .hdr, after
+	// that it's only an upload. The irradiance is 9 coefficients the light shader gets as is.
+	auto maps = cached_environment(path);
+	if (!maps) return false;
+
+	if (maps->seconds > 0) {
+		std::printf(
+			"Environment: %s, %u faces in %.0f ms\n",
+			path.generic_string().c_str(),
+			maps->cube.size,
+			maps->seconds * 1000
 		);
 	}
-	if (!AM->have_shader("Equi_To_Cube")) {
-		AM->load_shader(
-			"Equi_To_Cube", "res/shaders/cubemap.vertex", "res/shaders/equi_to_cube.fragment"
-		);
-	}
-	if (!AM->have_shader("Prefilter_Cubemap")) {
-		AM->load_shader(
-			"Prefilter_Cubemap", "res/shaders/cubemap.vertex", "res/shaders/prefilter.fragment"
+	else {
+		std::printf(
+			"Environment: %s, %u faces (cached)\n",
+			path.generic_string().c_str(),
+			maps->cube.size
 		);
 	}
-	if (!AM->have_shader("BRDF")) {
-		AM->load_shader("BRDF", "res/shaders/brdf.vertex", "res/shaders/brdf.fragment");
-	}
-
-	GLint vp[4];
-	glGetIntegerv(GL_VIEWPORT, vp);
-	defer{ glViewport(vp[0], vp[1], vp[2], vp[3]); };
-
-	auto& equi_to_cube_shader = AM->get_shader("Equi_To_Cube");
-	auto& irradiance_shader = AM->get_shader("Irradiance");
-
-	// pbr: setup framebuffer
-// ----------------------
-	unsigned int captureFBO;
-	unsigned int captureRBO;
-	glGenFramebuffers(1, &captureFBO);
-	glGenRenderbuffers(1, &captureRBO);
-
-	defer{
-		glDeleteFramebuffers(1, &captureFBO);
-		glDeleteRenderbuffers(1, &captureRBO);
-	};
 
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-	glRenderbufferStorage(
-		GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, Cubemap_Texture_Size.x, Cubemap_Texture_Size.y
-	);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
-
-	// pbr: load the HDR environment map
-	// ---------------------------------
-	int width, height, nrComponents;
-	float* data = stbi_loadf(path.generic_string().c_str(), &width, &height, &nrComponents, 0);
-	defer{ stbi_image_free(data); };
-
-	unsigned int hdrTexture;
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
+	upload_cube_level(0, maps->cube);
+	set_cube_parameters(0);
 
-	if (!data) return false;
+	irradiance = maps->irradiance;
 
-	glGenTextures(1, &hdrTexture);
-	glBindTexture(GL_TEXTURE_2D, hdrTexture);
-	// note how we specify the texture's data value to be float
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data);
+	if (!prefilter_id) glGenTextures(1, &prefilter_id);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, prefilter_id);
+	for (size_t i = 0; i < maps->prefilter.size(); ++i) {
+		upload_cube_level((GLint)i, maps->prefilter[i]);
+	}
+	set_cube_parameters((GLint)maps->prefilter.size() - 1);
+	prefilter_size = maps->prefilter.front().size;
+	prefilter_levels = maps->prefilter.size();
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
-	defer{ glDeleteTextures(1, &hdrTexture); };
+	if (!brdf_lut_id) {
+		// Same for every environment, it's shipped with the rest of res/.
+		auto lut = cached_brdf_lut("res/textures/brdf_lut.bin", Brdf_Lut_Kind::Multi_Scatter);
 
-	// pbr: setup cubemap to render to and attach to framebuffer
-	// ---------------------------------------------------------
-	glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
-	for (unsigned int i = 0; i < 6; ++i) {
+		brdf_lut_id = 0;
+		glGenTextures(1, &*brdf_lut_id);
+		glBindTexture(GL_TEXTURE_2D, *brdf_lut_id);
 		glTexImage2D(
-			GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+			GL_TEXTURE_2D,
 			0,
-			GL_RGB16F,
-			Cubemap_Texture_Size.x,
-			Cubemap_Texture_Size.y,
+			GL_RG16F,
+			lut.size,
+			lut.size,
 			0,
-			GL_RGB,
-			GL_FLOAT,
-			nullptr
+			GL_RG,
+			GL_HALF_FLOAT,
+			lut.pixels.data()
 		);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
 	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	// pbr: set up projection and view matrices for capturing data onto the 6 face directions
-	// --------------------------------------------------------------------------------------
-	auto captureProjection = Matrix4f::perspective(PIf / 2, 1, 10, 0.1f);
-	Matrix4f captureViews[] = {
-		Matrix4f::look_at({0.0f, 0.0f, 0.0f}, { 1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f,  0.0f}),
-		Matrix4f::look_at({0.0f, 0.0f, 0.0f}, {-1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f,  0.0f}),
-		Matrix4f::look_at({0.0f, 0.0f, 0.0f}, { 0.0f, -1.0f,  0.0f }, { 0.0f, 0.0f,  1.0f}),
-		Matrix4f::look_at({0.0f, 0.0f, 0.0f}, { 0.0f,  1.0f,  0.0f }, { 0.0f, 0.0f, -1.0f}),
-		Matrix4f::look_at({0.0f, 0.0f, 0.0f}, { 0.0f,  0.0f,  1.0f }, { 0.0f, 1.0f,  0.0f}),
-		Matrix4f::look_at({0.0f, 0.0f, 0.0f}, { 0.0f,  0.0f, -1.0f }, { 0.0f, 1.0f,  0.0f})
-	};
+	return true;
+}
 
-	// pbr: convert HDR equirectangular environment map to cubemap equivalent
-	// ----------------------------------------------------------------------
-	sf::Shader::bind(&equi_to_cube_shader);
-	equi_to_cube_shader.setUniform("equirectangularMap", 0);
-	glUniformMatrix4fv(
-		glGetUniformLocation(equi_to_cube_shader.getNativeHandle(), "projection"),
-		1,
-		GL_FALSE,
-		(float*)& captureProjection
-	);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, hdrTexture);
+std::vector<Cube_Map::Prefilter_Error> Cube_Map::validate_prefilter() noexcept {
+	if (prefilter_levels == 0) return {};
 
-	//don't forget to configure the viewport to the capture dimensions.
-	glViewport(0, 0, Cubemap_Texture_Size.x, Cubemap_Texture_Size.y);
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	
-	auto cube = Object_File::cube({ 2, 2, 2 });
+	std::filesystem::current_path(Base_Working_Directory);
+	if (!AM->have_shader("Prefilter_Cubemap")) {
+		AM->load_shader(
+			"Prefilter_Cubemap", "res/shaders/cubemap.vertex", "res/shaders/prefilter.fragment"
+		);
+	}
+	auto& prefilter_shader = AM->get_shader("Prefilter_Cubemap");
 
-	size_t cubeVAO{0};
-	size_t cubeVBO{0};
+	GLint vp[4];
+	glGetIntegerv(GL_VIEWPORT, vp);
+	defer{ glViewport(vp[0], vp[1], vp[2], vp[3]); };
+
+	GLuint fbo;
+	GLuint reference;
+	GLuint vao;
+	GLuint vbo;
+	glGenFramebuffers(1, &fbo);
+	glGenTextures(1, &reference);
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	defer{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteTextures(1, &reference);
+		glDeleteVertexArrays(1, &vao);
+		glDeleteBuffers(1, &vbo);
+	};
 
-	glGenVertexArrays(1, &cubeVAO);
-	glGenBuffers(1, &cubeVBO);
+	// Same storage as ours.
+	glBindTexture(GL_TEXTURE_CUBE_MAP, reference);
+	for (size_t level = 0; level < prefilter_levels; ++level) {
+		GLsizei size = (GLsizei)std::max(prefilter_size >> level, 1u);
+		for (unsigned int i = 0; i < 6; ++i) {
+			glTexImage2D(
+				GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+				(GLint)level,
+				GL_RGB16F,
+				size,
+				size,
+				0,
+				GL_RGB,
+				GL_FLOAT,
+				nullptr
+			);
+		}
+	}
+	set_cube_parameters((GLint)prefilter_levels - 1);
 
-	glGenVertexArrays(1, &cubeVAO);
-	glGenBuffers(1, &cubeVBO);
-	// fill buffer
-	glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+	auto cube = Object_File::cube({ 2, 2, 2 });
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
 	glBufferData(
 		GL_ARRAY_BUFFER,
 		cube.vertices.size() * sizeof(Vector3f),
 		cube.vertices.data(),
 		GL_STATIC_DRAW
 	);
-	// link vertex attributes
-	glBindVertexArray(cubeVAO);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-	
-	for (unsigned int i = 0; i < 6; ++i) {
-		glUniformMatrix4fv(
-			glGetUniformLocation(equi_to_cube_shader.getNativeHandle(), "view"),
-			1,
-			GL_FALSE,
-			(float*)&captureViews[i]
-		);
-		glFramebufferTexture2D(
-			GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, texture_id, 0
-		);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		glBindVertexArray(cubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-		glBindVertexArray(0);
-	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	// pbr: create an irradiance cubemap, and re-scale capture FBO to irradiance scale.
-	// --------------------------------------------------------------------------------
-	glGenTextures(1, &irradiance_id);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, irradiance_id);
-	for (unsigned int i = 0; i < 6; ++i)
-	{
-		glTexImage2D(
-			GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-			0,
-			GL_RGB16F,
-			Cubemap_Texture_Size.x / 16,
-			Cubemap_Texture_Size.y / 16,
-			0,
-			GL_RGB,
-			GL_FLOAT,
-			nullptr
-		);
-	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-	glRenderbufferStorage(
-		GL_RENDERBUFFER,
-		GL_DEPTH_COMPONENT24,
-		Cubemap_Texture_Size.x / 16,
-		Cubemap_Texture_Size.y / 16
-	);
-
-	// pbr: solve diffuse integral by convolution to create an irradiance (cube)map.
-	// -----------------------------------------------------------------------------
-	sf::Shader::bind(&irradiance_shader);
-	irradiance_shader.setUniform("environmentMap", 0);
-	glUniformMatrix4fv(
-		glGetUniformLocation(irradiance_shader.getNativeHandle(), "projection"),
-		1,
-		GL_FALSE,
-		(float*)&captureProjection
-	);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
 
-	// don't forget to configure the viewport to the capture dimensions.
-	glViewport(0, 0, Cubemap_Texture_Size.x / 16, Cubemap_Texture_Size.y / 16);
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	for (unsigned int i = 0; i < 6; ++i) {
-		glUniformMatrix4fv(
-			glGetUniformLocation(irradiance_shader.getNativeHandle(), "view"),
-			1,
-			GL_FALSE,
-			(float*)& captureViews[i]
-		);
-		glFramebufferTexture2D(
-			GL_FRAMEBUFFER,
-			GL_COLOR_ATTACHMENT0,
-			GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-			irradiance_id,
-			0
-		);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		glBindVertexArray(cubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-		glBindVertexArray(0);
-	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	// pbr: create a pre-filter cubemap, and re-scale capture FBO to pre-filter scale.
-	// --------------------------------------------------------------------------------
-	glGenTextures(1, &prefilter_id);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, prefilter_id);
-	for (unsigned int i = 0; i < 6; ++i) {
-		glTexImage2D(
-			GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-			0,
-			GL_RGB16F,
-			Cubemap_Texture_Size.x / 4,
-			Cubemap_Texture_Size.y / 4,
-			0,
-			GL_RGB,
-			GL_FLOAT,
-			nullptr
-		);
-	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	// be sure to set minifcation filter to mip_linear 
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// generate mipmaps for the cubemap so OpenGL automatically allocates the required memory.
-	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	auto capture_projection = Matrix4f::perspective(PIf / 2, 1, 10, 0.1f);
+	Matrix4f capture_views[] = {
+		Matrix4f::look_at({0.0f, 0.0f, 0.0f}, { 1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f,  0.0f}),
+		Matrix4f::look_at({0.0f, 0.0f, 0.0f}, {-1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f,  0.0f}),
+		Matrix4f::look_at({0.0f, 0.0f, 0.0f}, { 0.0f, -1.0f,  0.0f }, { 0.0f, 0.0f,  1.0f}),
+		Matrix4f::look_at({0.0f, 0.0f, 0.0f}, { 0.0f,  1.0f,  0.0f }, { 0.0f, 0.0f, -1.0f}),
+		Matrix4f::look_at({0.0f, 0.0f, 0.0f}, { 0.0f,  0.0f,  1.0f }, { 0.0f, 1.0f,  0.0f}),
+		Matrix4f::look_at({0.0f, 0.0f, 0.0f}, { 0.0f,  0.0f, -1.0f }, { 0.0f, 1.0f,  0.0f})
+	};
 
-	// pbr: run a quasi monte-carlo simulation on the environment lighting to create a prefilter (cube)map.
-	// ----------------------------------------------------------------------------------------------------
-	auto& prefilter_shader = AM->get_shader("Prefilter_Cubemap");
 	sf::Shader::bind(&prefilter_shader);
 	prefilter_shader.setUniform("environmentMap", 0);
 	glUniformMatrix4fv(
 		glGetUniformLocation(prefilter_shader.getNativeHandle(), "projection"),
 		1,
 		GL_FALSE,
-		(float*)&captureProjection
+		(float*)&capture_projection
 	);
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	for (unsigned int mip = 0; mip < Max_Mip_Levels; ++mip) {
-		// reisze framebuffer according to mip-level size.
-		size_t mipWidth = (size_t)(Cubemap_Texture_Size.x / 4 * std::pow(0.5, mip));
-		size_t mipHeight = (size_t)(Cubemap_Texture_Size.y / 4 * std::pow(0.5, mip));
-		glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
-		glViewport(0, 0, mipWidth, mipHeight);
-
-		float roughness = (float)mip / (float)(Max_Mip_Levels - 1);
-		prefilter_shader.setUniform("roughness", roughness);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	for (size_t level = 0; level < prefilter_levels; ++level) {
+		GLsizei size = (GLsizei)std::max(prefilter_size >> level, 1u);
+		glViewport(0, 0, size, size);
+
+		prefilter_shader.setUniform("roughness", (float)level / (Prefilter_Levels - 1));
 		for (unsigned int i = 0; i < 6; ++i) {
 			glUniformMatrix4fv(
 				glGetUniformLocation(prefilter_shader.getNativeHandle(), "view"),
 				1,
 				GL_FALSE,
-				(float*)&captureViews[i]
+				(float*)&capture_views[i]
 			);
 			glFramebufferTexture2D(
 				GL_FRAMEBUFFER,
 				GL_COLOR_ATTACHMENT0,
 				GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-				prefilter_id,
-				mip
+				reference,
+				(GLint)level
 			);
-
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-			glBindVertexArray(cubeVAO);
+			glClear(GL_COLOR_BUFFER_BIT);
 			glDrawArrays(GL_TRIANGLES, 0, 36);
-			glBindVertexArray(0);
 		}
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	if (!brdf_lut_id) {
-		brdf_lut_id = 0;
-
-		// pbr: generate a 2D LUT from the BRDF equations used.
-		// ----------------------------------------------------
-		glGenTextures(1, &*brdf_lut_id);
-
-		// pre-allocate enough memory for the LUT texture.
-		glBindTexture(GL_TEXTURE_2D, *brdf_lut_id);
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			GL_RG16F,
-			Cubemap_Texture_Size.x,
-			Cubemap_Texture_Size.y,
-			0,
-			GL_RG,
-			GL_FLOAT,
-			0
-		);
-		// be sure to set wrapping mode to GL_CLAMP_TO_EDGE
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindVertexArray(0);
+	sf::Shader::bind(nullptr);
+
+	std::vector<Prefilter_Error> errors;
+	std::vector<float> ours;
+	std::vector<float> theirs;
+	for (size_t level = 0; level < prefilter_levels; ++level) {
+		uint32_t size = std::max(prefilter_size >> level, 1u);
+		ours.resize((size_t)size * size * 3);
+		theirs.resize((size_t)size * size * 3);
+
+		double difference2 = 0;
+		double reference2 = 0;
+		double sum = 0;
+		float max_difference = 0;
+		for (unsigned int i = 0; i < 6; ++i) {
+			glBindTexture(GL_TEXTURE_CUBE_MAP, prefilter_id);
+			glGetTexImage(
+				GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, (GLint)level, GL_RGB, GL_FLOAT, ours.data()
+			);
+			glBindTexture(GL_TEXTURE_CUBE_MAP, reference);
+			glGetTexImage(
+				GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, (GLint)level, GL_RGB, GL_FLOAT, theirs.data()
+			);
 
-		// then re-configure capture framebuffer object and render screen-space quad with BRDF shader.
-		glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-		glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-		glRenderbufferStorage(
-			GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, Cubemap_Texture_Size.x, Cubemap_Texture_Size.y
-		);
-		glFramebufferTexture2D(
-			GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *brdf_lut_id, 0
-		);
+			for (size_t j = 0; j < ours.size(); ++j) {
+				float d = ours[j] - theirs[j];
+				difference2 += d * d;
+				reference2 += theirs[j] * theirs[j];
+				sum += theirs[j];
+				max_difference = std::max(max_difference, std::abs(d));
+			}
+		}
 
-		glViewport(0, 0, Cubemap_Texture_Size.x, Cubemap_Texture_Size.y);
-		sf::Shader::bind(&AM->get_shader("BRDF"));
-		glClearColor(1, 1, 0, 1);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		
-		size_t quadVAO;
-		size_t quadVBO;
-		float quadVertices[] = {
-			// positions        // texture Coords
-			-1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
-			-1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
-				1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
-				1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-		};
-		// setup plane VAO
-		glGenVertexArrays(1, &quadVAO);
-		glGenBuffers(1, &quadVBO);
-		glBindVertexArray(quadVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(
-			1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float))
-		);
-		glBindVertexArray(quadVAO);
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-		glBindVertexArray(0);
+		Prefilter_Error error;
+		error.size = size;
+		error.roughness = (float)level / (Prefilter_Levels - 1);
+		error.relative_rmse = (float)std::sqrt(difference2 / std::max(reference2, 1e-12));
+		error.max_error = (float)(max_difference / std::max(sum / (6 * ours.size()), 1e-12));
+		errors.push_back(error);
 	}
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	return true;
+	return errors;
 }
 
-void Cube_Map::set_textures(const sf::Image data[6]) noexcept {
+void Cube_Map::set_textures(const Cubemap_Faces& faces) noexcept {
 	glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
 
 	for (size_t i = 0; i < 6; ++i) {
-		auto& x = data[i];
 		glTexImage2D(
 			GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
 			0,
 			GL_RGBA,
-			x.getSize().x,
-			x.getSize().y,
+			faces.size,
+			faces.size,
 			0,
 			GL_RGBA,
 			GL_UNSIGNED_BYTE,
-			x.getPixelsPtr()
+			faces.face(i)
 		);
 	}
 
@@ -454,8 +330,8 @@ void Cube_Map::set_name(std::string str) noexcept {
 	name = std::move(str);
 }
 
-[[nodiscard]] size_t Cube_Map::get_irradiance_id() const noexcept {
-	return irradiance_id;
+[[nodiscard]] const Irradiance_SH& Cube_Map::get_irradiance() const noexcept {
+	return irradiance;
 }
 [[nodiscard]] size_t Cube_Map::get_prefilter_id() const noexcept {
 	return prefilter_id;
@@ -5,16 +5,16 @@
 
 #include "Model.hpp"
 
-namespace sf {
-	class Image;
-}
+#include "Files/Environment.hpp"
+
+struct Cubemap_Faces;
 struct Cube_Map : Widget3 {
 
 	Cube_Map() noexcept;
 
 	virtual void last_opengl_render() noexcept override;
 
-	void set_textures(const sf::Image data[6]) noexcept;
+	void set_textures(const Cubemap_Faces& faces) noexcept;
 
 	[[nodiscard]]
 	bool load_texture(std::filesystem::path path) noexcept;
@@ -22,15 +22,32 @@ struct Cube_Map : Widget3 {
 	void set_name(std::string str) noexcept;
 	const std::string& get_name() const noexcept;
 
-	[[nodiscard]] size_t get_irradiance_id() const noexcept;
+	[[nodiscard]] const Irradiance_SH& get_irradiance() const noexcept;
 	[[nodiscard]] size_t get_prefilter_id() const noexcept;
 	[[nodiscard]] size_t get_brdf_lut_id() const noexcept;
+
+	// How far our prefiltered chain is from what the Prefilter_Cubemap shader makes, per level.
+	struct Prefilter_Error {
+		uint32_t size{ 0 };
+		float roughness{ 0 };
+		// sqrt(sum (cpu - gpu)^2 / sum gpu^2), over every channel of every face.
+		float relative_rmse{ 0 };
+		// The largest difference, relative to the average gpu value.
+		float max_error{ 0 };
+	};
+
+	// Debug tool. Renders the chain again with the shader from the same sky, the way load_texture
+	// used to, and reads both back. Empty if we have no prefiltered chain.
+	std::vector<Prefilter_Error> validate_prefilter() noexcept;
 private:
 	Model cube_model;
 
 	size_t texture_id;
-	size_t irradiance_id;
-	size_t prefilter_id;
+	size_t prefilter_id{ 0 };
+	uint32_t prefilter_size{ 0 };
+	size_t prefilter_levels{ 0 };
+	// Zero for the cube maps made of six pngs, they don't light anything.
+	Irradiance_SH irradiance;
 	static std::optional<size_t> brdf_lut_id;
 	std::string name;
 };
@@ -5,13 +5,14 @@
 
 #include "OS/OpenFile.hpp"
 
+#include "Managers/AssetsManager.hpp"
+
 size_t Image::Total_N = 0;
 
-Image::Image(sf::Texture& texture) noexcept {
+Image::Image(const std::string& texture_key) noexcept : texture_key(texture_key) {
 	Total_N++;
 	n = Total_N;
-	sprite.setTexture(texture);
-	image = texture.copyToImage();
+	sprite.setTexture(AM->get_texture(texture_key));
 }
 
 void Image::update(float dt) noexcept {
@@ -21,6 +22,13 @@ void Image::update(float dt) noexcept {
 
 	ImGui::Begin(std::to_string(n).c_str(), &open);
 
+	// The texture of a big import gets sharper under us, it's the same one but bigger.
+	auto& texture = *sprite.getTexture();
+	auto rect = sprite.getTextureRect();
+	if (texture.getSize() != sf::Vector2u{ (unsigned)rect.width, (unsigned)rect.height }) {
+		sprite.setTexture(texture, true);
+	}
+
 	auto window_size = ImGui::GetWindowSize();
 	auto image_size = Vector2f{
 		(float)sprite.getTextureRect().width,
@@ -43,14 +51,17 @@ void Image::update(float dt) noexcept {
 	update_echantillon();
 
 	if (ImGui::Button("Export")) {
-		sf::Image img_to_save = image;
-		open_dir_async([img = std::move(img_to_save)](std::optional<std::filesystem::path> path) {
-			if (!path) return;
-
-			auto n_files = std::filesystem::hard_link_count(*path);
-			auto file_name = *path / ("screenshot_" + std::to_string(n_files) + ".png");
-			img.saveToFile(file_name.generic_string());
-		});
+		// We hold the pixels until they are saved.
+		auto img = AM->get_texture_pixels(texture_key);
+		if (img) {
+			open_dir_async([img](std::optional<std::filesystem::path> path) {
+				if (!path) return;
+
+				auto n_files = std::filesystem::hard_link_count(*path);
+				auto file_name = *path / ("screenshot_" + std::to_string(n_files) + ".png");
+				img->saveToFile(file_name.generic_string());
+			});
+		}
 	}
 
 	ImGui::SetWindowSize({
@@ -92,8 +103,10 @@ void Image::update_echantillon() noexcept {
 void Image::update_histogram() noexcept {
 	if (histogram_type == Histogram_Type::Grey_Scale) {
 		if (!grey_scale_histogram.cached) {
-			grey_scale_histogram.cached = true;
-			grey_scale_histogram.compute(*sprite.getTexture());
+			if (auto pixels = AM->get_texture_pixels(texture_key)) {
+				grey_scale_histogram.cached = true;
+				grey_scale_histogram.compute(*pixels);
+			}
 		}
 		using Data_Type = decltype(grey_scale_histogram.data);
 		ImGui::PlotHistogram(
@@ -115,8 +128,10 @@ void Image::update_histogram() noexcept {
 	}
 	else if (histogram_type == Histogram_Type::RGB) {
 		if (!rgb_scale_histogram.cached) {
-			rgb_scale_histogram.cached = true;
-			rgb_scale_histogram.compute(*sprite.getTexture());
+			if (auto pixels = AM->get_texture_pixels(texture_key)) {
+				rgb_scale_histogram.cached = true;
+				rgb_scale_histogram.compute(*pixels);
+			}
 		}
 
 		// lots of repetition here but i don't feel like making a small abstraction would make
@@ -175,8 +190,7 @@ void Image::update_histogram() noexcept {
 	}
 }
 
-void Image::Grey_Scale_Histogram::compute(const sf::Texture& texture) noexcept {
-	auto image_data = texture.copyToImage();
+void Image::Grey_Scale_Histogram::compute(const sf::Image& image_data) noexcept {
 	auto pixels = image_data.getPixelsPtr();
 
 	data[256] = 0;
@@ -189,8 +203,7 @@ void Image::Grey_Scale_Histogram::compute(const sf::Texture& texture) noexcept {
 	}
 }
 
-void Image::RGB_Histogram::compute(const sf::Texture& texture) noexcept {
-	auto image_data = texture.copyToImage();
+void Image::RGB_Histogram::compute(const sf::Image& image_data) noexcept {
 	auto pixels = image_data.getPixelsPtr();
 
 	// >TODO see if i really need to do that.
@@ -255,13 +268,19 @@ bool Image::is_open() const noexcept {
 size_t Image::get_n() const noexcept {
 	return n;
 }
+const std::string& Image::get_texture_key() const noexcept {
+	return texture_key;
+}
 
 std::optional<Image::Echantillon_Data> Image::get_echantillon() const noexcept {
 	if (!taking_echantillon) return {};
+	auto pixels = AM->get_texture_pixels(texture_key);
+	if (!pixels) return {};
+
 	Echantillon_Data d;
-	d.pos.x = (size_t)(image.getSize().x * (echantillon.pos.x / get_size().x));
-	d.pos.y = (size_t)(image.getSize().y * (echantillon.pos.y / get_size().y));
-	d.pixels = &image;
+	d.pos.x = (size_t)(pixels->getSize().x * (echantillon.pos.x / get_size().x));
+	d.pos.y = (size_t)(pixels->getSize().y * (echantillon.pos.y / get_size().y));
+	d.pixels = std::move(pixels);
 	return d;
 }
 
@@ -1,7 +1,9 @@
 #pragma once
 #include <SFML/Graphics.hpp>
 #include <array>
+#include <memory>
 #include <optional>
+#include <string>
 #include "Widget.hpp"
 
 class Image : public Widget {
@@ -15,14 +17,15 @@ public:
 	struct Echantillon_Data {
 		Vector2u pos{ 0, 0 };
 
-		const sf::Image* pixels{ nullptr };
-		// ^-- carefull this stuff will live only as far a the image live.
+		// Keeps the pixels in the image cache as long as we hold it.
+		std::shared_ptr<const sf::Image> pixels;
 	};
 
 public:
 	static size_t Total_N;
 
-	Image(sf::Texture& texture) noexcept;
+	// texture_key is the key of a texture in the Assets_Manager.
+	Image(const std::string& texture_key) noexcept;
 
 	void update(float dt) noexcept override;
 	void update_histogram() noexcept;
@@ -36,6 +39,7 @@ public:
 	bool is_open() const noexcept;
 
 	size_t get_n() const noexcept;
+	const std::string& get_texture_key() const noexcept;
 
 	std::optional<sf::Sprite> get_echantillon_sprite() const noexcept;
 	std::optional<Echantillon_Data> get_echantillon() const noexcept;
@@ -55,7 +59,7 @@ private:
 		// 256 value and the last one is the max of the previous 256.
 		std::array<size_t, 257> data{};
 
-		void compute(const sf::Texture& texture) noexcept;
+		void compute(const sf::Image& image) noexcept;
 	} grey_scale_histogram;
 	struct RGB_Histogram {
 		bool cached{ false };
@@ -64,12 +68,13 @@ private:
 		std::array<size_t, 257> greens{};
 		std::array<size_t, 257> blues{};
 
-		void compute(const sf::Texture& texture) noexcept;
+		void compute(const sf::Image& image) noexcept;
 	} rgb_scale_histogram;
 
 	bool taking_echantillon{ false };
 	Echantillon_View echantillon;
 
 	sf::Sprite sprite;
-	sf::Image image;
+	// We don't keep our own copy of the pixels, we ask the image cache when we need them.
+	std::string texture_key;
 };
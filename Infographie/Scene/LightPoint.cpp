@@ -6,7 +6,7 @@ decltype(Light_Point::Shader_Index_Map) Light_Point::Shader_Index_Map;
 Light_Point::Light_Point() noexcept : Model(true) {
 	set_selectable(true);
 
-	set_object_copy(Object_File::cube({ 1, 1, 1 }));
+	set_shared_geometry(Shared_Primitive::Unit_Cube, { 1, 1, 1 });
 	set_shader(AM->get_shader("Light_Box"));
 
 	// we get the first free index
@@ -32,19 +32,21 @@ void Light_Point::update(float) noexcept {
 	auto idx = std::to_string(Shader_Index_Map.at(this));
 	auto str = "light_points[" + idx + "].";
 
-	AM->get_shader("Deferred_Light").setUniform(
+	static const auto light_key = AM->shader_key("Deferred_Light");
+	auto& shader_light = AM->get_shader(light_key);
+	shader_light.setUniform(
 		str + "Position", sf::Vector3f{ UNROLL_3(get_global_position3()) }
 	);
-	AM->get_shader("Deferred_Light").setUniform(
+	shader_light.setUniform(
 		str + "Color", sf::Vector3f{ UNROLL_3(light_color) }
 	);
 	// update attenuation parameters and calculate radius
 	// note that we don't send this to the shader, we assume it is always 1.0 (in our case)
 	const float linear = 0.7f;
 	const float quadratic = 1.8f;
-	AM->get_shader("Deferred_Light").setUniform(str + "Linear", linear);
-	AM->get_shader("Deferred_Light").setUniform(str + "Strength", strength);
-	AM->get_shader("Deferred_Light").setUniform(str + "Quadratic", quadratic);
+	shader_light.setUniform(str + "Linear", linear);
+	shader_light.setUniform(str + "Strength", strength);
+	shader_light.setUniform(str + "Quadratic", quadratic);
 }
 
 // We make this is a noop since we render the body of a light in the last opengl render pass.
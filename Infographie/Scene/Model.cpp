@@ -15,6 +15,9 @@
 #include "Managers/AssetsManager.hpp"
 #include "Managers/InputsManager.hpp"
 #include "Math/algorithms.hpp"
+#include "Files/MeshSimplify.hpp"
+#include "Files/Meshlet.hpp"
+#include "Math/Frustum.hpp"
 
 #include "imgui/imgui.h"
 
@@ -36,40 +39,196 @@ Model::Model(bool w) noexcept : without_bounding_box(w) {
 	}
 
 	boundingbox_child = make_child<Model>(true);
-	boundingbox_child->set_object_copy(Object_File::cube(size3));
+	boundingbox_child->set_shared_geometry(Shared_Primitive::Unit_Cube, size3);
 	boundingbox_child->set_texture(AM->get_texture(Plain_Cube_Boundingbox_Texture_Key));
 	boundingbox_child->set_shader(AM->get_shader("Deferred_Simple"));
 	boundingbox_child->set_visible(false);
 }
 
 Model::~Model() noexcept {
-	if (vertex_array_id) {
-		glDeleteBuffers(1, &*vertex_buffer_id);
-		glDeleteBuffers(1, &*uv_buffer_id);
-		glDeleteBuffers(1, &*normal_buffer_id);
-		glDeleteBuffers(1, &*tangent_buffer_id);
-		glDeleteBuffers(1, &*bitangent_buffer_id);
-		glDeleteVertexArrays(1, &*vertex_array_id);
+	delete_buffers();
+}
+
+void Model::delete_buffers() noexcept {
+	for (auto buffer : {
+		&vertex_buffer_id,
+		&uv_buffer_id,
+		&normal_buffer_id,
+		&tangent_buffer_id,
+		&bitangent_buffer_id,
+		&packed_buffer_id,
+		&index_buffer_id
+	}) {
+		if (*buffer) glDeleteBuffers(1, &**buffer);
+		buffer->reset();
 	}
+	if (vertex_array_id) glDeleteVertexArrays(1, &*vertex_array_id);
+	vertex_array_id.reset();
+	index_count = 0;
+	lod_ranges.clear();
+	lod_errors.clear();
+	current_lod = 0;
+	meshlets = nullptr;
+	draw_clusters = false;
+	shared_geometry.reset();
+}
+
+Matrix4f Model::model_matrix() const noexcept {
+	// Shared geometries are unit sized, our size is part of the transform.
+	return
+		Matrix4f::translation(get_global_position3()) *
+		Matrix4f::rotation(rotation3) *
+		Matrix4f::scale(shared_geometry ? scaling.hamilton(size3) : scaling);
+}
+
+void Model::upload_indices(
+	const std::vector<uint32_t>& indices, const std::vector<Object_File::Lod>& lods
+) noexcept {
+	index_count = indices.size();
+	if (indices.empty()) return;
+
+	size_t total = indices.size();
+	for (auto& lod : lods) total += lod.indices.size();
+
+	index_buffer_id = 0;
+	glGenBuffers(1, &*index_buffer_id);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *index_buffer_id);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, total * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+	glBufferSubData(
+		GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(uint32_t), indices.data()
+	);
+	if (lods.empty()) return;
+
+	lod_ranges.push_back({ 0, indices.size() });
+	lod_errors.push_back(0);
+	for (auto& lod : lods) {
+		Lod_Range range;
+		range.offset = lod_ranges.back().offset + lod_ranges.back().count;
+		range.count = lod.indices.size();
+		glBufferSubData(
+			GL_ELEMENT_ARRAY_BUFFER,
+			range.offset * sizeof(uint32_t),
+			range.count * sizeof(uint32_t),
+			lod.indices.data()
+		);
+		lod_ranges.push_back(range);
+		lod_errors.push_back(lod.error);
+	}
+}
+
+void Model::select_lod(Vector3f min, Vector3f max) noexcept {
+	current_lod = 0;
+	if (lod_ranges.size() < 2) return;
+
+	float max_scaling =
+		std::max({ std::fabs(scaling.x), std::fabs(scaling.y), std::fabs(scaling.z) });
+
+	// We don't care about the rotation, we take a sphere around our origin that contains the
+	// bounding box whatever the rotation is.
+	float mesh_radius = (max - min).length() / 2;
+	float radius = ((min + max) / 2).length() * max_scaling + mesh_radius * max_scaling;
+
+	auto camera = Window_Info.active_camera;
+	float dist = (camera->get_global_position3() - get_global_position3()).length() - radius;
+	if (dist <= camera->cam_near) return;
+
+	// proj[1][1] is 1 / tan(fov / 2), it maps the half height of the frustum to 1.
+	// The lod errors are relative to mesh_radius, so that's the one we project, and we take the
+	// closest point of the sphere to stay on the safe side.
+	auto& proj = camera->get_projection_matrix();
+	float screen_radius =
+		mesh_radius * max_scaling * proj[{1, 1}] * (Window_Info.size.y / 2.f) / dist;
+
+	current_lod = ::select_lod(lod_errors, screen_radius);
+}
+
+void Model::cull_meshlets() noexcept {
+	draw_clusters = false;
+	visible_meshlets = meshlets ? meshlets->size() : 0;
+	if (!meshlets || meshlets->empty() || current_lod != 0) return;
+	if (!frustum_culling && !backface_culling) return;
+
+	Matrix4f model = model_matrix();
+	auto camera = Window_Info.active_camera;
+
+	// Everything in model space, the bounds stay as they are.
+	auto frustum = Frustum::from_matrix(
+		camera->get_projection_matrix() * camera->get_view_matrix() * model
+	);
+
+	// Cones don't survive a non uniform scale, the normals don't move like the positions.
+	bool cone = backface_culling &&
+		std::fabs(scaling.x - scaling.y) <= 1e-4f * std::fabs(scaling.x) &&
+		std::fabs(scaling.x - scaling.z) <= 1e-4f * std::fabs(scaling.x);
+	Vector3f viewer;
+	if (cone) {
+		auto inverse = model.invert();
+		cone = inverse.has_value();
+		if (cone) {
+			auto p = camera->get_global_position3();
+			auto v = *inverse * Vector4f{ p.x, p.y, p.z, 1 };
+			viewer = { v.x / v.w, v.y / v.w, v.z / v.w };
+		}
+	}
+
+	cluster_counts.clear();
+	cluster_offsets.clear();
+	visible_meshlets = 0;
+	size_t end = SIZE_MAX;
+	for (auto& m : *meshlets) {
+		if (frustum_culling && frustum.is_outside(m.center, m.radius)) continue;
+		if (cone && is_backfacing(m, viewer)) continue;
+		visible_meshlets++;
+
+		// Neighbours in the index buffer are merged into one draw.
+		size_t offset = 3 * (size_t)m.triangle_offset;
+		size_t count = 3 * (size_t)m.triangle_count;
+		if (offset == end) cluster_counts.back() += (GLsizei)count;
+		else {
+			cluster_counts.push_back((GLsizei)count);
+			cluster_offsets.push_back((const void*)(offset * sizeof(uint32_t)));
+		}
+		end = offset + count;
+	}
+	draw_clusters = true;
+}
+
+void Model::draw() noexcept {
+	if (draw_clusters) {
+		if (cluster_counts.empty()) return;
+		glMultiDrawElements(
+			GL_TRIANGLES,
+			cluster_counts.data(),
+			GL_UNSIGNED_INT,
+			cluster_offsets.data(),
+			(GLsizei)cluster_counts.size()
+		);
+	}
+	else if (!lod_ranges.empty()) {
+		auto& range = lod_ranges[current_lod];
+		glDrawElements(
+			GL_TRIANGLES,
+			(GLsizei)range.count,
+			GL_UNSIGNED_INT,
+			(void*)(range.offset * sizeof(uint32_t))
+		);
+	}
+	else if (index_count) glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, nullptr);
+	else glDrawArrays(GL_TRIANGLES, 0, vertex_count);
 }
 
 void Model::opengl_render() noexcept {
 	if (!visible) return;
-	if (!vertex_array_id) return;
+	if (!vertex_array_id && !shared_geometry) return;
 
-	glBindVertexArray(*vertex_array_id);
+	glBindVertexArray(shared_geometry ? shared_geometry->vertex_array_id : *vertex_array_id);
 	defer{ glBindVertexArray(0); };
 
-	auto& obj_to_use = object_file ? *object_file : object_file_copy;
-
 	if (shader || select_shader) {
 		auto s = shader;
 		if (is_focus() && select_shader) s = select_shader;
 
-		Matrix4f model =
-			Matrix4f::translation(get_global_position3()) *
-			Matrix4f::rotation(rotation3) *
-			Matrix4f::scale(scaling);
+		Matrix4f model = model_matrix();
 		Matrix4f view = Window_Info.active_camera->get_view_matrix();
 		Matrix4f proj = Window_Info.active_camera->get_projection_matrix();
 		Matrix4f view_wo_pos = view;
@@ -108,6 +267,16 @@ void Model::opengl_render() noexcept {
 		glUniform1f(glGetUniformLocation(handle, "ao"), ao);
 		glUniform4fv(glGetUniformLocation(handle, "plain_color"), 1, &plain_color.x);
 
+		Vector3f position_scale{ 1, 1, 1 };
+		Vector3f position_offset{ 0, 0, 0 };
+		if (packed_object_file) {
+			position_scale = packed_object_file->position_scale;
+			position_offset = packed_object_file->position_offset;
+		}
+		glUniform1i(glGetUniformLocation(handle, "packed_vertex"), packed_object_file ? 1 : 0);
+		glUniform3fv(glGetUniformLocation(handle, "position_scale"), 1, &position_scale.x);
+		glUniform3fv(glGetUniformLocation(handle, "position_offset"), 1, &position_offset.x);
+
 		if (s == select_shader) {
 			float a = (get_milliseconds_epoch() % 500000) / 1000.f;
 			glUniform1f(glGetUniformLocation(handle, "time"), a);
@@ -153,6 +322,16 @@ void Model::opengl_render() noexcept {
 		glActiveTexture(GL_TEXTURE0);
 	};
 
+	if (packed_object_file) select_lod(packed_object_file->min, packed_object_file->max);
+	else if (object_file) select_lod(object_file->min, object_file->max);
+	cull_meshlets();
+
+	// The attributes of the packed buffer (and the shared one) are part of the vertex array state.
+	if (packed_buffer_id || shared_geometry) {
+		draw();
+		return;
+	}
+
 	// 1rst attribute buffer : vertices
 	glEnableVertexAttribArray(0);
 	defer{ glDisableVertexAttribArray(0); };
@@ -223,18 +402,12 @@ void Model::opengl_render() noexcept {
 	);
 
 	// Draw the triangle !
-	glDrawArrays(GL_TRIANGLES, 0, obj_to_use.vertices.size());
+	draw();
 }
 
 void Model::set_object(const Object_File& o) noexcept {
-	if (vertex_array_id) {
-		glDeleteBuffers(1, &*vertex_buffer_id);
-		glDeleteBuffers(1, &*uv_buffer_id);
-		glDeleteBuffers(1, &*normal_buffer_id);
-		glDeleteBuffers(1, &*tangent_buffer_id);
-		glDeleteBuffers(1, &*bitangent_buffer_id);
-		glDeleteVertexArrays(1, &*vertex_array_id);
-	}
+	delete_buffers();
+	packed_object_file = nullptr;
 
 	vertex_array_id = 0;
 	uv_buffer_id = 0;
@@ -294,7 +467,11 @@ void Model::set_object(const Object_File& o) noexcept {
 		GL_STATIC_DRAW
 	);
 
+	upload_indices(o.indices, o.lods);
+	meshlets = &o.meshlets;
+
 	object_file = &o;
+	vertex_count = o.vertices.size();
 	set_size(o.max - o.min);
 }
 
@@ -302,14 +479,8 @@ void Model::set_object_copy(const Object_File& obj) noexcept {
 	object_file_copy = obj;
 	auto& o = object_file_copy;
 
-	if (vertex_array_id) {
-		glDeleteBuffers(1, &*vertex_buffer_id);
-		glDeleteBuffers(1, &*uv_buffer_id);
-		glDeleteBuffers(1, &*normal_buffer_id);
-		glDeleteBuffers(1, &*tangent_buffer_id);
-		glDeleteBuffers(1, &*bitangent_buffer_id);
-		glDeleteVertexArrays(1, &*vertex_array_id);
-	}
+	delete_buffers();
+	packed_object_file = nullptr;
 
 	vertex_array_id = 0;
 	uv_buffer_id = 0;
@@ -368,6 +539,78 @@ void Model::set_object_copy(const Object_File& obj) noexcept {
 		o.bitangents.data(),
 		GL_STATIC_DRAW
 	);
+	upload_indices(o.indices);
+
+	vertex_count = o.vertices.size();
+	set_size(o.max - o.min);
+}
+
+void Model::set_shared_geometry(Shared_Primitive primitive, Vector3f size) noexcept {
+	// Before we drop ours, if we were the last one it would be uploaded again for nothing.
+	auto geometry = acquire_geometry(primitive);
+
+	delete_buffers();
+	packed_object_file = nullptr;
+	object_file = nullptr;
+	object_file_copy = {};
+
+	shared_geometry = std::move(geometry);
+	vertex_count = shared_geometry->object.vertices.size();
+	set_size(size);
+}
+
+void Model::set_object(const Packed_Object_File& o) noexcept {
+	delete_buffers();
+
+	vertex_array_id = 0;
+	packed_buffer_id = 0;
+
+	glGenVertexArrays(1, &*vertex_array_id);
+	glBindVertexArray(*vertex_array_id);
+	defer{ glBindVertexArray(0); };
+	defer{ glBindBuffer(GL_ARRAY_BUFFER, 0); };
+
+	glGenBuffers(1, &*packed_buffer_id);
+	glBindBuffer(GL_ARRAY_BUFFER, *packed_buffer_id);
+	glBufferData(GL_ARRAY_BUFFER, o.bytes.size(), o.bytes.data(), GL_STATIC_DRAW);
+
+	for (GLuint i = 0; i < 5; ++i) glEnableVertexAttribArray(i);
+
+	auto attributes = [stride = (GLsizei)o.stride](auto vertex) {
+		using Vertex_T = decltype(vertex);
+		// unorm16 positions land in [0, 1], the shader rescale them with position_scale/offset.
+		glVertexAttribPointer(
+			0,
+			3,
+			std::is_same_v<Vertex_T, Packed_Vertex_Unorm16> ? GL_UNSIGNED_SHORT : GL_FLOAT,
+			std::is_same_v<Vertex_T, Packed_Vertex_Unorm16> ? GL_TRUE : GL_FALSE,
+			stride,
+			(void*)offsetof(Vertex_T, position)
+		);
+		glVertexAttribPointer(
+			1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex_T, uv)
+		);
+		// Octahedral normal and tangent, the shader unfold them.
+		glVertexAttribPointer(
+			2, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(Vertex_T, normal)
+		);
+		glVertexAttribPointer(
+			3, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(Vertex_T, tangent)
+		);
+		// The flags go in the bitangent slot, aBitangent.x is the handedness bit.
+		glVertexAttribPointer(
+			4, 1, GL_UNSIGNED_SHORT, GL_FALSE, stride, (void*)offsetof(Vertex_T, flags)
+		);
+	};
+	if (o.format == Position_Format::Unorm16)	attributes(Packed_Vertex_Unorm16{});
+	else										attributes(Packed_Vertex_Float{});
+
+	upload_indices(o.indices, o.lods);
+	meshlets = &o.meshlets;
+
+	object_file = nullptr;
+	packed_object_file = &o;
+	vertex_count = o.count;
 	set_size(o.max - o.min);
 }
 
@@ -422,10 +665,14 @@ void Model::set_size(Vector3f s) noexcept {
 	size3 = s;
 	picking_sphere_radius = std::powf(3 * s.x * s.y * s.z / (4 * PIf), 1 / 3.f);
 	if (boundingbox_child && !without_bounding_box) {
-		auto& o = (object_file ? *object_file : object_file_copy);
-
-		boundingbox_child->set_object_copy(Object_File::cube(size3));
-		boundingbox_child->set_position((o.min + o.max) / 2);
+		// The shared geometries are centered.
+		Vector3f center;
+		if (packed_object_file) center = (packed_object_file->min + packed_object_file->max) / 2;
+		else if (object_file) center = (object_file->min + object_file->max) / 2;
+		else if (!shared_geometry) center = (object_file_copy.min + object_file_copy.max) / 2;
+
+		boundingbox_child->set_shared_geometry(Shared_Primitive::Unit_Cube, size3);
+		boundingbox_child->set_position(center);
 	}
 }
 
@@ -476,9 +723,9 @@ Model::Picker::Picker() noexcept {
 	yz_plan = std::make_unique<Model>(true);
 	zx_plan = std::make_unique<Model>(true);
 
-	xy_plan->set_object_copy(Object_File::cube({ 1, 1, 0.1f }));
-	yz_plan->set_object_copy(Object_File::cube({ 0.1f, 1, 1 }));
-	zx_plan->set_object_copy(Object_File::cube({ 1, 0.1f, 1 }));
+	xy_plan->set_shared_geometry(Shared_Primitive::Unit_Cube, { 1, 1, 0.1f });
+	yz_plan->set_shared_geometry(Shared_Primitive::Unit_Cube, { 0.1f, 1, 1 });
+	zx_plan->set_shared_geometry(Shared_Primitive::Unit_Cube, { 1, 0.1f, 1 });
 
 	xy_plan->set_texture(AM->get_texture(Plain_Cube_Boundingbox_Texture_Key));
 	yz_plan->set_texture(AM->get_texture(Plain_Cube_Boundingbox_Texture_Key));
@@ -669,3 +916,36 @@ void Model::set_use_plain_color(bool x) noexcept {
 void Model::set_plain_color(Vector4f x) noexcept {
 	plain_color = x;
 }
+
+const Object_File* Model::get_object_file() const noexcept {
+	return object_file;
+}
+const Packed_Object_File* Model::get_packed_object_file() const noexcept {
+	return packed_object_file;
+}
+
+size_t Model::get_lod() const noexcept {
+	return current_lod;
+}
+size_t Model::get_lod_count() const noexcept {
+	return std::max(lod_ranges.size(), (size_t)1);
+}
+
+bool Model::get_frustum_culling() const noexcept {
+	return frustum_culling;
+}
+void Model::set_frustum_culling(bool x) noexcept {
+	frustum_culling = x;
+}
+bool Model::get_backface_culling() const noexcept {
+	return backface_culling;
+}
+void Model::set_backface_culling(bool x) noexcept {
+	backface_culling = x;
+}
+size_t Model::get_meshlet_count() const noexcept {
+	return meshlets ? meshlets->size() : 0;
+}
+size_t Model::get_visible_meshlet_count() const noexcept {
+	return visible_meshlets;
+}
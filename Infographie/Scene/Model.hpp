@@ -6,6 +6,9 @@
 
 #include "Math/Vector.hpp"
 #include "Files/FileFormat.hpp"
+#include "Files/PackedVertex.hpp"
+#include "Graphic/SharedGeometry.hpp"
+#include "Math/Matrix.hpp"
 
 
 #include <optional>
@@ -24,6 +27,10 @@ public:
 
 	void set_object(const Object_File& object_file) noexcept;
 	void set_object_copy(const Object_File& object_file) noexcept;
+	// The packed object needs to outlive the model, like the Object_File one.
+	void set_object(const Packed_Object_File& packed_object_file) noexcept;
+	// One of the shared unit meshes, stretched to size. Cheap, use it for helpers.
+	void set_shared_geometry(Shared_Primitive primitive, Vector3f size) noexcept;
 	void set_texture(const sf::Texture& texture) noexcept;
 	void set_alpha_texture(const sf::Texture& texture) noexcept;
 	void set_normal_texture(const sf::Texture& texture) noexcept;
@@ -35,6 +42,9 @@ public:
 	void set_select_shader(sf::Shader& shader) noexcept;
 
 	const sf::Texture* get_texture() const noexcept;
+	// The one given to set_object, nullptr otherwise.
+	const Object_File* get_object_file() const noexcept;
+	const Packed_Object_File* get_packed_object_file() const noexcept;
 
 	float get_picking_sphere_radius() const noexcept;
 
@@ -63,11 +73,37 @@ public:
 	void set_use_plain_color(bool x) noexcept;
 	void set_plain_color(Vector4f x) noexcept;
 
+	// 0 is the full mesh.
+	size_t get_lod() const noexcept;
+	size_t get_lod_count() const noexcept;
+
+	// Per meshlet culling, only for the full mesh (lod 0).
+	bool get_frustum_culling() const noexcept;
+	void set_frustum_culling(bool x) noexcept;
+	// We don't cull back faces, so this eats the inside of open meshes. Off by default.
+	bool get_backface_culling() const noexcept;
+	void set_backface_culling(bool x) noexcept;
+	size_t get_meshlet_count() const noexcept;
+	size_t get_visible_meshlet_count() const noexcept;
+
 protected:
 	void toggle_picker() noexcept;
 	void push_picker() noexcept;
 	void pop_picker() noexcept;
 
+	void delete_buffers() noexcept;
+	Matrix4f model_matrix() const noexcept;
+	// Needs the vertex array to be bound, the element buffer binding is part of its state.
+	// The lods go after the full mesh in the same buffer.
+	void upload_indices(
+		const std::vector<uint32_t>& indices, const std::vector<Object_File::Lod>& lods = {}
+	) noexcept;
+	// Pick current_lod from the size of our bounding sphere on screen.
+	void select_lod(Vector3f min, Vector3f max) noexcept;
+	// Fill the cluster draw ranges with the meshlets that pass the culling.
+	void cull_meshlets() noexcept;
+	void draw() noexcept;
+
 	float picking_sphere_radius{ 0.f };
 
 	float metallic{ 0.5f };
@@ -96,6 +132,35 @@ protected:
 	// we use a local copy
 	Object_File object_file_copy;
 
+	// When set, everything live in one interleaved buffer (packed_buffer_id) and the vertex array
+	// already knows the layout.
+	const Packed_Object_File* packed_object_file{ nullptr };
+
+	// Not ours, we only hold a reference on it.
+	std::shared_ptr<const Shared_Geometry> shared_geometry;
+
+	size_t vertex_count{ 0 };
+	// 0 when we draw the vertices as a soup.
+	size_t index_count{ 0 };
+
+	struct Lod_Range {
+		size_t offset{ 0 };
+		size_t count{ 0 };
+	};
+	// Empty when there is no lod, else [0] is the full mesh.
+	std::vector<Lod_Range> lod_ranges;
+	std::vector<float> lod_errors;
+	size_t current_lod{ 0 };
+
+	const std::vector<Object_File::Meshlet>* meshlets{ nullptr };
+	bool frustum_culling{ true };
+	bool backface_culling{ false };
+	// When set we draw cluster_counts/cluster_offsets instead of the lod range.
+	bool draw_clusters{ false };
+	size_t visible_meshlets{ 0 };
+	std::vector<GLsizei> cluster_counts;
+	std::vector<const void*> cluster_offsets;
+
 	bool selectable{ true };
 
 	bool render_checkbox{ false };
@@ -107,6 +172,8 @@ protected:
 	std::optional<GLuint> normal_buffer_id;
 	std::optional<GLuint> tangent_buffer_id;
 	std::optional<GLuint> bitangent_buffer_id;
+	std::optional<GLuint> packed_buffer_id;
+	std::optional<GLuint> index_buffer_id;
 
 	Model* boundingbox_child{ nullptr };
 
@@ -184,7 +184,9 @@ Surface::Surface(size_t n_point) noexcept : n_control_points(n_point) {
 
 			control_points.push_back(make_child<Model>());
 			control_points.back()->set_global_position({ s, t, 0.f});
-			control_points.back()->set_object_copy(Object_File::cube({ 0.05f, 0.05f, 0.05f }));
+			control_points.back()->set_shared_geometry(
+				Shared_Primitive::Unit_Cube, { 0.05f, 0.05f, 0.05f }
+			);
 			control_points.back()->set_shader(AM->get_shader("Deferred_Simple"));
 		}
 	}
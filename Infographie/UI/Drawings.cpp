@@ -14,6 +14,7 @@
 #include "Window.hpp"
 
 #include "Managers/AssetsManager.hpp"
+#include "UI/Icons.hpp"
 constexpr auto Image_Button_Border = 1;
 
 void update_drawing_tools(Drawing_Settings& settings) noexcept;
@@ -33,15 +34,11 @@ void update_drawing_settings(Drawing_Settings& settings) noexcept {
 	ImGui::ColorPicker3("Background Color", reinterpret_cast<float*>(&Window_Info.clear_color));
 	ImGui::PopItemWidth();
 
-	auto& pt_texture = AM->get_texture("Primitives_Tool");
-	sf::Vector2f pt_texture_size{ UNROLL_2_P(pt_texture.getSize(), float) };
-	auto& dt_texture = AM->get_texture("Drawings_Tool");
-	sf::Vector2f dt_texture_size{ UNROLL_2_P(dt_texture.getSize(), float) };
-	if (ImGui::ImageButton(pt_texture, pt_texture_size, Image_Button_Border)) {
+	if (icon_button("Primitives_Tool", {}, Image_Button_Border)) {
 		settings.primitive_tools_selected = !settings.primitive_tools_selected;
 	}
 	ImGui::SameLine();
-	if (ImGui::ImageButton(dt_texture, dt_texture_size, Image_Button_Border)) {
+	if (icon_button("Drawings_Tool", {}, Image_Button_Border)) {
 		settings.drawing_tools_selected = !settings.drawing_tools_selected;
 	}
 
@@ -57,7 +54,13 @@ void update_drawing_settings(Drawing_Settings& settings) noexcept {
 		if (auto canvas_widget = (Canvas*)settings.root->find_child(img_widget_id); canvas_widget)
 		{
 			ImGui::PushID(canvas_widget);
-			ImGui::Text("%u", canvas_widget->get_n());
+			// What its painted tiles take, a blank canvas is close to nothing whatever its size.
+			constexpr float Mb = 1024 * 1024;
+			ImGui::Text(
+				"%u (%.1f Mb)",
+				canvas_widget->get_n(),
+				canvas_widget->get_image().allocated_bytes() / Mb
+			);
 			ImGui::NextColumn();
 			if (ImGui::Button(canvas_widget->is_visible() ? "Close" : "Open")) {
 				canvas_widget->set_visible(!canvas_widget->is_visible());
@@ -105,29 +108,19 @@ void update_drawing_tools(Drawing_Settings& settings) noexcept {
 	// code execution, AST manipulation have been released. No public compiler release for now
 	// but if it's half as good as i think i'll be glad.
 
-	auto& dt_circle_texture = AM->get_texture("DT_Circle");
-	sf::Vector2f dt_circle_texture_size{ UNROLL_2_P(dt_circle_texture.getSize(), float) };
-	auto& dt_square_texture = AM->get_texture("DT_Square");
-	sf::Vector2f dt_square_texture_size{ UNROLL_2_P(dt_square_texture.getSize(), float) };
-	auto& dt_fill_texture = AM->get_texture("DT_Fill");
-	sf::Vector2f dt_fill_texture_size{ UNROLL_2_P(dt_fill_texture.getSize(), float) };
-	auto& dt_line_texture = AM->get_texture("DT_Line");
-	sf::Vector2f dt_line_texture_size{ UNROLL_2_P(dt_line_texture.getSize(), float) };
-
-
-	if (ImGui::ImageButton(dt_circle_texture, dt_circle_texture_size, Image_Button_Border)) {
+	if (icon_button("DT_Circle", {}, Image_Button_Border)) {
 		settings.drawing_tool = Drawing_Settings::DT_Circle{};
 	}
 	ImGui::SameLine();
-	if (ImGui::ImageButton(dt_square_texture, dt_square_texture_size, Image_Button_Border)) {
+	if (icon_button("DT_Square", {}, Image_Button_Border)) {
 		settings.drawing_tool = Drawing_Settings::DT_Square{};
 	}
 	ImGui::SameLine();
-	if (ImGui::ImageButton(dt_fill_texture, dt_fill_texture_size, Image_Button_Border)) {
+	if (icon_button("DT_Fill", {}, Image_Button_Border)) {
 		settings.drawing_tool = Drawing_Settings::DT_Fill{};
 	}
 	ImGui::SameLine();
-	if (ImGui::ImageButton(dt_line_texture, dt_line_texture_size, Image_Button_Border)) {
+	if (icon_button("DT_Line", {}, Image_Button_Border)) {
 		settings.drawing_tool = Drawing_Settings::DT_Line{};
 	}
 
@@ -174,34 +167,23 @@ void update_primitive_tools(Drawing_Settings& settings) noexcept {
 	ImGui::Separator();
 	ImGui::Separator();
 
-	auto& pt_polygon_texture = AM->get_texture("PT_Polygon");
-	sf::Vector2f pt_polygon_texture_size{ UNROLL_2_P(pt_polygon_texture.getSize(), float) };
-	auto& pt_arrow_texture = AM->get_texture("PT_Arrow");
-	sf::Vector2f pt_arrow_texture_size{ UNROLL_2_P(pt_arrow_texture.getSize(), float) };
-	auto& pt_circle_texture = AM->get_texture("DT_Circle");
-	sf::Vector2f pt_circle_texture_size{ UNROLL_2_P(pt_circle_texture.getSize(), float) };
-	auto& pt_rect_texture = AM->get_texture("PT_Rect");
-	sf::Vector2f pt_rect_texture_size{ UNROLL_2_P(pt_rect_texture.getSize(), float) };
-	auto& pt_heart_texture = AM->get_texture("PT_Heart");
-	sf::Vector2f pt_heart_texture_size{ UNROLL_2_P(pt_heart_texture.getSize(), float) };
-
-	if (ImGui::ImageButton(pt_polygon_texture, pt_polygon_texture_size, Image_Button_Border)) {
+	if (icon_button("PT_Polygon", {}, Image_Button_Border)) {
 		settings.primitive_tool = Drawing_Settings::PT_Polygon{};
 	}
 	ImGui::SameLine();
-	if (ImGui::ImageButton(pt_arrow_texture, pt_arrow_texture_size, Image_Button_Border)) {
+	if (icon_button("PT_Arrow", {}, Image_Button_Border)) {
 		settings.primitive_tool = Drawing_Settings::PT_Arrow{};
 	}
 	ImGui::SameLine();
-	if (ImGui::ImageButton(pt_circle_texture, pt_circle_texture_size, Image_Button_Border)) {
+	if (icon_button("DT_Circle", {}, Image_Button_Border)) {
 		settings.primitive_tool = Drawing_Settings::PT_Circle{};
 	}
 	ImGui::SameLine();
-	if (ImGui::ImageButton(pt_rect_texture, pt_rect_texture_size, Image_Button_Border)) {
+	if (icon_button("PT_Rect", {}, Image_Button_Border)) {
 		settings.primitive_tool = Drawing_Settings::PT_Rect{};
 	}
 	ImGui::SameLine();
-	if (ImGui::ImageButton(pt_heart_texture, pt_heart_texture_size, Image_Button_Border)) {
+	if (icon_button("PT_Heart", {}, Image_Button_Border)) {
 		settings.primitive_tool = Drawing_Settings::PT_Heart{};
 	}
 	ImGui::Separator();
@@ -12,6 +12,7 @@
 
 #include "Managers/AssetsManager.hpp"
 #include "Managers/InputsManager.hpp"
+#include "UI/Icons.hpp"
 
 #include "Window.hpp"
 
@@ -44,8 +45,28 @@ void update_geometries_settings(Geometries_Settings& settings) noexcept {
 			}
 		});
 	}
+	ImGui::SameLine();
+	ImGui::Checkbox("Compact vertices", &settings.compact_vertices);
+	ImGui::SameLine();
+	ImGui::Checkbox("Smooth tangents", &settings.mesh_pipeline.smooth_tangents);
+	ImGui::SameLine();
+	ImGui::Checkbox("Generate LODs", &settings.mesh_pipeline.generate_lods);
+	ImGui::SameLine();
+	ImGui::Checkbox("Optimize", &settings.mesh_pipeline.optimize);
+	ImGui::SameLine();
+	ImGui::Checkbox("Meshlets", &settings.mesh_pipeline.build_meshlets);
+
+	auto& compression = settings.texture_compression;
+	int tier = compression.enabled ? 1 + (int)compression.quality : 0;
+	ImGui::PushItemWidth(120);
+	const char* tiers = "Off\0Fast (BC1/3)\0Normal (BC1/3)\0High (BC7)\0";
+	if (ImGui::Combo("Texture compression", &tier, tiers)) {
+		compression.enabled = tier > 0;
+		if (tier > 0) compression.quality = (Block_Quality)(tier - 1);
+	}
+	ImGui::PopItemWidth();
 
-	if (ImGui::ImageButton(AM->get_texture("Cube_Icon"), { 20, 20 }, 2)) {
+	if (icon_button("Cube_Icon", { 20, 20 }, 2)) {
 		for (auto& f : settings.spawn_object_callback) {
 			f(Object_File::cube({ 1, 1, 1 }));
 		}
@@ -70,6 +91,22 @@ void update_geometries_settings(Geometries_Settings& settings) noexcept {
 				selected_map[model] = model->is_focus();
 			}
 			ImGui::Text("%u", model->get_n());
+			ImGui::Text("Lod: %zu / %zu", model->get_lod(), model->get_lod_count() - 1);
+			if (model->get_meshlet_count()) {
+				ImGui::Text(
+					"Meshlets: %zu / %zu",
+					model->get_visible_meshlet_count(),
+					model->get_meshlet_count()
+				);
+
+				bool frustum_culling = model->get_frustum_culling();
+				bool backface_culling = model->get_backface_culling();
+				ImGui::Checkbox("Frustum culling", &frustum_culling);
+				ImGui::SameLine();
+				ImGui::Checkbox("Backface culling", &backface_culling);
+				model->set_frustum_culling(frustum_culling);
+				model->set_backface_culling(backface_culling);
+			}
 
 			auto load_texture_lambda = [&](Geometries_Settings::Texture_Type type) {
 				auto c = push_cursor(sf::Cursor::Wait);
@@ -9,6 +9,8 @@
 #include "Scene/Widget.hpp"
 
 #include "Files/FileFormat.hpp"
+#include "Files/MeshPipeline.hpp"
+#include "Files/BlockCompress.hpp"
 
 struct Geometries_Settings {
 	enum class Texture_Type {
@@ -30,6 +32,12 @@ struct Geometries_Settings {
 	std::vector<std::function<void(Uuid_t)>> texture_generated_set_callback;
 	std::vector<std::function<void(const Object_File&)>> spawn_object_callback;
 
+	// Upload loaded models as Packed_Object_File (20 bytes per vertex instead of 56).
+	bool compact_vertices{ true };
+	Mesh_Pipeline_Options mesh_pipeline;
+	// For the textures loaded on a model, see BlockCompress.hpp
+	Block_Options texture_compression{ true, Block_Quality::Normal };
+
 	Widget* root{ nullptr };
 	std::vector<Uuid_t> models_widget_id;
 };
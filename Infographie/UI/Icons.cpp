@@ -0,0 +1,22 @@
+#include "Icons.hpp"
+
+#include <SFML/Graphics.hpp>
+
+#include "imgui/imgui.h"
+#include "imgui/imgui-SFML.h"
+
+#include "Common.hpp"
+#include "Managers/AssetsManager.hpp"
+
+bool icon_button(const std::string& key, sf::Vector2f size, int frame_padding) noexcept {
+	auto icon = AM->get_icon(key);
+	if (!icon) return ImGui::Button(key.c_str());
+
+	if (size.x == 0 || size.y == 0) size = { (float)icon->rect.width, (float)icon->rect.height };
+
+	sf::Sprite sprite{ *icon->texture, icon->rect };
+	ImGui::PushID(key.c_str());
+	bool clicked = ImGui::ImageButton(sprite, size, frame_padding);
+	ImGui::PopID();
+	return clicked;
+}
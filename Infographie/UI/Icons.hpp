@@ -0,0 +1,9 @@
+#pragma once
+#include <string>
+
+#include <SFML/System/Vector2.hpp>
+
+// ImageButton on an icon of an atlas (see Assets_Manager::load_icon_atlas_async), at its size if
+// size is 0. The icons share their texture and ImGui makes the id of an image button from it,
+// so we push the key as the id. Until the atlas is there it's a plain button with the key.
+bool icon_button(const std::string& key, sf::Vector2f size = {}, int frame_padding = -1) noexcept;
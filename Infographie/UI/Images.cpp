@@ -12,18 +12,46 @@
 #include "Managers/AssetsManager.hpp"
 #include "Window.hpp"
 
+#include <algorithm>
+#include <cctype>
+
 Vector3f rgb_to_hsv(Vector3i rgb) noexcept;
 Vector3i hsv_to_rgb(Vector3f hsv) noexcept;
 
+namespace {
+	// What stb_image (so sf::Image) can decode.
+	bool is_image_file(const std::filesystem::path& path) noexcept {
+		constexpr const char* Extensions[] = {
+			".png", ".jpg", ".jpeg", ".bmp", ".tga", ".gif", ".psd", ".hdr"
+		};
+		auto ext = path.extension().string();
+		for (auto& c : ext) c = (char)std::tolower((unsigned char)c);
+		for (auto x : Extensions) if (ext == x) return true;
+		return false;
+	}
+
+	std::vector<std::filesystem::path> list_images(const std::filesystem::path& dir) noexcept {
+		std::vector<std::filesystem::path> paths;
+		std::error_code ec;
+		for (auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+			if (entry.is_regular_file(ec) && is_image_file(entry.path())) {
+				paths.push_back(entry.path());
+			}
+		}
+		std::sort(std::begin(paths), std::end(paths));
+		return paths;
+	}
+};
+
 void update_image_settings(Images_Settings& settings) noexcept {
 	constexpr auto Max_Buffer_Size = 2048;
 	thread_local char buffer[Max_Buffer_Size];
 	std::lock_guard guard{ settings.mutex };
 
-	if (ImGui::Button("Import image")) {
+	if (ImGui::Button("Import images")) {
 		Open_File_Opts opts;
 		opts.allow_redirect_link = false;
-		opts.allow_multiple = false;
+		opts.allow_multiple = true;
 		opts.dialog_title = "Infographie, Import";
 
 		auto c = push_cursor(sf::Cursor::Wait);
@@ -32,9 +60,27 @@ void update_image_settings(Images_Settings& settings) noexcept {
 			std::lock_guard guard{ settings.mutex };
 			if (!result.succeded) return;
 
-			for (auto& x : settings.import_images_callback) x(result.filepath);
+			for (auto& x : settings.import_images_callback) x(result.filepaths);
 		}, opts);
 	}
+	ImGui::SameLine();
+	if (ImGui::Button("Import folder")) {
+		auto c = push_cursor(sf::Cursor::Wait);
+		open_dir_async([&, c](std::optional<std::filesystem::path> dir) {
+			pop_cursor(c);
+			if (!dir) return;
+			// The decoding is done on the workers, listing the folder is all we do here.
+			auto paths = list_images(*dir);
+			std::lock_guard guard{ settings.mutex };
+			if (paths.empty()) {
+				Log.push("No image in " + dir->generic_string());
+				Log.show = true;
+				return;
+			}
+
+			for (auto& x : settings.import_images_callback) x(paths);
+		});
+	}
 
 	if (ImGui::Button("Screenshot")) {
 		if (settings.screenshot_directory.empty()) {
@@ -90,14 +136,41 @@ here it's normalized)_"
 	ImGui::TextColored(imgui_color, "See :D");
 	ImGui::Separator();
 
+	auto& image_cache = AM->get_image_cache();
+	auto cache_stats = image_cache.get_stats();
+	constexpr float Mb = 1024 * 1024;
+	ImGui::Text(
+		"Image cache: %zu images, %.1f / %.1f Mb",
+		cache_stats.resident_count,
+		cache_stats.resident_bytes / Mb,
+		cache_stats.budget_bytes / Mb
+	);
+	ImGui::Text(
+		"Hits: %zu, Misses: %zu, Evictions: %zu",
+		cache_stats.hits,
+		cache_stats.misses,
+		cache_stats.evictions
+	);
+	int budget_mb = (int)(cache_stats.budget_bytes / Mb);
+	if (ImGui::DragInt("Budget (Mb)", &budget_mb, 1, 0, 4096)) {
+		image_cache.set_budget((size_t)budget_mb * 1024 * 1024);
+	}
+	ImGui::Separator();
+
 	if (!settings.root) return;
 
+	constexpr float Thumbnail_Size = 32;
 	ImGui::Columns(2);
 	for (size_t i = settings.images_widget_id.size() - 1; i + 1 > 0; --i) {
 		ImGui::PushID("Images");
 		ImGui::PushID(i);
 		auto& img_widget_id = settings.images_widget_id[i];
 		if (auto img_widget = (Image*)settings.root->find_child(img_widget_id); img_widget) {
+			if (auto thumbnail = AM->get_thumbnail(img_widget->get_texture_key()); thumbnail) {
+				auto size = (sf::Vector2f)thumbnail->getSize();
+				ImGui::Image(*thumbnail, size * (Thumbnail_Size / std::max(size.x, size.y)));
+				ImGui::SameLine();
+			}
 			ImGui::Text("%u", img_widget->get_n());
 			ImGui::NextColumn();
 			if (ImGui::Button(img_widget->is_open() ? "Close" : "Open")) {
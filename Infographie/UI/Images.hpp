@@ -19,7 +19,8 @@ struct Images_Settings {
 	// i'm not using c style function pointer because for one, it's fucking ulgy and for two
 	// i keep a pointer to an instance of Images_Settings (this class) that _I MAKE SURE_
 	// i synchronise it.
-	std::vector<std::function<void(const std::filesystem::path&)>> import_images_callback;
+	// A whole batch at once, a folder or the files selected.
+	std::vector<std::function<void(std::vector<std::filesystem::path>)>> import_images_callback;
 
 	// that we don't care it's not gonna be async... though i might put that thing in another
 	// thread since i fully expect it to take a long time... Humm maybe later
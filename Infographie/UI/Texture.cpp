@@ -1,11 +1,15 @@
 #include "Texture.hpp"
 
+#include <cstdio>
+
 #include "imgui/imgui.h"
 #include "imgui/imgui-SFML.h"
 
 #include "OS/OpenFile.hpp"
 #include "Scene/CubeMap.hpp"
 
+#include "Utils/Logs.hpp"
+
 #include "Window.hpp"
 
 std::pair<std::string, std::string> Texture_Settings::get_shader_path() const noexcept {
@@ -89,6 +93,30 @@ void update_texture_settings(Texture_Settings& settings) noexcept {
 			((Cube_Map*)settings.root->find_child(id))->set_visible(visible);
 			++i;
 		}
+
+		// Our cpu prefilter against the shader we used to have.
+		if (ImGui::Button("Validate prefilter")) {
+			auto id = settings.cubemap_ids[active_cubemap];
+			auto cube_map = (Cube_Map*)settings.root->find_child(id);
+			std::vector<Cube_Map::Prefilter_Error> errors;
+			if (cube_map) errors = cube_map->validate_prefilter();
+			if (errors.empty()) Log.push("No prefiltered chain to validate.");
+
+			for (auto& x : errors) {
+				char line[128];
+				snprintf(
+					line,
+					sizeof(line),
+					"Prefilter %ux%u roughness %.2f: rmse %.2f%%, max %.2f%%",
+					x.size,
+					x.size,
+					x.roughness,
+					x.relative_rmse * 100,
+					x.max_error * 100
+				);
+				Log.push(line);
+			}
+		}
 	}
 
 	ImGui::Separator();
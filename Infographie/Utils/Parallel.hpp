@@ -0,0 +1,38 @@
+#pragma once
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Set on the threads of a Thread_Pool. Their jobs already keep every core busy, a parallel_for
+// starting threads of its own in each of them would make workers squared threads. There it all
+// runs on the calling thread, the fan out is for the tools running a single loop at a time.
+inline thread_local bool parallel_in_pool_worker = false;
+
+// How many workers parallel_for will use for n items.
+inline size_t parallel_worker_count(size_t n, size_t min_per_worker = 1024) noexcept {
+	if (parallel_in_pool_worker) return 1;
+	size_t hardware = std::max((size_t)std::thread::hardware_concurrency(), (size_t)1);
+	return std::clamp(n / std::max(min_per_worker, (size_t)1), (size_t)1, hardware);
+}
+
+// Split [0, n) in contiguous ranges, one per worker, and call f(begin, end, worker) on each.
+// worker is in [0, parallel_worker_count(n, min_per_worker)) so it can index per thread partial
+// results. The calling thread does the first range itself and we block until everything is done.
+template<typename F>
+void parallel_for(size_t n, F&& f, size_t min_per_worker = 1024) noexcept {
+	if (n == 0) return;
+
+	size_t workers = parallel_worker_count(n, min_per_worker);
+	size_t per_worker = (n + workers - 1) / workers;
+
+	std::vector<std::thread> threads;
+	threads.reserve(workers - 1);
+	for (size_t w = 1; w < workers; ++w) {
+		size_t begin = std::min(w * per_worker, n);
+		size_t end = std::min(begin + per_worker, n);
+		threads.emplace_back([&f, begin, end, w] { f(begin, end, w); });
+	}
+
+	f((size_t)0, std::min(per_worker, n), (size_t)0);
+	for (auto& t : threads) t.join();
+}
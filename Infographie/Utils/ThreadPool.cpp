@@ -0,0 +1,51 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+#include "Utils/Parallel.hpp"
+
+Thread_Pool::Thread_Pool(size_t thread_count) noexcept {
+	if (thread_count == 0) {
+		thread_count = std::max((size_t)std::thread::hardware_concurrency(), (size_t)1);
+	}
+
+	threads.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; ++i) threads.emplace_back([this] { worker(); });
+}
+
+Thread_Pool::~Thread_Pool() noexcept {
+	{
+		std::lock_guard guard{ mutex };
+		stopping = true;
+	}
+	wake_up.notify_all();
+	for (auto& t : threads) t.join();
+}
+
+void Thread_Pool::push(std::function<void()> job) noexcept {
+	{
+		std::lock_guard guard{ mutex };
+		jobs.push(std::move(job));
+	}
+	wake_up.notify_one();
+}
+
+size_t Thread_Pool::size() const noexcept {
+	return threads.size();
+}
+
+void Thread_Pool::worker() noexcept {
+	parallel_in_pool_worker = true;
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock lock{ mutex };
+			wake_up.wait(lock, [&] { return stopping || !jobs.empty(); });
+			if (jobs.empty()) return;
+
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+		job();
+	}
+}
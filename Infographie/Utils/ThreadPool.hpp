@@ -0,0 +1,34 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads eating a FIFO of jobs, for the long lived background work.
+// parallel_for is still the way to go for a one shot loop over an array, inside a job it runs
+// on the worker alone (see parallel_in_pool_worker).
+// The jobs still queued when the pool is destroyed are run before the threads are joined.
+class Thread_Pool {
+public:
+	// 0 means one thread per hardware thread.
+	explicit Thread_Pool(size_t thread_count = 0) noexcept;
+	~Thread_Pool() noexcept;
+
+	Thread_Pool(const Thread_Pool&) = delete;
+	Thread_Pool& operator=(const Thread_Pool&) = delete;
+
+	void push(std::function<void()> job) noexcept;
+	size_t size() const noexcept;
+
+private:
+	void worker() noexcept;
+
+	std::mutex mutex;
+	std::condition_variable wake_up;
+	std::queue<std::function<void()>> jobs;
+	bool stopping{ false };
+
+	std::vector<std::thread> threads;
+};
@@ -0,0 +1,114 @@
+#include "Timeline.hpp"
+
+#include <algorithm>
+
+namespace {
+	constexpr size_t Bar_Width = 48;
+
+	double to_ms(std::chrono::steady_clock::duration d) noexcept {
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+};
+
+Timeline::Timeline() noexcept {
+	origin = Clock::now();
+	threads.push_back(std::this_thread::get_id());
+}
+
+size_t Timeline::begin(std::string name, std::vector<size_t> after) noexcept {
+	auto now = Clock::now();
+	auto id = std::this_thread::get_id();
+
+	std::lock_guard guard{ mutex };
+	auto it = std::find(std::begin(threads), std::end(threads), id);
+	if (it == std::end(threads)) it = threads.insert(std::end(threads), id);
+
+	Span span;
+	span.name = std::move(name);
+	span.thread = (size_t)(it - std::begin(threads));
+	span.begin = now;
+	span.after = std::move(after);
+	spans.push_back(std::move(span));
+	return spans.size() - 1;
+}
+
+void Timeline::end(size_t span) noexcept {
+	auto now = Clock::now();
+
+	std::lock_guard guard{ mutex };
+	if (span >= spans.size()) return;
+	spans[span].end = now;
+	spans[span].ended = true;
+}
+
+void Timeline::print(FILE* out) noexcept {
+	std::lock_guard guard{ mutex };
+
+	double wall = 0;
+	double sum = 0;
+	for (auto& span : spans) {
+		if (!span.ended) continue;
+		wall = std::max(wall, to_ms(span.end - origin));
+		sum += to_ms(span.end - span.begin);
+	}
+	if (wall <= 0) return;
+
+	// A span begins after the ones it waits for ended, so they are before it in spans and one
+	// pass in order is enough. chain is the longest we can make ending with that span.
+	std::vector<double> chain(spans.size(), 0);
+	std::vector<size_t> previous(spans.size(), None);
+	size_t last = None;
+	for (size_t i = 0; i < spans.size(); ++i) {
+		if (!spans[i].ended) continue;
+
+		for (auto a : spans[i].after) {
+			if (a >= i || !spans[a].ended || chain[a] <= chain[i]) continue;
+			chain[i] = chain[a];
+			previous[i] = a;
+		}
+		chain[i] += to_ms(spans[i].end - spans[i].begin);
+		if (last == None || chain[i] > chain[last]) last = i;
+	}
+
+	fprintf(
+		out,
+		"Startup in %.1f ms, %.1f ms of work on %zu threads, %.1f ms of critical path\n",
+		wall,
+		sum,
+		threads.size(),
+		chain[last]
+	);
+	fprintf(out, "%8s %8s  %2s\n", "begin", "ms", "th");
+	for (auto& span : spans) {
+		if (!span.ended) continue;
+
+		double begin = to_ms(span.begin - origin);
+		double end = to_ms(span.end - origin);
+		char bar[Bar_Width + 1];
+		for (size_t i = 0; i < Bar_Width; ++i) {
+			// A column is drawn if the span covers any of it, so even the short ones show up.
+			double from = wall * i / Bar_Width;
+			double to = wall * (i + 1) / Bar_Width;
+			bar[i] = begin < to && end >= from ? '#' : ' ';
+		}
+		bar[Bar_Width] = '\0';
+
+		fprintf(
+			out,
+			"%8.1f %8.1f  %2zu |%s| %s\n",
+			begin,
+			end - begin,
+			span.thread,
+			bar,
+			span.name.c_str()
+		);
+	}
+
+	std::vector<size_t> path;
+	for (auto i = last; i != None; i = previous[i]) path.push_back(i);
+	fprintf(out, "Critical path:");
+	for (auto it = path.rbegin(); it != path.rend(); ++it) {
+		fprintf(out, "%s %s", it == path.rbegin() ? "" : " >", spans[*it].name.c_str());
+	}
+	fprintf(out, "\n");
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// What ran when and on which thread, and what it had to wait for. We record the startup in one
+// (the window on the main thread, the asset jobs on the workers) to see that it's as long as
+// its critical path and not as the sum of everything.
+// Any thread can begin and end spans.
+class Timeline {
+public:
+	static constexpr size_t None = (size_t)-1;
+
+	Timeline() noexcept;
+
+	// after are the spans that had to end before this one could begin, that's what the critical
+	// path follows. The span is on the calling thread.
+	size_t begin(std::string name, std::vector<size_t> after = {}) noexcept;
+	void end(size_t span) noexcept;
+
+	// A line per span in the order they began, with a bar of when it ran, then the longest
+	// chain of spans through the after. The spans still open are left out.
+	void print(FILE* out = stdout) noexcept;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Span {
+		std::string name;
+		size_t thread{ 0 };
+		Clock::time_point begin;
+		Clock::time_point end;
+		bool ended{ false };
+		std::vector<size_t> after;
+	};
+
+	std::mutex mutex;
+	Clock::time_point origin;
+	std::vector<Span> spans;
+	// The index in there is the lane, the one making the timeline is the first.
+	std::vector<std::thread::id> threads;
+};